@@ -0,0 +1,267 @@
+/*
+  batch.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+/*
+  Batch conversion of .y4m/.yuv files without read()/write() copies.
+
+  The input file is mapped with MADV_SEQUENTIAL and the kernels run on the
+  mapped rows directly (libyv12to422 in unaligned mode). The output is
+    - a preallocated file mapped with MAP_SHARED. The kernels write into
+      the mapping, only the luma of yv16 is copied (memcpy).
+    - or a pipe on stdout. Frames are handed to the pipe with vmsplice():
+      the luma of yv16 is spliced straight from the input mapping, the
+      converted planes from a ring of buffers. A buffer is not reused
+      until more than the pipe capacity has been spliced after it, so the
+      reader of the pipe has consumed it by then.
+    - or any other stdout, through writev().
+
+  --io uring|threads reads and writes the files instead (batch_async.cpp).
+*/
+
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "batch.h"
+#include "batch_common.h"
+#include "io_engine.h"
+
+#if defined(__linux__)
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+
+static void convert_to_file(const options& opt, const char* path,
+                            engine_table& engines, copy_stats& stats)
+{
+    file_job job;
+    open_file_job(opt, path, engines, job);
+    scratch_buffer scratch(yv12to422_scratch_size(job.ctx));
+    convert_frames(job, 0, job.in.frames.size(), scratch.data);
+    add_stats(job, stats);
+}
+
+
+// vmsplice() to a pipe, writev() to anything else.
+class stdout_writer {
+    int fd;
+    bool pipe;
+    size_t capacity;
+    std::vector<std::unique_ptr<page_buffer>> ring;
+    size_t ring_pos;
+    std::unique_ptr<page_buffer> header;
+
+public:
+    size_t copied;
+
+    stdout_writer() : fd(STDOUT_FILENO), capacity(0), ring_pos(0), copied(0)
+    {
+        struct stat st;
+        pipe = fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode);
+        if (pipe) {
+            // a larger pipe lets the reader run further behind us.
+            fcntl(fd, F_SETPIPE_SZ, 1 << 20);
+            int size = fcntl(fd, F_GETPIPE_SZ);
+            capacity = size > 0 ? size : 1 << 16;
+        }
+    }
+
+    // buffers for converted planes. every one of them stays untouched while
+    // the pipe may still hold its pages.
+    void set_chunk_size(size_t size)
+    {
+        if (!ring.empty() && size <= ring[0]->size) {
+            return;
+        }
+        ring.clear();
+        ring_pos = 0;
+        const size_t num = pipe ? capacity / size + 2 : 1;
+        for (size_t i = 0; i < num; ++i) {
+            ring.emplace_back(new page_buffer(size));
+        }
+    }
+
+    void put_header(const std::string& h)
+    {
+        header.reset(new page_buffer(h.size()));
+        memcpy(header->data, h.data(), h.size());
+        struct iovec iov = { header->data, h.size() };
+        put(&iov, 1);
+    }
+
+    uint8_t* next_chunk()
+    {
+        uint8_t* p = ring[ring_pos]->data;
+        ring_pos = (ring_pos + 1) % ring.size();
+        return p;
+    }
+
+    void put(struct iovec* iov, int count)
+    {
+        while (count > 0) {
+            ssize_t n = pipe ? vmsplice(fd, iov, count, 0) : writev(fd, iov, count);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw sys_error("failed to write", "stdout");
+            }
+            if (!pipe) {
+                copied += n;
+            }
+            while (count > 0 && (size_t)n >= iov->iov_len) {
+                n -= iov->iov_len;
+                ++iov;
+                --count;
+            }
+            if (count > 0) {
+                iov->iov_base = (uint8_t*)iov->iov_base + n;
+                iov->iov_len -= n;
+            }
+        }
+    }
+};
+
+
+static void convert_to_stdout(const options& opt, const mapped_file& src,
+                              const input_stream& in, bool first,
+                              engine_table& engines, stdout_writer& writer,
+                              copy_stats& stats)
+{
+    const yv12to422_t& ctx = engines.get(opt, in);
+    const bool yuy2 = opt.yuy2 != 0;
+
+    const size_t frame_size = output_frame_size(in.header, yuy2);
+    const size_t luma_size = (size_t)in.header.width * in.header.height;
+    const size_t chunk_size = yuy2 ? frame_size : frame_size - luma_size;
+    writer.set_chunk_size(chunk_size);
+
+    scratch_buffer scratch(yv12to422_scratch_size(&ctx));
+    const size_t copied = writer.copied;
+
+    if (in.y4m && first) {
+        writer.put_header(y4m_format_header(get_output_header(opt, in.header)));
+    }
+
+    for (size_t offset : in.frames) {
+        uint8_t* chunk = writer.next_chunk();
+        yv12to422_src_t s;
+        yv12to422_dst_t d;
+        set_planes(ctx.params, src.data + offset, chunk, chunk, s, d);
+        if (!yuy2) {
+            d.data[0] = nullptr;    // luma goes to the pipe from the input mapping
+        }
+        convert(ctx, s, d, scratch.data);
+
+        struct iovec iov[3];
+        int count = 0;
+        if (in.y4m) {
+            iov[count++] = { (void*)FRAME_HEADER, FRAME_HEADER_SIZE };
+        }
+        if (!yuy2) {
+            iov[count++] = { (void*)(src.data + offset), luma_size };
+        }
+        iov[count++] = { chunk, chunk_size };
+        writer.put(iov, count);
+    }
+
+    stats.frames += in.frames.size();
+    stats.copied += writer.copied - copied;
+    stats.read_write += input_bytes(in) + in.frames.size() * (frame_size + (in.y4m ? FRAME_HEADER_SIZE : 0));
+}
+
+
+int run_batch(const options& opt)
+{
+    if (opt.jobs > 1) {
+        return run_batch_parallel(opt);
+    }
+
+    const bool to_stdout = strcmp(opt.output, "-") == 0;
+    std::unique_ptr<stdout_writer> writer;
+    if (to_stdout) {
+        writer.reset(new stdout_writer());
+    }
+
+    std::unique_ptr<io_engine> io;
+    if (opt.io == IO_URING) {
+        io = create_uring_engine(opt.queue_depth);
+        if (!io) {
+            fprintf(stderr, "io_uring is not available. using --io threads.\n");
+        }
+    }
+    if (opt.io != IO_MMAP && !io) {
+        io = create_thread_engine(opt.io_threads);
+    }
+
+    engine_table engines;
+    bool y4m_written = false;
+    for (const char* path : opt.inputs) {
+        copy_stats stats;
+        if (io) {
+            convert_file_async(opt, path, *io, engines, stats);
+            print_stats(path, stats);
+            continue;
+        }
+        if (!to_stdout) {
+            convert_to_file(opt, path, engines, stats);
+            print_stats(path, stats);
+            continue;
+        }
+
+        mapped_file src;
+        input_stream in;
+        map_input(path, src);
+        index_input(opt, path, src.size,
+                    [&](size_t pos, size_t) { return src.data + pos; }, in);
+        if (in.y4m && y4m_written) {
+            throw std::runtime_error("only one y4m input can be written to stdout.");
+        }
+        convert_to_stdout(opt, src, in, !y4m_written, engines, *writer, stats);
+        y4m_written = y4m_written || in.y4m;
+        print_stats(path, stats);
+    }
+    return 0;
+}
+
+#else
+
+int run_batch(const options&)
+{
+    throw std::runtime_error("batch mode is available only on Linux.");
+}
+
+#endif
@@ -0,0 +1,42 @@
+/*
+  batch.h
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+
+#ifndef YV12TO422_CLI_BATCH_H
+#define YV12TO422_CLI_BATCH_H
+
+#include "options.h"
+
+// converts every opt.inputs through mmap, or through the opt.io engine.
+// throws std::runtime_error.
+int run_batch(const options& opt);
+
+// concatenates the shard outputs opt.inputs into opt.output. (merge.cpp)
+int run_merge(const options& opt);
+
+// the throughput of narrow frames with and without narrow mode. (bench.cpp)
+int run_bench(const options& opt);
+
+#endif
@@ -0,0 +1,305 @@
+/*
+  batch_async.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+
+/*
+  Batch conversion with asynchronous reads/writes (--io uring|threads).
+
+  Every file gets queue_depth slots, each holding one input frame and one
+  output record. A slot reads its frame, is converted on this thread when
+  the read completes, writes the record to its fixed offset in the output
+  file and then reads the next frame. So several reads and writes of one
+  file are in flight while a frame is converted.
+
+  The input is opened with O_DIRECT when the file system allows it. A frame
+  is then read as the block aligned range which covers it and the kernels
+  run on the frame where it starts in the buffer (unaligned mode). The
+  output uses O_DIRECT only when every record is a whole number of blocks
+  (raw output of suitable sizes), otherwise it goes through the page cache
+  into a preallocated file.
+*/
+
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "batch_common.h"
+#include "io_engine.h"
+
+#if defined(__linux__)
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+static const size_t BLOCK = 4096;
+
+
+static inline size_t align_block(size_t n)
+{
+    return (n + BLOCK - 1) & ~(BLOCK - 1);
+}
+
+
+struct scoped_fd {
+    int fd = -1;
+
+    ~scoped_fd()
+    {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+};
+
+
+struct slot {
+    uint8_t* in;
+    uint8_t* out;
+    size_t frame;       // index in input_stream::frames
+    size_t lead;        // offset of the frame in in
+    size_t need;        // bytes of in which have to be read
+    size_t len;         // bytes of the current request
+    size_t done;        // bytes of it transferred so far
+    off_t offset;       // file offset of the current request
+};
+
+
+static const uint8_t* peek_file(int fd, const char* path, size_t pos,
+                                size_t size, std::vector<uint8_t>& buf)
+{
+    buf.resize(size);
+    size_t got = 0;
+    while (got < size) {
+        ssize_t n = pread(fd, buf.data() + got, size - got, pos + got);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw sys_error("failed to read", path);
+        }
+        got += n;
+    }
+    return buf.data();
+}
+
+
+static void create_output(const char* path, size_t size, bool& direct,
+                          scoped_fd& f)
+{
+    f.fd = -1;
+    if (direct) {
+        f.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+        direct = f.fd >= 0;
+    }
+    if (f.fd < 0) {
+        f.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    if (f.fd < 0) {
+        throw sys_error("failed to create", path);
+    }
+    if (ftruncate(f.fd, size) < 0) {
+        throw sys_error("failed to resize", path);
+    }
+    int err = posix_fallocate(f.fd, 0, size);
+    if (err == ENOSPC) {
+        errno = err;
+        throw sys_error("failed to allocate", path);
+    }
+}
+
+
+void convert_file_async(const options& opt, const char* path, io_engine& io,
+                        engine_table& engines, copy_stats& stats)
+{
+    scoped_fd src;
+    src.fd = open(path, O_RDONLY);
+    if (src.fd < 0) {
+        throw sys_error("failed to open", path);
+    }
+    struct stat st;
+    if (fstat(src.fd, &st) < 0) {
+        throw sys_error("failed to stat", path);
+    }
+    if (st.st_size == 0) {
+        throw std::runtime_error(std::string(path) + " is empty.");
+    }
+    const size_t file_size = st.st_size;
+    posix_fadvise(src.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    input_stream in;
+    std::vector<uint8_t> peek_buf;
+    index_input(opt, path, file_size, [&](size_t pos, size_t size) {
+        return peek_file(src.fd, path, pos, size, peek_buf);
+    }, in);
+
+    // the buffered descriptor stays for indexing only if O_DIRECT works.
+    scoped_fd direct;
+    direct.fd = open(path, O_RDONLY | O_DIRECT);
+    const bool direct_in = direct.fd >= 0;
+    const int in_fd = direct_in ? direct.fd : src.fd;
+
+    const yv12to422_t& ctx = engines.get(opt, in);
+    const bool yuy2 = opt.yuy2 != 0;
+
+    const std::string header = in.y4m ? y4m_format_header(get_output_header(opt, in.header)) : "";
+    const size_t frame_header = in.y4m ? FRAME_HEADER_SIZE : 0;
+    const size_t in_size = input_frame_size(in.header);
+    const size_t frame_size = output_frame_size(in.header, yuy2);
+    const size_t record = frame_header + frame_size;
+    const size_t luma_size = (size_t)in.header.width * in.header.height;
+    const size_t num_frames = in.frames.size();
+
+    std::string out_path = output_path(opt, path, in.y4m);
+    bool direct_out = header.empty() && record % BLOCK == 0;
+    scoped_fd dst;
+    create_output(out_path.c_str(), header.size() + num_frames * record, direct_out, dst);
+    if (!header.empty() && pwrite(dst.fd, header.data(), header.size(), 0) != (ssize_t)header.size()) {
+        throw sys_error("failed to write", out_path.c_str());
+    }
+
+    // a frame read with O_DIRECT starts anywhere in the first block.
+    const size_t in_buf_size = align_block(in_size) + (direct_in ? BLOCK : 0);
+    const size_t out_buf_size = align_block(record);
+    const size_t depth = std::min((size_t)opt.queue_depth, num_frames);
+    page_buffer buffers(depth * (in_buf_size + out_buf_size));
+
+    std::vector<slot> slots(depth);
+    std::vector<struct iovec> iov;
+    for (size_t i = 0; i < depth; ++i) {
+        slots[i].in = buffers.data + i * (in_buf_size + out_buf_size);
+        slots[i].out = slots[i].in + in_buf_size;
+        iov.push_back({ slots[i].in, in_buf_size });    // buf_index 2 * i
+        iov.push_back({ slots[i].out, out_buf_size });  // buf_index 2 * i + 1
+    }
+    io.register_buffers(iov);
+
+    scratch_buffer scratch(yv12to422_scratch_size(&ctx));
+
+    // tag: slot * 2 + write
+    auto queue = [&](size_t i, bool write) {
+        slot& s = slots[i];
+        io_request req;
+        req.fd = write ? dst.fd : in_fd;
+        req.write = write;
+        req.buf = (write ? s.out : s.in) + s.done;
+        req.len = s.len - s.done;
+        req.offset = s.offset + s.done;
+        req.buf_index = (int)(i * 2 + write);
+        req.tag = i * 2 + write;
+        io.queue(req);
+    };
+
+    auto start_read = [&](size_t i, size_t k) {
+        slot& s = slots[i];
+        const size_t pos = in.frames[k];
+        const size_t start = direct_in ? pos & ~(BLOCK - 1) : pos;
+        s.frame = k;
+        s.lead = pos - start;
+        s.need = s.lead + in_size;
+        s.len = direct_in ? align_block(s.need) : s.need;
+        s.done = 0;
+        s.offset = start;
+        queue(i, false);
+    };
+
+    auto start_write = [&](size_t i) {
+        slot& s = slots[i];
+        memcpy(s.out, FRAME_HEADER, frame_header);
+        yv12to422_src_t sp;
+        yv12to422_dst_t dp;
+        set_planes(ctx.params, s.in + s.lead, s.out + frame_header,
+                   s.out + frame_header + luma_size, sp, dp);
+        convert(ctx, sp, dp, scratch.data);
+
+        s.len = record;
+        s.done = 0;
+        s.offset = header.size() + s.frame * record;
+        queue(i, true);
+    };
+
+    size_t next = 0;
+    for (size_t i = 0; i < depth; ++i) {
+        start_read(i, next++);
+    }
+
+    size_t written = 0;
+    std::vector<io_completion> done;
+    while (written < num_frames) {
+        done.clear();
+        io.wait(done);
+        for (const auto& c : done) {
+            const size_t i = c.tag / 2;
+            const bool write = (c.tag & 1) != 0;
+            slot& s = slots[i];
+            if (c.result < 0) {
+                errno = (int)-c.result;
+                throw sys_error(write ? "failed to write" : "failed to read",
+                                write ? out_path.c_str() : path);
+            }
+            s.done += c.result;
+
+            if (!write) {
+                // O_DIRECT reads end at the end of the file, short of len.
+                if (s.done >= s.need) {
+                    start_write(i);
+                } else if (c.result == 0) {
+                    throw std::runtime_error(std::string(path) + ": unexpected end of file.");
+                } else {
+                    queue(i, false);
+                }
+                continue;
+            }
+
+            if (s.done < s.len) {
+                if (c.result == 0) {
+                    throw std::runtime_error("failed to write " + out_path);
+                }
+                queue(i, true);
+                continue;
+            }
+            ++written;
+            if (next < num_frames) {
+                start_read(i, next++);
+            }
+        }
+        io.submit();
+    }
+    io.register_buffers({});
+
+    stats.frames += num_frames;
+    stats.copied += header.size() + num_frames * (frame_header + (yuy2 ? 0 : luma_size));
+    stats.copied += direct_in ? 0 : num_frames * in_size;
+    stats.copied += direct_out ? 0 : num_frames * record;
+    stats.read_write += input_bytes(in) + header.size() + num_frames * record;
+}
+
+#endif
@@ -0,0 +1,367 @@
+/*
+  batch_common.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include "batch_common.h"
+
+#if defined(__linux__)
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+
+std::runtime_error sys_error(const std::string& msg, const char* path)
+{
+    return std::runtime_error(msg + " " + path + ": " + strerror(errno));
+}
+
+
+size_t input_frame_size(const y4m_header& h)
+{
+    return (size_t)h.width * h.height + (size_t)(h.width / 2) * (h.height / 2) * 2;
+}
+
+
+size_t output_frame_size(const y4m_header& h, bool yuy2)
+{
+    return yuy2 ? (size_t)h.width * 2 * h.height :
+                  (size_t)h.width * h.height + (size_t)(h.width / 2) * h.height * 2;
+}
+
+
+size_t input_bytes(const input_stream& in)
+{
+    return in.header_size + in.frames.size() * ((in.y4m ? FRAME_HEADER_SIZE : 0) +
+                                                input_frame_size(in.header));
+}
+
+
+// frames [first, end) of num for the shard of opt.
+static void shard_range(const options& opt, size_t num, size_t& first, size_t& end)
+{
+    first = num * opt.shard / opt.shards;
+    end = num * (opt.shard + 1) / opt.shards;
+}
+
+
+// usually every frame header is a bare "FRAME\n". then the frames are at a
+// fixed stride, and the range of the shard is found without reading the
+// frames before it. the headers of the range are still checked.
+static bool index_fixed_stride(const options& opt, size_t file_size,
+                               size_t data_start, const peek_func& peek,
+                               input_stream& in)
+{
+    const size_t stride = FRAME_HEADER_SIZE + input_frame_size(in.header);
+    const size_t body = file_size - data_start;
+    if (body % stride != 0) {
+        return false;
+    }
+    size_t first, end;
+    shard_range(opt, body / stride, first, end);
+    for (size_t k = first; k < end; ++k) {
+        const size_t pos = data_start + k * stride;
+        if (memcmp(peek(pos, FRAME_HEADER_SIZE), FRAME_HEADER, FRAME_HEADER_SIZE) != 0) {
+            in.frames.clear();
+            return false;
+        }
+        in.frames.push_back(pos + FRAME_HEADER_SIZE);
+    }
+    in.first_frame = first;
+    in.total_frames = body / stride;
+    return true;
+}
+
+
+void index_input(const options& opt, const char* path, size_t file_size,
+                 const peek_func& peek, input_stream& in)
+{
+    in.frames.clear();
+
+    size_t len = std::min(file_size, MAX_HEADER);
+    const uint8_t* p = peek(0, len);
+    if (len > 10 && memcmp(p, "YUV4MPEG2 ", 10) == 0) {
+        auto eol = (const uint8_t*)memchr(p, '\n', len);
+        if (!eol) {
+            throw std::runtime_error("y4m: header line is too long.");
+        }
+        y4m_parse_header(std::string((const char*)p, eol - p), in.header);
+        in.y4m = true;
+        if (y4m_bit_depth(in.header) > 8) {
+            throw std::runtime_error(std::string(path) + ": batch mode takes only 8bit input.");
+        }
+
+        size_t pos = eol - p + 1;
+        in.header_size = pos;
+        if (index_fixed_stride(opt, file_size, pos, peek, in)) {
+            return;
+        }
+
+        const size_t frame_size = input_frame_size(in.header);
+        while (pos < file_size) {
+            len = std::min(file_size - pos, MAX_HEADER);
+            p = peek(pos, len);
+            if (len < FRAME_HEADER_SIZE || memcmp(p, "FRAME", 5) != 0) {
+                throw std::runtime_error("y4m: broken frame header.");
+            }
+            eol = (const uint8_t*)memchr(p, '\n', len);
+            if (!eol) {
+                throw std::runtime_error("y4m: broken frame header.");
+            }
+            pos += eol - p + 1;
+            if (file_size - pos < frame_size) {
+                throw std::runtime_error("y4m: truncated frame.");
+            }
+            in.frames.push_back(pos);
+            pos += frame_size;
+        }
+
+        size_t first, end;
+        in.total_frames = in.frames.size();
+        shard_range(opt, in.total_frames, first, end);
+        in.frames.erase(in.frames.begin() + end, in.frames.end());
+        in.frames.erase(in.frames.begin(), in.frames.begin() + first);
+        in.first_frame = first;
+        return;
+    }
+
+    if (opt.width <= 0 || opt.height <= 0) {
+        throw std::runtime_error(std::string(path) + " is not y4m. raw input needs --size.");
+    }
+    in.header.width = opt.width;
+    in.header.height = opt.height;
+    in.header.interlace = '?';
+    in.header.chroma.clear();
+    in.header.tags.clear();
+    in.y4m = false;
+    in.header_size = 0;
+
+    const size_t frame_size = input_frame_size(in.header);
+    if (file_size % frame_size != 0) {
+        throw std::runtime_error(std::string(path) + ": file size is not a multiple of the frame size.");
+    }
+    size_t first, end;
+    in.total_frames = file_size / frame_size;
+    shard_range(opt, in.total_frames, first, end);
+    for (size_t k = first; k < end; ++k) {
+        in.frames.push_back(k * frame_size);
+    }
+    in.first_frame = first;
+}
+
+
+std::string output_path(const options& opt, const char* input, bool y4m)
+{
+    std::string name = input;
+    size_t slash = name.rfind('/');
+    if (slash != std::string::npos) {
+        name = name.substr(slash + 1);
+    }
+    size_t dot = name.rfind('.');
+    if (dot != std::string::npos && dot > 0) {
+        name = name.substr(0, dot);
+    }
+    name += "_422";
+    if (opt.shards > 1) {
+        name += "_" + std::to_string(opt.shard) + "of" + std::to_string(opt.shards);
+    }
+    return std::string(opt.output) + "/" + name + (y4m ? ".y4m" : ".yuv");
+}
+
+
+void set_planes(const yv12to422_params_t& p, const uint8_t* in,
+                       uint8_t* out, uint8_t* out_uv, yv12to422_src_t& s,
+                       yv12to422_dst_t& d)
+{
+    const int w = p.width;
+    const int h = p.height;
+    s.data[0] = in;
+    s.data[1] = in + w * h;
+    s.data[2] = s.data[1] + (w / 2) * (h / 2);
+    s.pitch[0] = w;
+    s.pitch[1] = s.pitch[2] = w / 2;
+
+    if (p.output != YV12TO422_OUTPUT_YV16) {
+        d.data[0] = out;
+        d.pitch[0] = w * 2;
+        d.data[1] = d.data[2] = nullptr;
+        d.pitch[1] = d.pitch[2] = 0;
+        return;
+    }
+    d.data[0] = out;
+    d.data[1] = out_uv;
+    d.data[2] = out_uv + (w / 2) * h;
+    d.pitch[0] = w;
+    d.pitch[1] = d.pitch[2] = w / 2;
+}
+
+
+const yv12to422_t& engine_table::get(const options& opt, const input_stream& in)
+{
+    yv12to422_params_t params;
+    get_params(opt, in.header, params);
+    params.unaligned = 1;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    const std::vector<int> key = { params.width, params.height, params.interlaced, params.cplace };
+    auto it = engines.find(key);
+    if (it != engines.end()) {
+        return it->second;
+    }
+    yv12to422_t ctx;
+    int err = yv12to422_init(&ctx, &params);
+    if (err != YV12TO422_OK) {
+        throw std::runtime_error(yv12to422_strerror(err));
+    }
+    return engines.emplace(key, ctx).first->second;
+}
+
+
+void map_input(const char* path, mapped_file& m)
+{
+    m.fd = open(path, O_RDONLY);
+    if (m.fd < 0) {
+        throw sys_error("failed to open", path);
+    }
+    struct stat st;
+    if (fstat(m.fd, &st) < 0) {
+        throw sys_error("failed to stat", path);
+    }
+    if (st.st_size == 0) {
+        throw std::runtime_error(std::string(path) + " is empty.");
+    }
+    m.size = st.st_size;
+    void* p = mmap(nullptr, m.size, PROT_READ, MAP_PRIVATE, m.fd, 0);
+    if (p == MAP_FAILED) {
+        throw sys_error("failed to map", path);
+    }
+    m.data = (uint8_t*)p;
+    madvise(m.data, m.size, MADV_SEQUENTIAL);
+}
+
+
+void map_output(const char* path, size_t size, mapped_file& m)
+{
+    m.fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m.fd < 0) {
+        throw sys_error("failed to create", path);
+    }
+    if (ftruncate(m.fd, size) < 0) {
+        throw sys_error("failed to resize", path);
+    }
+    // allocate the blocks now, so that a full disk is an error here and
+    // not a SIGBUS while writing into the mapping.
+    int err = posix_fallocate(m.fd, 0, size);
+    if (err == ENOSPC) {
+        errno = err;
+        throw sys_error("failed to allocate", path);
+    }
+    m.size = size;
+    void* p = mmap(nullptr, m.size, PROT_READ | PROT_WRITE, MAP_SHARED, m.fd, 0);
+    if (p == MAP_FAILED) {
+        throw sys_error("failed to map", path);
+    }
+    m.data = (uint8_t*)p;
+    madvise(m.data, m.size, MADV_SEQUENTIAL);
+}
+
+
+void open_file_job(const options& opt, const char* path, engine_table& engines,
+                   file_job& job)
+{
+    job.path = path;
+    map_input(path, job.src);
+    index_input(opt, path, job.src.size,
+                [&](size_t pos, size_t) { return job.src.data + pos; }, job.in);
+    job.ctx = &engines.get(opt, job.in);
+
+    const std::string header = job.in.y4m ? y4m_format_header(get_output_header(opt, job.in.header)) : "";
+    job.header_size = header.size();
+    job.record = (job.in.y4m ? FRAME_HEADER_SIZE : 0) +
+                 output_frame_size(job.in.header, opt.yuy2 != 0);
+
+    std::string out_path = output_path(opt, path, job.in.y4m);
+    map_output(out_path.c_str(), job.header_size + job.in.frames.size() * job.record, job.dst);
+    memcpy(job.dst.data, header.data(), header.size());
+}
+
+
+void convert_frames(const file_job& job, size_t begin, size_t end, void* scratch)
+{
+    const yv12to422_t& ctx = *job.ctx;
+    const size_t frame_header = job.in.y4m ? FRAME_HEADER_SIZE : 0;
+    const size_t luma_size = (size_t)job.in.header.width * job.in.header.height;
+
+    for (size_t k = begin; k < end; ++k) {
+        uint8_t* out = job.dst.data + job.header_size + k * job.record;
+        memcpy(out, FRAME_HEADER, frame_header);
+        out += frame_header;
+
+        yv12to422_src_t s;
+        yv12to422_dst_t d;
+        set_planes(ctx.params, job.src.data + job.in.frames[k], out, out + luma_size, s, d);
+        convert(ctx, s, d, scratch);
+    }
+}
+
+
+void add_stats(const file_job& job, copy_stats& stats)
+{
+    const size_t frames = job.in.frames.size();
+    const size_t frame_header = job.in.y4m ? FRAME_HEADER_SIZE : 0;
+    const size_t luma_size = (size_t)job.in.header.width * job.in.header.height;
+    const bool yuy2 = job.ctx->params.output != YV12TO422_OUTPUT_YV16;
+
+    stats.frames += frames;
+    stats.copied += job.header_size + frames * (frame_header + (yuy2 ? 0 : luma_size));
+    stats.read_write += input_bytes(job.in) + job.dst.size;
+}
+
+
+void convert(const yv12to422_t& ctx, const yv12to422_src_t& s,
+                    const yv12to422_dst_t& d, void* scratch)
+{
+    int err = yv12to422_convert(&ctx, &s, &d, scratch);
+    if (err != YV12TO422_OK) {
+        throw std::runtime_error(yv12to422_strerror(err));
+    }
+}
+
+
+void print_stats(const char* path, const copy_stats& stats)
+{
+    if (stats.frames > 0) {
+        fprintf(stderr, "%s: %zu frames, %zu bytes copied per frame "
+                "(read/write would copy %zu)\n", path, stats.frames,
+                stats.copied / stats.frames, stats.read_write / stats.frames);
+    }
+}
+
+#endif
@@ -0,0 +1,224 @@
+/*
+  batch_common.h
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+
+#ifndef YV12TO422_CLI_BATCH_COMMON_H
+#define YV12TO422_CLI_BATCH_COMMON_H
+
+// helpers of the batch drivers. Linux only, like batch mode itself.
+#if defined(__linux__)
+
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "libyv12to422.h"
+#include "options.h"
+#include "y4m.h"
+
+
+static const char FRAME_HEADER[] = "FRAME\n";
+static const size_t FRAME_HEADER_SIZE = sizeof(FRAME_HEADER) - 1;
+static const size_t MAX_HEADER = 4096;
+
+
+struct input_stream {
+    y4m_header header;
+    bool y4m;
+    size_t header_size = 0;         // bytes of the y4m stream header
+    std::vector<size_t> frames;     // offsets of the frame data (of the shard)
+    size_t first_frame = 0;         // number of frames[0] in the file
+    size_t total_frames = 0;        // frames of the whole file
+};
+
+
+struct copy_stats {
+    size_t frames = 0;
+    size_t copied = 0;              // bytes copied by this tool
+    size_t read_write = 0;          // bytes a read()/write() design copies
+};
+
+
+struct scratch_buffer {
+    void* data = nullptr;
+    size_t size = 0;
+
+    scratch_buffer() {}
+    explicit scratch_buffer(size_t n)
+    {
+        reserve(n);
+    }
+    scratch_buffer(const scratch_buffer&) = delete;
+    scratch_buffer& operator=(const scratch_buffer&) = delete;
+    ~scratch_buffer()
+    {
+        free(data);
+    }
+
+    // grows only. the old contents are lost.
+    void reserve(size_t n)
+    {
+        if (n <= size) {
+            return;
+        }
+        free(data);
+        data = nullptr;
+        size = 0;
+        if (posix_memalign(&data, 64, n) != 0) {
+            throw std::runtime_error("failed to allocate scratch buffer.");
+        }
+        size = n;
+    }
+};
+
+
+struct mapped_file {
+    int fd = -1;
+    uint8_t* data = nullptr;
+    size_t size = 0;
+
+    ~mapped_file()
+    {
+        if (data) {
+            munmap(data, size);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+};
+
+
+// anonymous, page aligned memory. unlike free(), munmap() never writes into
+// the pages, so they stay intact while a pipe still refers to them.
+struct page_buffer {
+    uint8_t* data;
+    size_t size;
+
+    explicit page_buffer(size_t n) : size(n)
+    {
+        void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            throw std::runtime_error("failed to allocate buffer.");
+        }
+        data = (uint8_t*)p;
+    }
+    ~page_buffer()
+    {
+        munmap(data, size);
+    }
+};
+
+
+// returns the bytes [pos, pos + size) of the input file.
+using peek_func = std::function<const uint8_t*(size_t pos, size_t size)>;
+
+
+// msg + path + strerror(errno)
+std::runtime_error sys_error(const std::string& msg, const char* path);
+
+size_t input_frame_size(const y4m_header& h);
+
+size_t output_frame_size(const y4m_header& h, bool yuy2);
+
+// bytes of the input which a read()/write() design reads for the frames of
+// in: the stream header and the frames with their headers.
+size_t input_bytes(const input_stream& in);
+
+// finds the frames of a y4m file, or of a raw file of opt.width x opt.height.
+// only the frames of the shard opt.shard/opt.shards are kept.
+void index_input(const options& opt, const char* path, size_t file_size,
+                 const peek_func& peek, input_stream& in);
+
+// <dir>/<name without extension>_422[_<shard>of<shards>].<y4m|yuv>
+std::string output_path(const options& opt, const char* input, bool y4m);
+
+// planes of one tightly packed yv12 frame and of its yv16/yuy2 result.
+void set_planes(const yv12to422_params_t& p, const uint8_t* in,
+                uint8_t* out, uint8_t* out_uv, yv12to422_src_t& s,
+                yv12to422_dst_t& d);
+
+// unaligned mode engines, one per distinct stream format. an engine is never
+// modified after its creation, so any thread may use it.
+class engine_table {
+    std::mutex mtx;
+    std::map<std::vector<int>, yv12to422_t> engines;
+
+public:
+    const yv12to422_t& get(const options& opt, const input_stream& in);
+};
+
+
+// a mapped input and its mapped, preallocated output file.
+struct file_job {
+    const char* path;
+    mapped_file src;
+    mapped_file dst;
+    input_stream in;
+    const yv12to422_t* ctx;
+    size_t header_size;     // bytes of the output before the first frame
+    size_t record;          // bytes of one output frame with its header
+};
+
+void map_input(const char* path, mapped_file& m);
+
+void map_output(const char* path, size_t size, mapped_file& m);
+
+// maps the files of path and writes the stream header of the output.
+void open_file_job(const options& opt, const char* path, engine_table& engines,
+                   file_job& job);
+
+// frames [begin, end) of job.
+void convert_frames(const file_job& job, size_t begin, size_t end, void* scratch);
+
+void add_stats(const file_job& job, copy_stats& stats);
+
+void convert(const yv12to422_t& ctx, const yv12to422_src_t& s,
+             const yv12to422_dst_t& d, void* scratch);
+
+void print_stats(const char* path, const copy_stats& stats);
+
+
+class io_engine;
+
+// converts one file with read/write requests through io, keeping up to
+// opt.queue_depth frames in flight. (batch_async.cpp)
+void convert_file_async(const options& opt, const char* path, io_engine& io,
+                        engine_table& engines, copy_stats& stats);
+
+// --jobs: every file on a pool of work-stealing threads. (batch_parallel.cpp)
+int run_batch_parallel(const options& opt);
+
+#endif // __linux__
+
+#endif
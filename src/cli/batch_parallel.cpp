@@ -0,0 +1,243 @@
+/*
+  batch_parallel.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+
+/*
+  Batch conversion on --jobs threads.
+
+  Work is a set of tasks on one deque per worker. A worker takes the newest
+  task of its own deque, and when that is empty, steals the oldest task of
+  another one. The first task of a file maps it and splits its frames into
+  ranges, which are pushed onto the deque of that worker. So the worker goes
+  on with the first frames of the file while idle workers steal the last
+  ones, and long files are spread over the pool while short files fill the
+  gaps between them.
+
+  All the tasks share one engine_table (one engine per stream format) and
+  one scratch arena per worker.
+*/
+
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "batch_common.h"
+
+#if defined(__linux__)
+
+
+static const size_t MAX_FRAMES_PER_TASK = 8;
+
+
+struct task {
+    size_t file;        // index in options::inputs
+    bool open;          // map the file and split it into frame ranges
+    size_t begin;       // frames [begin, end)
+    size_t end;
+};
+
+
+// owner pushes and pops at the back, thieves steal at the front.
+class work_deque {
+    std::mutex mtx;
+    std::deque<task> tasks;
+
+public:
+    void push(const task& t)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        tasks.push_back(t);
+    }
+
+    bool pop(task& t)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (tasks.empty()) {
+            return false;
+        }
+        t = tasks.back();
+        tasks.pop_back();
+        return true;
+    }
+
+    bool steal(task& t)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (tasks.empty()) {
+            return false;
+        }
+        t = tasks.front();
+        tasks.pop_front();
+        return true;
+    }
+};
+
+
+struct file_state {
+    std::unique_ptr<file_job> job;
+    std::atomic<size_t> remaining{0};   // frame tasks not finished yet
+};
+
+
+class scheduler {
+    const options& opt;
+    const size_t jobs;
+    engine_table engines;
+    std::vector<file_state> files;
+    std::vector<work_deque> deques;
+    std::vector<scratch_buffer> arenas;
+    std::atomic<size_t> pending;        // tasks pushed and not finished
+    std::atomic<bool> failed;
+    std::exception_ptr error;
+    std::mutex mtx;                     // error and stderr
+
+    void push(size_t worker, const task& t)
+    {
+        pending.fetch_add(1, std::memory_order_relaxed);
+        deques[worker].push(t);
+    }
+
+    bool steal(size_t worker, task& t)
+    {
+        for (size_t i = 1; i < jobs; ++i) {
+            if (deques[(worker + i) % jobs].steal(t)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void finish(file_state& f)
+    {
+        copy_stats stats;
+        add_stats(*f.job, stats);
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            print_stats(f.job->path, stats);
+        }
+        f.job.reset();
+    }
+
+    void open(size_t worker, const task& t)
+    {
+        file_state& f = files[t.file];
+        f.job.reset(new file_job());
+        open_file_job(opt, opt.inputs[t.file], engines, *f.job);
+
+        const size_t frames = f.job->in.frames.size();
+        if (frames == 0) {
+            finish(f);
+            return;
+        }
+        const size_t grain = std::max<size_t>(1, std::min(MAX_FRAMES_PER_TASK, frames / jobs));
+        const size_t count = (frames + grain - 1) / grain;
+        f.remaining.store(count, std::memory_order_relaxed);
+
+        // the last range first, so that this worker pops the first one.
+        for (size_t i = count; i-- > 0;) {
+            push(worker, { t.file, false, i * grain, std::min(frames, (i + 1) * grain) });
+        }
+    }
+
+    void convert(size_t worker, const task& t)
+    {
+        file_state& f = files[t.file];
+        scratch_buffer& scratch = arenas[worker];
+        scratch.reserve(yv12to422_scratch_size(f.job->ctx));
+        convert_frames(*f.job, t.begin, t.end, scratch.data);
+        if (f.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            finish(f);
+        }
+    }
+
+    void worker(size_t id)
+    {
+        task t;
+        while (!failed.load(std::memory_order_relaxed)) {
+            if (!deques[id].pop(t) && !steal(id, t)) {
+                if (pending.load(std::memory_order_acquire) == 0) {
+                    return;
+                }
+                std::this_thread::yield();
+                continue;
+            }
+            try {
+                if (t.open) {
+                    open(id, t);
+                } else {
+                    convert(id, t);
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                failed.store(true, std::memory_order_relaxed);
+            }
+            pending.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+
+public:
+    explicit scheduler(const options& o) :
+        opt(o), jobs(o.jobs), files(o.inputs.size()), deques(jobs),
+        arenas(jobs), pending(0), failed(false)
+    {
+        // in reverse, so that every worker pops its files in input order.
+        for (size_t i = files.size(); i-- > 0;) {
+            push(i % jobs, { i, true, 0, 0 });
+        }
+    }
+
+    void run()
+    {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < jobs; ++i) {
+            threads.emplace_back(&scheduler::worker, this, i);
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+
+int run_batch_parallel(const options& opt)
+{
+    scheduler(opt).run();
+    return 0;
+}
+
+#endif
@@ -0,0 +1,153 @@
+/*
+  bench.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+
+/*
+  --bench: the throughput of the kernels on narrow frames, with and without
+  narrow mode. Synthetic frames of chroma width 16 to 256 are converted
+  from and to 64 byte aligned planes with the other options of the command
+  line (--itype, --cplace, --interlaced, --lshift, --yuy2, --simd).
+*/
+
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+#include "batch.h"
+
+
+using clock_type = std::chrono::steady_clock;
+
+
+struct aligned_plane {
+    uint8_t* data;
+    int pitch;
+
+    aligned_plane(int width, int height) : data(nullptr), pitch((width + 63) / 64 * 64)
+    {
+#ifdef _WIN32
+        void* p = _aligned_malloc((size_t)pitch * height, 64);
+#else
+        void* p = nullptr;
+        if (posix_memalign(&p, 64, (size_t)pitch * height) != 0) {
+            p = nullptr;
+        }
+#endif
+        if (!p) {
+            throw std::runtime_error("failed to allocate a plane.");
+        }
+        data = (uint8_t*)p;
+        std::mt19937 rng(pitch);
+        for (size_t i = 0; i < (size_t)pitch * height; ++i) {
+            data[i] = (uint8_t)rng();
+        }
+    }
+    ~aligned_plane()
+    {
+#ifdef _WIN32
+        _aligned_free(data);
+#else
+        free(data);
+#endif
+    }
+    aligned_plane(const aligned_plane&) = delete;
+    aligned_plane& operator=(const aligned_plane&) = delete;
+};
+
+
+// luma megapixels per second. 0 when narrow mode is not used at this size.
+static double measure(yv12to422_params_t params, bool narrow, int& strips)
+{
+    params.narrow = narrow ? 1 : 0;
+    yv12to422_t ctx;
+    int err = yv12to422_init(&ctx, &params);
+    if (err != YV12TO422_OK) {
+        throw std::runtime_error(yv12to422_strerror(err));
+    }
+    strips = ctx.narrow_strips;
+    if (narrow && strips == 0) {
+        return 0.0;
+    }
+
+    const int w = params.width;
+    const int h = params.height;
+    const bool yuy2 = params.output != YV12TO422_OUTPUT_YV16;
+    aligned_plane sy(w, h), su(w / 2, h / 2), sv(w / 2, h / 2);
+    aligned_plane dy(yuy2 ? w * 2 : w, h), du(w / 2, h), dv(w / 2, h);
+    aligned_plane scratch((int)yv12to422_scratch_size(&ctx) + 64, 1);
+
+    yv12to422_src_t src = { { sy.data, su.data, sv.data }, { sy.pitch, su.pitch, sv.pitch } };
+    yv12to422_dst_t dst = { { dy.data, du.data, dv.data }, { dy.pitch, du.pitch, dv.pitch } };
+
+    long frames = 0;
+    const auto start = clock_type::now();
+    double elapsed = 0.0;
+    do {
+        for (int i = 0; i < 64; ++i) {
+            yv12to422_convert(&ctx, &src, &dst, scratch.data);
+        }
+        frames += 64;
+        elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+    } while (elapsed < 0.2);
+
+    return (double)frames * w * h / elapsed / 1e6;
+}
+
+
+int run_bench(const options& opt)
+{
+    static const int widths[] = { 16, 24, 32, 48, 64, 90, 128, 160, 180, 256 };
+    const int height = opt.height > 0 ? opt.height : 240;
+
+    y4m_header h;
+    h.width = widths[0] * 2;
+    h.height = height;
+    h.interlace = '?';
+    yv12to422_params_t params;
+    get_params(opt, h, params);
+
+    fprintf(stderr, "height %d, luma Mpixel/s\n"
+            "chroma width   normal   narrow  strips\n", height);
+    for (int width : widths) {
+        params.width = width * 2;
+        int strips = 0;
+        const double normal = measure(params, false, strips);
+        const double narrow = measure(params, true, strips);
+        if (strips == 0) {
+            fprintf(stderr, "%12d  %7.1f        -       -\n", width, normal);
+        } else {
+            fprintf(stderr, "%12d  %7.1f  %7.1f  %6d\n", width, normal, narrow, strips);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+/*
+  io_engine.h
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+
+#ifndef YV12TO422_CLI_IO_ENGINE_H
+#define YV12TO422_CLI_IO_ENGINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+
+struct io_request {
+    int fd;
+    bool write;
+    uint8_t* buf;
+    size_t len;
+    off_t offset;
+    int buf_index;      // index of the registered buffer holding buf
+    uint64_t tag;
+};
+
+
+struct io_completion {
+    uint64_t tag;
+    ssize_t result;     // bytes transferred, or -errno
+};
+
+
+/*
+  Asynchronous positional reads/writes. Requests are queued, started by
+  submit() and completed in any order. Short transfers are reported as
+  they are; the caller queues the rest again.
+*/
+class io_engine {
+public:
+    virtual ~io_engine() {}
+
+    virtual const char* name() const = 0;
+
+    // every buffer used by the following requests. replaces the previous set.
+    virtual void register_buffers(const std::vector<struct iovec>& buffers) = 0;
+
+    virtual void queue(const io_request& req) = 0;
+
+    virtual void submit() = 0;
+
+    // waits for one or more completions and appends them to done.
+    virtual void wait(std::vector<io_completion>& done) = 0;
+};
+
+
+// nullptr if the kernel has no io_uring (or it is disabled).
+// depth is the maximum number of requests in flight.
+std::unique_ptr<io_engine> create_uring_engine(unsigned depth);
+
+// pread()/pwrite() on a pool of threads.
+std::unique_ptr<io_engine> create_thread_engine(int threads);
+
+#endif
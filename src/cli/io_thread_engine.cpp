@@ -0,0 +1,136 @@
+/*
+  io_thread_engine.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+
+#if defined(__linux__)
+
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+
+#include "io_engine.h"
+
+
+class thread_engine : public io_engine {
+    std::vector<std::thread> workers;
+    std::vector<io_request> pending;
+    std::deque<io_request> requests;
+    std::vector<io_completion> completions;
+    std::mutex mtx;
+    std::condition_variable request_ready;
+    std::condition_variable completion_ready;
+    bool quit;
+
+    void worker()
+    {
+        for (;;) {
+            io_request req;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                request_ready.wait(lock, [this] { return quit || !requests.empty(); });
+                if (quit) {
+                    return;
+                }
+                req = requests.front();
+                requests.pop_front();
+            }
+
+            ssize_t n;
+            do {
+                n = req.write ? pwrite(req.fd, req.buf, req.len, req.offset)
+                              : pread(req.fd, req.buf, req.len, req.offset);
+            } while (n < 0 && errno == EINTR);
+
+            std::lock_guard<std::mutex> lock(mtx);
+            completions.push_back({ req.tag, n < 0 ? -errno : n });
+            completion_ready.notify_one();
+        }
+    }
+
+public:
+    explicit thread_engine(int threads) : quit(false)
+    {
+        for (int i = 0; i < threads; ++i) {
+            workers.emplace_back(&thread_engine::worker, this);
+        }
+    }
+
+    ~thread_engine()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            quit = true;
+        }
+        request_ready.notify_all();
+        for (auto& t : workers) {
+            t.join();
+        }
+    }
+
+    const char* name() const override
+    {
+        return "threads";
+    }
+
+    void register_buffers(const std::vector<struct iovec>&) override {}
+
+    void queue(const io_request& req) override
+    {
+        pending.push_back(req);
+    }
+
+    void submit() override
+    {
+        if (pending.empty()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            requests.insert(requests.end(), pending.begin(), pending.end());
+        }
+        pending.clear();
+        request_ready.notify_all();
+    }
+
+    void wait(std::vector<io_completion>& done) override
+    {
+        submit();
+        std::unique_lock<std::mutex> lock(mtx);
+        completion_ready.wait(lock, [this] { return !completions.empty(); });
+        done.insert(done.end(), completions.begin(), completions.end());
+        completions.clear();
+    }
+};
+
+
+std::unique_ptr<io_engine> create_thread_engine(int threads)
+{
+    return std::unique_ptr<io_engine>(new thread_engine(threads > 0 ? threads : 1));
+}
+
+#endif
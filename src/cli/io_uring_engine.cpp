@@ -0,0 +1,279 @@
+/*
+  io_uring_engine.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+
+/*
+  io_uring through the raw system calls (no liburing).
+
+  The buffers given to register_buffers() are registered with the ring and
+  the transfers use READ_FIXED/WRITE_FIXED, so the kernel does not map and
+  pin the pages on every request. If registration fails (RLIMIT_MEMLOCK),
+  the plain READ/WRITE opcodes are used.
+*/
+
+
+#include "io_engine.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params* p)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                              unsigned flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+                        flags, nullptr, 0);
+}
+
+
+static int sys_io_uring_register(int fd, unsigned opcode, const void* arg,
+                                 unsigned nr_args)
+{
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+
+class uring_engine : public io_engine {
+    int ring_fd;
+
+    void* sq_ptr;
+    size_t sq_size;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned* sq_array;
+    struct io_uring_sqe* sqes;
+    size_t sqes_size;
+
+    void* cq_ptr;
+    size_t cq_size;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe* cqes;
+
+    unsigned to_submit;
+    bool fixed;
+
+    void unmap()
+    {
+        if (sqes) {
+            munmap(sqes, sqes_size);
+        }
+        if (cq_ptr && cq_ptr != sq_ptr) {
+            munmap(cq_ptr, cq_size);
+        }
+        if (sq_ptr) {
+            munmap(sq_ptr, sq_size);
+        }
+    }
+
+public:
+    uring_engine() : ring_fd(-1), sq_ptr(nullptr), sqes(nullptr), cq_ptr(nullptr),
+        to_submit(0), fixed(false) {}
+
+    ~uring_engine()
+    {
+        unmap();
+        if (ring_fd >= 0) {
+            close(ring_fd);
+        }
+    }
+
+    // false if io_uring is not available.
+    bool init(unsigned depth)
+    {
+        struct io_uring_params p;
+        memset(&p, 0, sizeof(p));
+        ring_fd = sys_io_uring_setup(depth, &p);
+        if (ring_fd < 0) {
+            return false;
+        }
+
+        sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+        const bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) {
+            sq_size = cq_size = sq_size > cq_size ? sq_size : cq_size;
+        }
+
+        sq_ptr = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+        if (sq_ptr == MAP_FAILED) {
+            sq_ptr = nullptr;
+            return false;
+        }
+        if (single_mmap) {
+            cq_ptr = sq_ptr;
+        } else {
+            cq_ptr = mmap(nullptr, cq_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+            if (cq_ptr == MAP_FAILED) {
+                cq_ptr = nullptr;
+                return false;
+            }
+        }
+        sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+        void* s = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+        if (s == MAP_FAILED) {
+            return false;
+        }
+        sqes = (struct io_uring_sqe*)s;
+
+        uint8_t* sq = (uint8_t*)sq_ptr;
+        sq_head = (unsigned*)(sq + p.sq_off.head);
+        sq_tail = (unsigned*)(sq + p.sq_off.tail);
+        sq_mask = *(unsigned*)(sq + p.sq_off.ring_mask);
+        sq_entries = p.sq_entries;
+        sq_array = (unsigned*)(sq + p.sq_off.array);
+
+        uint8_t* cq = (uint8_t*)cq_ptr;
+        cq_head = (unsigned*)(cq + p.cq_off.head);
+        cq_tail = (unsigned*)(cq + p.cq_off.tail);
+        cq_mask = *(unsigned*)(cq + p.cq_off.ring_mask);
+        cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+        return true;
+    }
+
+    const char* name() const override
+    {
+        return fixed ? "uring (fixed buffers)" : "uring";
+    }
+
+    void register_buffers(const std::vector<struct iovec>& buffers) override
+    {
+        if (fixed) {
+            sys_io_uring_register(ring_fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+            fixed = false;
+        }
+        if (!buffers.empty()) {
+            fixed = sys_io_uring_register(ring_fd, IORING_REGISTER_BUFFERS,
+                                          buffers.data(), (unsigned)buffers.size()) == 0;
+        }
+    }
+
+    void queue(const io_request& req) override
+    {
+        // only the kernel moves the head.
+        const unsigned tail = *sq_tail;
+        if (tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries) {
+            submit();
+            if (tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries) {
+                throw std::runtime_error("io_uring submission queue is full.");
+            }
+        }
+
+        const unsigned index = tail & sq_mask;
+        struct io_uring_sqe* sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        if (fixed) {
+            sqe->opcode = req.write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+            sqe->buf_index = (uint16_t)req.buf_index;
+        } else {
+            sqe->opcode = req.write ? IORING_OP_WRITE : IORING_OP_READ;
+        }
+        sqe->fd = req.fd;
+        sqe->addr = (uint64_t)(uintptr_t)req.buf;
+        sqe->len = (uint32_t)req.len;
+        sqe->off = (uint64_t)req.offset;
+        sqe->user_data = req.tag;
+        sq_array[index] = index;
+
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+        ++to_submit;
+    }
+
+    void submit() override
+    {
+        while (to_submit > 0) {
+            int n = sys_io_uring_enter(ring_fd, to_submit, 0, 0);
+            if (n < 0) {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                    continue;
+                }
+                throw std::runtime_error(std::string("io_uring_enter failed: ") +
+                                         strerror(errno));
+            }
+            to_submit -= n;
+        }
+    }
+
+    void wait(std::vector<io_completion>& done) override
+    {
+        submit();
+        for (;;) {
+            unsigned head = *cq_head;
+            const unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+            if (head != tail) {
+                for (; head != tail; ++head) {
+                    const struct io_uring_cqe& cqe = cqes[head & cq_mask];
+                    done.push_back({ cqe.user_data, cqe.res });
+                }
+                __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+                return;
+            }
+            if (sys_io_uring_enter(ring_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+                errno != EINTR) {
+                throw std::runtime_error(std::string("io_uring_enter failed: ") +
+                                         strerror(errno));
+            }
+        }
+    }
+};
+
+
+std::unique_ptr<io_engine> create_uring_engine(unsigned depth)
+{
+    std::unique_ptr<uring_engine> e(new uring_engine());
+    if (!e->init(depth)) {
+        return nullptr;
+    }
+    return std::unique_ptr<io_engine>(e.release());
+}
+
+#else
+
+std::unique_ptr<io_engine> create_uring_engine(unsigned)
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,219 @@
+/*
+  loadgen.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+
+/*
+  --loadgen: a local client of the daemon. Every client thread submits
+  --requests frames of --size and measures the time from submitting a
+  slot to seeing it done. The first result of every thread is compared
+  with a conversion done here.
+*/
+
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "batch_common.h"
+#include "shm_ring.h"
+
+#if defined(__linux__)
+
+
+using clock_type = std::chrono::steady_clock;
+
+
+// one yv12 frame and its conversion by this process.
+struct test_frame {
+    std::vector<uint8_t> in;
+    std::vector<uint8_t> out;
+};
+
+
+static void make_test_frame(const yv12to422_params_t& params, uint32_t seed,
+                            test_frame& f)
+{
+    y4m_header h;
+    h.width = params.width;
+    h.height = params.height;
+    f.in.resize(input_frame_size(h));
+    f.out.resize(output_frame_size(h, params.output != YV12TO422_OUTPUT_YV16));
+    std::mt19937 rng(seed);
+    for (auto& b : f.in) {
+        b = (uint8_t)rng();
+    }
+
+    yv12to422_t ctx;
+    int err = yv12to422_init(&ctx, &params);
+    if (err != YV12TO422_OK) {
+        throw std::runtime_error(yv12to422_strerror(err));
+    }
+    scratch_buffer scratch(yv12to422_scratch_size(&ctx));
+    const size_t luma = (size_t)params.width * params.height;
+    yv12to422_src_t s;
+    yv12to422_dst_t d;
+    set_planes(params, f.in.data(), f.out.data(), f.out.data() + luma, s, d);
+    convert(ctx, s, d, scratch.data);
+}
+
+
+static void copy_in(const shm_request& r, const uint8_t* in, uint8_t* slot)
+{
+    const size_t luma = (size_t)r.width * r.height;
+    const size_t chroma = (size_t)(r.width / 2) * (r.height / 2);
+    memcpy(slot + r.src[0], in, luma);
+    memcpy(slot + r.src[1], in + luma, chroma);
+    memcpy(slot + r.src[2], in + luma + chroma, chroma);
+}
+
+
+static bool same_output(const shm_request& r, const uint8_t* slot,
+                        const std::vector<uint8_t>& out)
+{
+    const size_t luma = (size_t)r.width * r.height;
+    if (r.output != YV12TO422_OUTPUT_YV16) {
+        return memcmp(slot + r.dst[0], out.data(), luma * 2) == 0;
+    }
+    return memcmp(slot + r.dst[0], out.data(), luma) == 0 &&
+           memcmp(slot + r.dst[1], out.data() + luma, luma / 2) == 0 &&
+           memcmp(slot + r.dst[2], out.data() + luma + luma / 2, luma / 2) == 0;
+}
+
+
+static double percentile(const std::vector<double>& sorted, double q)
+{
+    size_t i = (size_t)(q * sorted.size());
+    return sorted[std::min(i, sorted.size() - 1)];
+}
+
+
+int run_loadgen(const options& opt)
+{
+    shm_client client(opt.shm_name);
+
+    y4m_header h;
+    h.width = opt.width;
+    h.height = opt.height;
+    h.interlace = '?';
+    yv12to422_params_t params;
+    get_params(opt, h, params);
+    params.unaligned = 1;
+
+    shm_request proto;
+    memset(&proto, 0, sizeof(proto));
+    proto.width = params.width;
+    proto.height = params.height;
+    proto.interlaced = params.interlaced;
+    proto.itype = params.itype;
+    proto.cplace = params.cplace;
+    proto.lshift = params.lshift;
+    proto.b = params.b;
+    proto.c = params.c;
+    proto.output = params.output;
+    if (!shm_set_layout(proto, client.slot_size())) {
+        throw std::runtime_error("--size is larger than the slots of the daemon.");
+    }
+
+    std::vector<double> latency;    // microseconds
+    std::mutex mtx;
+    std::vector<std::string> errors;
+
+    auto run = [&](int id) {
+        try {
+            test_frame f;
+            make_test_frame(params, (uint32_t)id + 1, f);
+            std::vector<double> lat;
+            lat.reserve(opt.requests);
+
+            for (int i = 0; i < opt.requests; ++i) {
+                const uint32_t s = client.acquire();
+                shm_request& r = client.request(s);
+                r = proto;
+                copy_in(r, f.in.data(), client.data(s));
+
+                const auto t0 = clock_type::now();
+                client.submit(s);
+                const int status = client.wait(s);
+                const auto t1 = clock_type::now();
+
+                if (status != YV12TO422_OK) {
+                    client.release(s);
+                    throw std::runtime_error(std::string("daemon: ") + yv12to422_strerror(status));
+                }
+                if (i == 0 && !same_output(r, client.data(s), f.out)) {
+                    client.release(s);
+                    throw std::runtime_error("the result of the daemon differs from the local one.");
+                }
+                client.release(s);
+                lat.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+            }
+
+            std::lock_guard<std::mutex> lock(mtx);
+            latency.insert(latency.end(), lat.begin(), lat.end());
+        } catch (std::exception& e) {
+            std::lock_guard<std::mutex> lock(mtx);
+            errors.push_back(e.what());
+        }
+    };
+
+    const auto start = clock_type::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < opt.clients; ++i) {
+        threads.emplace_back(run, i);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    const double elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+
+    if (!errors.empty()) {
+        throw std::runtime_error(errors[0]);
+    }
+
+    std::sort(latency.begin(), latency.end());
+    fprintf(stderr, "%zu frames of %dx%d from %d clients: %.1f frames/s\n"
+            "round trip (us): p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+            latency.size(), opt.width, opt.height, opt.clients,
+            latency.size() / elapsed, percentile(latency, 0.5),
+            percentile(latency, 0.9), percentile(latency, 0.99),
+            percentile(latency, 0.999), latency.back());
+    return 0;
+}
+
+#else
+
+int run_loadgen(const options&)
+{
+    throw std::runtime_error("loadgen is available only on Linux.");
+}
+
+#endif
@@ -0,0 +1,262 @@
+/*
+  merge.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+
+/*
+  --merge: concatenates the outputs of --shard 0/n to n-1/n into one stream.
+
+  Every y4m shard is a complete stream with the same header, but for its
+  XSHARD=<i>/<n> tag. Raw shards carry i and n in their names only
+  (<name>_422_<i>of<n>.yuv). The parts are put in the order of i, and each
+  of 0 to n-1 must be given once. The header without the XSHARD tag is
+  written and the frames of every part are appended with copy_file_range()
+  (or sendfile() when the output is not a regular file on the same file
+  system), so the data does not pass through this process.
+*/
+
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "batch.h"
+#include "batch_common.h"
+
+#if defined(__linux__)
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// the y4m header line with '\n', or an empty string for raw parts.
+static std::string read_header(int fd, const char* path)
+{
+    char buf[MAX_HEADER];
+    ssize_t n = pread(fd, buf, sizeof(buf), 0);
+    if (n < 0) {
+        throw sys_error("failed to read", path);
+    }
+    if (n < 10 || memcmp(buf, "YUV4MPEG2 ", 10) != 0) {
+        return "";
+    }
+    auto eol = (const char*)memchr(buf, '\n', n);
+    if (!eol) {
+        throw std::runtime_error(std::string(path) + ": y4m header line is too long.");
+    }
+    return std::string(buf, eol - buf + 1);
+}
+
+
+struct part {
+    const char* path;
+    std::string header;     // without the XSHARD tag
+    size_t header_size;     // in the file
+    int shard;
+    int shards;
+};
+
+
+static const char SHARD_TAG[] = " XSHARD=";
+
+
+// takes i/n of the XSHARD tag out of the header, or out of the name of a
+// raw part.
+static void get_shard(part& p)
+{
+    int n = 0;
+    std::string& h = p.header;
+    if (!h.empty()) {
+        const size_t pos = h.find(SHARD_TAG);
+        if (pos == std::string::npos ||
+            sscanf(h.c_str() + pos + sizeof(SHARD_TAG) - 1, "%d/%d%n", &p.shard, &p.shards, &n) != 2) {
+            throw std::runtime_error(std::string(p.path) + ": not the output of --shard.");
+        }
+        h.erase(pos, sizeof(SHARD_TAG) - 1 + n);
+    } else {
+        std::string name = p.path;
+        const size_t slash = name.rfind('/');
+        if (slash != std::string::npos) {
+            name = name.substr(slash + 1);
+        }
+        const size_t under = name.rfind('_');
+        if (under == std::string::npos ||
+            sscanf(name.c_str() + under, "_%dof%d%n", &p.shard, &p.shards, &n) != 2 ||
+            (name[under + n] != '\0' && name[under + n] != '.')) {
+            throw std::runtime_error(std::string(p.path) + ": not the output of --shard.");
+        }
+    }
+    if (p.shards < 1 || p.shard < 0 || p.shard >= p.shards) {
+        throw std::runtime_error(std::string(p.path) + ": invalid shard " +
+                                 std::to_string(p.shard) + "/" + std::to_string(p.shards) + ".");
+    }
+}
+
+
+// sorts the parts by shard. every shard of the same count must be there once.
+static void check_shards(std::vector<part>& parts)
+{
+    std::sort(parts.begin(), parts.end(),
+              [](const part& a, const part& b) { return a.shard < b.shard; });
+    const int shards = parts[0].shards;
+    if ((size_t)shards != parts.size()) {
+        throw std::runtime_error(std::to_string(parts.size()) + " parts are given for " +
+                                 std::to_string(shards) + " shards.");
+    }
+    for (int i = 0; i < shards; ++i) {
+        const part& p = parts[i];
+        if (p.shards != shards) {
+            throw std::runtime_error(std::string(p.path) + " is a shard of " +
+                                     std::to_string(p.shards) + ", not of " +
+                                     std::to_string(shards) + ".");
+        }
+        if (p.shard < i) {
+            throw std::runtime_error("shard " + std::to_string(p.shard) + " of " +
+                                     std::to_string(shards) + " is given twice.");
+        }
+        if (p.shard > i) {
+            throw std::runtime_error("shard " + std::to_string(i) + " of " +
+                                     std::to_string(shards) + " is missing.");
+        }
+    }
+}
+
+
+static void write_all(int fd, const char* data, size_t size, const char* path)
+{
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw sys_error("failed to write", path);
+        }
+        data += n;
+        size -= n;
+    }
+}
+
+
+static void copy_range(int in, off_t pos, size_t size, int out, const char* path)
+{
+    bool use_sendfile = false;
+    while (size > 0) {
+        ssize_t n;
+        if (!use_sendfile) {
+            loff_t off = pos;
+            n = copy_file_range(in, &off, out, nullptr, size, 0);
+            if (n < 0 && (errno == EXDEV || errno == EINVAL || errno == ENOSYS ||
+                          errno == EOPNOTSUPP || errno == EBADF)) {
+                use_sendfile = true;
+                continue;
+            }
+        } else {
+            off_t off = pos;
+            n = sendfile(out, in, &off, size);
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw sys_error("failed to copy", path);
+        }
+        if (n == 0) {
+            throw std::runtime_error(std::string(path) + ": unexpected end of file.");
+        }
+        pos += n;
+        size -= n;
+    }
+}
+
+
+int run_merge(const options& opt)
+{
+    std::vector<part> parts;
+    for (const char* path : opt.inputs) {
+        int in = open(path, O_RDONLY);
+        if (in < 0) {
+            throw sys_error("failed to open", path);
+        }
+        part p;
+        p.path = path;
+        p.header = read_header(in, path);
+        p.header_size = p.header.size();
+        close(in);
+        get_shard(p);
+        parts.push_back(p);
+    }
+    if (parts.empty()) {
+        throw std::runtime_error("no parts to merge.");
+    }
+    check_shards(parts);
+    const std::string& header = parts[0].header;
+    for (const part& p : parts) {
+        if (p.header != header) {
+            throw std::runtime_error(std::string(p.path) + ": header differs from " +
+                                     parts[0].path + ".");
+        }
+    }
+
+    const bool to_stdout = strcmp(opt.output, "-") == 0;
+    const char* out_path = to_stdout ? "stdout" : opt.output;
+    int out = to_stdout ? STDOUT_FILENO : open(opt.output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) {
+        throw sys_error("failed to create", opt.output);
+    }
+    write_all(out, header.data(), header.size(), out_path);
+
+    for (const part& p : parts) {
+        int in = open(p.path, O_RDONLY);
+        if (in < 0) {
+            throw sys_error("failed to open", p.path);
+        }
+        struct stat st;
+        if (fstat(in, &st) < 0) {
+            throw sys_error("failed to stat", p.path);
+        }
+        copy_range(in, p.header_size, st.st_size - p.header_size, out, p.path);
+        close(in);
+    }
+
+    if (!to_stdout && close(out) < 0) {
+        throw sys_error("failed to close", opt.output);
+    }
+    return 0;
+}
+
+#else
+
+int run_merge(const options&)
+{
+    throw std::runtime_error("merge is available only on Linux.");
+}
+
+#endif
@@ -0,0 +1,355 @@
+/*
+  options.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "options.h"
+
+
+void usage()
+{
+    fprintf(stderr,
+        "yv12to422 ver." LIBYV12TO422_VERSION "\n"
+        "usage: yv12to422 [options] [input.y4m|-] [output.y4m|-]\n"
+        "       yv12to422 --batch -o <dir>|- [options] input.y4m|input.yuv ...\n"
+        "       yv12to422 --merge -o <output>|- part0 part1 ...\n"
+        "       yv12to422 --daemon [--shm <name>] [--size <W>x<H>] [--slots <n>] [--jobs <n>]\n"
+        "       yv12to422 --loadgen [--shm <name>] --size <W>x<H> [--clients <n>] [--requests <n>] [options]\n"
+        "       yv12to422 --bench [--size <W>x<H>] [options]\n"
+        "  --interlaced 0|1  default: from the I tag of the header\n"
+        "  --cplace 0-3      default: from the C and I tags of the header\n"
+        "  --itype 0-2       default: 2\n"
+        "  --lshift          shift chroma 1/4 sample to the left\n"
+        "  --b <float>       default: 0.0\n"
+        "  --c <float>       default: 0.75\n"
+        "  --yuy2            write packed YUY2 frames (C422 XPACKED=YUY2)\n"
+        "  --uyvy            write packed UYVY frames (C422 XPACKED=UYVY)\n"
+        "  --depth 10|16     write 8bit input as 10 or 16bit (C422p10, C422p16)\n"
+        "  --yv24            write 4:4:4 planar frames (C444, C444p10...)\n"
+        "  --hsiting 0|1     chroma of --yv24 is co-sited with the even columns (0)\n"
+        "                    or centered (1). default: from the C tag of the header\n"
+        "  --matrix 601|709|2020\n"
+        "                    color matrix of the input. default: 601\n"
+        "  --out-matrix 601|709|2020\n"
+        "                    convert the output to this matrix. default: --matrix\n"
+        "  --range limited|full\n"
+        "                    default: from the XCOLORRANGE tag of the header\n"
+        "  --out-range limited|full\n"
+        "                    convert the output to this range. default: --range\n"
+        "  --threads         process U and V in parallel\n"
+        "  --simd sse2|avx2|avx512\n"
+        "                    default: the best one this CPU supports\n"
+        "  --batch           convert files through mmap (Linux only)\n"
+        "  -o <dir>|-        batch output directory, or stdout\n"
+        "  --size <W>x<H>    frame size of raw .yuv input\n"
+        "  --io mmap|uring|threads\n"
+        "                    batch I/O. default: mmap\n"
+        "  --queue-depth <n> frames in flight per file (uring/threads). default: 8\n"
+        "  --io-threads <n>  workers of the threads engine. default: 4\n"
+        "  --jobs <n>        convert files and frames on n threads (mmap to <dir>)\n"
+        "  --shard <i>/<n>   convert only the i-th (0 to n-1) of n frame ranges\n"
+        "  --merge           concatenate the outputs of the shards 0 to n-1\n"
+        "  --daemon          convert frames submitted through shared memory\n"
+        "  --loadgen         submit frames to the daemon and report the latency\n"
+        "  --shm <name>      shared memory object of the daemon. default: /yv12to422\n"
+        "  --slots <n>       frames the daemon can hold at once. default: 8\n"
+        "  --clients <n>     loadgen threads. default: 1\n"
+        "  --requests <n>    frames per loadgen thread. default: 1000\n"
+        "  --narrow          pack the rows of narrow chroma planes into wide vectors\n"
+        "  --bench           measure frames of chroma width 16 to 256 (height: --size)\n");
+}
+
+
+options parse_options(int argc, char** argv)
+{
+    options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto value = [&]() -> const char* {
+            if (i + 1 >= argc) {
+                throw std::runtime_error(a + " needs a value.");
+            }
+            return argv[++i];
+        };
+        if (a == "--interlaced") {
+            opt.interlaced = atoi(value()) != 0;
+        } else if (a == "--cplace") {
+            opt.cplace = atoi(value());
+        } else if (a == "--itype") {
+            opt.itype = atoi(value());
+        } else if (a == "--lshift") {
+            opt.lshift = 1;
+        } else if (a == "--b") {
+            opt.b = atof(value());
+        } else if (a == "--c") {
+            opt.c = atof(value());
+        } else if (a == "--yuy2") {
+            opt.yuy2 = 1;
+        } else if (a == "--uyvy") {
+            opt.yuy2 = 1;
+            opt.uyvy = true;
+        } else if (a == "--depth") {
+            opt.depth = atoi(value());
+            if (opt.depth != 10 && opt.depth != 16) {
+                throw std::runtime_error("--depth must be 10 or 16.");
+            }
+        } else if (a == "--yv24") {
+            opt.yv24 = true;
+        } else if (a == "--hsiting") {
+            opt.hsiting = atoi(value());
+            if (opt.hsiting != 0 && opt.hsiting != 1) {
+                throw std::runtime_error("--hsiting must be 0 or 1.");
+            }
+        } else if (a == "--matrix" || a == "--out-matrix") {
+            std::string v = value();
+            int m = v == "601" ? YV12TO422_MATRIX_BT601 :
+                    v == "709" ? YV12TO422_MATRIX_BT709 :
+                    v == "2020" ? YV12TO422_MATRIX_BT2020 : -1;
+            if (m < 0) {
+                throw std::runtime_error("unknown matrix: " + v);
+            }
+            (a == "--matrix" ? opt.matrix : opt.out_matrix) = m;
+        } else if (a == "--range" || a == "--out-range") {
+            std::string v = value();
+            if (v != "limited" && v != "full") {
+                throw std::runtime_error("unknown range: " + v);
+            }
+            (a == "--range" ? opt.range : opt.out_range) = v == "full" ? 1 : 0;
+        } else if (a == "--threads") {
+            opt.threads = 2;
+        } else if (a == "--simd") {
+            std::string v = value();
+            opt.simd = v == "sse2" ? YV12TO422_SIMD_SSE2 :
+                       v == "avx2" ? YV12TO422_SIMD_AVX2 :
+                       v == "avx512" ? YV12TO422_SIMD_AVX512 : -2;
+            if (opt.simd == -2) {
+                throw std::runtime_error("unknown simd: " + v);
+            }
+        } else if (a == "--batch") {
+            opt.batch = true;
+        } else if (a == "-o") {
+            opt.output = value();
+        } else if (a == "--size") {
+            const char* v = value();
+            if (sscanf(v, "%dx%d", &opt.width, &opt.height) != 2) {
+                throw std::runtime_error(std::string("invalid size: ") + v);
+            }
+        } else if (a == "--io") {
+            std::string v = value();
+            opt.io = v == "mmap" ? IO_MMAP :
+                     v == "uring" ? IO_URING :
+                     v == "threads" ? IO_THREADS : -1;
+            if (opt.io < 0) {
+                throw std::runtime_error("unknown io: " + v);
+            }
+        } else if (a == "--queue-depth") {
+            opt.queue_depth = atoi(value());
+            if (opt.queue_depth < 1) {
+                throw std::runtime_error("--queue-depth must be 1 or more.");
+            }
+        } else if (a == "--io-threads") {
+            opt.io_threads = atoi(value());
+            if (opt.io_threads < 1) {
+                throw std::runtime_error("--io-threads must be 1 or more.");
+            }
+        } else if (a == "--jobs") {
+            opt.jobs = atoi(value());
+            if (opt.jobs < 1) {
+                throw std::runtime_error("--jobs must be 1 or more.");
+            }
+        } else if (a == "--shard") {
+            const char* v = value();
+            if (sscanf(v, "%d/%d", &opt.shard, &opt.shards) != 2 ||
+                opt.shards < 1 || opt.shard < 0 || opt.shard >= opt.shards) {
+                throw std::runtime_error(std::string("invalid shard: ") + v);
+            }
+        } else if (a == "--merge") {
+            opt.merge = true;
+        } else if (a == "--daemon") {
+            opt.daemon = true;
+        } else if (a == "--loadgen") {
+            opt.loadgen = true;
+        } else if (a == "--shm") {
+            opt.shm_name = value();
+        } else if (a == "--slots") {
+            opt.slots = atoi(value());
+            if (opt.slots < 1) {
+                throw std::runtime_error("--slots must be 1 or more.");
+            }
+        } else if (a == "--clients") {
+            opt.clients = atoi(value());
+            if (opt.clients < 1) {
+                throw std::runtime_error("--clients must be 1 or more.");
+            }
+        } else if (a == "--requests") {
+            opt.requests = atoi(value());
+            if (opt.requests < 1) {
+                throw std::runtime_error("--requests must be 1 or more.");
+            }
+        } else if (a == "--narrow") {
+            opt.narrow = true;
+        } else if (a == "--bench") {
+            opt.bench = true;
+        } else if (a == "-h" || a == "--help") {
+            usage();
+            exit(0);
+        } else if (a.size() > 1 && a[0] == '-') {
+            throw std::runtime_error("unknown option: " + a);
+        } else {
+            opt.inputs.push_back(argv[i]);
+        }
+    }
+
+    if (opt.depth > 0 && (opt.bench || opt.batch || opt.merge || opt.daemon || opt.loadgen)) {
+        throw std::runtime_error("--depth is available only in the stream mode.");
+    }
+    if (opt.yv24 && (opt.bench || opt.batch || opt.merge || opt.daemon || opt.loadgen)) {
+        throw std::runtime_error("--yv24 is available only in the stream mode.");
+    }
+    if (opt.yv24 && (opt.yuy2 || opt.lshift)) {
+        throw std::runtime_error("--yv24 takes no --yuy2, --uyvy and --lshift.");
+    }
+    // the batch modes take the luma of yv16 from the input as is.
+    const bool convert = opt.out_matrix >= 0 || opt.out_range >= 0;
+    if (convert && (opt.bench || opt.batch || opt.merge || opt.daemon || opt.loadgen)) {
+        throw std::runtime_error("--out-matrix and --out-range are available only in the stream mode.");
+    }
+    if (convert && (opt.yv24 || opt.depth > 0)) {
+        throw std::runtime_error("--out-matrix and --out-range take no --yv24 and --depth.");
+    }
+    if (opt.bench) {
+        if (opt.batch || opt.merge || opt.daemon || opt.loadgen || !opt.inputs.empty()) {
+            throw std::runtime_error("--bench takes no files.");
+        }
+    } else if (opt.daemon || opt.loadgen) {
+        if (opt.daemon == opt.loadgen || opt.batch || opt.merge || !opt.inputs.empty()) {
+            throw std::runtime_error("--daemon and --loadgen take no files.");
+        }
+        if (opt.loadgen && (opt.width <= 0 || opt.height <= 0)) {
+            throw std::runtime_error("--loadgen needs --size.");
+        }
+    } else if (opt.merge) {
+        if (opt.batch || opt.inputs.empty() || !opt.output) {
+            throw std::runtime_error("merge needs -o <output>|- and one or more parts.");
+        }
+    } else if (!opt.batch) {
+        // yv12to422 [input] [output]
+        if (opt.inputs.size() > 2 || (opt.inputs.size() == 2 && opt.output)) {
+            throw std::runtime_error("too many arguments.");
+        }
+        if (opt.inputs.size() == 2) {
+            opt.output = opt.inputs[1];
+            opt.inputs.pop_back();
+        }
+    } else if (opt.inputs.empty() || !opt.output) {
+        throw std::runtime_error("batch mode needs -o <dir>|- and one or more inputs.");
+    } else if (opt.io != IO_MMAP && strcmp(opt.output, "-") == 0) {
+        throw std::runtime_error("--io uring|threads needs -o <dir>.");
+    } else if (opt.jobs > 1 && (opt.io != IO_MMAP || strcmp(opt.output, "-") == 0)) {
+        throw std::runtime_error("--jobs needs --io mmap and -o <dir>.");
+    }
+    return opt;
+}
+
+
+void get_params(const options& opt, const y4m_header& header,
+                yv12to422_params_t& params)
+{
+    bool interlaced;
+    int cplace;
+    y4m_get_chroma_placement(header, interlaced, cplace);
+    if (opt.interlaced >= 0) {
+        interlaced = opt.interlaced != 0;
+        if (opt.cplace < 0 && header.interlace != 't' && header.interlace != 'b') {
+            cplace = interlaced ? 2 : 1;
+        }
+    }
+    if (opt.cplace >= 0) {
+        cplace = opt.cplace;
+    }
+
+    const int bits = y4m_bit_depth(header);
+    if (bits > 8 && opt.yuy2) {
+        throw std::runtime_error("--yuy2 and --uyvy need 8bit input.");
+    }
+    if (opt.depth > 0 && (bits > 8 || opt.yuy2)) {
+        throw std::runtime_error("--depth needs 8bit input and planar output.");
+    }
+    if ((opt.out_matrix >= 0 || opt.out_range >= 0) && bits > 8) {
+        throw std::runtime_error("--out-matrix and --out-range need 8bit input.");
+    }
+
+    int simd = opt.simd;
+    if (simd < 0) {
+        simd = yv12to422_has_avx512() ? YV12TO422_SIMD_AVX512 :
+               yv12to422_has_avx2() ? YV12TO422_SIMD_AVX2 : YV12TO422_SIMD_SSE2;
+    }
+
+    yv12to422_default_params(&params, header.width, header.height);
+    params.interlaced = interlaced;
+    params.cplace = cplace;
+    params.itype = opt.itype;
+    params.lshift = opt.lshift;
+    params.b = opt.b;
+    params.c = opt.c;
+    params.output = opt.uyvy ? YV12TO422_OUTPUT_UYVY :
+                    opt.yuy2 ? YV12TO422_OUTPUT_YUY2 :
+                    opt.yv24 ? YV12TO422_OUTPUT_YV24 : YV12TO422_OUTPUT_YV16;
+    params.simd = simd;
+    params.threads = opt.threads;
+    params.narrow = opt.narrow ? 1 : 0;
+    params.bits = bits;
+    params.output_bits = opt.depth;
+    params.hsiting = opt.hsiting >= 0 ? opt.hsiting : y4m_get_horizontal_siting(header);
+    params.matrix = opt.matrix;
+    params.full_range = opt.range >= 0 ? opt.range : y4m_get_full_range(header);
+    params.out_matrix = opt.out_matrix;
+    params.out_full_range = opt.out_range;
+}
+
+
+y4m_header get_output_header(const options& opt, const y4m_header& header)
+{
+    y4m_header out = header;
+    const int bits = opt.depth > 0 ? opt.depth : y4m_bit_depth(header);
+    const std::string css = opt.yv24 ? "444" : "422";
+    out.chroma = bits > 8 ? css + "p" + std::to_string(bits) : css;
+    out.tags.push_back(opt.uyvy ? "XPACKED=UYVY" : opt.yuy2 ? "XPACKED=YUY2" :
+                       bits > 8 ? "XYSCSS=" + css + "P" + std::to_string(bits) :
+                       "XYSCSS=" + css);
+    if (opt.out_range >= 0) {
+        y4m_set_full_range(out, opt.out_range != 0);
+    }
+    if (opt.shards > 1) {
+        // for --merge. (see merge.cpp)
+        out.tags.push_back("XSHARD=" + std::to_string(opt.shard) + "/" + std::to_string(opt.shards));
+    }
+    return out;
+}
@@ -0,0 +1,96 @@
+/*
+  options.h
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+
+#ifndef YV12TO422_CLI_OPTIONS_H
+#define YV12TO422_CLI_OPTIONS_H
+
+#include <vector>
+
+#include "libyv12to422.h"
+#include "y4m.h"
+
+
+enum {
+    IO_MMAP,
+    IO_URING,
+    IO_THREADS,
+};
+
+
+struct options {
+    std::vector<const char*> inputs;
+    const char* output = nullptr;
+    int interlaced = -1;        // -1: from the y4m header
+    int cplace = -1;            // -1: from the y4m header
+    int itype = 2;
+    int lshift = 0;
+    double b = 0.0;
+    double c = 0.75;
+    int yuy2 = 0;               // packed output, yuy2 or uyvy
+    bool uyvy = false;
+    int depth = 0;              // 10 or 16: 8bit input to 10 or 16bit output
+    bool yv24 = false;          // 4:4:4 planar output
+    int hsiting = -1;           // -1: from the y4m header
+    int matrix = YV12TO422_MATRIX_BT601;    // of the source
+    int out_matrix = -1;        // -1: same as matrix
+    int range = -1;             // 0: limited, 1: full. -1: from the y4m header
+    int out_range = -1;         // -1: same as range
+    int threads = 1;
+    int simd = -1;              // -1: best available
+    bool batch = false;
+    int width = 0;              // frame size of raw .yuv input (batch)
+    int height = 0;
+    int io = IO_MMAP;           // batch I/O engine
+    int queue_depth = 8;        // frames in flight per file (uring/threads)
+    int io_threads = 4;         // workers of the threads engine
+    int jobs = 1;               // batch worker threads (mmap to files)
+    int shard = 0;              // batch converts only the shard-th of
+    int shards = 1;             // shards equal frame ranges of each input
+    bool merge = false;         // concatenate shard outputs
+    bool daemon = false;        // serve the shared memory ring
+    bool loadgen = false;       // measure a running daemon
+    const char* shm_name = "/yv12to422";
+    int slots = 8;              // slots of the ring (daemon)
+    int clients = 1;            // client threads (loadgen)
+    int requests = 1000;        // requests per client (loadgen)
+    bool narrow = false;        // narrow mode of libyv12to422
+    bool bench = false;         // measure narrow frames
+};
+
+
+// throws std::runtime_error on bad arguments.
+options parse_options(int argc, char** argv);
+
+void usage();
+
+// fills params for a stream described by header (the options override it).
+void get_params(const options& opt, const y4m_header& header,
+                yv12to422_params_t& params);
+
+// the header of the converted stream.
+y4m_header get_output_header(const options& opt, const y4m_header& header);
+
+#endif
@@ -0,0 +1,305 @@
+/*
+  shm_daemon.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+
+/*
+  --daemon: owns the conversion workers for local clients. (see shm_ring.h)
+
+  Every worker waits on the submit counter, takes a submitted slot and
+  converts it in place. Each worker keeps its own engines (one per distinct
+  request) and its own scratch area, so workers share nothing but the ring.
+  SIGINT/SIGTERM stop the daemon and remove the shared memory object.
+
+  Clients can write to the mapping at any time, so a worker copies the
+  request out of the slot before it checks it, converts by the copy, and
+  writes back only the status. The geometry of the ring is taken from the
+  daemon, not from the header in the mapping. Requests are limited to the
+  frame size of --size, and at most MAX_ENGINES engines are kept.
+*/
+
+
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "batch_common.h"
+#include "shm_ring.h"
+
+#if defined(__linux__)
+
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+using engine_key = std::tuple<int, int, int, int, int, int, double, double, int>;
+
+// a new engine beyond this many drops the cached ones.
+static const size_t MAX_ENGINES = 16;
+
+
+// the ring as the daemon created it.
+struct ring_layout {
+    uint32_t num_slots;
+    size_t slot_size;
+    int max_width;
+    int max_height;
+};
+
+
+class worker {
+    const yv12to422_params_t& defaults;
+    const ring_layout layout;
+    shm_ring_header* header;
+    shm_slot* slots;
+    uint8_t* data;
+    std::map<engine_key, yv12to422_t> engines;
+    scratch_buffer scratch;
+    uint32_t next;
+
+    // the plane lies in the data of the slot.
+    bool plane_in_slot(uint64_t offset, int pitch, size_t row, int rows) const
+    {
+        return pitch > 0 && (size_t)pitch >= row &&
+               offset <= layout.slot_size &&
+               (uint64_t)pitch * (rows - 1) + row <= layout.slot_size - offset;
+    }
+
+    int convert(const shm_request& r, uint8_t* slot_data)
+    {
+        if (r.width <= 0 || r.height <= 0 || r.width % 2 != 0 ||
+            r.width > layout.max_width || r.height > layout.max_height ||
+            !std::isfinite(r.b) || !std::isfinite(r.c) ||
+            (r.output != YV12TO422_OUTPUT_YV16 && r.output != YV12TO422_OUTPUT_YUY2 &&
+             r.output != YV12TO422_OUTPUT_UYVY)) {
+            return YV12TO422_ERR_INVALID_PARAM;
+        }
+        // yuy2 or uyvy.
+        const bool yuy2 = r.output != YV12TO422_OUTPUT_YV16;
+        const int w = r.width;
+        const int h = r.height;
+        // yv16 luma which stays where the source luma is.
+        const bool keep_luma = !yuy2 && r.dst[0] == r.src[0] && r.dst_pitch[0] == r.src_pitch[0];
+
+        bool ok = plane_in_slot(r.src[0], r.src_pitch[0], w, h) &&
+                  plane_in_slot(r.src[1], r.src_pitch[1], w / 2, h / 2) &&
+                  plane_in_slot(r.src[2], r.src_pitch[2], w / 2, h / 2);
+        if (yuy2) {
+            ok = ok && plane_in_slot(r.dst[0], r.dst_pitch[0], (size_t)w * 2, h);
+        } else {
+            ok = ok && (keep_luma || plane_in_slot(r.dst[0], r.dst_pitch[0], w, h)) &&
+                 plane_in_slot(r.dst[1], r.dst_pitch[1], w / 2, h) &&
+                 plane_in_slot(r.dst[2], r.dst_pitch[2], w / 2, h);
+        }
+        if (!ok) {
+            return YV12TO422_ERR_INVALID_SIZE;
+        }
+
+        const engine_key key(w, h, r.interlaced, r.itype, r.cplace, r.lshift,
+                             r.b, r.c, r.output);
+        auto it = engines.find(key);
+        if (it == engines.end()) {
+            yv12to422_params_t p = defaults;
+            p.width = w;
+            p.height = h;
+            p.interlaced = r.interlaced;
+            p.itype = r.itype;
+            p.cplace = r.cplace;
+            p.lshift = r.lshift;
+            p.b = r.b;
+            p.c = r.c;
+            p.output = r.output;
+            yv12to422_t ctx;
+            int err = yv12to422_init(&ctx, &p);
+            if (err != YV12TO422_OK) {
+                return err;
+            }
+            if (engines.size() >= MAX_ENGINES) {
+                engines.clear();
+            }
+            it = engines.emplace(key, ctx).first;
+        }
+        const yv12to422_t& ctx = it->second;
+        scratch.reserve(yv12to422_scratch_size(&ctx));
+
+        yv12to422_src_t s;
+        yv12to422_dst_t d;
+        for (int i = 0; i < 3; ++i) {
+            s.data[i] = slot_data + r.src[i];
+            s.pitch[i] = r.src_pitch[i];
+            d.data[i] = slot_data + r.dst[i];
+            d.pitch[i] = r.dst_pitch[i];
+        }
+        if (yuy2) {
+            d.data[1] = d.data[2] = nullptr;
+        } else if (keep_luma) {
+            d.data[0] = nullptr;
+        }
+        return yv12to422_convert(&ctx, &s, &d, scratch.data);
+    }
+
+    // claims a submitted slot.
+    bool take(uint32_t& slot)
+    {
+        const uint32_t n = layout.num_slots;
+        for (uint32_t i = 0; i < n; ++i) {
+            const uint32_t s = (next + i) % n;
+            uint32_t expected = SHM_SLOT_SUBMITTED;
+            if (slots[s].state.compare_exchange_strong(expected, SHM_SLOT_BUSY,
+                                                       std::memory_order_acquire)) {
+                next = s + 1;
+                slot = s;
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    worker(const yv12to422_params_t& d, const ring_layout& l, uint8_t* base,
+           size_t data_offset, uint32_t first) :
+        defaults(d), layout(l), header((shm_ring_header*)base),
+        slots((shm_slot*)(base + SHM_SLOTS_OFFSET)), data(base + data_offset),
+        next(first) {}
+
+    void run()
+    {
+        while (!header->shutdown.load()) {
+            const uint32_t seq = header->submit_seq.load();
+            uint32_t s;
+            if (!take(s)) {
+                futex_wait(header->submit_seq, seq, -1);
+                continue;
+            }
+            const shm_request r = slots[s].req;
+            slots[s].req.status = convert(r, data + s * layout.slot_size);
+            slots[s].state.store(SHM_SLOT_DONE, std::memory_order_release);
+            futex_wake(slots[s].state, INT_MAX);
+        }
+    }
+};
+
+
+int run_daemon(const options& opt)
+{
+    const int width = opt.width > 0 ? opt.width : 1920;
+    const int height = opt.height > 0 ? opt.height : 1080;
+    const size_t slot_size = shm_slot_size(width, height);
+    size_t data_offset;
+    const size_t size = shm_ring_size(opt.slots, slot_size, data_offset);
+
+    int fd = shm_open(opt.shm_name, O_RDWR | O_CREAT | O_EXCL, 0660);
+    if (fd < 0) {
+        if (errno == EEXIST) {
+            throw std::runtime_error(std::string(opt.shm_name) + " exists. another daemon "
+                                     "is running, or remove /dev/shm" + opt.shm_name + ".");
+        }
+        throw sys_error("failed to create", opt.shm_name);
+    }
+    if (ftruncate(fd, size) < 0) {
+        shm_unlink(opt.shm_name);
+        throw sys_error("failed to resize", opt.shm_name);
+    }
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        shm_unlink(opt.shm_name);
+        throw sys_error("failed to map", opt.shm_name);
+    }
+    uint8_t* base = (uint8_t*)p;
+
+    // the object is zero filled: every slot is SHM_SLOT_FREE.
+    shm_ring_header* header = (shm_ring_header*)base;
+    header->version = SHM_VERSION;
+    header->num_slots = opt.slots;
+    header->slot_size = slot_size;
+    header->data_offset = data_offset;
+    __atomic_store_n(&header->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+
+    // the engine options which are not in the requests (simd, threads).
+    y4m_header h;
+    h.width = width;
+    h.height = height;
+    h.interlace = '?';
+    yv12to422_params_t defaults;
+    get_params(opt, h, defaults);
+    defaults.unaligned = 1;
+
+    // only this thread takes the signals.
+    sigset_t sigs;
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGINT);
+    sigaddset(&sigs, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &sigs, nullptr);
+
+    const ring_layout layout = {(uint32_t)opt.slots, slot_size, width, height};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < opt.jobs; ++i) {
+        threads.emplace_back([&, i] {
+            worker(defaults, layout, base, data_offset, (uint32_t)i).run();
+        });
+    }
+    fprintf(stderr, "yv12to422: serving %s (%d slots for %dx%d, %d workers)\n",
+            opt.shm_name, opt.slots, width, height, opt.jobs);
+
+    int sig;
+    sigwait(&sigs, &sig);
+
+    header->shutdown.store(1);
+    header->submit_seq.fetch_add(1);
+    futex_wake(header->submit_seq, INT_MAX);
+    for (auto& t : threads) {
+        t.join();
+    }
+    // clients blocked on a slot or on a free slot see the shutdown.
+    header->free_seq.fetch_add(1);
+    futex_wake(header->free_seq, INT_MAX);
+    for (int i = 0; i < opt.slots; ++i) {
+        futex_wake(((shm_slot*)(base + SHM_SLOTS_OFFSET))[i].state, INT_MAX);
+    }
+
+    shm_unlink(opt.shm_name);
+    munmap(base, size);
+    close(fd);
+    return 0;
+}
+
+#else
+
+int run_daemon(const options&)
+{
+    throw std::runtime_error("daemon mode is available only on Linux.");
+}
+
+#endif
@@ -0,0 +1,216 @@
+/*
+  shm_ring.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "shm_ring.h"
+
+#if defined(__linux__)
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+
+static const size_t PAGE = 4096;
+
+
+static inline size_t align_page(size_t n)
+{
+    return (n + PAGE - 1) & ~(PAGE - 1);
+}
+
+
+size_t shm_ring_size(uint32_t num_slots, size_t slot_size, size_t& data_offset)
+{
+    data_offset = SHM_SLOTS_OFFSET + align_page(num_slots * sizeof(shm_slot));
+    return data_offset + num_slots * align_page(slot_size);
+}
+
+
+size_t shm_slot_size(int width, int height)
+{
+    const size_t luma = (size_t)width * height;
+    return align_page(luma * 3 + (size_t)(width / 2) * height);
+}
+
+
+bool shm_set_layout(shm_request& req, size_t slot_size)
+{
+    const int w = req.width;
+    const int h = req.height;
+    if (w <= 0 || h <= 0) {
+        return false;
+    }
+    const size_t luma = (size_t)w * h;
+    const size_t chroma = (size_t)(w / 2) * (h / 2);
+
+    if (req.output != YV12TO422_OUTPUT_YV16) {
+        // yuy2 | Y | U | V
+        req.dst[0] = req.dst[1] = req.dst[2] = 0;
+        req.dst_pitch[0] = w * 2;
+        req.dst_pitch[1] = req.dst_pitch[2] = 0;
+        req.src[0] = luma * 2;
+        req.src[1] = luma * 3;
+    } else {
+        // Y | U422 | V422 | U | V
+        req.dst[0] = 0;
+        req.dst[1] = luma;
+        req.dst[2] = luma + chroma * 2;
+        req.dst_pitch[0] = w;
+        req.dst_pitch[1] = req.dst_pitch[2] = w / 2;
+        req.src[0] = 0;
+        req.src[1] = luma * 2;
+    }
+    req.src[2] = req.src[1] + chroma;
+    req.src_pitch[0] = w;
+    req.src_pitch[1] = req.src_pitch[2] = w / 2;
+    return req.src[2] + chroma <= slot_size;
+}
+
+
+void futex_wait(std::atomic<uint32_t>& word, uint32_t value, int timeout_ms)
+{
+    struct timespec ts = { timeout_ms / 1000, (timeout_ms % 1000) * 1000000L };
+    // not FUTEX_PRIVATE_FLAG: the word is shared between processes.
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, value,
+            timeout_ms < 0 ? nullptr : &ts, nullptr, 0);
+}
+
+
+void futex_wake(std::atomic<uint32_t>& word, int count)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, count,
+            nullptr, nullptr, 0);
+}
+
+
+shm_client::shm_client(const char* name) : fd(-1), base(nullptr), size(0)
+{
+    fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("failed to open ") + name + ": " +
+                                 strerror(errno) + " (is the daemon running?)");
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < SHM_SLOTS_OFFSET) {
+        close(fd);
+        throw std::runtime_error(std::string(name) + " is not a conversion ring.");
+    }
+    size = st.st_size;
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error(std::string("failed to map ") + name + ": " + strerror(errno));
+    }
+    base = (uint8_t*)p;
+    header = (shm_ring_header*)base;
+    slots = (shm_slot*)(base + SHM_SLOTS_OFFSET);
+
+    size_t data_offset;
+    if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC ||
+        header->version != SHM_VERSION ||
+        shm_ring_size(header->num_slots, header->slot_size, data_offset) != size ||
+        data_offset != header->data_offset) {
+        munmap(base, size);
+        close(fd);
+        throw std::runtime_error(std::string(name) + " is not a conversion ring of this version.");
+    }
+}
+
+
+shm_client::~shm_client()
+{
+    munmap(base, size);
+    close(fd);
+}
+
+
+uint32_t shm_client::acquire()
+{
+    const uint32_t n = header->num_slots;
+    for (;;) {
+        const uint32_t seq = header->free_seq.load();
+        const uint32_t start = header->next_slot.fetch_add(1, std::memory_order_relaxed);
+        for (uint32_t i = 0; i < n; ++i) {
+            const uint32_t s = (start + i) % n;
+            uint32_t expected = SHM_SLOT_FREE;
+            if (slots[s].state.compare_exchange_strong(expected, SHM_SLOT_CLAIMED,
+                                                       std::memory_order_acquire)) {
+                return s;
+            }
+        }
+        if (header->shutdown.load()) {
+            throw std::runtime_error("the daemon has stopped.");
+        }
+        header->free_waiters.fetch_add(1);
+        futex_wait(header->free_seq, seq, 100);
+        header->free_waiters.fetch_sub(1);
+    }
+}
+
+
+void shm_client::submit(uint32_t slot)
+{
+    slots[slot].state.store(SHM_SLOT_SUBMITTED, std::memory_order_release);
+    header->submit_seq.fetch_add(1);
+    futex_wake(header->submit_seq, 1);
+}
+
+
+int shm_client::wait(uint32_t slot)
+{
+    for (;;) {
+        const uint32_t state = slots[slot].state.load(std::memory_order_acquire);
+        if (state == SHM_SLOT_DONE) {
+            return slots[slot].req.status;
+        }
+        if (header->shutdown.load()) {
+            throw std::runtime_error("the daemon has stopped.");
+        }
+        futex_wait(slots[slot].state, state, 100);
+    }
+}
+
+
+void shm_client::release(uint32_t slot)
+{
+    slots[slot].state.store(SHM_SLOT_FREE, std::memory_order_release);
+    header->free_seq.fetch_add(1);
+    if (header->free_waiters.load() > 0) {
+        futex_wake(header->free_seq, INT_MAX);
+    }
+}
+
+#endif
@@ -0,0 +1,182 @@
+/*
+  shm_ring.h
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+
+/*
+  Shared memory transport of the conversion daemon (--daemon).
+
+  The daemon creates a POSIX shared memory object with a ring of frame
+  slots. A client claims a free slot, writes a yv12 frame and a request
+  into it, and marks it submitted. A worker of the daemon converts the
+  frame into the same slot and marks it done. The client reads the result
+  and frees the slot. The states of the slots and the submit counter are
+  futex words, so waiting sides sleep in the kernel and nothing is copied
+  through a socket.
+
+    mapping:  shm_ring_header | shm_slot[num_slots] | data of slot 0 | ...
+
+  A plane is given by its offset in the data of the slot and its pitch. For
+  yv16 output, a destination luma at the offset of the source luma means
+  the luma is left where it is.
+*/
+
+
+#ifndef YV12TO422_CLI_SHM_RING_H
+#define YV12TO422_CLI_SHM_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "options.h"
+
+
+static const uint32_t SHM_MAGIC = 0x32323459;  // "Y422"
+static const uint32_t SHM_VERSION = 1;
+static const size_t SHM_SLOTS_OFFSET = 4096;    // the header takes one page
+
+
+enum {
+    SHM_SLOT_FREE,
+    SHM_SLOT_CLAIMED,       // a client is writing the request
+    SHM_SLOT_SUBMITTED,
+    SHM_SLOT_BUSY,          // a worker is converting
+    SHM_SLOT_DONE,
+};
+
+
+// the arguments of YV12To422() and the planes in the slot.
+struct shm_request {
+    int32_t width;
+    int32_t height;
+    int32_t interlaced;
+    int32_t itype;
+    int32_t cplace;
+    int32_t lshift;
+    double b;
+    double c;
+    int32_t output;         // YV12TO422_OUTPUT_*
+    int32_t status;         // set by the daemon. YV12TO422_OK or an error
+    uint64_t src[3];        // Y, U, V offsets in the data of the slot
+    uint64_t dst[3];        // Y, U, V for yv16. dst[0] only for yuy2/uyvy
+    int32_t src_pitch[3];
+    int32_t dst_pitch[3];
+};
+
+
+struct alignas(64) shm_slot {
+    std::atomic<uint32_t> state;    // SHM_SLOT_*. futex word
+    shm_request req;
+};
+
+
+struct shm_ring_header {
+    uint32_t magic;                 // SHM_MAGIC when the ring is ready
+    uint32_t version;
+    uint32_t num_slots;
+    uint32_t reserved;
+    uint64_t slot_size;             // bytes of data per slot
+    uint64_t data_offset;           // of the data of slot 0 in the mapping
+    alignas(64) std::atomic<uint32_t> submit_seq;   // futex word of the workers
+    std::atomic<uint32_t> shutdown;
+    alignas(64) std::atomic<uint32_t> free_seq;     // futex word of the clients
+    std::atomic<uint32_t> free_waiters;
+    alignas(64) std::atomic<uint32_t> next_slot;    // where clients start looking
+};
+
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && sizeof(std::atomic<uint32_t>) == 4,
+              "futex words must be plain 32bit integers.");
+
+
+// bytes of the mapping for num_slots slots of slot_size bytes.
+size_t shm_ring_size(uint32_t num_slots, size_t slot_size, size_t& data_offset);
+
+// bytes of a slot for frames up to width x height in either output.
+size_t shm_slot_size(int width, int height);
+
+// a tightly packed layout of req->width x req->height for req->output:
+// yv16 overwrites the source chroma and keeps the luma, yuy2 is written in
+// front of the source. false if it does not fit into slot_size.
+bool shm_set_layout(shm_request& req, size_t slot_size);
+
+
+void futex_wait(std::atomic<uint32_t>& word, uint32_t value, int timeout_ms);
+
+void futex_wake(std::atomic<uint32_t>& word, int count);
+
+
+class shm_client {
+    int fd;
+    uint8_t* base;
+    size_t size;
+    shm_ring_header* header;
+    shm_slot* slots;
+
+public:
+    // throws std::runtime_error if the daemon is not running.
+    explicit shm_client(const char* name);
+    ~shm_client();
+    shm_client(const shm_client&) = delete;
+    shm_client& operator=(const shm_client&) = delete;
+
+    uint32_t num_slots() const
+    {
+        return header->num_slots;
+    }
+    size_t slot_size() const
+    {
+        return header->slot_size;
+    }
+
+    // claims a free slot. blocks while all of them are in use.
+    uint32_t acquire();
+
+    shm_request& request(uint32_t slot)
+    {
+        return slots[slot].req;
+    }
+    uint8_t* data(uint32_t slot)
+    {
+        return base + header->data_offset + slot * header->slot_size;
+    }
+
+    void submit(uint32_t slot);
+
+    // waits until the daemon has converted the slot. returns its status.
+    // throws std::runtime_error if the daemon stops.
+    int wait(uint32_t slot);
+
+    void release(uint32_t slot);
+};
+
+
+// --daemon (shm_daemon.cpp)
+int run_daemon(const options& opt);
+
+// --loadgen (loadgen.cpp)
+int run_loadgen(const options& opt);
+
+#endif
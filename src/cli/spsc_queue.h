@@ -0,0 +1,114 @@
+/*
+  spsc_queue.h
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+#ifndef YV12TO422_SPSC_QUEUE_H
+#define YV12TO422_SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+
+/*
+  Bounded lock-free queue for exactly one producer thread and one consumer
+  thread. push()/pop() spin for a while and then yield, since the stages
+  of the pipeline wait for each other only for the time of one frame.
+*/
+template <typename T>
+class spsc_queue {
+    static constexpr size_t CACHE_LINE = 64;
+
+    std::vector<T> ring;
+    const size_t mask;
+    alignas(CACHE_LINE) std::atomic<size_t> head;   // written by consumer
+    alignas(CACHE_LINE) std::atomic<size_t> tail;   // written by producer
+
+    static size_t round_up_pow2(size_t n)
+    {
+        size_t x = 1;
+        while (x < n) {
+            x <<= 1;
+        }
+        return x;
+    }
+
+    static void backoff(int& count)
+    {
+        if (++count > 64) {
+            std::this_thread::yield();
+        }
+    }
+
+public:
+    explicit spsc_queue(size_t capacity) :
+        ring(round_up_pow2(capacity)), mask(ring.size() - 1), head(0), tail(0)
+    {}
+
+    spsc_queue(const spsc_queue&) = delete;
+    spsc_queue& operator=(const spsc_queue&) = delete;
+
+    bool try_push(const T& v)
+    {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) > mask) {
+            return false;
+        }
+        ring[t & mask] = v;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& v)
+    {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        v = ring[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    void push(const T& v)
+    {
+        int count = 0;
+        while (!try_push(v)) {
+            backoff(count);
+        }
+    }
+
+    T pop()
+    {
+        T v;
+        int count = 0;
+        while (!try_pop(v)) {
+            backoff(count);
+        }
+        return v;
+    }
+};
+
+#endif
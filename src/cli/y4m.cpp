@@ -0,0 +1,234 @@
+/*
+  y4m.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "y4m.h"
+
+
+static const char Y4M_MAGIC[] = "YUV4MPEG2";
+static const char FRAME_MAGIC[] = "FRAME";
+static const size_t MAX_LINE = 4096;
+
+
+// reads up to '\n'. returns false if EOF comes before any character.
+static bool read_line(FILE* fp, std::string& line)
+{
+    line.clear();
+    int c;
+    while ((c = fgetc(fp)) != EOF) {
+        if (c == '\n') {
+            return true;
+        }
+        if (line.size() >= MAX_LINE) {
+            throw std::runtime_error("y4m: header line is too long.");
+        }
+        line.push_back(static_cast<char>(c));
+    }
+    if (line.empty()) {
+        return false;
+    }
+    throw std::runtime_error("y4m: unexpected end of stream.");
+}
+
+
+static std::vector<std::string> split(const std::string& line)
+{
+    std::vector<std::string> tokens;
+    size_t pos = 0;
+    while (pos < line.size()) {
+        size_t end = line.find(' ', pos);
+        if (end == std::string::npos) {
+            end = line.size();
+        }
+        if (end > pos) {
+            tokens.push_back(line.substr(pos, end - pos));
+        }
+        pos = end + 1;
+    }
+    return tokens;
+}
+
+
+void y4m_read_header(FILE* fp, y4m_header& header)
+{
+    std::string line;
+    if (!read_line(fp, line)) {
+        throw std::runtime_error("y4m: empty input.");
+    }
+    y4m_parse_header(line, header);
+}
+
+
+void y4m_parse_header(const std::string& line, y4m_header& header)
+{
+    auto tokens = split(line);
+    if (tokens.empty() || tokens[0] != Y4M_MAGIC) {
+        throw std::runtime_error("y4m: input is not YUV4MPEG2.");
+    }
+
+    header.width = 0;
+    header.height = 0;
+    header.interlace = '?';
+    header.chroma.clear();
+    header.tags.clear();
+
+    for (size_t i = 1; i < tokens.size(); ++i) {
+        const std::string& t = tokens[i];
+        const std::string value = t.substr(1);
+        switch (t[0]) {
+        case 'W':
+            header.width = atoi(value.c_str());
+            break;
+        case 'H':
+            header.height = atoi(value.c_str());
+            break;
+        case 'I':
+            header.interlace = value.empty() ? '?' : value[0];
+            break;
+        case 'C':
+            header.chroma = value;
+            break;
+        default:
+            if (t.compare(0, 7, "XYSCSS=") != 0) {
+                header.tags.push_back(t);
+            }
+        }
+    }
+
+    if (header.width <= 0 || header.height <= 0) {
+        throw std::runtime_error("y4m: invalid frame size.");
+    }
+}
+
+
+bool y4m_read_frame_header(FILE* fp)
+{
+    std::string line;
+    if (!read_line(fp, line)) {
+        return false;
+    }
+    if (line.compare(0, sizeof(FRAME_MAGIC) - 1, FRAME_MAGIC) != 0) {
+        throw std::runtime_error("y4m: broken frame header.");
+    }
+    return true;
+}
+
+
+std::string y4m_format_header(const y4m_header& header)
+{
+    std::string line = Y4M_MAGIC;
+    line += " W" + std::to_string(header.width) + " H" + std::to_string(header.height);
+    if (header.interlace != '?') {
+        line += " I";
+        line += header.interlace;
+    }
+    if (!header.chroma.empty()) {
+        line += " C" + header.chroma;
+    }
+    for (auto& t : header.tags) {
+        line += " " + t;
+    }
+    line += "\n";
+    return line;
+}
+
+
+void y4m_write_header(FILE* fp, const y4m_header& header)
+{
+    fputs(y4m_format_header(header).c_str(), fp);
+}
+
+
+void y4m_write_frame_header(FILE* fp)
+{
+    fputs(FRAME_MAGIC, fp);
+    fputc('\n', fp);
+}
+
+
+void y4m_get_chroma_placement(const y4m_header& header, bool& interlaced, int& cplace)
+{
+    const std::string& c = header.chroma;
+    if (!c.empty() && c != "420" && c != "420jpeg" && c != "420mpeg2" &&
+        c != "420paldv" && y4m_bit_depth(header) == 8) {
+        throw std::runtime_error("y4m: input must be C420, C420jpeg, C420mpeg2, C420paldv "
+                                 "or C420p9 to C420p16.");
+    }
+
+    interlaced = header.interlace == 't' || header.interlace == 'b';
+    if (!interlaced) {
+        cplace = 1;
+    } else if (c == "420paldv") {
+        cplace = 3;
+    } else {
+        cplace = 2;
+    }
+}
+
+
+int y4m_get_horizontal_siting(const y4m_header& header)
+{
+    const std::string& c = header.chroma;
+    return c == "420mpeg2" || c == "420paldv" ? 0 : 1;
+}
+
+
+static const char COLORRANGE[] = "XCOLORRANGE=";
+
+
+int y4m_get_full_range(const y4m_header& header)
+{
+    for (const std::string& tag : header.tags) {
+        if (tag.compare(0, sizeof(COLORRANGE) - 1, COLORRANGE) == 0) {
+            return tag.compare(sizeof(COLORRANGE) - 1, std::string::npos, "FULL") == 0;
+        }
+    }
+    return 0;
+}
+
+
+void y4m_set_full_range(y4m_header& header, bool full)
+{
+    auto& tags = header.tags;
+    for (auto it = tags.begin(); it != tags.end();) {
+        it = it->compare(0, sizeof(COLORRANGE) - 1, COLORRANGE) == 0 ? tags.erase(it) : it + 1;
+    }
+    tags.push_back(std::string(COLORRANGE) + (full ? "FULL" : "LIMITED"));
+}
+
+
+int y4m_bit_depth(const y4m_header& header)
+{
+    const std::string& c = header.chroma;
+    if (c.size() < 5 || c.compare(0, 4, "420p") != 0) {
+        return 8;
+    }
+    const int bits = atoi(c.c_str() + 4);
+    return bits >= 9 && bits <= 16 && c == "420p" + std::to_string(bits) ? bits : 8;
+}
@@ -0,0 +1,76 @@
+/*
+  y4m.h
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+#ifndef YV12TO422_Y4M_H
+#define YV12TO422_Y4M_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+struct y4m_header {
+    int width;
+    int height;
+    char interlace;                 // 'p', 't', 'b', 'm' or '?'
+    std::string chroma;             // value of the C tag. empty if omitted
+    std::vector<std::string> tags;  // every other tag, kept as is
+};
+
+
+// all of these throw std::runtime_error on malformed streams.
+
+void y4m_read_header(FILE* fp, y4m_header& header);
+
+// line is the first line of the stream without '\n'.
+void y4m_parse_header(const std::string& line, y4m_header& header);
+
+// with the trailing '\n'.
+std::string y4m_format_header(const y4m_header& header);
+
+// returns false at the end of the stream.
+bool y4m_read_frame_header(FILE* fp);
+
+void y4m_write_header(FILE* fp, const y4m_header& header);
+
+void y4m_write_frame_header(FILE* fp);
+
+// interlaced/cplace which match the header. (see readme)
+void y4m_get_chroma_placement(const y4m_header& header, bool& interlaced, int& cplace);
+
+// params.hsiting of the header. 0 for C420mpeg2 and C420paldv, whose chroma
+// is co-sited with the even luma columns, 1 (centered) otherwise.
+int y4m_get_horizontal_siting(const y4m_header& header);
+
+// 1 for XCOLORRANGE=FULL, 0 (limited) otherwise.
+int y4m_get_full_range(const y4m_header& header);
+
+// replaces the XCOLORRANGE tag.
+void y4m_set_full_range(y4m_header& header, bool full);
+
+// 8 for C420*, 9 to 16 for C420p9 to C420p16 (uint16_t samples).
+int y4m_bit_depth(const y4m_header& header);
+
+#endif
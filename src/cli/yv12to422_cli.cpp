@@ -0,0 +1,336 @@
+/*
+  yv12to422_cli.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+/*
+  yv12to422 - YUV4MPEG2 4:2:0 to 4:2:2 stream converter.
+
+    ffmpeg -i in.mkv -f yuv4mpegpipe - | yv12to422 | x264 --demuxer y4m -o out.264 -
+
+  Reading, converting and writing run on three threads. Frames go around
+  two rings of preallocated buffers (reader -> converter -> reader and
+  converter -> writer -> converter) made of single-producer single-consumer
+  queues, so no stage ever waits on a lock. nullptr is the end of stream.
+*/
+
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+    #include <fcntl.h>
+    #include <io.h>
+#endif
+
+#include "batch.h"
+#include "libyv12to422.h"
+#include "options.h"
+#include "shm_ring.h"
+#include "spsc_queue.h"
+#include "y4m.h"
+
+
+static const int QUEUE_DEPTH = 4;
+static const size_t IO_BUFFER_SIZE = 1 << 20;
+
+
+struct frame {
+    uint8_t* data[3];
+    int pitch[3];
+    int width[3];               // bytes to read/write per row
+    int height[3];
+    int num_planes;
+    void* block;
+
+    frame(int num, const int* w, const int* h, int align) : num_planes(num)
+    {
+        size_t size = 0;
+        for (int i = 0; i < num; ++i) {
+            width[i] = w[i];
+            height[i] = h[i];
+            pitch[i] = (w[i] + align - 1) / align * align;
+            size += (size_t)pitch[i] * h[i];
+        }
+        block = aligned_malloc(size, align);
+        uint8_t* p = (uint8_t*)block;
+        for (int i = 0; i < num; ++i) {
+            data[i] = p;
+            p += (size_t)pitch[i] * h[i];
+        }
+    }
+
+    ~frame()
+    {
+        aligned_free(block);
+    }
+
+    static void* aligned_malloc(size_t size, int align)
+    {
+#ifdef _WIN32
+        void* p = _aligned_malloc(size, align);
+#else
+        void* p = nullptr;
+        if (posix_memalign(&p, align, size) != 0) {
+            p = nullptr;
+        }
+#endif
+        if (!p) {
+            throw std::runtime_error("failed to allocate frame buffer.");
+        }
+        return p;
+    }
+
+    static void aligned_free(void* p)
+    {
+#ifdef _WIN32
+        _aligned_free(p);
+#else
+        free(p);
+#endif
+    }
+};
+
+
+struct pipeline {
+    spsc_queue<frame*> in_full, in_free, out_full, out_free;
+    std::atomic<bool> abort;
+    std::string error[3];       // reader, converter, writer
+
+    pipeline() :
+        in_full(QUEUE_DEPTH + 1), in_free(QUEUE_DEPTH + 1),
+        out_full(QUEUE_DEPTH + 1), out_free(QUEUE_DEPTH + 1), abort(false)
+    {}
+};
+
+
+static void reader(pipeline& pl, FILE* fp)
+{
+    try {
+        while (!pl.abort.load(std::memory_order_relaxed)) {
+            frame* f = pl.in_free.pop();
+            if (!y4m_read_frame_header(fp)) {
+                break;
+            }
+            for (int i = 0; i < f->num_planes; ++i) {
+                uint8_t* p = f->data[i];
+                for (int y = 0; y < f->height[i]; ++y, p += f->pitch[i]) {
+                    if (fread(p, 1, f->width[i], fp) != (size_t)f->width[i]) {
+                        throw std::runtime_error("y4m: truncated frame.");
+                    }
+                }
+            }
+            pl.in_full.push(f);
+        }
+    } catch (std::exception& e) {
+        pl.error[0] = e.what();
+        pl.abort = true;
+    }
+    pl.in_full.push(nullptr);
+}
+
+
+static void converter(pipeline& pl, const yv12to422_t* ctx, void* scratch)
+{
+    const bool yuy2 = ctx->params.output == YV12TO422_OUTPUT_YUY2 ||
+                      ctx->params.output == YV12TO422_OUTPUT_UYVY;
+    frame* f;
+    while ((f = pl.in_full.pop()) != nullptr) {
+        frame* o = pl.out_free.pop();
+        if (pl.abort.load(std::memory_order_relaxed)) {
+            pl.in_free.push(f);
+            pl.out_free.push(o);
+            continue;
+        }
+
+        yv12to422_src_t s;
+        yv12to422_dst_t d;
+        for (int i = 0; i < 3; ++i) {
+            s.data[i] = f->data[i];
+            s.pitch[i] = f->pitch[i];
+            d.data[i] = o->data[yuy2 ? 0 : i];
+            d.pitch[i] = o->pitch[yuy2 ? 0 : i];
+        }
+        int err = yv12to422_convert(ctx, &s, &d, scratch);
+        pl.in_free.push(f);
+        if (err != YV12TO422_OK) {
+            pl.error[1] = yv12to422_strerror(err);
+            pl.abort = true;
+            pl.out_free.push(o);
+            continue;
+        }
+        pl.out_full.push(o);
+    }
+    pl.out_full.push(nullptr);
+}
+
+
+static void writer(pipeline& pl, FILE* fp)
+{
+    frame* o;
+    while ((o = pl.out_full.pop()) != nullptr) {
+        if (!pl.abort.load(std::memory_order_relaxed)) {
+            y4m_write_frame_header(fp);
+            for (int i = 0; i < o->num_planes; ++i) {
+                const uint8_t* p = o->data[i];
+                for (int y = 0; y < o->height[i]; ++y, p += o->pitch[i]) {
+                    fwrite(p, 1, o->width[i], fp);
+                }
+            }
+            if (ferror(fp)) {
+                pl.error[2] = "failed to write output.";
+                pl.abort = true;
+            }
+        }
+        pl.out_free.push(o);
+    }
+    if (fflush(fp) != 0 && pl.error[2].empty()) {
+        pl.error[2] = "failed to write output.";
+    }
+}
+
+
+static FILE* open_file(const char* path, bool write)
+{
+    if (!path || strcmp(path, "-") == 0) {
+        FILE* fp = write ? stdout : stdin;
+#ifdef _WIN32
+        _setmode(_fileno(fp), _O_BINARY);
+#endif
+        return fp;
+    }
+    FILE* fp = fopen(path, write ? "wb" : "rb");
+    if (!fp) {
+        throw std::runtime_error(std::string("failed to open ") + path);
+    }
+    return fp;
+}
+
+
+static int run_stream(const options& opt)
+{
+    FILE* in = open_file(opt.inputs.empty() ? nullptr : opt.inputs[0], false);
+    y4m_header header;
+    y4m_read_header(in, header);
+
+    yv12to422_params_t params;
+    get_params(opt, header, params);
+
+    yv12to422_t ctx;
+    int err = yv12to422_init(&ctx, &params);
+    if (err != YV12TO422_OK) {
+        throw std::runtime_error(yv12to422_strerror(err));
+    }
+    const int align = yv12to422_memalign(&ctx);
+
+    FILE* out = open_file(opt.output, true);
+    setvbuf(in, nullptr, _IOFBF, IO_BUFFER_SIZE);
+    setvbuf(out, nullptr, _IOFBF, IO_BUFFER_SIZE);
+
+    y4m_write_header(out, get_output_header(opt, header));
+
+    // in bytes. samples of 9 to 16bit are uint16_t.
+    const int w = header.width * (params.bits > 8 ? 2 : 1);
+    const int out_w = header.width * (params.bits > 8 || params.output_bits > 8 ? 2 : 1);
+    const int h = header.height;
+    const int in_w[] = { w, w / 2, w / 2 };
+    const int in_h[] = { h, h / 2, h / 2 };
+    const int out_w_uv = opt.yv24 ? out_w : out_w / 2;
+    const int yv16_w[] = { out_w, out_w_uv, out_w_uv };
+    const int yv16_h[] = { h, h, h };
+    const int yuy2_w[] = { w * 2 };
+    const int yuy2_h[] = { h };
+
+    std::vector<std::unique_ptr<frame>> frames;
+    pipeline pl;
+    for (int i = 0; i < QUEUE_DEPTH; ++i) {
+        frames.emplace_back(new frame(3, in_w, in_h, align));
+        pl.in_free.push(frames.back().get());
+        if (opt.yuy2) {
+            frames.emplace_back(new frame(1, yuy2_w, yuy2_h, align));
+        } else {
+            frames.emplace_back(new frame(3, yv16_w, yv16_h, align));
+        }
+        pl.out_free.push(frames.back().get());
+    }
+
+    size_t scratch_size = yv12to422_scratch_size(&ctx);
+    void* scratch = scratch_size > 0 ? frame::aligned_malloc(scratch_size, align) : nullptr;
+
+    std::thread t_reader(reader, std::ref(pl), in);
+    std::thread t_writer(writer, std::ref(pl), out);
+    converter(pl, &ctx, scratch);
+    t_reader.join();
+    t_writer.join();
+
+    if (scratch) {
+        frame::aligned_free(scratch);
+    }
+    if (in != stdin) {
+        fclose(in);
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    for (auto& e : pl.error) {
+        if (!e.empty()) {
+            throw std::runtime_error(e);
+        }
+    }
+    return 0;
+}
+
+
+int main(int argc, char** argv)
+{
+    try {
+        options opt = parse_options(argc, argv);
+        if (opt.bench) {
+            return run_bench(opt);
+        }
+        if (opt.batch) {
+            return run_batch(opt);
+        }
+        if (opt.merge) {
+            return run_merge(opt);
+        }
+        if (opt.daemon) {
+            return run_daemon(opt);
+        }
+        if (opt.loadgen) {
+            return run_loadgen(opt);
+        }
+        return run_stream(opt);
+    } catch (std::exception& e) {
+        fprintf(stderr, "yv12to422: %s\n", e.what());
+        return 1;
+    }
+}
@@ -0,0 +1,57 @@
+/*
+  compat.h
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+#ifndef YV12TO422_COMPAT_H
+#define YV12TO422_COMPAT_H
+
+#if defined(_MSC_VER)
+    #pragma warning(disable:4752)
+#else
+    // vector types passed to class templates (the io policies of the
+    // kernels) lose their attributes. only sizeof is used there.
+    #pragma GCC diagnostic ignored "-Wignored-attributes"
+    #ifndef __forceinline
+        #define __forceinline inline __attribute__((always_inline))
+    #endif
+#endif
+
+#if !defined(_WIN32)
+    #ifndef __stdcall
+        #define __stdcall
+    #endif
+    #ifndef __cdecl
+        #define __cdecl
+    #endif
+    #include <strings.h>
+    #define _stricmp strcasecmp
+#endif
+
+#if defined(_WIN32)
+    #define YV12TO422_EXPORT __declspec(dllexport)
+#else
+    #define YV12TO422_EXPORT __attribute__((visibility("default")))
+#endif
+
+#endif
@@ -160,7 +160,21 @@ static uint32_t get_simd_support_info(void)
 }
 
 
+// the AVX2 kernels are compiled with FMA, which every AVX2 CPU has.
 int has_avx2()
 {
-    return !!(get_simd_support_info() & CPU_AVX2_SUPPORT);
+    const uint32_t flags = CPU_AVX2_SUPPORT | CPU_FMA3_SUPPORT;
+    return (get_simd_support_info() & flags) == flags;
+}
+
+
+// VS2013 has no AVX512 intrinsics. the project for it defines
+// YV12TO422_DISABLE_AVX512 and leaves proc_to422_avx512.cpp out.
+int has_avx512()
+{
+#if defined(YV12TO422_DISABLE_AVX512)
+    return 0;
+#endif
+    const uint32_t flags = CPU_AVX512F_SUPPORT | CPU_AVX512BW_SUPPORT;
+    return (get_simd_support_info() & flags) == flags;
 }
@@ -31,65 +31,88 @@ static inline int16_t round_to_short(const double d)
     return (int16_t)(d * 1024 + (d < 0.0 ? -0.5 : 0.5));
 }
 
+// the taps of the integer kernels are scaled by 1024, the float kernels
+// take them as they are.
+static inline void set_tap(const double d, int16_t& tap)
+{
+    tap = round_to_short(d);
+}
+
+static inline void set_tap(const double d, float& tap)
+{
+    tap = (float)d;
+}
+
+static inline void set_tap(const double d, double& tap)
+{
+    tap = d;
+}
+
 class MitchellNetravariCoefficients
 {
     double p0, p2, p3, q0, q1, q2, q3;
 
-    int16_t get_tap(const double distance)
+    template <typename C>
+    C get_tap(const double distance)
     {
         double d = fabs(distance);
+        C tap;
         if (d < 1.0) {
-            return round_to_short(p0 + d * d * (p2 + d * p3));
+            set_tap(p0 + d * d * (p2 + d * p3), tap);
+        } else {
+            set_tap(q0 + d * (q1 + d * (q2 + d * q3)), tap);
         }
-        return round_to_short(q0 + d * (q1 + d * (q2 + d * q3)));
+        return tap;
     }
 
-    void set_coeff_p(int16_t* coeff, int cplace)
+    template <typename C>
+    void set_coeff_p(C* coeff, int cplace)
     {
         if (cplace == 0) {
-            coeff[0] = get_tap(-6.0 / 4);
-            coeff[1] = get_tap(-2.0 / 4);
+            coeff[0] = get_tap<C>(-6.0 / 4);
+            coeff[1] = get_tap<C>(-2.0 / 4);
         } else if (cplace == 1) {
-            coeff[0] = get_tap(-7.0 / 4);
-            coeff[1] = get_tap(-3.0 / 4);
-            coeff[2] = get_tap(1.0 / 4);
-            coeff[3] = get_tap(5.0 / 4);
+            coeff[0] = get_tap<C>(-7.0 / 4);
+            coeff[1] = get_tap<C>(-3.0 / 4);
+            coeff[2] = get_tap<C>(1.0 / 4);
+            coeff[3] = get_tap<C>(5.0 / 4);
         } else if (cplace == 2) {
             coeff[0] = 0;
-            coeff[1] = 2 * get_tap(-2.0 / 4);
+            coeff[1] = 2 * get_tap<C>(-2.0 / 4);
             coeff[2] = 0;
-            coeff[3] = 2 * get_tap(6.0 / 4);
+            coeff[3] = 2 * get_tap<C>(6.0 / 4);
         } else {
-            coeff[0] = 2 * get_tap(-6.0 / 4);
+            coeff[0] = 2 * get_tap<C>(-6.0 / 4);
             coeff[1] = 0;
-            coeff[2] = 2 * get_tap(2.0 / 4);
+            coeff[2] = 2 * get_tap<C>(2.0 / 4);
             coeff[3] = 0;
         }
     }
 
-    void set_coeff_i(int16_t* coeff, int cplace)
+    template <typename C>
+    void set_coeff_i(C* coeff, int cplace)
     {
         if (cplace == 0 || cplace == 3) {
-            coeff[0] = get_tap(-12.0 / 8);
-            coeff[1] = get_tap(-4.0 / 8);
+            coeff[0] = get_tap<C>(-12.0 / 8);
+            coeff[1] = get_tap<C>(-4.0 / 8);
         } else if (cplace == 1) {
-            coeff[0] = get_tap(-14.0 / 8);
-            coeff[1] = get_tap(-6.0 / 8);
-            coeff[2] = get_tap(2.0 / 8);
-            coeff[3] = get_tap(10.0 / 8);
-            coeff[4] = get_tap(-14.0 / 8);
-            coeff[5] = get_tap(-6.0 / 8);
-            coeff[6] = get_tap(2.0 / 8);
-            coeff[7] = get_tap(10.0 / 8);
+            coeff[0] = get_tap<C>(-14.0 / 8);
+            coeff[1] = get_tap<C>(-6.0 / 8);
+            coeff[2] = get_tap<C>(2.0 / 8);
+            coeff[3] = get_tap<C>(10.0 / 8);
+            coeff[4] = get_tap<C>(-14.0 / 8);
+            coeff[5] = get_tap<C>(-6.0 / 8);
+            coeff[6] = get_tap<C>(2.0 / 8);
+            coeff[7] = get_tap<C>(10.0 / 8);
         } else {
-            coeff[0] = get_tap(-15.0 / 8);
-            coeff[1] = get_tap(-7.0 / 8);
-            coeff[2] = get_tap(1.0 / 8);
-            coeff[3] = get_tap(9.0 / 8);
-            coeff[4] = get_tap(-13.0 / 8);
-            coeff[5] = get_tap(-5.0 / 8);
-            coeff[6] = get_tap(3.0 / 8);
-            coeff[7] = get_tap(11.0 / 8);
+            coeff[0] = get_tap<C>(-15.0 / 8);
+            coeff[1] = get_tap<C>(-7.0 / 8);
+            coeff[2] = get_tap<C>(1.0 / 8);
+            coeff[3] = get_tap<C>(9.0 / 8);
+            coeff[4] = get_tap<C>(-13.0 / 8);
+            coeff[5] = get_tap<C>(-5.0 / 8);
+            coeff[6] = get_tap<C>(3.0 / 8);
+            coeff[7] = get_tap<C>(11.0 / 8);
         }
     }
 
@@ -105,7 +128,27 @@ public:
         q3 = (            -b -  6. * c) / 6.0;
     }
 
-    void set_coeff(int16_t *coeff, bool interlaced, int cplace)
+    // 4:2:2 to 4:2:0. the 8 rows around a chroma sample phase / 4 rows
+    // below the fourth one, weighted by the filter stretched to the 4:2:0
+    // rows (all of its support, 4 rows up and down) and normalized to 1024.
+    void set_coeff_d(int16_t* coeff, int phase)
+    {
+        double taps[8], sum = 0.0;
+        for (int i = 0; i < 8; ++i) {
+            taps[i] = get_tap<double>((i - 3 - phase / 4.0) / 2);
+            sum += taps[i];
+        }
+        int total = 0;
+        for (int i = 0; i < 8; ++i) {
+            coeff[i] = round_to_short(taps[i] / sum);
+            total += coeff[i];
+        }
+        // the rounding error goes to the nearer of the middle rows.
+        coeff[phase < 2 ? 3 : 4] += (int16_t)(1024 - total);
+    }
+
+    template <typename C>
+    void set_coeff(C* coeff, bool interlaced, int cplace)
     {
         if (interlaced) {
             set_coeff_i(coeff, cplace);
@@ -119,4 +162,21 @@ void set_cubic_coefficients(double b, double c, int16_t* array, bool interlaced,
 {
     auto mnc = MitchellNetravariCoefficients(b, c);
     mnc.set_coeff(array, interlaced, cplace);
-}
\ No newline at end of file
+}
+
+
+void set_cubic_coefficients(double b, double c, float* array, bool interlaced, int cplace)
+{
+    auto mnc = MitchellNetravariCoefficients(b, c);
+    mnc.set_coeff(array, interlaced, cplace);
+}
+
+
+// the taps of phase 0 to 3 for YV422To12, 8 each.
+void set_decimation_coefficients(double b, double c, int16_t* array)
+{
+    auto mnc = MitchellNetravariCoefficients(b, c);
+    for (int phase = 0; phase < 4; ++phase) {
+        mnc.set_coeff_d(array + phase * 8, phase);
+    }
+}
@@ -0,0 +1,1321 @@
+/*
+  libyv12to422.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "libyv12to422.h"
+#include "proc_to422.h"
+
+
+extern void set_cubic_coefficients(double b, double c, int16_t* array, bool interlaced, int cplace);
+extern void set_cubic_coefficients(double b, double c, float* array, bool interlaced, int cplace);
+extern int has_avx2();
+extern int has_avx512();
+
+// the sizes of YV12TO422_ABI_VERSION 1. a new member that does not fit
+// here shrinks the reserved array of its struct.
+#if UINTPTR_MAX > 0xffffffffu
+static_assert(sizeof(yv12to422_params_t) == 168, "layout of yv12to422_params_t");
+static_assert(sizeof(yv12to422_t) == 632, "layout of yv12to422_t");
+static_assert(sizeof(yv12to422_stream_t) == 184, "layout of yv12to422_stream_t");
+static_assert(sizeof(yv422to12_t) == 384, "layout of yv422to12_t");
+#endif
+
+
+static inline bool is_aligned(const void* p, int align)
+{
+    return ((uintptr_t)p & (align - 1)) == 0;
+}
+
+static inline bool is_aligned(int pitch, int align)
+{
+    return (pitch & (align - 1)) == 0;
+}
+
+// rgb32 and rgb24.
+static inline bool rgb_output(int output)
+{
+    return output == YV12TO422_OUTPUT_RGB32 || output == YV12TO422_OUTPUT_RGB24;
+}
+
+// yuy2, uyvy, v210 and rgb, in dst->data[0].
+static inline bool packed_output(int output)
+{
+    return output == YV12TO422_OUTPUT_YUY2 || output == YV12TO422_OUTPUT_UYVY ||
+           output == YV12TO422_OUTPUT_V210 || rgb_output(output);
+}
+
+// yv24, whose chroma is upsampled horizontally before the vertical kernels.
+static inline bool yv24_output(const yv12to422_t* ctx)
+{
+    return ctx->params.output == YV12TO422_OUTPUT_YV24;
+}
+
+// nv16, p210 and p216, the Y plane and the UV plane.
+static inline bool semi_planar_output(int output)
+{
+    return output == YV12TO422_OUTPUT_NV16 || output == YV12TO422_OUTPUT_P210 ||
+           output == YV12TO422_OUTPUT_P216;
+}
+
+// yv16 and yv24, the Y, U and V planes.
+static inline bool planar_output(int output)
+{
+    return output == YV12TO422_OUTPUT_YV16 || output == YV12TO422_OUTPUT_YV24;
+}
+
+// yuy2 and uyvy input, unpacked to yv16 by one kernel.
+static inline bool packed_input(const yv12to422_params_t& p)
+{
+    return p.input == YV12TO422_INPUT_YUY2 || p.input == YV12TO422_INPUT_UYVY;
+}
+
+// nv12 input to nv16 or p216. the kernels write the UV plane of dst.
+static inline bool direct_uv_output(const yv12to422_params_t& p)
+{
+    return p.input == YV12TO422_INPUT_NV12 &&
+           (p.output == YV12TO422_OUTPUT_NV16 || p.output == YV12TO422_OUTPUT_P216);
+}
+
+
+void yv12to422_default_params(yv12to422_params_t* params, int width, int height)
+{
+    memset(params, 0, sizeof(*params));
+    params->abi_version = YV12TO422_ABI_VERSION;
+    params->width = width;
+    params->height = height;
+    params->interlaced = 0;
+    params->itype = 2;
+    params->cplace = 1;
+    params->lshift = 0;
+    params->b = 0.0;
+    params->c = 0.75;
+    params->output = YV12TO422_OUTPUT_YUY2;
+    params->simd = YV12TO422_SIMD_SSE2;
+    params->threads = 1;
+    params->unaligned = 0;
+    params->narrow = 0;
+    params->bits = 8;
+    params->output_bits = 0;
+    params->input = YV12TO422_INPUT_YV12;
+    params->hsiting = 0;
+    params->matrix = YV12TO422_MATRIX_BT601;
+    params->full_range = 0;
+    params->out_matrix = -1;
+    params->out_full_range = -1;
+}
+
+
+// taps of 13 fractional bits for yuv444_to_rgb. full range rgb from the
+// source range.
+static void set_rgb_coefficients(int matrix, bool full_range, int16_t* coeffs)
+{
+    static const double kr[] = { 0.299, 0.2126, 0.2627 };
+    static const double kb[] = { 0.114, 0.0722, 0.0593 };
+    const double r = kr[matrix];
+    const double b = kb[matrix];
+    const double g = 1.0 - r - b;
+    const double ys = full_range ? 1.0 : 255.0 / 219.0;
+    const double cs = full_range ? 1.0 : 255.0 / 224.0;
+    auto tap = [](double x) { return (int16_t)floor(x * 8192 + 0.5); };
+
+    coeffs[0] = tap(ys);
+    coeffs[1] = 4096;
+    coeffs[2] = 0;
+    coeffs[3] = tap(2 * (1 - r) * cs);
+    coeffs[4] = tap(-2 * b * (1 - b) / g * cs);
+    coeffs[5] = tap(-2 * r * (1 - r) / g * cs);
+    coeffs[6] = tap(2 * (1 - b) * cs);
+    coeffs[7] = 0;
+    coeffs[8] = full_range ? 0 : 16;
+}
+
+
+// the output matrix and range of yuv to yuv conversion. -1 is the source.
+static inline int out_matrix(const yv12to422_params_t& p)
+{
+    return p.out_matrix < 0 ? p.matrix : p.out_matrix;
+}
+
+
+static inline int out_full_range(const yv12to422_params_t& p)
+{
+    return p.out_full_range < 0 ? p.full_range : p.out_full_range;
+}
+
+
+static inline bool yuv_matrix_output(const yv12to422_params_t& p)
+{
+    return out_matrix(p) != p.matrix || out_full_range(p) != p.full_range;
+}
+
+
+/*
+  coeffs of yuv_matrix, taps of 14 fractional bits for the samples of 7
+  fractional bits (the luma shifted, the 16bit chroma halved). the output is
+  A * (the source - its offsets) + the output offsets, where A is the yuv to
+  rgb matrix of the source followed by the rgb to yuv matrix of the output,
+  each scaled by its range. A maps no chroma to luma between the same
+  matrices, but does between different ones.
+*/
+static void set_yuv_coefficients(const yv12to422_params_t& p, int32_t* coeffs)
+{
+    static const double kr[] = { 0.299, 0.2126, 0.2627 };
+    static const double kb[] = { 0.114, 0.0722, 0.0593 };
+    // yuv (y 0 to 1, u and v -0.5 to 0.5) to rgb, and rgb to yuv.
+    auto to_rgb = [](int m, double a[3][3]) {
+        const double r = kr[m], b = kb[m], g = 1.0 - r - b;
+        const double t[3][3] = {
+            { 1.0, 0.0, 2 * (1 - r) },
+            { 1.0, -2 * b * (1 - b) / g, -2 * r * (1 - r) / g },
+            { 1.0, 2 * (1 - b), 0.0 },
+        };
+        memcpy(a, t, sizeof(t));
+    };
+    auto to_yuv = [](int m, double a[3][3]) {
+        const double r = kr[m], b = kb[m], g = 1.0 - r - b;
+        const double t[3][3] = {
+            { r, g, b },
+            { -r / (2 * (1 - b)), -g / (2 * (1 - b)), 0.5 },
+            { 0.5, -g / (2 * (1 - r)), -b / (2 * (1 - r)) },
+        };
+        memcpy(a, t, sizeof(t));
+    };
+    double src[3][3], dst[3][3], a[3][3];
+    to_rgb(p.matrix, src);
+    to_yuv(out_matrix(p), dst);
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            a[i][j] = dst[i][0] * src[0][j] + dst[i][1] * src[1][j] + dst[i][2] * src[2][j];
+        }
+    }
+
+    // the range of 8bit samples, and the offset of luma.
+    const bool full_s = p.full_range != 0;
+    const bool full_o = out_full_range(p) != 0;
+    const double ys_s = full_s ? 255.0 : 219.0;
+    const double cs_s = full_s ? 255.0 : 224.0;
+    const double ys_o = full_o ? 255.0 : 219.0;
+    const double cs_o = full_o ? 255.0 : 224.0;
+    const int yo_s = full_s ? 0 : 16;
+    const int yo_o = full_o ? 0 : 16;
+    auto tap = [](double x) { return (int32_t)floor(x * 16384 + 0.5); };
+
+    const int32_t ky = tap(ys_o / ys_s * a[0][0]);
+    const int32_t ku = tap(ys_o / cs_s * a[0][1]);
+    const int32_t kv = tap(ys_o / cs_s * a[0][2]);
+    const int32_t kuu = tap(cs_o / cs_s * a[1][1]);
+    const int32_t kuv = tap(cs_o / cs_s * a[1][2]);
+    const int32_t kvu = tap(cs_o / cs_s * a[2][1]);
+    const int32_t kvv = tap(cs_o / cs_s * a[2][2]);
+    auto pair = [](int32_t lo, int32_t hi) {
+        return (int32_t)(((uint32_t)hi << 16) | (uint16_t)lo);
+    };
+    coeffs[0] = pair(ky, ku);
+    coeffs[1] = pair(kv, 0);
+    coeffs[2] = pair(kuu, kuv);
+    coeffs[3] = pair(kvu, kvv);
+    coeffs[4] = (yo_o << 21) - 128 * (ky * yo_s + 128 * (ku + kv)) + (1 << 20);
+    coeffs[5] = (128 << 21) - 128 * 128 * (kuu + kuv) + (1 << 20);
+    coeffs[6] = (128 << 21) - 128 * 128 * (kvu + kvv) + (1 << 20);
+}
+
+
+/*
+  Narrow mode. A chroma plane which is narrower than NARROW_WIDTH / 2 is cut
+  into horizontal strips, and the strips are copied side by side into one
+  wide plane, so the vectors hold rows of several strips instead of the
+  padding after each row. The kernels run once on it, and the rows of each
+  strip are copied back.
+
+  It is used only for aligned planes whose rows do not end at a cache line
+  (buff_pitch % 64). The aligned kernels stream their rows to memory, and
+  partial cache lines of streaming stores are far slower than the copies.
+  Unaligned kernels use cached stores and exact width rows, which beat it.
+
+  Like the windows of the band streaming below, a strip is converted with
+  STREAM_MARGIN extra source rows above and below (or up to the edge of the
+  plane), and starts at a multiple of 4 chroma rows. So every strip has
+  narrow_rows = strip + 2 * STREAM_MARGIN + height_uv % 4 source rows, and
+  the last one ends at the bottom of the plane.
+*/
+static const int STREAM_MARGIN = 4;
+
+// the wide plane is about this many bytes wide.
+static const int NARROW_WIDTH = 256;
+
+
+static void set_narrow(yv12to422_t* ctx, arch_t arch, int vector_size)
+{
+    const yv12to422_params_t& p = ctx->params;
+    const int width = p.width / 2 * ctx->sample_size;
+    const int height = p.height / 2;
+    if (p.unaligned || ctx->buff_pitch % 64 == 0) {
+        return;
+    }
+    int strips = NARROW_WIDTH / width;
+    if (strips < 2) {
+        return;
+    }
+    const int strip = aligned_size((height + strips - 1) / strips, 4);
+    const int rows = strip + STREAM_MARGIN * 2 + height % 4;
+    if (rows >= height) {
+        return;
+    }
+    strips = (height + strip - 1) / strip;
+    ctx->narrow_strips = strips;
+    ctx->narrow_rows = rows;
+    ctx->narrow_pitch = aligned_size(width * strips, vector_size);
+    // the converted strips are read back at once. so they are stored with
+    // the cached stores of the unaligned kernels, not streamed to memory.
+    ctx->proc_narrow = (void(*)(void))get_proc_chroma(
+        p.itype, p.cplace, p.interlaced != 0, arch, true, ctx->sample_size);
+}
+
+
+int yv12to422_init(yv12to422_t* ctx, const yv12to422_params_t* params)
+{
+    const yv12to422_params_t& p = *params;
+
+    if (p.abi_version != YV12TO422_ABI_VERSION) {
+        return YV12TO422_ERR_INVALID_PARAM;
+    }
+    if (p.width < 2 || p.width % 2 > 0 || p.height % 4 > 0 || p.height < 16) {
+        return YV12TO422_ERR_INVALID_SIZE;
+    }
+    if (p.itype < 0 || p.itype > 2 || p.cplace < 0 || p.cplace > 3 ||
+        p.output < YV12TO422_OUTPUT_YV16 || p.output > YV12TO422_OUTPUT_RGB24 ||
+        p.hsiting < 0 || p.hsiting > 1 || p.matrix < YV12TO422_MATRIX_BT601 ||
+        p.matrix > YV12TO422_MATRIX_BT2020 || p.full_range < 0 || p.full_range > 1 ||
+        p.out_matrix < -1 || p.out_matrix > YV12TO422_MATRIX_BT2020 ||
+        p.out_full_range < -1 || p.out_full_range > 1 ||
+        p.simd < YV12TO422_SIMD_SSE2 || p.simd > YV12TO422_SIMD_AVX512 ||
+        p.threads < 1 || p.bits < 8 || (p.bits > 16 && p.bits != 32) ||
+        (p.output_bits != 0 && p.output_bits != p.bits &&
+         !((p.output_bits == 10 || p.output_bits == 16) && p.bits == 8))) {
+        return YV12TO422_ERR_INVALID_PARAM;
+    }
+    // 8bit source to 10 or 16bit output.
+    const bool widen = p.bits == 8 && p.output_bits > 8;
+    const int output_bits = widen ? p.output_bits : p.bits;
+    if (((p.output == YV12TO422_OUTPUT_YUY2 || p.output == YV12TO422_OUTPUT_UYVY ||
+          p.output == YV12TO422_OUTPUT_NV16 || rgb_output(p.output)) && output_bits != 8) ||
+        ((p.output == YV12TO422_OUTPUT_P210 || p.output == YV12TO422_OUTPUT_V210) &&
+         output_bits != 10) ||
+        (p.output == YV12TO422_OUTPUT_P216 && output_bits != 16)) {
+        return YV12TO422_ERR_INVALID_PARAM;
+    }
+    // U and V of nv12 go through the kernels together, so they must share
+    // the chroma placement (not dv pal).
+    const bool nv12 = p.input == YV12TO422_INPUT_NV12;
+    if (p.input < YV12TO422_INPUT_YV12 || p.input > YV12TO422_INPUT_UYVY ||
+        (nv12 && (p.bits == 32 || p.output == YV12TO422_OUTPUT_V210 ||
+                  (p.interlaced && p.cplace == 3)))) {
+        return YV12TO422_ERR_INVALID_PARAM;
+    }
+    // 4:1:1 chroma is only upsampled horizontally, into the 4:2:2 planes.
+    const bool yv411 = p.input == YV12TO422_INPUT_YV411;
+    if (yv411 && (p.width % 4 > 0 || p.lshift || widen ||
+                  p.output == YV12TO422_OUTPUT_YV24 || rgb_output(p.output))) {
+        return YV12TO422_ERR_INVALID_PARAM;
+    }
+    // the horizontal pass of yv24 takes the place of lshift.
+    const bool yv24 = p.output == YV12TO422_OUTPUT_YV24;
+    if ((yv24 && (nv12 || p.lshift)) || (rgb_output(p.output) && nv12)) {
+        return YV12TO422_ERR_INVALID_PARAM;
+    }
+    // yuv to yuv conversion of 8bit yv12 only.
+    const bool matrix = yuv_matrix_output(p);
+    if (matrix && (nv12 || p.bits != 8 || widen ||
+                   (p.output != YV12TO422_OUTPUT_YV16 && p.output != YV12TO422_OUTPUT_YUY2 &&
+                    p.output != YV12TO422_OUTPUT_UYVY))) {
+        return YV12TO422_ERR_INVALID_PARAM;
+    }
+    // packed 4:2:2 is only unpacked, the chroma needs no upsampling.
+    const bool packed = packed_input(p);
+    if (packed && (p.output != YV12TO422_OUTPUT_YV16 || p.bits != 8 || widen || matrix)) {
+        return YV12TO422_ERR_INVALID_PARAM;
+    }
+    if ((p.simd == YV12TO422_SIMD_AVX2 && !has_avx2()) ||
+        (p.simd == YV12TO422_SIMD_AVX512 && !has_avx512())) {
+        return YV12TO422_ERR_UNSUPPORTED_CPU;
+    }
+    arch_t arch = p.simd == YV12TO422_SIMD_AVX512 ? USE_AVX512 :
+                  p.simd == YV12TO422_SIMD_AVX2 ? USE_AVX2 : USE_SSE2;
+    const bool unaligned = p.unaligned != 0;
+    // the chroma of yuv to yuv conversion is interpolated to 16bit samples
+    // like that of output_bits 16, and the matrix rounds it to 8bit once.
+    const bool widen_uv = widen || matrix;
+    const int bits_uv = matrix ? 16 : output_bits;
+    // of the chroma, which the kernels work on.
+    const int sample_size = p.bits == 32 ? 4 : bits_uv > 8 ? 2 : 1;
+    // bytes of a chroma row. the UV row of nv12 holds the samples of both.
+    const int width_uv = p.width / 2 * sample_size * (nv12 ? 2 : 1);
+    if (unaligned) {
+        // exact width rows need at least one whole vector per U row, of the
+        // 8bit source too when it is widened, and of the 4:1:1 source.
+        const int row = p.width / (yv411 ? 4 : 2) * (widen_uv ? 1 : sample_size);
+        if (row < 16) {
+            return YV12TO422_ERR_INVALID_SIZE;
+        }
+        if (arch == USE_AVX512 && row < 64) {
+            arch = USE_AVX2;
+        }
+        if (arch == USE_AVX2 && row < 32) {
+            arch = USE_SSE2;
+        }
+    }
+    const int vector_size = arch == USE_AVX512 ? 64 : arch == USE_AVX2 ? 32 : 16;
+
+    memset(ctx, 0, sizeof(yv12to422_t));
+    ctx->params = p;
+    ctx->params.threads = p.threads > 1 ? 2 : 1;
+    ctx->params.unaligned = unaligned ? 1 : 0;
+    ctx->memalign = unaligned ? 1 : vector_size;
+    ctx->dvpal = p.interlaced && p.cplace == 3 ? -1 : 1;
+    ctx->sample_size = sample_size;
+    ctx->buff_pitch = aligned_size(width_uv, vector_size);
+    ctx->width_uv = unaligned ? width_uv : ctx->buff_pitch;
+
+    // the horizontal taps of 4:1:1 are halfway between two samples, like
+    // those of progressive cplace 0.
+    const bool interlaced = p.interlaced != 0 && !yv411;
+    const int cplace = yv411 ? 0 : p.cplace;
+    if (p.itype == 2 && sample_size == 4) {
+        set_cubic_coefficients(p.b, p.c, ctx->fcoeffs, interlaced, cplace);
+    } else if (p.itype == 2) {
+        set_cubic_coefficients(p.b, p.c, ctx->coeffs, interlaced, cplace);
+    }
+    if (sample_size == 2) {
+        ctx->coeffs[8] = (int16_t)((1 << bits_uv) - 1 - 32768);
+    }
+
+    if (yv411) {
+        ctx->proc_chroma = (void(*)(void))get_proc_upsample_411(
+            arch, unaligned, sample_size, p.itype);
+    } else {
+        ctx->proc_chroma = (void(*)(void))get_proc_chroma(
+            p.itype, p.cplace, p.interlaced != 0, arch, unaligned, sample_size);
+    }
+    ctx->proc_shift = (void(*)(void))get_proc_horizontal_shift(
+        arch, unaligned, sample_size, nv12);
+    if (nv12) {
+        // from the interleaved 4:2:2 chroma. nv16 and p216 need nothing.
+        if (p.output == YV12TO422_OUTPUT_YV16) {
+            ctx->proc_pack = (void(*)(void))get_interleaved_to_planar(
+                arch, sample_size, unaligned);
+        } else if (packed_output(p.output)) {
+            ctx->proc_pack = (void(*)(void))get_interleaved_to_packed(
+                arch, p.output == YV12TO422_OUTPUT_UYVY, unaligned);
+        } else if (p.output == YV12TO422_OUTPUT_P210) {
+            ctx->proc_pack = (void(*)(void))get_proc_msb10(arch, unaligned);
+        }
+    } else if (packed) {
+        ctx->proc_pack = (void(*)(void))get_packed_to_planar(
+            arch, p.input == YV12TO422_INPUT_UYVY, p.lshift != 0, unaligned);
+    } else if (p.output == YV12TO422_OUTPUT_V210) {
+        ctx->proc_pack = (void(*)(void))get_planar_to_v210(widen, unaligned);
+    } else if (rgb_output(p.output)) {
+        ctx->proc_pack = (void(*)(void))get_yuv444_to_rgb(
+            arch, p.output == YV12TO422_OUTPUT_RGB24, unaligned);
+        set_rgb_coefficients(p.matrix, p.full_range != 0, ctx->rgb_coeffs);
+    } else if (packed_output(p.output)) {
+        ctx->proc_pack = (void(*)(void))get_planar_to_packed(
+            arch, p.output == YV12TO422_OUTPUT_UYVY, matrix, unaligned);
+    } else if (semi_planar_output(p.output)) {
+        ctx->proc_pack = (void(*)(void))get_planar_to_interleaved(
+            arch, sample_size, p.output == YV12TO422_OUTPUT_P210, unaligned);
+    }
+    if (matrix) {
+        set_yuv_coefficients(p, ctx->yuv_coeffs);
+        if (p.output == YV12TO422_OUTPUT_YV16) {
+            ctx->proc_matrix = (void(*)(void))get_proc_matrix(arch, unaligned);
+        }
+    }
+    if (yv24 || rgb_output(p.output)) {
+        const int siting = p.itype == 0 ? 0 : 1 + p.hsiting;
+        ctx->proc_upsample = (void(*)(void))get_proc_upsample_h(
+            arch, unaligned, sample_size, siting);
+    }
+    if (widen_uv) {
+        ctx->proc_widen = (void(*)(void))get_proc_widen(arch, unaligned, bits_uv);
+    }
+    if (widen) {
+        // 8bit x << 8 is 10bit x << 2 in the msbs.
+        const int luma_bits = p.output == YV12TO422_OUTPUT_P210 ? 16 : output_bits;
+        ctx->proc_luma = (void(*)(void))get_proc_widen(arch, unaligned, luma_bits);
+    } else if (p.output == YV12TO422_OUTPUT_P210) {
+        ctx->proc_luma = (void(*)(void))get_proc_msb10(arch, unaligned);
+    }
+
+    if (p.narrow && !nv12 && !yv24 && !yv411 && !packed && !rgb_output(p.output)) {
+        set_narrow(ctx, arch, vector_size);
+    }
+
+    return YV12TO422_OK;
+}
+
+
+// the U and V rows of rgb, upsampled one at a time, at the end of the
+// scratch area.
+static size_t rgb_rows_size(const yv12to422_t* ctx)
+{
+    return rgb_output(ctx->params.output) ? (size_t)ctx->buff_pitch * 4 : 0;
+}
+
+// rgb frames are converted in bands of this many rows, like those of the
+// stream, so the 4:2:2 chroma of a band (about width * 80 bytes) is read
+// back from the cache and is never written to memory as a whole frame. The
+// windows redo 2 * STREAM_MARGIN source chroma rows of every band, a
+// quarter more work for the vertical kernels.
+static const int RGB_BAND_HEIGHT = 64;
+
+
+// the rows of the horizontal pass, lshift or the upsampling of yv24, whose
+// rows are twice as wide. 0 without it.
+static int horizontal_pitch(const yv12to422_t* ctx)
+{
+    return yv24_output(ctx) ? ctx->buff_pitch * 2 :
+           ctx->params.lshift ? ctx->buff_pitch : 0;
+}
+
+
+size_t yv12to422_scratch_size(const yv12to422_t* ctx)
+{
+    const yv12to422_params_t& p = ctx->params;
+    if (packed_input(p)) {
+        return 0;
+    }
+    if (rgb_output(p.output)) {
+        return yv12to422_stream_scratch_size(ctx, RGB_BAND_HEIGHT);
+    }
+    // U and V, or the UV plane of nv12 which is as wide as both.
+    const int planes = p.input == YV12TO422_INPUT_NV12 ? 1 : 2;
+    size_t size = 0;
+    if (ctx->proc_widen) {
+        size += (size_t)ctx->buff_pitch * (p.height / 2) * planes;
+    }
+    size += (size_t)horizontal_pitch(ctx) * (p.height / 2) * planes;
+    if (p.input == YV12TO422_INPUT_NV12 ? !direct_uv_output(p) :
+        !planar_output(p.output) || ctx->proc_matrix) {
+        size += (size_t)ctx->buff_pitch * p.height * planes;
+    }
+    if (ctx->narrow_strips > 0) {
+        // the strips of the source and the converted strips, for U and V.
+        size += (size_t)ctx->narrow_pitch * ctx->narrow_rows * 3 * 2;
+    }
+    return size;
+}
+
+
+int yv12to422_memalign(const yv12to422_t* ctx)
+{
+    return ctx->memalign;
+}
+
+
+// the taps passed to the kernels.
+static inline const int16_t* kernel_coeffs(const yv12to422_t* ctx)
+{
+    return ctx->sample_size == 4 ? (const int16_t*)ctx->fcoeffs : ctx->coeffs;
+}
+
+
+static bool check_alignment(const yv12to422_t* ctx, const yv12to422_src_t* src,
+                            const yv12to422_dst_t* dst, const void* scratch,
+                            size_t scratch_size)
+{
+    const int memalign = ctx->memalign;
+    const int output = ctx->params.output;
+
+    for (int i = 0; i < 3; ++i) {
+        // nv12 has no V plane, yuy2 and uyvy have only data[0].
+        const bool source = packed_input(ctx->params) ? i == 0 :
+                            i < 2 || ctx->params.input != YV12TO422_INPUT_NV12;
+        if (source && (!is_aligned(src->data[i], memalign) ||
+                       !is_aligned(src->pitch[i], memalign))) {
+            return false;
+        }
+        if ((packed_output(output) && i > 0) || (semi_planar_output(output) && i == 2) ||
+            (planar_output(output) && i == 0 && !dst->data[0])) {
+            continue;
+        }
+        if (!is_aligned(dst->data[i], memalign) || !is_aligned(dst->pitch[i], memalign)) {
+            return false;
+        }
+    }
+    return scratch_size == 0 || is_aligned(scratch, memalign);
+}
+
+
+// vertical interpolation of the whole chroma plane in narrow mode.
+static void proc_narrow(const yv12to422_t* ctx, const uint8_t* srcp, int src_pitch,
+                        uint8_t* dstp, int dst_pitch, uint8_t* buff, int sign)
+{
+    const int width = ctx->params.width / 2 * ctx->sample_size;
+    const int height = ctx->params.height / 2;
+    const int strips = ctx->narrow_strips;
+    const int rows = ctx->narrow_rows;
+    const int pitch = ctx->narrow_pitch;
+    const int strip = rows - STREAM_MARGIN * 2 - height % 4;
+
+    // the upside down V plane of dv pal is gathered upside down, and the
+    // kernel runs on it as usual.
+    ptrdiff_t sp = src_pitch;
+    ptrdiff_t dp = dst_pitch;
+    if (sign < 0) {
+        srcp += sp * (height - 1);
+        dstp += dp * (height * 2 - 1);
+        sp = -sp;
+        dp = -dp;
+    }
+
+    uint8_t* gathered = buff;
+    uint8_t* converted = buff + (size_t)pitch * rows;
+    for (int k = 0; k < strips; ++k) {
+        const int first = k == 0 ? 0 :
+                          k * strip - STREAM_MARGIN < height - rows ? k * strip - STREAM_MARGIN : height - rows;
+        for (int y = 0; y < rows; ++y) {
+            memcpy(gathered + (size_t)pitch * y + width * k, srcp + sp * (first + y), width);
+        }
+    }
+
+    auto proc_chroma = (proc_to422)ctx->proc_narrow;
+    proc_chroma(width * strips, rows, gathered, converted, pitch, pitch, kernel_coeffs(ctx));
+
+    for (int k = 0; k < strips; ++k) {
+        const int first = k == 0 ? 0 :
+                          k * strip - STREAM_MARGIN < height - rows ? k * strip - STREAM_MARGIN : height - rows;
+        const int top = k * strip;
+        const int bottom = top + strip < height ? top + strip : height;
+        const uint8_t* s = converted + (size_t)pitch * (top - first) * 2 + width * k;
+        for (int y = top * 2; y < bottom * 2; ++y) {
+            memcpy(dstp + dp * y, s, width);
+            s += pitch;
+        }
+    }
+}
+
+
+// widening, lshift or the horizontal upsampling of yv24, and vertical
+// interpolation of one chroma plane of height rows. sign is -1 for the V
+// plane of dv pal, which is processed upside down. the plane may hold frames
+// of the geometry of frame side by side. the horizontal pass runs on each of
+// them, because it reads the neighbors of each column. shift_buff holds its
+// rows. narrow_buff is the scratch of narrow mode, nullptr to not use it.
+static void proc_plane(const yv12to422_t* ctx, int height, const uint8_t* srcp,
+                       int src_pitch, uint8_t* dstp, int dst_pitch,
+                       uint8_t* widen_buff, uint8_t* shift_buff,
+                       uint8_t* narrow_buff, int sign, const yv12to422_t* frame,
+                       int frames)
+{
+    if (ctx->params.input == YV12TO422_INPUT_YV411) {
+        // height rows of 4:1:1, to as many 4:2:2 rows.
+        auto proc_upsample_411 = (proc_to422)ctx->proc_chroma;
+        proc_upsample_411(ctx->params.width / 4 * ctx->sample_size, height, srcp, dstp,
+                          src_pitch, dst_pitch, kernel_coeffs(ctx));
+        return;
+    }
+    if (ctx->proc_widen) {
+        auto proc_widen = (proc_horizontal)ctx->proc_widen;
+        proc_widen(ctx->width_uv, height, srcp, widen_buff, src_pitch, ctx->buff_pitch);
+        srcp = widen_buff;
+        src_pitch = ctx->buff_pitch;
+    }
+    int width = ctx->width_uv;
+    if (yv24_output(ctx)) {
+        // upsampled before the vertical kernels, on half of the rows.
+        auto proc_upsample_h = (proc_horizontal)frame->proc_upsample;
+        const int step = yv12to422_batch_step(frame) / 2 * ctx->sample_size;
+        for (int k = 0; k < frames; ++k) {
+            proc_upsample_h(frame->params.width / 2 * ctx->sample_size, height,
+                            srcp + step * k, shift_buff + step * 2 * k, src_pitch,
+                            horizontal_pitch(ctx));
+        }
+        srcp = shift_buff;
+        src_pitch = horizontal_pitch(ctx);
+        // as wide as the luma rows. twice width_uv can be wider than dst.
+        width = aligned_size(ctx->params.width * ctx->sample_size, ctx->memalign);
+    } else if (ctx->params.lshift) {
+        auto proc_chroma_qpel_shift_h = (proc_horizontal)frame->proc_shift;
+        // the UV rows of nv12 are as wide as the luma rows.
+        const int columns = yv12to422_batch_step(frame) /
+                            (ctx->params.input == YV12TO422_INPUT_NV12 ? 1 : 2);
+        const int step = columns * ctx->sample_size;
+        for (int k = 0; k < frames; ++k) {
+            proc_chroma_qpel_shift_h(frame->width_uv, height, srcp + step * k,
+                                     shift_buff + step * k, src_pitch, ctx->buff_pitch);
+        }
+        srcp = shift_buff;
+        src_pitch = ctx->buff_pitch;
+    }
+    if (narrow_buff) {
+        proc_narrow(ctx, srcp, src_pitch, dstp, dst_pitch, narrow_buff, sign);
+        return;
+    }
+    auto proc_chroma = (proc_to422)ctx->proc_chroma;
+    proc_chroma(width, height, srcp, dstp, src_pitch * sign,
+                dst_pitch * sign, kernel_coeffs(ctx));
+}
+
+
+// height luma rows to dst, widened or shifted by proc_luma, or copied.
+static void write_luma(const yv12to422_t* ctx, int height, const uint8_t* srcp,
+                       int src_pitch, uint8_t* dstp, int dst_pitch)
+{
+    const int width = ctx->params.width * ctx->sample_size;
+    if (ctx->proc_luma) {
+        auto proc_luma = (proc_horizontal)ctx->proc_luma;
+        proc_luma(width, height, srcp, dstp, src_pitch, dst_pitch);
+        return;
+    }
+    for (int y = 0; y < height; ++y) {
+        memcpy(dstp, srcp, width);
+        srcp += src_pitch;
+        dstp += dst_pitch;
+    }
+}
+
+
+// the 4:2:2 U and V rows and the luma rows to height rgb rows. the chroma
+// rows are upsampled one at a time into rows, which stay in the cache.
+static void write_rgb(const yv12to422_t* ctx, int height, const uint8_t* srcpy,
+                      int src_pitch_y, const uint8_t* srcpu, const uint8_t* srcpv,
+                      int pitch_uv, uint8_t* dstp, int dst_pitch, uint8_t* rows)
+{
+    auto proc_upsample_h = (proc_horizontal)ctx->proc_upsample;
+    auto torgb = (yuv444_to_rgb)ctx->proc_pack;
+    const int width = ctx->params.width;
+    const int pitch = ctx->buff_pitch * 2;
+    uint8_t* u = rows;
+    uint8_t* v = rows + pitch;
+
+    for (int y = 0; y < height; ++y) {
+        proc_upsample_h(width / 2, 1, srcpu, u, pitch_uv, pitch);
+        proc_upsample_h(width / 2, 1, srcpv, v, pitch_uv, pitch);
+        torgb(width, 1, srcpy, u, v, dstp, src_pitch_y, pitch, dst_pitch, ctx->rgb_coeffs);
+        srcpy += src_pitch_y;
+        srcpu += pitch_uv;
+        srcpv += pitch_uv;
+        dstp += dst_pitch;
+    }
+}
+
+
+// the 4:2:2 UV rows of nv12 input and the luma rows to the rows [top, top +
+// height) of dst.
+static void write_nv12_output(const yv12to422_t* ctx, int top, int height,
+                              const uint8_t* srcpy, int src_pitch_y,
+                              const uint8_t* uv, int uv_pitch,
+                              const yv12to422_dst_t* dst)
+{
+    const yv12to422_params_t& p = ctx->params;
+    const int width_u = p.width / 2 * ctx->sample_size;
+    auto row = [&](int i) { return dst->data[i] + (ptrdiff_t)dst->pitch[i] * top; };
+
+    if (packed_output(p.output)) {
+        auto topacked = (interleaved_to_packed)ctx->proc_pack;
+        topacked(p.width, height, srcpy, uv, row(0), src_pitch_y, uv_pitch, dst->pitch[0]);
+        return;
+    }
+    if (p.output == YV12TO422_OUTPUT_YV16) {
+        auto toplanar = (interleaved_to_planar)ctx->proc_pack;
+        toplanar(width_u, height, uv, row(1), row(2), uv_pitch, dst->pitch[1],
+                 dst->pitch[2]);
+    } else if (p.output == YV12TO422_OUTPUT_P210) {
+        auto proc_msb10 = (proc_horizontal)ctx->proc_pack;
+        proc_msb10(width_u * 2, height, uv, row(1), uv_pitch, dst->pitch[1]);
+    } else if (uv != row(1)) {
+        // nv16 and p216 from the window of band streaming.
+        uint8_t* d = row(1);
+        for (int y = 0; y < height; ++y) {
+            memcpy(d, uv, width_u * 2);
+            uv += uv_pitch;
+            d += dst->pitch[1];
+        }
+    }
+    if (dst->data[0]) {
+        write_luma(ctx, height, srcpy, src_pitch_y, row(0), dst->pitch[0]);
+    }
+}
+
+
+// U and V of nv12 go through the kernels at once, as one plane of pairs.
+// params.threads has nothing to split.
+static int convert_frames_nv12(const yv12to422_t* ctx, const yv12to422_t* frame,
+                               int frames, const yv12to422_src_t* src,
+                               const yv12to422_dst_t* dst, void* scratch)
+{
+    const yv12to422_params_t& p = ctx->params;
+    const int height_uv = p.height / 2;
+    const int buff_pitch = ctx->buff_pitch;
+
+    uint8_t* buff = (uint8_t*)scratch;
+    uint8_t* widen_buff = nullptr;
+    if (ctx->proc_widen) {
+        widen_buff = buff;
+        buff += (size_t)buff_pitch * height_uv;
+    }
+    uint8_t* shift_buff = nullptr;
+    if (p.lshift) {
+        shift_buff = buff;
+        buff += (size_t)buff_pitch * height_uv;
+    }
+    uint8_t* uv = buff;
+    int uv_pitch = buff_pitch;
+    if (direct_uv_output(p)) {
+        uv = dst->data[1];
+        uv_pitch = dst->pitch[1];
+    }
+
+    proc_plane(ctx, height_uv, src->data[1], src->pitch[1], uv, uv_pitch, widen_buff,
+               shift_buff, nullptr, 1, frame, frames);
+    write_nv12_output(ctx, 0, p.height, src->data[0], src->pitch[0], uv, uv_pitch, dst);
+    return YV12TO422_OK;
+}
+
+
+static void ignore_band(void* /*user*/, int /*top*/, int /*height*/)
+{
+}
+
+
+// rgb frames band by band (see RGB_BAND_HEIGHT).
+static int convert_rgb(const yv12to422_t* ctx, const yv12to422_src_t* src,
+                       const yv12to422_dst_t* dst, void* scratch)
+{
+    yv12to422_stream_t stream;
+    const int ret = yv12to422_stream_begin(&stream, ctx, src, dst, scratch,
+                                           RGB_BAND_HEIGHT, ignore_band, nullptr);
+    if (ret != YV12TO422_OK) {
+        return ret;
+    }
+    return yv12to422_stream_push(&stream, ctx->params.height);
+}
+
+
+// frames of the geometry of frame, side by side in the planes of ctx.
+static int convert_frames(const yv12to422_t* ctx, const yv12to422_t* frame,
+                          int frames, const yv12to422_src_t* src,
+                          const yv12to422_dst_t* dst, void* scratch)
+{
+    const yv12to422_params_t& p = ctx->params;
+    // yuv to yuv conversion reads the 4:2:2 chroma from the scratch area.
+    const bool yv16out = planar_output(p.output) && !ctx->proc_matrix;
+
+    if (ctx->proc_matrix && !dst->data[0]) {
+        return YV12TO422_ERR_INVALID_PARAM;
+    }
+    if (!check_alignment(ctx, src, dst, scratch, yv12to422_scratch_size(ctx))) {
+        return YV12TO422_ERR_UNALIGNED;
+    }
+    if (p.input == YV12TO422_INPUT_NV12) {
+        return convert_frames_nv12(ctx, frame, frames, src, dst, scratch);
+    }
+    if (packed_input(p)) {
+        if (!dst->data[0]) {
+            return YV12TO422_ERR_INVALID_PARAM;
+        }
+        auto unpack = (packed_to_planar)ctx->proc_pack;
+        unpack(p.width, p.height, src->data[0], dst->data[0], dst->data[1], dst->data[2],
+               src->pitch[0], dst->pitch[0], dst->pitch[1], dst->pitch[2]);
+        return YV12TO422_OK;
+    }
+    if (rgb_output(p.output)) {
+        return convert_rgb(ctx, src, dst, scratch);
+    }
+
+    // the chroma rows of 4:1:1 are as many as the luma rows.
+    const int src_height_uv = p.input == YV12TO422_INPUT_YV411 ? p.height : p.height / 2;
+    const uint8_t* srcpy = src->data[0];
+    const int src_pitch_y = src->pitch[0];
+
+    uint8_t* buff = (uint8_t*)scratch;
+    const int buff_pitch = ctx->buff_pitch;
+    uint8_t* widenu = nullptr;
+    uint8_t* widenv = nullptr;
+    if (ctx->proc_widen) {
+        widenu = buff;
+        widenv = widenu + buff_pitch * src_height_uv;
+        buff = widenv + buff_pitch * src_height_uv;
+    }
+    uint8_t* buffu = nullptr;
+    uint8_t* buffv = nullptr;
+    if (horizontal_pitch(ctx) > 0) {
+        buffu = buff;
+        buffv = buffu + horizontal_pitch(ctx) * src_height_uv;
+        buff = buffv + horizontal_pitch(ctx) * src_height_uv;
+    }
+
+    int yv16_pitch_uv;
+    uint8_t* yv16pu;
+    uint8_t* yv16pv;
+    if (!yv16out) {
+        yv16_pitch_uv = buff_pitch;
+        yv16pu = buff;
+        yv16pv = yv16pu + yv16_pitch_uv * p.height;
+    } else {
+        yv16_pitch_uv = dst->pitch[1];
+        yv16pu = dst->data[1];
+        yv16pv = dst->data[2];
+    }
+    const int yv16_pitch_v = yv16out ? dst->pitch[2] : yv16_pitch_uv;
+
+    uint8_t* narrowu = nullptr;
+    uint8_t* narrowv = nullptr;
+    if (ctx->narrow_strips > 0) {
+        narrowu = buff + (yv16out ? 0 : (size_t)buff_pitch * p.height * 2);
+        narrowv = narrowu + (size_t)ctx->narrow_pitch * ctx->narrow_rows * 3;
+    }
+
+    #pragma omp parallel sections num_threads(p.threads)
+    {
+        #pragma omp section
+        {
+            proc_plane(ctx, src_height_uv, src->data[1], src->pitch[1], yv16pu,
+                       yv16_pitch_uv, widenu, buffu, narrowu, 1, frame, frames);
+        }
+
+        #pragma omp section
+        {
+            proc_plane(ctx, src_height_uv, src->data[2], src->pitch[2], yv16pv,
+                       yv16_pitch_v, widenv, buffv, narrowv, ctx->dvpal, frame, frames);
+        }
+    }
+
+    if (packed_output(p.output)) {
+        auto yv16topacked = (planar_to_packed)ctx->proc_pack;
+        yv16topacked(p.width, p.height, srcpy, yv16pu, yv16pv, dst->data[0],
+                     src_pitch_y, yv16_pitch_uv, dst->pitch[0], ctx->yuv_coeffs);
+        return YV12TO422_OK;
+    }
+    if (ctx->proc_matrix) {
+        auto proc_matrix = (planar_matrix)ctx->proc_matrix;
+        proc_matrix(p.width, p.height, srcpy, yv16pu, yv16pv, dst->data[0], dst->data[1],
+                    dst->data[2], src_pitch_y, yv16_pitch_uv, dst->pitch[0], dst->pitch[1],
+                    dst->pitch[2], ctx->yuv_coeffs);
+        return YV12TO422_OK;
+    }
+    if (semi_planar_output(p.output)) {
+        auto interleave = (planar_to_interleaved)ctx->proc_pack;
+        interleave(p.width / 2 * ctx->sample_size, p.height, yv16pu, yv16pv, dst->data[1],
+                   yv16_pitch_uv, dst->pitch[1]);
+    }
+
+    if (dst->data[0]) {
+        write_luma(ctx, p.height, srcpy, src_pitch_y, dst->data[0], dst->pitch[0]);
+    }
+    return YV12TO422_OK;
+}
+
+
+int yv12to422_convert(const yv12to422_t* ctx, const yv12to422_src_t* src,
+                      const yv12to422_dst_t* dst, void* scratch)
+{
+    return convert_frames(ctx, ctx, 1, src, dst, scratch);
+}
+
+
+int yv12to422_batch_step(const yv12to422_t* ctx)
+{
+    const yv12to422_params_t& p = ctx->params;
+    // the U rows are buff_pitch bytes, the UV rows of nv12 too.
+    const int planes = p.input == YV12TO422_INPUT_NV12 ? 1 : 2;
+    if (p.unaligned) {
+        return p.width;
+    }
+    if (p.input == YV12TO422_INPUT_YV411) {
+        // the 4:1:1 source chroma of every frame starts at a multiple of
+        // memalign as well, for the frames converted one by one.
+        return aligned_size(p.width / 4 * ctx->sample_size, ctx->memalign) * 4 /
+               ctx->sample_size;
+    }
+    if (ctx->proc_widen) {
+        // the step of the 8bit source, whose chroma of every frame starts
+        // at a multiple of memalign as well. the frames that are converted
+        // one by one (v210) are aligned then.
+        return aligned_size(p.width / 2 * (3 - planes), ctx->memalign) * planes;
+    }
+    return ctx->buff_pitch * planes / ctx->sample_size;
+}
+
+
+// the context of count frames side by side, which is one frame of
+// count * step luma columns. unaligned kernels may get wider vectors.
+static bool widen(const yv12to422_t* ctx, int count, yv12to422_t* wide)
+{
+    yv12to422_params_t p = ctx->params;
+    p.width = yv12to422_batch_step(ctx) * count;
+    return yv12to422_init(wide, &p) == YV12TO422_OK;
+}
+
+
+size_t yv12to422_batch_scratch_size(const yv12to422_t* ctx, int count)
+{
+    yv12to422_t wide;
+    if (count < 1) {
+        return 0;
+    }
+    const size_t size = yv12to422_scratch_size(ctx);
+    if (count == 1 || !widen(ctx, count, &wide)) {
+        return size;
+    }
+    // frames which are not side by side are converted with ctx.
+    const size_t wide_size = yv12to422_scratch_size(&wide);
+    return wide_size > size ? wide_size : size;
+}
+
+
+static bool side_by_side(const yv12to422_t* ctx, const yv12to422_src_t* src,
+                         const yv12to422_dst_t* dst, int count)
+{
+    const int output = ctx->params.output;
+    const bool nv12 = ctx->params.input == YV12TO422_INPUT_NV12;
+    if (output == YV12TO422_OUTPUT_V210 || rgb_output(output) ||
+        ctx->params.input == YV12TO422_INPUT_YV411) {
+        // the groups of 48 pixels would cross the frames, and so would the
+        // horizontal neighbors of the rgb and 4:1:1 chroma.
+        return false;
+    }
+    if (packed_input(ctx->params)) {
+        // one pass over each frame, nothing to save.
+        return false;
+    }
+    const ptrdiff_t columns = yv12to422_batch_step(ctx);
+    // the source of widening is 8bit.
+    const ptrdiff_t step = columns * (ctx->proc_widen ? 1 : ctx->sample_size);
+    // the output of yuv to yuv conversion is 8bit.
+    const ptrdiff_t out_step = columns * (yuv_matrix_output(ctx->params) ? 1 : ctx->sample_size);
+    for (int k = 1; k < count; ++k) {
+        for (int i = 0; i < 3; ++i) {
+            const ptrdiff_t s = i == 0 || nv12 ? step * k : step / 2 * k;
+            if ((i < 2 || !nv12) && (src[k].pitch[i] != src[0].pitch[i] ||
+                                     src[k].data[i] != src[0].data[i] + s)) {
+                return false;
+            }
+            if ((packed_output(output) && i > 0) || (semi_planar_output(output) && i == 2)) {
+                continue;
+            }
+            // the UV plane is as wide as the luma plane.
+            const ptrdiff_t d = packed_output(output) ? out_step * 2 * k :
+                                i == 0 || semi_planar_output(output) ||
+                                output == YV12TO422_OUTPUT_YV24 ? out_step * k :
+                                out_step / 2 * k;
+            const bool skip = !dst[0].data[i] && !dst[k].data[i];
+            if (dst[k].pitch[i] != dst[0].pitch[i] ||
+                (!skip && (!dst[0].data[i] || dst[k].data[i] != dst[0].data[i] + d))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+int yv12to422_convert_batch(const yv12to422_t* ctx, const yv12to422_src_t* src,
+                            const yv12to422_dst_t* dst, int count, void* scratch)
+{
+    if (count < 1) {
+        return count == 0 ? YV12TO422_OK : YV12TO422_ERR_INVALID_PARAM;
+    }
+    yv12to422_t wide;
+    if (count > 1 && side_by_side(ctx, src, dst, count) && widen(ctx, count, &wide)) {
+        return convert_frames(&wide, ctx, count, src, dst, scratch);
+    }
+    for (int k = 0; k < count; ++k) {
+        int ret = yv12to422_convert(ctx, src + k, dst + k, scratch);
+        if (ret != YV12TO422_OK) {
+            return ret;
+        }
+    }
+    return YV12TO422_OK;
+}
+
+
+/*
+  A band is converted from a window of source chroma rows which extends
+  STREAM_MARGIN rows above and below it (or to the edge of the frame). The
+  kernels treat the ends of the window like the ends of the frame, which
+  changes only the rows within their reach (2 rows for progressive cubic,
+  4 for interlaced, which skips the other field), so the rows of the band
+  are the same as those of a whole frame. Windows start at multiples of 4
+  chroma rows to keep the field and the row pair structure of the kernels,
+  and have 8 rows or more, like the chroma of the smallest frame.
+  So a band of luma rows [top, bottom) is ready when the source has
+  bottom + 2 * STREAM_MARGIN rows.
+*/
+
+
+// source chroma rows of the largest window.
+static int stream_window(const yv12to422_t* ctx, int band_height)
+{
+    const int height_uv = ctx->params.height / 2;
+    const int rows = band_height / 2 + STREAM_MARGIN * 2;
+    return rows < height_uv ? rows : height_uv;
+}
+
+
+size_t yv12to422_stream_scratch_size(const yv12to422_t* ctx, int band_height)
+{
+    if (band_height < 8 || band_height % 8 > 0) {
+        return 0;
+    }
+    if (packed_input(ctx->params)) {
+        return 0;
+    }
+    const size_t rows = stream_window(ctx, band_height);
+    const size_t planes = ctx->params.input == YV12TO422_INPUT_NV12 ? 1 : 2;
+    // widened and shifted (or upsampled) source chroma, then the 4:2:2 (or
+    // 4:4:4) chroma of the window.
+    const size_t out_pitch = yv24_output(ctx) ? ctx->buff_pitch * 2 : ctx->buff_pitch;
+    return rows * planes * ((ctx->proc_widen ? ctx->buff_pitch : 0) + horizontal_pitch(ctx) +
+                            out_pitch * 2) + rgb_rows_size(ctx);
+}
+
+
+int yv12to422_stream_begin(yv12to422_stream_t* stream, const yv12to422_t* ctx,
+                           const yv12to422_src_t* src, const yv12to422_dst_t* dst,
+                           void* scratch, int band_height,
+                           yv12to422_band_callback callback, void* user)
+{
+    if (band_height < 8 || band_height % 8 > 0 || !callback ||
+        ((ctx->proc_matrix || packed_input(ctx->params)) && !dst->data[0])) {
+        return YV12TO422_ERR_INVALID_PARAM;
+    }
+    if (!check_alignment(ctx, src, dst, scratch,
+                         yv12to422_stream_scratch_size(ctx, band_height))) {
+        return YV12TO422_ERR_UNALIGNED;
+    }
+    stream->ctx = ctx;
+    stream->src = *src;
+    stream->dst = *dst;
+    stream->scratch = scratch;
+    stream->band_height = band_height;
+    stream->next_row = 0;
+    stream->callback = callback;
+    stream->user = user;
+    return YV12TO422_OK;
+}
+
+
+// output rows [top, bottom).
+static void stream_band(yv12to422_stream_t* st, int top, int bottom)
+{
+    const yv12to422_t* ctx = st->ctx;
+    const yv12to422_params_t& p = ctx->params;
+    const yv12to422_src_t& src = st->src;
+    const yv12to422_dst_t& dst = st->dst;
+    const int height_uv = p.height / 2;
+    const int buff_pitch = ctx->buff_pitch;
+    // of the 4:2:2 (or 4:4:4) chroma of the window.
+    const int out_pitch = yv24_output(ctx) ? buff_pitch * 2 : buff_pitch;
+
+    int first = top / 2 > STREAM_MARGIN ? top / 2 - STREAM_MARGIN : 0;
+    const int last = bottom == p.height ? height_uv :
+                     bottom / 2 + STREAM_MARGIN < height_uv ? bottom / 2 + STREAM_MARGIN : height_uv;
+    if (last - first < 8) {
+        // the short last band.
+        first = (last - 8) / 4 * 4;
+    }
+    const int rows = last - first;
+
+    const size_t window = stream_window(ctx, st->band_height);
+    uint8_t* buff = (uint8_t*)st->scratch;
+
+    // the rows of the band in the window.
+    const ptrdiff_t offset = (ptrdiff_t)out_pitch * (top - first * 2);
+    const uint8_t* srcpy = src.data[0] + (ptrdiff_t)src.pitch[0] * top;
+    const int height = bottom - top;
+
+    if (packed_input(p)) {
+        auto unpack = (packed_to_planar)ctx->proc_pack;
+        auto row = [&](int i) { return dst.data[i] + (ptrdiff_t)dst.pitch[i] * top; };
+        unpack(p.width, height, srcpy, row(0), row(1), row(2), src.pitch[0], dst.pitch[0],
+               dst.pitch[1], dst.pitch[2]);
+        return;
+    }
+
+    if (p.input == YV12TO422_INPUT_NV12) {
+        uint8_t* widen_buff = nullptr;
+        if (ctx->proc_widen) {
+            widen_buff = buff;
+            buff += buff_pitch * window;
+        }
+        uint8_t* shift_buff = nullptr;
+        if (p.lshift) {
+            shift_buff = buff;
+            buff += buff_pitch * window;
+        }
+        proc_plane(ctx, rows, src.data[1] + (ptrdiff_t)src.pitch[1] * first, src.pitch[1],
+                   buff, buff_pitch, widen_buff, shift_buff, nullptr, 1, ctx, 1);
+        write_nv12_output(ctx, top, height, srcpy, src.pitch[0], buff + offset,
+                          buff_pitch, &dst);
+        return;
+    }
+    uint8_t* widenu = nullptr;
+    uint8_t* widenv = nullptr;
+    if (ctx->proc_widen) {
+        widenu = buff;
+        widenv = widenu + buff_pitch * window;
+        buff = widenv + buff_pitch * window;
+    }
+    uint8_t* buffu = nullptr;
+    uint8_t* buffv = nullptr;
+    if (horizontal_pitch(ctx) > 0) {
+        buffu = buff;
+        buffv = buffu + horizontal_pitch(ctx) * window;
+        buff = buffv + horizontal_pitch(ctx) * window;
+    }
+    uint8_t* yv16pu = buff;
+    uint8_t* yv16pv = yv16pu + out_pitch * window * 2;
+    // 4:1:1 has the source rows of the 4:2:2 rows of the window.
+    const int src_rows = p.input == YV12TO422_INPUT_YV411 ? 2 : 1;
+
+    #pragma omp parallel sections num_threads(p.threads)
+    {
+        #pragma omp section
+        {
+            proc_plane(ctx, rows * src_rows,
+                       src.data[1] + (ptrdiff_t)src.pitch[1] * first * src_rows,
+                       src.pitch[1], yv16pu, out_pitch, widenu, buffu, nullptr, 1, ctx, 1);
+        }
+
+        #pragma omp section
+        {
+            proc_plane(ctx, rows * src_rows,
+                       src.data[2] + (ptrdiff_t)src.pitch[2] * first * src_rows,
+                       src.pitch[2], yv16pv, out_pitch, widenv, buffv, nullptr, ctx->dvpal,
+                       ctx, 1);
+        }
+    }
+
+    if (rgb_output(p.output)) {
+        write_rgb(ctx, height, srcpy, src.pitch[0], yv16pu + offset, yv16pv + offset,
+                  out_pitch, dst.data[0] + (ptrdiff_t)dst.pitch[0] * top, dst.pitch[0],
+                  yv16pv + out_pitch * window * 2);
+        return;
+    }
+    if (packed_output(p.output)) {
+        auto yv16topacked = (planar_to_packed)ctx->proc_pack;
+        yv16topacked(p.width, height, srcpy, yv16pu + offset, yv16pv + offset,
+                     dst.data[0] + (ptrdiff_t)dst.pitch[0] * top,
+                     src.pitch[0], buff_pitch, dst.pitch[0], ctx->yuv_coeffs);
+        return;
+    }
+    if (ctx->proc_matrix) {
+        auto proc_matrix = (planar_matrix)ctx->proc_matrix;
+        proc_matrix(p.width, height, srcpy, yv16pu + offset, yv16pv + offset,
+                    dst.data[0] + (ptrdiff_t)dst.pitch[0] * top,
+                    dst.data[1] + (ptrdiff_t)dst.pitch[1] * top,
+                    dst.data[2] + (ptrdiff_t)dst.pitch[2] * top, src.pitch[0], buff_pitch,
+                    dst.pitch[0], dst.pitch[1], dst.pitch[2], ctx->yuv_coeffs);
+        return;
+    }
+
+    if (semi_planar_output(p.output)) {
+        auto interleave = (planar_to_interleaved)ctx->proc_pack;
+        interleave(p.width / 2 * ctx->sample_size, height, yv16pu + offset, yv16pv + offset,
+                   dst.data[1] + (ptrdiff_t)dst.pitch[1] * top, buff_pitch, dst.pitch[1]);
+    } else {
+        const int width_uv = p.width / (yv24_output(ctx) ? 1 : 2) * ctx->sample_size;
+        for (int i = 1; i < 3; ++i) {
+            const uint8_t* s = (i == 1 ? yv16pu : yv16pv) + offset;
+            uint8_t* d = dst.data[i] + (ptrdiff_t)dst.pitch[i] * top;
+            for (int y = 0; y < height; ++y) {
+                memcpy(d, s, width_uv);
+                s += out_pitch;
+                d += dst.pitch[i];
+            }
+        }
+    }
+    if (dst.data[0]) {
+        write_luma(ctx, height, srcpy, src.pitch[0],
+                   dst.data[0] + (ptrdiff_t)dst.pitch[0] * top, dst.pitch[0]);
+    }
+}
+
+
+int yv12to422_stream_push(yv12to422_stream_t* stream, int rows)
+{
+    const int height = stream->ctx->params.height;
+    const int height_uv = height / 2;
+    if (rows < 0) {
+        return YV12TO422_ERR_INVALID_PARAM;
+    }
+    const int ready_uv = rows >= height ? height_uv : rows / 2;
+    // packed 4:2:2 needs only the rows of the band.
+    const bool packed = packed_input(stream->ctx->params);
+
+    while (stream->next_row < height) {
+        const int top = stream->next_row;
+        const int bottom = top + stream->band_height < height ? top + stream->band_height : height;
+        const int need = bottom == height ? height_uv :
+                         bottom / 2 + STREAM_MARGIN < height_uv ? bottom / 2 + STREAM_MARGIN : height_uv;
+        if (packed ? rows < bottom : ready_uv < need) {
+            break;
+        }
+        stream_band(stream, top, bottom);
+        stream->next_row = bottom;
+        stream->callback(stream->user, top, bottom - top);
+    }
+    return YV12TO422_OK;
+}
+
+
+int yv12to422_has_avx2(void)
+{
+    return has_avx2();
+}
+
+
+int yv12to422_has_avx512(void)
+{
+    return has_avx512();
+}
+
+
+const char* yv12to422_strerror(int err)
+{
+    switch (err) {
+    case YV12TO422_OK:
+        return "success.";
+    case YV12TO422_ERR_INVALID_PARAM:
+        return "invalid parameter.";
+    case YV12TO422_ERR_INVALID_SIZE:
+        return "width must be mod 2, height must be mod 4 and 16 or more.";
+    case YV12TO422_ERR_UNSUPPORTED_CPU:
+        return "requested SIMD is not supported by this CPU.";
+    case YV12TO422_ERR_UNALIGNED:
+        return "planes, pitches and scratch must be aligned to memalign.";
+    case YV12TO422_ERR_BUSY:
+        return "too many frames in flight.";
+    case YV12TO422_ERR_NOMEM:
+        return "out of memory.";
+    default:
+        return "unknown error.";
+    }
+}
@@ -0,0 +1,367 @@
+/*
+  libyv12to422.h
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+/*
+  Host independent YV12(4:2:0 planar 8bit) to YV16/YUY2 conversion engine.
+  With params.bits 9 to 16, 4:2:0 planar of uint16_t samples (YUV420P10,
+  P12, P16...) is converted to 4:2:2 planar of the same bit depth, and
+  with params.bits 32, 4:2:0 planar of float samples (YUV420PS). With
+  params.output_bits 10 or 16, 8bit sources are written as 10 or 16bit,
+  interpolated from the 8bit samples without rounding them to 8bit.
+  Besides planar YV16, the output can be packed (YUY2, UYVY, 10bit V210)
+  or semi-planar (NV16, P210, P216), interleaved by the same SIMD as the
+  kernels. With params.input NV12, the source chroma is one interleaved UV
+  plane (NV12, or P016 for 16bit samples), which the kernels interpolate
+  without splitting it. With output YV24, the chroma is also upsampled
+  horizontally (linear, or duplicated with itype 0) to 4:4:4, and with
+  output RGB32 or RGB24, the 4:4:4 rows are converted to RGB as well.
+  With params.out_matrix or params.out_full_range different from the
+  source, the 8bit YV16, YUY2 or UYVY output is converted to another matrix
+  (e.g. BT.601 to BT.709) or range when the 4:2:2 samples are written (yv12
+  input only, not with output_bits, and data[0] of yv16 must not be NULL).
+  With params.input YV411, the 4:1:1 chroma (dv ntsc) is upsampled only
+  horizontally, by itype, straight to the 4:2:2 planes (or the intermediate
+  chroma of packed and semi-planar output).
+  With params.input YUY2 or UYVY, the 4:2:2 source is unpacked to YV16 in
+  one pass (data[0] of dst must not be NULL), and lshift shifts its chroma
+  in the same pass.
+
+  The engine never allocates memory. The context is a plain struct owned by
+  the caller, and every working buffer (the shifted chroma for lshift, the
+  upsampled chroma of YV24 and the intermediate 4:2:2 chroma for packed and
+  semi-planar output) lives in a caller supplied scratch area whose size is
+  reported by yv12to422_scratch_size().
+
+  Alignment rules (memalign is 16 for SSE2, 32 for AVX2 and 64 for AVX512):
+    - every plane pointer, every pitch and the scratch area must be
+      multiples of memalign.
+    - chroma pitches must be at least aligned_size(width / 2, memalign),
+      luma pitches at least aligned_size(width, memalign), because the
+      kernels always process whole vectors. pitches are in bytes, and so
+      are these widths with bits > 8 (the number of samples times 2, or 4
+      for float). With output_bits 16, the widths of the output planes are
+      twice those of the source (and of output_bits 10, for P210). The UV
+      plane of NV16, P210 and P216 is as wide (in bytes) as its luma plane,
+      and so is the UV plane of NV12 input. The U and V pitches of YV24 follow
+      the rule of the luma pitch. The chroma pitches of YV411 input must be
+      at least aligned_size(width / 4, memalign). The pitch of YUY2 and
+      UYVY input must be at least aligned_size(width * 2, memalign).
+      V210 rows are (width + 47) / 48 * 128 bytes, and the pixels of the
+      last group after width are written as zero. RGB rows are width * 4
+      (or 3) bytes. A negative dst pitch writes them bottom up.
+
+  With params.unaligned, there is no alignment rule (memalign is 1) and no
+  byte after width is read or written, so rows can be packed tightly (e.g.
+  the frames of a memory mapped y4m file). width must be 32 or more, and
+  narrow frames use narrower vectors than params.simd.
+*/
+
+
+#ifndef LIBYV12TO422_H
+#define LIBYV12TO422_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define LIBYV12TO422_VERSION "1.0.2"
+
+/* the layout of the structs below. it changes only with the soname of the
+   library, and later members take the room of their reserved arrays. */
+#define YV12TO422_ABI_VERSION 1
+
+
+enum {
+    YV12TO422_OK = 0,
+    YV12TO422_ERR_INVALID_PARAM,
+    YV12TO422_ERR_INVALID_SIZE,
+    YV12TO422_ERR_UNSUPPORTED_CPU,
+    YV12TO422_ERR_UNALIGNED,
+    YV12TO422_ERR_BUSY,         /* the async queue is full */
+    YV12TO422_ERR_NOMEM,        /* an async worker could not allocate scratch */
+};
+
+enum {
+    YV12TO422_OUTPUT_YV16 = 0,
+    YV12TO422_OUTPUT_YUY2 = 1,
+    YV12TO422_OUTPUT_P216 = 2,  /* 16bit Y plane and interleaved UV plane */
+    YV12TO422_OUTPUT_UYVY = 3,
+    YV12TO422_OUTPUT_NV16 = 4,  /* 8bit Y plane and interleaved UV plane */
+    YV12TO422_OUTPUT_P210 = 5,  /* P216 of 10bit samples in the msbs */
+    YV12TO422_OUTPUT_V210 = 6,  /* 10bit packed, groups of 48 pixels in 128
+                                   bytes. pitch >= (width + 47) / 48 * 128 */
+    YV12TO422_OUTPUT_YV24 = 7,  /* 4:4:4 planar, chroma as wide as luma */
+    YV12TO422_OUTPUT_RGB32 = 8, /* B G R A, 8bit full range */
+    YV12TO422_OUTPUT_RGB24 = 9, /* B G R, 8bit full range */
+};
+
+enum {
+    YV12TO422_INPUT_YV12 = 0,   /* Y, U and V planes */
+    YV12TO422_INPUT_NV12 = 1,   /* Y plane and interleaved UV plane */
+    YV12TO422_INPUT_YV411 = 2,  /* Y, U and V planes, chroma 1/4 as wide as
+                                   luma and as high (dv ntsc) */
+    YV12TO422_INPUT_YUY2 = 3,   /* packed 4:2:2 in data[0], to yv16 */
+    YV12TO422_INPUT_UYVY = 4,
+};
+
+enum {
+    YV12TO422_MATRIX_BT601 = 0,
+    YV12TO422_MATRIX_BT709 = 1,
+    YV12TO422_MATRIX_BT2020 = 2,    /* non-constant luminance */
+};
+
+enum {
+    YV12TO422_SIMD_SSE2 = 0,
+    YV12TO422_SIMD_AVX2 = 1,
+    YV12TO422_SIMD_AVX512 = 2,  /* AVX512F + AVX512BW */
+};
+
+
+typedef struct yv12to422_params {
+    int abi_version;    /* YV12TO422_ABI_VERSION, set by
+                           yv12to422_default_params(). the init functions
+                           reject params of another version */
+    int width;          /* luma width */
+    int height;         /* luma height, mod 4 and 16 or more */
+    int interlaced;     /* same as the avisynth filter's "interlaced" */
+    int itype;          /* 0:point 1:linear 2:cubic */
+    int cplace;         /* 0 to 3, see readme */
+    int lshift;         /* shift chroma 1/4 sample to the left. not for yv24 */
+    double b;           /* cubic b */
+    double c;           /* cubic c */
+    int output;         /* YV12TO422_OUTPUT_* */
+    int simd;           /* YV12TO422_SIMD_* */
+    int threads;        /* 1 or 2 (U and V in parallel) */
+    int unaligned;      /* unaligned loads/stores and exact width rows */
+    int narrow;         /* pack the rows of narrow chroma planes (see readme) */
+    int bits;           /* 8, 9 to 16 for uint16_t samples or 32 for float
+                           samples (yv16, or p210/p216 of the same bits,
+                           for the last two) */
+    int output_bits;    /* 0: same as bits. 10 or 16: 8bit source to 10 or
+                           16bit output, rounded once. p216 needs 16bit,
+                           p210 and v210 need 10bit output */
+    int input;          /* YV12TO422_INPUT_*. nv12 takes no float samples,
+                           no dv pal placement and no v210 output. yv411
+                           needs width mod 4, takes no lshift, output_bits,
+                           yv24 and rgb, and ignores interlaced and cplace.
+                           yuy2 and uyvy are unpacked to 8bit yv16 (with
+                           lshift in the same pass), and take no out_matrix */
+    int hsiting;        /* yv24 and rgb. 0: chroma co-sited with the even
+                           luma columns (mpeg2, h264). 1: centered between
+                           two columns (mpeg1, jpeg) */
+    int matrix;         /* rgb and out_matrix. YV12TO422_MATRIX_* of the source */
+    int full_range;     /* rgb and out_full_range. 0: the source is limited
+                           range (16-235, 16-240). 1: full range */
+    int out_matrix;     /* -1: same as matrix. YV12TO422_MATRIX_* of yv16,
+                           yuy2 or uyvy output, converted from matrix */
+    int out_full_range; /* -1: same as full_range. range of the output */
+    int reserved[16];   /* zero */
+} yv12to422_params_t;
+
+
+typedef struct yv12to422_src {
+    const uint8_t* data[3];     /* Y, U, V. Y, UV for nv12 input. data[0]
+                                   only for yuy2 and uyvy input */
+    int pitch[3];
+} yv12to422_src_t;
+
+
+typedef struct yv12to422_dst {
+    uint8_t* data[3];           /* Y, U, V for yv16 and yv24. data[0] only for yuy2,
+                                   uyvy, v210 and rgb. Y, UV for nv16, p210
+                                   and p216 */
+                                /* yv16 and yv24: data[0] == NULL skips the luma
+                                   copy (for hosts that share the luma plane) */
+    int pitch[3];
+} yv12to422_dst_t;
+
+
+/* members are private. */
+typedef struct yv12to422 {
+    yv12to422_params_t params;
+    int memalign;
+    int dvpal;
+    int width_uv;
+    int buff_pitch;
+    int sample_size;            /* bytes per sample */
+    int16_t coeffs[9];          /* cubic taps, then the largest value - 32768 */
+    float fcoeffs[8];           /* cubic taps for float samples */
+    void (*proc_chroma)(void);
+    void (*proc_shift)(void);
+    void (*proc_pack)(void);
+    int narrow_strips;          /* 0: narrow mode is off */
+    int narrow_rows;
+    int narrow_pitch;
+    void (*proc_narrow)(void);
+    void (*proc_widen)(void);   /* NULL unless output_bits widens the source */
+    void (*proc_luma)(void);    /* NULL: luma is copied */
+    void (*proc_upsample)(void);  /* horizontal pass of yv24 and rgb */
+    int16_t rgb_coeffs[9];      /* the matrix of rgb output */
+    void (*proc_matrix)(void);  /* yv16 output of yuv to yuv conversion */
+    int32_t yuv_coeffs[7];      /* yuv to yuv matrix and range */
+    void* reserved[32];
+} yv12to422_t;
+
+
+/* sets the same defaults as the avisynth filter, and abi_version. params
+   must start from it, not from a zeroed or copied struct of another
+   build. */
+void yv12to422_default_params(yv12to422_params_t* params, int width, int height);
+
+int yv12to422_init(yv12to422_t* ctx, const yv12to422_params_t* params);
+
+size_t yv12to422_scratch_size(const yv12to422_t* ctx);
+
+int yv12to422_convert(const yv12to422_t* ctx, const yv12to422_src_t* src,
+                      const yv12to422_dst_t* dst, void* scratch);
+
+int yv12to422_memalign(const yv12to422_t* ctx);
+
+
+/*
+  Conversion of count frames of the geometry of ctx in one call, for small
+  frames whose per-call cost (kernel setup, the first and last rows of
+  each plane) outweighs the rows in between.
+
+  When the frames lie side by side in one arena, i.e. every plane of frame
+  k starts k * yv12to422_batch_step(ctx) luma columns (half of it for
+  chroma, twice of it in bytes for yuy2/uyvy and for 16bit samples) right of the one
+  of frame 0, with
+  the same pitches, every plane of all the frames goes through the kernels
+  as one wide row loop. Otherwise the frames are converted one by one.
+*/
+
+/* luma columns between frames side by side. width with params.unaligned,
+   aligned_size(width, 2 * memalign) otherwise (the columns of
+   aligned_size(width * n, 2 * memalign) bytes for bits > 8, n = 2 or 4
+   for float, and aligned_size(width * n, memalign) for nv12 input), and
+   the padding columns between the frames are written like those after
+   the last one. 8bit sources widened by output_bits keep the step of
+   8bit, aligned_size(width, 2 * memalign) (aligned_size(width, memalign)
+   for nv12), so that the source chroma of every frame is aligned too.
+   The chroma of yv411 sources starts a quarter of it right, and the step
+   is 4 * aligned_size(width / 4 * n, memalign) / n (n = 1 for 8bit). */
+int yv12to422_batch_step(const yv12to422_t* ctx);
+
+size_t yv12to422_batch_scratch_size(const yv12to422_t* ctx, int count);
+
+int yv12to422_convert_batch(const yv12to422_t* ctx, const yv12to422_src_t* src,
+                            const yv12to422_dst_t* dst, int count, void* scratch);
+
+
+/*
+  Streaming conversion of one frame in horizontal bands, for hosts that get
+  the source from a decoder a few rows at a time and want to hand the top
+  of the output to an encoder before the bottom is decoded.
+
+  yv12to422_stream_push() is called whenever more source rows are in src.
+  It converts every band whose source rows, including the look-ahead of the
+  interpolation (cubic taps below the band, the next rows of the same field
+  for interlaced kernels), are available, and reports each finished band
+  through the callback, top to bottom. The output is identical to
+  yv12to422_convert().
+*/
+
+/* rows [y, y + height) of dst are final. */
+typedef void (*yv12to422_band_callback)(void* user, int y, int height);
+
+/* members are private. */
+typedef struct yv12to422_stream {
+    const yv12to422_t* ctx;
+    yv12to422_src_t src;
+    yv12to422_dst_t dst;
+    void* scratch;
+    int band_height;
+    int next_row;               /* first output row not finished */
+    yv12to422_band_callback callback;
+    void* user;
+    void* reserved[8];
+} yv12to422_stream_t;
+
+/* band_height is in luma rows and must be a multiple of 8. */
+size_t yv12to422_stream_scratch_size(const yv12to422_t* ctx, int band_height);
+
+/* src and dst follow the same rules as for yv12to422_convert(). only the
+   pointers are stored, the rows behind them may still be written. */
+int yv12to422_stream_begin(yv12to422_stream_t* stream, const yv12to422_t* ctx,
+                           const yv12to422_src_t* src, const yv12to422_dst_t* dst,
+                           void* scratch, int band_height,
+                           yv12to422_band_callback callback, void* user);
+
+/* luma rows [0, rows) and chroma rows [0, rows / 2) of src are complete
+   (chroma rows [0, rows) for yv411 input, rows [0, rows) of yuy2 and uyvy
+   input). rows never decreases. rows == height finishes the frame. */
+int yv12to422_stream_push(yv12to422_stream_t* stream, int rows);
+
+
+/*
+  The reverse conversion, 8bit 4:2:2 to YV12 (YV422To12). The 4:2:2 source
+  is params.output (YV16, or YUY2 and UYVY read directly), and the chroma
+  rows are decimated to the placement of interlaced and cplace, by itype:
+  0 takes the nearest row, 1 averages the rows as described for each cplace
+  in the readme (the two rows, or 75/25 for interlaced cplace 2), and 2
+  weights the 8 rows around each by the cubic filter of b and c, stretched to
+  the 4:2:0 rows. width, height, simd and unaligned follow the
+  rules of yv12to422_init() (YUY2 and UYVY pitches at least
+  aligned_size(width * 2, memalign)), bits must be 8, and the rest of
+  params is ignored.
+  There is no scratch area.
+*/
+
+/* members are private. */
+typedef struct yv422to12 {
+    yv12to422_params_t params;
+    int memalign;
+    int width_uv;
+    int16_t coeffs[4][8];       /* cubic taps of the 4 quarter row phases */
+    void (*proc_chroma)(void);
+    void (*proc_luma)(void);    /* NULL: luma is copied */
+    void* reserved[16];
+} yv422to12_t;
+
+int yv422to12_init(yv422to12_t* ctx, const yv12to422_params_t* params);
+
+/* src is the 4:2:2 frame (data[0] only for yuy2 and uyvy), dst the YV12
+   frame. */
+int yv422to12_convert(const yv422to12_t* ctx, const yv12to422_src_t* src,
+                      const yv12to422_dst_t* dst);
+
+int yv422to12_memalign(const yv422to12_t* ctx);
+
+int yv12to422_has_avx2(void);
+
+int yv12to422_has_avx512(void);
+
+const char* yv12to422_strerror(int err);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
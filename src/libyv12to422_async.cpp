@@ -0,0 +1,278 @@
+/*
+  libyv12to422_async.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+
+#include <condition_variable>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "libyv12to422_async.h"
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+
+struct yv12to422_async {
+    std::mutex mtx;
+    std::condition_variable job_ready;
+    std::condition_variable completion_ready;
+    std::vector<yv12to422_job_t> jobs;    // ring of capacity jobs
+    size_t job_head;                        // the oldest queued job
+    size_t job_count;
+    std::deque<yv12to422_completion_t> completions;
+    size_t capacity;
+    bool quit;
+    int event_fd;
+    std::vector<std::thread> workers;
+};
+
+
+// the scratch area of a worker. it grows to the largest job.
+class worker_scratch {
+    void* data;
+    size_t size;
+
+public:
+    worker_scratch() : data(nullptr), size(0) {}
+    ~worker_scratch()
+    {
+        release();
+    }
+
+    void release()
+    {
+#ifdef _WIN32
+        _aligned_free(data);
+#else
+        free(data);
+#endif
+        data = nullptr;
+        size = 0;
+    }
+
+    void* get(size_t n)
+    {
+        if (n > size) {
+            release();
+#ifdef _WIN32
+            data = _aligned_malloc(n, 64);
+#else
+            if (posix_memalign(&data, 64, n) != 0) {
+                data = nullptr;
+            }
+#endif
+            if (!data) {
+                return nullptr;
+            }
+            size = n;
+        }
+        return data;
+    }
+};
+
+
+static void signal_event(int fd)
+{
+#if defined(__linux__)
+    if (fd >= 0) {
+        uint64_t one = 1;
+        ssize_t r = write(fd, &one, sizeof(one));
+        (void)r;
+    }
+#else
+    (void)fd;
+#endif
+}
+
+
+static void worker(yv12to422_async_t* a)
+{
+    worker_scratch scratch;
+    for (;;) {
+        yv12to422_job_t job;
+        {
+            std::unique_lock<std::mutex> lock(a->mtx);
+            a->job_ready.wait(lock, [a] { return a->quit || a->job_count > 0; });
+            if (a->job_count == 0) {
+                return;
+            }
+            job = a->jobs[a->job_head];
+            a->job_head = (a->job_head + 1) % a->capacity;
+            --a->job_count;
+        }
+
+        void* s = job.scratch;
+        const size_t size = yv12to422_scratch_size(job.ctx);
+        if (!s && size > 0) {
+            s = scratch.get(size);
+        }
+        const int status = size > 0 && !s ? YV12TO422_ERR_NOMEM :
+                           yv12to422_convert(job.ctx, &job.src, &job.dst, s);
+
+        if (job.callback) {
+            job.callback(job.arg, job.user, status);
+            continue;
+        }
+        bool was_empty;
+        {
+            std::lock_guard<std::mutex> lock(a->mtx);
+            was_empty = a->completions.empty();
+            a->completions.push_back({ job.user, status });
+        }
+        a->completion_ready.notify_all();
+        if (was_empty) {
+            signal_event(a->event_fd);
+        }
+    }
+}
+
+
+yv12to422_async_t* yv12to422_async_create(int threads, int capacity)
+{
+    if (threads <= 0) {
+        threads = (int)std::thread::hardware_concurrency();
+        threads = threads > 0 ? threads : 1;
+    }
+    yv12to422_async_t* a = new (std::nothrow) yv12to422_async_t();
+    if (!a) {
+        return nullptr;
+    }
+    a->capacity = capacity > 0 ? capacity : 1;
+    a->job_head = 0;
+    a->job_count = 0;
+    a->quit = false;
+#if defined(__linux__)
+    a->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#else
+    a->event_fd = -1;
+#endif
+    try {
+        // the queue is allocated here, so submitting never allocates.
+        a->jobs.resize(a->capacity);
+        for (int i = 0; i < threads; ++i) {
+            a->workers.emplace_back(worker, a);
+        }
+    } catch (...) {
+        yv12to422_async_destroy(a);
+        return nullptr;
+    }
+    return a;
+}
+
+
+void yv12to422_async_destroy(yv12to422_async_t* async)
+{
+    if (!async) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(async->mtx);
+        async->quit = true;
+    }
+    async->job_ready.notify_all();
+    for (auto& t : async->workers) {
+        t.join();
+    }
+#if defined(__linux__)
+    if (async->event_fd >= 0) {
+        close(async->event_fd);
+    }
+#endif
+    delete async;
+}
+
+
+int yv12to422_async_submit(yv12to422_async_t* async, const yv12to422_job_t* jobs,
+                           int count)
+{
+    int queued = 0;
+    {
+        std::lock_guard<std::mutex> lock(async->mtx);
+        while (queued < count && async->job_count < async->capacity) {
+            const size_t tail = (async->job_head + async->job_count) % async->capacity;
+            async->jobs[tail] = jobs[queued++];
+            ++async->job_count;
+        }
+    }
+    if (queued >= (int)async->workers.size()) {
+        async->job_ready.notify_all();
+    } else {
+        for (int i = 0; i < queued; ++i) {
+            async->job_ready.notify_one();
+        }
+    }
+    return queued;
+}
+
+
+static int take_completions(yv12to422_async_t* async, yv12to422_completion_t* out,
+                            int max)
+{
+    int n = 0;
+    while (n < max && !async->completions.empty()) {
+        out[n++] = async->completions.front();
+        async->completions.pop_front();
+    }
+    return n;
+}
+
+
+int yv12to422_async_poll(yv12to422_async_t* async, yv12to422_completion_t* out,
+                         int max)
+{
+    std::lock_guard<std::mutex> lock(async->mtx);
+    return take_completions(async, out, max);
+}
+
+
+int yv12to422_async_wait(yv12to422_async_t* async, yv12to422_completion_t* out,
+                         int max, int min, int timeout_ms)
+{
+    std::unique_lock<std::mutex> lock(async->mtx);
+    auto enough = [async, min] { return (int)async->completions.size() >= min; };
+    if (timeout_ms < 0) {
+        async->completion_ready.wait(lock, enough);
+    } else {
+        async->completion_ready.wait_for(lock, std::chrono::milliseconds(timeout_ms), enough);
+    }
+    return take_completions(async, out, max);
+}
+
+
+int yv12to422_async_fd(const yv12to422_async_t* async)
+{
+    return async->event_fd;
+}
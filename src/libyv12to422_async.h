@@ -0,0 +1,111 @@
+/*
+  libyv12to422_async.h
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+/*
+  Asynchronous conversion on a pool of worker threads.
+
+  Unlike the engine itself, the pool allocates: its threads, its queues and
+  one scratch area per worker. The job queue is allocated by
+  yv12to422_async_create(), so a full queue is the only reason for
+  yv12to422_async_submit() to refuse a job. Jobs are converted in any order and in
+  parallel. Each finished job either calls its callback on the worker
+  thread, or, without a callback, is put into the completion queue of the
+  pool, which the host reads with yv12to422_async_poll() (never blocks) or
+  yv12to422_async_wait(). On Linux, yv12to422_async_fd() is an eventfd for
+  event loops, readable whenever the queue has become non-empty.
+
+  A C++ interface with futures and C++20 awaitables is in
+  yv12to422_async.hpp.
+*/
+
+
+#ifndef LIBYV12TO422_ASYNC_H
+#define LIBYV12TO422_ASYNC_H
+
+#include "libyv12to422.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef struct yv12to422_async yv12to422_async_t;
+
+
+typedef struct yv12to422_job {
+    const yv12to422_t* ctx;
+    yv12to422_src_t src;
+    yv12to422_dst_t dst;
+    void* scratch;              /* NULL: the scratch area of the worker */
+    uint64_t user;              /* returned with the completion */
+    /* NULL: the completion goes to the completion queue */
+    void (*callback)(void* arg, uint64_t user, int status);
+    void* arg;
+} yv12to422_job_t;
+
+
+typedef struct yv12to422_completion {
+    uint64_t user;
+    int status;                 /* result of yv12to422_convert(), or
+                                   YV12TO422_ERR_NOMEM when job.scratch is
+                                   NULL and the worker could not allocate
+                                   its scratch area */
+} yv12to422_completion_t;
+
+
+/* threads <= 0: one per cpu. at most capacity jobs wait for a worker.
+   NULL on failure. */
+yv12to422_async_t* yv12to422_async_create(int threads, int capacity);
+
+/* converts the jobs that are still queued, then stops the workers.
+   completions nobody has read are dropped. */
+void yv12to422_async_destroy(yv12to422_async_t* async);
+
+/* queues jobs[0] to jobs[count - 1] at once and wakes as many workers as
+   needed. never blocks. returns how many jobs were queued, fewer than
+   count when the queue is full. */
+int yv12to422_async_submit(yv12to422_async_t* async, const yv12to422_job_t* jobs,
+                           int count);
+
+/* moves up to max completions to out. never blocks. returns the number. */
+int yv12to422_async_poll(yv12to422_async_t* async, yv12to422_completion_t* out,
+                         int max);
+
+/* like poll, but first waits until min completions are queued or until
+   timeout_ms (< 0: no limit) has passed. */
+int yv12to422_async_wait(yv12to422_async_t* async, yv12to422_completion_t* out,
+                         int max, int min, int timeout_ms);
+
+/* eventfd which becomes readable when the completion queue becomes
+   non-empty. read it to reset it, then poll until the queue is empty.
+   -1 where eventfd is not available. */
+int yv12to422_async_fd(const yv12to422_async_t* async);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
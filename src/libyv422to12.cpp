@@ -0,0 +1,236 @@
+/*
+  libyv422to12.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+
+/*
+  4:2:2 to 4:2:0 (YV422To12), the conversions which the readme describes
+  for each cplace.
+
+  Chroma row k of the output lies at a position of the 4:2:2 rows of its
+  frame, or of its field (k % 2) when the fields are decimated separately
+  (interlaced, and progressive cplace 2 and 3). Counted in quarter rows from
+  the row 2 * j of the field (j = k, or k / 2 by field), it is
+    0 for progressive cplace 0 and 2, and interlaced cplace 0
+    2 for progressive cplace 1 and 3, and interlaced cplace 1
+    1 for the top field, 3 for the bottom field of interlaced cplace 2
+    0 for U, 4 for V of interlaced cplace 3 (dv pal)
+  and the kernels make it of the rows around it: the nearest one 4 times
+  (itype 0), the two rows around it repeated by their weights (itype 1), or
+  the 8 rows with the cubic taps of its phase (itype 2, the filter stretched
+  to the 4:2:0 rows spans 4 rows up and down). Rows outside the frame or the
+  field are those of its edge.
+*/
+
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "libyv12to422.h"
+#include "proc_to422.h"
+
+
+extern void set_decimation_coefficients(double b, double c, int16_t* array);
+extern int has_avx2();
+extern int has_avx512();
+
+
+static inline bool is_aligned(const void* p, int align)
+{
+    return ((uintptr_t)p & (align - 1)) == 0;
+}
+
+static inline bool is_aligned(int pitch, int align)
+{
+    return (pitch & (align - 1)) == 0;
+}
+
+
+int yv422to12_init(yv422to12_t* ctx, const yv12to422_params_t* params)
+{
+    const yv12to422_params_t& p = *params;
+
+    if (p.abi_version != YV12TO422_ABI_VERSION) {
+        return YV12TO422_ERR_INVALID_PARAM;
+    }
+    if (p.width < 2 || p.width % 2 > 0 || p.height % 4 > 0 || p.height < 16) {
+        return YV12TO422_ERR_INVALID_SIZE;
+    }
+    if (p.itype < 0 || p.itype > 2 || p.cplace < 0 || p.cplace > 3 || p.bits != 8 ||
+        (p.output != YV12TO422_OUTPUT_YV16 && p.output != YV12TO422_OUTPUT_YUY2 &&
+         p.output != YV12TO422_OUTPUT_UYVY) ||
+        p.simd < YV12TO422_SIMD_SSE2 || p.simd > YV12TO422_SIMD_AVX512) {
+        return YV12TO422_ERR_INVALID_PARAM;
+    }
+    if ((p.simd == YV12TO422_SIMD_AVX2 && !has_avx2()) ||
+        (p.simd == YV12TO422_SIMD_AVX512 && !has_avx512())) {
+        return YV12TO422_ERR_UNSUPPORTED_CPU;
+    }
+    arch_t arch = p.simd == YV12TO422_SIMD_AVX512 ? USE_AVX512 :
+                  p.simd == YV12TO422_SIMD_AVX2 ? USE_AVX2 : USE_SSE2;
+    const bool unaligned = p.unaligned != 0;
+    const int width_uv = p.width / 2;
+    if (unaligned) {
+        if (width_uv < 16) {
+            return YV12TO422_ERR_INVALID_SIZE;
+        }
+        if (arch == USE_AVX512 && width_uv < 64) {
+            arch = USE_AVX2;
+        }
+        if (arch == USE_AVX2 && width_uv < 32) {
+            arch = USE_SSE2;
+        }
+    }
+    const int vector_size = arch == USE_AVX512 ? 64 : arch == USE_AVX2 ? 32 : 16;
+
+    memset(ctx, 0, sizeof(yv422to12_t));
+    ctx->params = p;
+    ctx->params.unaligned = unaligned ? 1 : 0;
+    ctx->memalign = unaligned ? 1 : vector_size;
+    ctx->width_uv = unaligned ? width_uv : aligned_size(width_uv, vector_size);
+
+    const bool cubic = p.itype == 2;
+    if (cubic) {
+        set_decimation_coefficients(p.b, p.c, &ctx->coeffs[0][0]);
+    }
+    if (p.output == YV12TO422_OUTPUT_YV16) {
+        ctx->proc_chroma = (void(*)(void))get_proc_decimate(arch, cubic, unaligned);
+        return YV12TO422_OK;
+    }
+    const bool uyvy = p.output == YV12TO422_OUTPUT_UYVY;
+    const bool dvpal = p.interlaced && p.cplace == 3;
+    ctx->proc_chroma = (void(*)(void))get_packed_decimate(
+        arch, cubic, uyvy, dvpal, unaligned);
+    ctx->proc_luma = (void(*)(void))get_packed_to_luma(arch, uyvy, unaligned);
+
+    return YV12TO422_OK;
+}
+
+
+int yv422to12_memalign(const yv422to12_t* ctx)
+{
+    return ctx->memalign;
+}
+
+
+// the 8 source rows of output chroma row k, of the V plane with v, and the
+// phase of their cubic taps. itype 0 and 1 use the first 4.
+static int source_rows(const yv12to422_params_t& p, int k, bool v, int* rows)
+{
+    const bool field = p.interlaced || p.cplace > 1;
+    const int parity = field ? k % 2 : 0;
+    const int j = field ? k / 2 : k;
+    const int height = field ? p.height / 2 : p.height;
+
+    int pos = 8 * j;
+    if (!p.interlaced || p.cplace == 1) {
+        pos += p.cplace % 2 == 1 ? 2 : 0;
+    } else if (p.cplace == 2) {
+        pos += parity ? 3 : 1;
+    } else if (p.cplace == 3 && v) {
+        pos += 4;
+    }
+    const int top = pos / 4;
+    const int phase = pos % 4;
+
+    for (int i = 0; i < 8; ++i) {
+        int r = p.itype == 0 ? (phase > 2 ? top + 1 : top) :
+                p.itype == 1 ? (i < 4 - phase ? top : top + 1) : top - 3 + i;
+        r = r < 0 ? 0 : r >= height ? height - 1 : r;
+        rows[i] = field ? r * 2 + parity : r;
+    }
+    return phase;
+}
+
+
+static bool check_alignment(const yv422to12_t* ctx, const yv12to422_src_t* src,
+                            const yv12to422_dst_t* dst)
+{
+    const int memalign = ctx->memalign;
+    const bool packed = ctx->params.output != YV12TO422_OUTPUT_YV16;
+    for (int i = 0; i < 3; ++i) {
+        if ((i == 0 || !packed) && (!is_aligned(src->data[i], memalign) ||
+                                    !is_aligned(src->pitch[i], memalign))) {
+            return false;
+        }
+        if (!is_aligned(dst->data[i], memalign) || !is_aligned(dst->pitch[i], memalign)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+int yv422to12_convert(const yv422to12_t* ctx, const yv12to422_src_t* src,
+                      const yv12to422_dst_t* dst)
+{
+    const yv12to422_params_t& p = ctx->params;
+    if (!check_alignment(ctx, src, dst)) {
+        return YV12TO422_ERR_UNALIGNED;
+    }
+
+    if (ctx->proc_luma) {
+        auto proc_luma = (proc_horizontal)ctx->proc_luma;
+        proc_luma(p.width, p.height, src->data[0], dst->data[0], src->pitch[0],
+                  dst->pitch[0]);
+    } else {
+        for (int y = 0; y < p.height; ++y) {
+            memcpy(dst->data[0] + (ptrdiff_t)dst->pitch[0] * y,
+                   src->data[0] + (ptrdiff_t)src->pitch[0] * y, p.width);
+        }
+    }
+
+    for (int k = 0; k < p.height / 2; ++k) {
+        int rows_u[8], rows_v[8];
+        const int phase = source_rows(p, k, false, rows_u);
+        source_rows(p, k, true, rows_v);
+        uint8_t* dstpu = dst->data[1] + (ptrdiff_t)dst->pitch[1] * k;
+        uint8_t* dstpv = dst->data[2] + (ptrdiff_t)dst->pitch[2] * k;
+
+        if (p.output != YV12TO422_OUTPUT_YV16) {
+            // U of the first 8 rows, V of the last 8 for dv pal.
+            const uint8_t* rows[16];
+            for (int i = 0; i < 8; ++i) {
+                rows[i] = src->data[0] + (ptrdiff_t)src->pitch[0] * rows_u[i];
+                rows[i + 8] = src->data[0] + (ptrdiff_t)src->pitch[0] * rows_v[i];
+            }
+            auto proc_chroma = (packed_decimate)ctx->proc_chroma;
+            proc_chroma(p.width, rows, dstpu, dstpv, ctx->coeffs[phase]);
+            continue;
+        }
+        auto proc_chroma = (proc_decimate)ctx->proc_chroma;
+        const uint8_t* rows[8];
+        for (int i = 0; i < 8; ++i) {
+            rows[i] = src->data[1] + (ptrdiff_t)src->pitch[1] * rows_u[i];
+        }
+        proc_chroma(ctx->width_uv, rows, dstpu, ctx->coeffs[phase]);
+        for (int i = 0; i < 8; ++i) {
+            rows[i] = src->data[2] + (ptrdiff_t)src->pitch[2] * rows_v[i];
+        }
+        proc_chroma(ctx->width_uv, rows, dstpv, ctx->coeffs[phase]);
+    }
+
+    return YV12TO422_OK;
+}
@@ -0,0 +1,268 @@
+/*
+  planar_to_packed.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+#include "proc_to422_kernels.h"
+
+
+proc_horizontal get_proc_msb10(arch_t arch, bool unaligned)
+{
+#if !defined(YV12TO422_DISABLE_AVX512)
+    if (arch == USE_AVX512) {
+        return get_proc_msb10_avx512(unaligned);
+    }
+#endif
+    if (arch == USE_AVX2) {
+        return get_proc_msb10_avx2(unaligned);
+    }
+    return get_proc_msb10_s<__m128i>(unaligned);
+}
+
+
+planar_to_packed get_planar_to_packed(arch_t arch, bool uyvy, bool matrix, bool unaligned)
+{
+#if !defined(YV12TO422_DISABLE_AVX512)
+    if (arch == USE_AVX512) {
+        return get_planar_to_packed_avx512(uyvy, matrix, unaligned);
+    }
+#endif
+    if (arch == USE_AVX2) {
+        return get_planar_to_packed_avx2(uyvy, matrix, unaligned);
+    }
+    return get_planar_to_packed_s<__m128i>(uyvy, matrix, unaligned);
+}
+
+
+planar_matrix get_proc_matrix(arch_t arch, bool unaligned)
+{
+#if !defined(YV12TO422_DISABLE_AVX512)
+    if (arch == USE_AVX512) {
+        return get_proc_matrix_avx512(unaligned);
+    }
+#endif
+    if (arch == USE_AVX2) {
+        return get_proc_matrix_avx2(unaligned);
+    }
+    return get_proc_matrix_s<__m128i>(unaligned);
+}
+
+
+planar_to_interleaved get_planar_to_interleaved(arch_t arch, int sample_size,
+                                                bool msb10, bool unaligned)
+{
+#if !defined(YV12TO422_DISABLE_AVX512)
+    if (arch == USE_AVX512) {
+        return get_planar_to_interleaved_avx512(sample_size, msb10, unaligned);
+    }
+#endif
+    if (arch == USE_AVX2) {
+        return get_planar_to_interleaved_avx2(sample_size, msb10, unaligned);
+    }
+    return get_planar_to_interleaved_s<__m128i>(sample_size, msb10, unaligned);
+}
+
+
+interleaved_to_packed get_interleaved_to_packed(arch_t arch, bool uyvy, bool unaligned)
+{
+#if !defined(YV12TO422_DISABLE_AVX512)
+    if (arch == USE_AVX512) {
+        return get_interleaved_to_packed_avx512(uyvy, unaligned);
+    }
+#endif
+    if (arch == USE_AVX2) {
+        return get_interleaved_to_packed_avx2(uyvy, unaligned);
+    }
+    return get_interleaved_to_packed_s<__m128i>(uyvy, unaligned);
+}
+
+
+interleaved_to_planar get_interleaved_to_planar(arch_t arch, int sample_size,
+                                                bool unaligned)
+{
+#if !defined(YV12TO422_DISABLE_AVX512)
+    if (arch == USE_AVX512) {
+        return get_interleaved_to_planar_avx512(sample_size, unaligned);
+    }
+#endif
+    if (arch == USE_AVX2) {
+        return get_interleaved_to_planar_avx2(sample_size, unaligned);
+    }
+    return get_interleaved_to_planar_s<__m128i>(sample_size, unaligned);
+}
+
+
+/*
+  v210: 6 pixels in 4 little endian words of 3 10bit samples,
+    Cb0 Y0 Cr0 | Y1 Cb1 Y2 | Cr1 Y3 Cb2 | Y4 Cr2 Y5
+  which are the samples of UYVY in order. Rows are written in groups of 48
+  pixels (128 bytes), the stride unit of v210, and the pixels of the last
+  group after width are 0.
+
+  The words are built with 128bit shifts and ors on every SIMD. Regrouping
+  the samples by 3 would need lane crossing permutes on wider vectors.
+*/
+
+// 12 dwords of two samples (s0 | s1 << 16) to 8 words of three samples.
+static __forceinline void
+pack_v210(const __m128i& d0, const __m128i& d1, const __m128i& d2, __m128i& w0,
+          __m128i& w1)
+{
+    const __m128 f0 = _mm_castsi128_ps(d0);
+    const __m128 f1 = _mm_castsi128_ps(d1);
+    const __m128 f2 = _mm_castsi128_ps(d2);
+    const __m128 t1 = _mm_shuffle_ps(f0, f1, _MM_SHUFFLE(1, 0, 2, 1));
+    const __m128 t2 = _mm_shuffle_ps(f1, f2, _MM_SHUFFLE(2, 1, 3, 2));
+    // dwords 0 3 6 9, 1 4 7 10 and 2 5 8 11.
+    const __m128i a = _mm_castps_si128(_mm_shuffle_ps(f0, t2, _MM_SHUFFLE(2, 0, 3, 0)));
+    const __m128i b = _mm_castps_si128(_mm_shuffle_ps(t1, t2, _MM_SHUFFLE(3, 1, 2, 0)));
+    const __m128i c = _mm_castps_si128(_mm_shuffle_ps(t1, f2, _MM_SHUFFLE(3, 0, 3, 1)));
+
+    const __m128i mask = _mm_set1_epi32(0x3FF);
+    __m128i even = or_reg(and_reg(a, mask),
+                          _mm_slli_epi32(and_reg(srli_epi32(a, 16), mask), 10));
+    even = or_reg(even, _mm_slli_epi32(and_reg(b, mask), 20));
+    __m128i odd = or_reg(and_reg(srli_epi32(b, 16), mask),
+                         _mm_slli_epi32(and_reg(c, mask), 10));
+    odd = or_reg(odd, _mm_slli_epi32(and_reg(srli_epi32(c, 16), mask), 20));
+
+    w0 = _mm_unpacklo_epi32(even, odd);
+    w1 = _mm_unpackhi_epi32(even, odd);
+}
+
+
+// 48 pixels. the luma is 8bit (x << 2) with WIDEN, 16bit otherwise.
+template <typename M, bool WIDEN>
+static __forceinline void
+planar_to_v210_group(const uint8_t* srcpy, const uint8_t* srcpu,
+                     const uint8_t* srcpv, uint8_t* dstp)
+{
+    __m128i y[6];
+    for (int i = 0; i < 3; ++i) {
+        if (WIDEN) {
+            y[i * 2] = M::load(srcpy + 16 * i);
+            cvtepu8_epi16x2(y[i * 2], y[i * 2 + 1]);
+            y[i * 2] = slli_epi16(y[i * 2], 2);
+            y[i * 2 + 1] = slli_epi16(y[i * 2 + 1], 2);
+        } else {
+            y[i * 2] = M::load(srcpy + 32 * i);
+            y[i * 2 + 1] = M::load(srcpy + 32 * i + 16);
+        }
+    }
+
+    // the samples in v210 order, 4 pixels per vector.
+    __m128i s[12];
+    for (int i = 0; i < 3; ++i) {
+        __m128i u = M::load(srcpu + 16 * i);
+        __m128i v = M::load(srcpv + 16 * i);
+        __m128i uv0 = unpacklo_epi16(u, v);
+        __m128i uv1 = unpackhi_epi16(u, v);
+        s[i * 4] = unpacklo_epi16(uv0, y[i * 2]);
+        s[i * 4 + 1] = unpackhi_epi16(uv0, y[i * 2]);
+        s[i * 4 + 2] = unpacklo_epi16(uv1, y[i * 2 + 1]);
+        s[i * 4 + 3] = unpackhi_epi16(uv1, y[i * 2 + 1]);
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        __m128i w0, w1;
+        pack_v210(s[i * 3], s[i * 3 + 1], s[i * 3 + 2], w0, w1);
+        M::store(dstp + 32 * i, w0);
+        M::store(dstp + 32 * i + 16, w1);
+    }
+}
+
+
+// the chroma is 16bit. width is the luma width.
+template <typename M, bool WIDEN>
+static void __stdcall
+planar_to_v210(const int width, const int height, const uint8_t* srcpy,
+               const uint8_t* srcpu, const uint8_t* srcpv, uint8_t* dstp,
+               const int pitch_y, const int pitch_uv, const int dst_pitch,
+               const int32_t*)
+{
+    const int luma_size = WIDEN ? 1 : 2;
+    const int groups = width / 48;
+    const int rest = width % 48;
+    // the last pixels, padded with 0 to a group.
+    __m128i tail_y[6], tail_u[3], tail_v[3];
+
+    for (int y = 0; y < height; ++y) {
+        for (int g = 0; g < groups; ++g) {
+            planar_to_v210_group<M, WIDEN>(srcpy + 48 * luma_size * g, srcpu + 48 * g,
+                                           srcpv + 48 * g, dstp + 128 * g);
+        }
+        if (rest > 0) {
+            memset(tail_y, 0, sizeof(tail_y));
+            memset(tail_u, 0, sizeof(tail_u));
+            memset(tail_v, 0, sizeof(tail_v));
+            memcpy(tail_y, srcpy + 48 * luma_size * groups, rest * luma_size);
+            memcpy(tail_u, srcpu + 48 * groups, rest);
+            memcpy(tail_v, srcpv + 48 * groups, rest);
+            planar_to_v210_group<M, WIDEN>((const uint8_t*)tail_y, (const uint8_t*)tail_u,
+                                           (const uint8_t*)tail_v, dstp + 128 * groups);
+        }
+        srcpy += pitch_y;
+        srcpu += pitch_uv;
+        srcpv += pitch_uv;
+        dstp += dst_pitch;
+    }
+}
+
+
+planar_to_packed get_planar_to_v210(bool widen, bool unaligned)
+{
+    if (unaligned) {
+        return widen ? planar_to_v210<unaligned_io<__m128i>, true>
+                     : planar_to_v210<unaligned_io<__m128i>, false>;
+    }
+    return widen ? planar_to_v210<aligned_io<__m128i>, true>
+                 : planar_to_v210<aligned_io<__m128i>, false>;
+}
+
+
+yuv444_to_rgb get_yuv444_to_rgb(arch_t arch, bool rgb24, bool unaligned)
+{
+#if !defined(YV12TO422_DISABLE_AVX512)
+    if (arch == USE_AVX512) {
+        return get_yuv444_to_rgb_avx512(rgb24, unaligned);
+    }
+#endif
+    if (arch == USE_AVX2) {
+        return get_yuv444_to_rgb_avx2(rgb24, unaligned);
+    }
+    return get_yuv444_to_rgb_s<__m128i>(rgb24, unaligned);
+}
+
+
+packed_to_planar get_packed_to_planar(arch_t arch, bool uyvy, bool shift, bool unaligned)
+{
+#if !defined(YV12TO422_DISABLE_AVX512)
+    if (arch == USE_AVX512) {
+        return get_packed_to_planar_avx512(uyvy, shift, unaligned);
+    }
+#endif
+    if (arch == USE_AVX2) {
+        return get_packed_to_planar_avx2(uyvy, shift, unaligned);
+    }
+    return get_packed_to_planar_s<__m128i>(uyvy, shift, unaligned);
+}
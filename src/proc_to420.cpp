@@ -0,0 +1,70 @@
+/*
+  proc_to420.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+
+#include "proc_to422_kernels.h"
+
+
+proc_decimate get_proc_decimate(arch_t arch, bool cubic, bool unaligned)
+{
+#if !defined(YV12TO422_DISABLE_AVX512)
+    if (arch == USE_AVX512) {
+        return get_proc_decimate_avx512(cubic, unaligned);
+    }
+#endif
+    if (arch == USE_AVX2) {
+        return get_proc_decimate_avx2(cubic, unaligned);
+    }
+    return get_proc_decimate_s<__m128i>(cubic, unaligned);
+}
+
+
+packed_decimate get_packed_decimate(arch_t arch, bool cubic, bool uyvy, bool dvpal,
+                                    bool unaligned)
+{
+#if !defined(YV12TO422_DISABLE_AVX512)
+    if (arch == USE_AVX512) {
+        return get_packed_decimate_avx512(cubic, uyvy, dvpal, unaligned);
+    }
+#endif
+    if (arch == USE_AVX2) {
+        return get_packed_decimate_avx2(cubic, uyvy, dvpal, unaligned);
+    }
+    return get_packed_decimate_s<__m128i>(cubic, uyvy, dvpal, unaligned);
+}
+
+
+proc_horizontal get_packed_to_luma(arch_t arch, bool uyvy, bool unaligned)
+{
+#if !defined(YV12TO422_DISABLE_AVX512)
+    if (arch == USE_AVX512) {
+        return get_packed_to_luma_avx512(uyvy, unaligned);
+    }
+#endif
+    if (arch == USE_AVX2) {
+        return get_packed_to_luma_avx2(uyvy, unaligned);
+    }
+    return get_packed_to_luma_s<__m128i>(uyvy, unaligned);
+}
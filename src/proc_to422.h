@@ -26,21 +26,213 @@
 #ifndef YV12TO422_PROC_TO_422_H
 #define YV12TO422_PROC_TO_422_H
 
-#pragma warning(disable:4752)
-
 #include <cstdint>
+#include "compat.h"
+
+enum arch_t {
+    USE_SSE2,
+    USE_AVX2,
+    USE_AVX512,
+};
 
 using proc_to422 = void (__stdcall *)(
     const int aligned_width, const int height, const uint8_t* srcp,
     uint8_t* dstp, int src_pitch, int dst_pitch, const int16_t* coeffs);
 
-proc_to422 get_proc_chroma(int itype, int cplace, bool interlaced, bool avx2);
+// unaligned: planes and pitches may have any alignment, and rows are
+// processed exactly to width (width must be sizeof(vector) or more).
+// sample_size: 1 for 8bit, 2 for 9 to 16bit, 4 for float samples. widths and
+// pitches are in bytes either way. the 16bit kernels clamp to coeffs[8] +
+// 32768, the float kernels take float taps through coeffs.
+proc_to422 get_proc_chroma(int itype, int cplace, bool interlaced, arch_t arch,
+                           bool unaligned, int sample_size);
+
+proc_to422 get_proc_chroma_avx2(int itype, int cplace, bool interlaced, bool unaligned,
+                                int sample_size);
+
+proc_to422 get_proc_chroma_avx512(int itype, int cplace, bool interlaced, bool unaligned,
+                                  int sample_size);
 
 using proc_horizontal = void(__stdcall *)(
     const int aligned_width, const int height, const uint8_t* srcp,
     uint8_t* dstp, int src_pitch, int dst_pitch);
 
-proc_horizontal get_proc_horizontal_shift(bool use_avx2);
+// interleaved: the UV rows of nv12, whose neighbors are two samples apart.
+proc_horizontal get_proc_horizontal_shift(arch_t arch, bool unaligned, int sample_size,
+                                          bool interleaved);
+
+proc_horizontal get_proc_horizontal_shift_avx2(bool unaligned, int sample_size,
+                                               bool interleaved);
+
+proc_horizontal get_proc_horizontal_shift_avx512(bool unaligned, int sample_size,
+                                                 bool interleaved);
+
+// 2x horizontal upsampling for 4:4:4. siting 0: duplicate, 1: linear for
+// chroma co-sited with even luma columns, 2: linear for centered chroma.
+// width is the bytes of a source row, which must hold a whole vector.
+proc_horizontal get_proc_upsample_h(arch_t arch, bool unaligned, int sample_size,
+                                    int siting);
+
+proc_horizontal get_proc_upsample_h_avx2(bool unaligned, int sample_size, int siting);
+
+proc_horizontal get_proc_upsample_h_avx512(bool unaligned, int sample_size, int siting);
+
+// 2x horizontal upsampling of 4:1:1 chroma to 4:2:2, by itype. the cubic
+// taps are those of cplace 0. width is the bytes of a source row, which
+// must hold a whole vector.
+proc_to422 get_proc_upsample_411(arch_t arch, bool unaligned, int sample_size, int itype);
+
+proc_to422 get_proc_upsample_411_avx2(bool unaligned, int sample_size, int itype);
+
+proc_to422 get_proc_upsample_411_avx512(bool unaligned, int sample_size, int itype);
+
+// 8bit to 16bit samples of bits (10 or 16). width is in bytes of the output.
+proc_horizontal get_proc_widen(arch_t arch, bool unaligned, int bits);
+
+proc_horizontal get_proc_widen_avx2(bool unaligned, int bits);
+
+proc_horizontal get_proc_widen_avx512(bool unaligned, int bits);
+
+// 10bit samples to the msbs of 16bit (P210). width is in bytes.
+proc_horizontal get_proc_msb10(arch_t arch, bool unaligned);
+
+proc_horizontal get_proc_msb10_avx2(bool unaligned);
+
+proc_horizontal get_proc_msb10_avx512(bool unaligned);
+
+// 8bit planar to YUY2, or UYVY. width is the luma width. with matrix, the
+// samples are converted with coeffs (YUV to YUV matrix and range), which
+// is unused otherwise.
+using planar_to_packed = void (__stdcall *)(
+    const int width, const int height, const uint8_t* srcpy,
+    const uint8_t* srcpu, const uint8_t* srcpv, uint8_t* dstp,
+    const int pitch_y, const int pitch_uv, const int dst_pitch,
+    const int32_t* coeffs);
+
+planar_to_packed get_planar_to_packed(arch_t arch, bool uyvy, bool matrix, bool unaligned);
+
+planar_to_packed get_planar_to_packed_avx2(bool uyvy, bool matrix, bool unaligned);
+
+planar_to_packed get_planar_to_packed_avx512(bool uyvy, bool matrix, bool unaligned);
+
+// 8bit 4:2:2 planes to YV16, converted with coeffs like planar_to_packed.
+// width is the luma width.
+using planar_matrix = void (__stdcall *)(
+    const int width, const int height, const uint8_t* srcpy,
+    const uint8_t* srcpu, const uint8_t* srcpv, uint8_t* dstpy,
+    uint8_t* dstpu, uint8_t* dstpv, const int pitch_y, const int pitch_uv,
+    const int dst_pitch_y, const int dst_pitch_u, const int dst_pitch_v,
+    const int32_t* coeffs);
+
+planar_matrix get_proc_matrix(arch_t arch, bool unaligned);
+
+planar_matrix get_proc_matrix_avx2(bool unaligned);
+
+planar_matrix get_proc_matrix_avx512(bool unaligned);
+
+// 10bit U and V planes and 8bit (widen) or 10bit luma to v210. rows are
+// written in groups of 48 pixels, 128 bytes.
+planar_to_packed get_planar_to_v210(bool widen, bool unaligned);
+
+// 8bit 4:4:4 rows to rgb32 (B G R A) or rgb24 (B G R) with the matrix of
+// coeffs (see set_rgb_coefficients). width is the luma width.
+using yuv444_to_rgb = void (__stdcall *)(
+    const int width, const int height, const uint8_t* srcpy,
+    const uint8_t* srcpu, const uint8_t* srcpv, uint8_t* dstp,
+    const int pitch_y, const int pitch_uv, const int dst_pitch,
+    const int16_t* coeffs);
+
+yuv444_to_rgb get_yuv444_to_rgb(arch_t arch, bool rgb24, bool unaligned);
+
+yuv444_to_rgb get_yuv444_to_rgb_avx2(bool rgb24, bool unaligned);
+
+yuv444_to_rgb get_yuv444_to_rgb_avx512(bool rgb24, bool unaligned);
+
+// U and V planes to one interleaved plane (NV16, P216, or P210 with msb10).
+// width is the bytes of a U row.
+using planar_to_interleaved = void (__stdcall *)(
+    const int width, const int height, const uint8_t* srcpu,
+    const uint8_t* srcpv, uint8_t* dstp, const int src_pitch, const int dst_pitch);
+
+planar_to_interleaved get_planar_to_interleaved(arch_t arch, int sample_size,
+                                                bool msb10, bool unaligned);
+
+planar_to_interleaved get_planar_to_interleaved_avx2(int sample_size, bool msb10,
+                                                     bool unaligned);
+
+planar_to_interleaved get_planar_to_interleaved_avx512(int sample_size, bool msb10,
+                                                       bool unaligned);
+
+// 8bit luma and the interleaved UV plane of nv12 input to YUY2 (or UYVY).
+// width is the luma width.
+using interleaved_to_packed = void (__stdcall *)(
+    const int width, const int height, const uint8_t* srcpy,
+    const uint8_t* srcpuv, uint8_t* dstp, const int pitch_y, const int pitch_uv,
+    const int dst_pitch);
+
+interleaved_to_packed get_interleaved_to_packed(arch_t arch, bool uyvy, bool unaligned);
+
+interleaved_to_packed get_interleaved_to_packed_avx2(bool uyvy, bool unaligned);
+
+interleaved_to_packed get_interleaved_to_packed_avx512(bool uyvy, bool unaligned);
+
+// an interleaved UV plane to U and V planes. width is the bytes of a U row.
+using interleaved_to_planar = void (__stdcall *)(
+    const int width, const int height, const uint8_t* srcp, uint8_t* dstpu,
+    uint8_t* dstpv, const int src_pitch, const int dst_pitch_u, const int dst_pitch_v);
+
+interleaved_to_planar get_interleaved_to_planar(arch_t arch, int sample_size,
+                                                bool unaligned);
+
+interleaved_to_planar get_interleaved_to_planar_avx2(int sample_size, bool unaligned);
+
+interleaved_to_planar get_interleaved_to_planar_avx512(int sample_size, bool unaligned);
+
+// 8bit YUY2 (or UYVY) to YV16. shift: the chroma is shifted 1/4 sample to
+// the left (lshift) in the same pass. width is the luma width.
+using packed_to_planar = void (__stdcall *)(
+    const int width, const int height, const uint8_t* srcp, uint8_t* dstpy,
+    uint8_t* dstpu, uint8_t* dstpv, const int src_pitch, const int dst_pitch_y,
+    const int dst_pitch_u, const int dst_pitch_v);
+
+packed_to_planar get_packed_to_planar(arch_t arch, bool uyvy, bool shift, bool unaligned);
+
+packed_to_planar get_packed_to_planar_avx2(bool uyvy, bool shift, bool unaligned);
+
+packed_to_planar get_packed_to_planar_avx512(bool uyvy, bool shift, bool unaligned);
+
+// 4:2:2 to 4:2:0 of 8bit chroma, one output row of the source rows of srcp.
+// cubic: the 8 rows weighted by the 4 tap pairs of coeffs, otherwise the
+// first 4 averaged.
+// width is the bytes of a chroma row.
+using proc_decimate = void (__stdcall *)(
+    const int width, const uint8_t* const* srcp, uint8_t* dstp, const int16_t* coeffs);
+
+proc_decimate get_proc_decimate(arch_t arch, bool cubic, bool unaligned);
+
+proc_decimate get_proc_decimate_avx2(bool cubic, bool unaligned);
+
+proc_decimate get_proc_decimate_avx512(bool cubic, bool unaligned);
+
+// the same of YUY2 (or UYVY) rows to a U row and a V row. width is the luma
+// width. dvpal: V comes from srcp[8] to srcp[15].
+using packed_decimate = void (__stdcall *)(
+    const int width, const uint8_t* const* srcp, uint8_t* dstpu, uint8_t* dstpv,
+    const int16_t* coeffs);
+
+packed_decimate get_packed_decimate(arch_t arch, bool cubic, bool uyvy, bool dvpal,
+                                    bool unaligned);
+
+packed_decimate get_packed_decimate_avx2(bool cubic, bool uyvy, bool dvpal, bool unaligned);
+
+packed_decimate get_packed_decimate_avx512(bool cubic, bool uyvy, bool dvpal, bool unaligned);
+
+// the luma of YUY2 (or UYVY) rows. width is the luma width.
+proc_horizontal get_packed_to_luma(arch_t arch, bool uyvy, bool unaligned);
+
+proc_horizontal get_packed_to_luma_avx2(bool uyvy, bool unaligned);
+
+proc_horizontal get_packed_to_luma_avx512(bool uyvy, bool unaligned);
 
 static inline int aligned_size(int x, int align)
 {
@@ -0,0 +1,115 @@
+/*
+  proc_to422_avx2.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+#if !defined(__AVX2__)
+    #error "proc_to422_avx2.cpp must be compiled with AVX2 enabled."
+#endif
+
+#include "proc_to422_kernels.h"
+
+
+proc_to422 get_proc_chroma_avx2(int itype, int cplace, bool interlaced, bool unaligned,
+                                int sample_size)
+{
+    return get_proc_chroma_s<__m256i>(itype, cplace, interlaced, unaligned, sample_size);
+}
+
+proc_horizontal get_proc_horizontal_shift_avx2(bool unaligned, int sample_size,
+                                               bool interleaved)
+{
+    return get_proc_horizontal_shift_s<__m256i>(unaligned, sample_size, interleaved);
+}
+
+proc_horizontal get_proc_upsample_h_avx2(bool unaligned, int sample_size, int siting)
+{
+    return get_proc_upsample_h_s<__m256i>(unaligned, sample_size, siting);
+}
+
+proc_to422 get_proc_upsample_411_avx2(bool unaligned, int sample_size, int itype)
+{
+    return get_proc_upsample_411_s<__m256i>(unaligned, sample_size, itype);
+}
+
+proc_horizontal get_proc_widen_avx2(bool unaligned, int bits)
+{
+    return get_proc_widen_s<__m256i>(unaligned, bits);
+}
+
+proc_horizontal get_proc_msb10_avx2(bool unaligned)
+{
+    return get_proc_msb10_s<__m256i>(unaligned);
+}
+
+planar_to_packed get_planar_to_packed_avx2(bool uyvy, bool matrix, bool unaligned)
+{
+    return get_planar_to_packed_s<__m256i>(uyvy, matrix, unaligned);
+}
+
+
+planar_matrix get_proc_matrix_avx2(bool unaligned)
+{
+    return get_proc_matrix_s<__m256i>(unaligned);
+}
+
+yuv444_to_rgb get_yuv444_to_rgb_avx2(bool rgb24, bool unaligned)
+{
+    return get_yuv444_to_rgb_s<__m256i>(rgb24, unaligned);
+}
+
+planar_to_interleaved get_planar_to_interleaved_avx2(int sample_size, bool msb10,
+                                                    bool unaligned)
+{
+    return get_planar_to_interleaved_s<__m256i>(sample_size, msb10, unaligned);
+}
+
+interleaved_to_packed get_interleaved_to_packed_avx2(bool uyvy, bool unaligned)
+{
+    return get_interleaved_to_packed_s<__m256i>(uyvy, unaligned);
+}
+
+interleaved_to_planar get_interleaved_to_planar_avx2(int sample_size, bool unaligned)
+{
+    return get_interleaved_to_planar_s<__m256i>(sample_size, unaligned);
+}
+
+packed_to_planar get_packed_to_planar_avx2(bool uyvy, bool shift, bool unaligned)
+{
+    return get_packed_to_planar_s<__m256i>(uyvy, shift, unaligned);
+}
+
+proc_decimate get_proc_decimate_avx2(bool cubic, bool unaligned)
+{
+    return get_proc_decimate_s<__m256i>(cubic, unaligned);
+}
+
+packed_decimate get_packed_decimate_avx2(bool cubic, bool uyvy, bool dvpal, bool unaligned)
+{
+    return get_packed_decimate_s<__m256i>(cubic, uyvy, dvpal, unaligned);
+}
+
+proc_horizontal get_packed_to_luma_avx2(bool uyvy, bool unaligned)
+{
+    return get_packed_to_luma_s<__m256i>(uyvy, unaligned);
+}
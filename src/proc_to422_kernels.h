@@ -0,0 +1,2244 @@
+/*
+  proc_to422_kernels.h
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+#ifndef YV12TO422_PROC_TO_422_KERNELS_H
+#define YV12TO422_PROC_TO_422_KERNELS_H
+
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <map>
+
+#include "proc_to422.h"
+#include "simd.h"
+
+
+/*
+  Memory access of the kernels. Pointers and pitches are in bytes.
+
+  aligned_io: planes, pitches and width are multiples of sizeof(T).
+  unaligned_io: any address, pitch and width (>= sizeof(T)). The last vector
+  of a row is moved back to width - sizeof(T) and overlaps the previous one,
+  so nothing after the row is read or written. All the vertical kernels
+  compute each column independently, so the overlapped bytes are just
+  written twice with the same values.
+  store_lane writes the 128bit lane i of a vector to p (a multiple of 16
+  with aligned_io).
+*/
+template <typename T>
+struct aligned_io {
+    static __forceinline T load(const uint8_t* p)
+    {
+        return load_reg((const T*)p);
+    }
+    static __forceinline void store(uint8_t* p, const T& v)
+    {
+        stream_reg((T*)p, v);
+    }
+    static __forceinline void store_lane(uint8_t* p, const T& v, int i)
+    {
+        stream_reg((__m128i*)p, lane(v, i));
+    }
+    static __forceinline int next(int x, int /*width*/)
+    {
+        return x + sizeof(T);
+    }
+};
+
+
+template <typename T>
+struct unaligned_io {
+    static __forceinline T load(const uint8_t* p)
+    {
+        return loadu_reg((const T*)p);
+    }
+    static __forceinline void store(uint8_t* p, const T& v)
+    {
+        storeu_reg((T*)p, v);
+    }
+    static __forceinline void store_lane(uint8_t* p, const T& v, int i)
+    {
+        storeu_reg((__m128i*)p, lane(v, i));
+    }
+    static __forceinline int next(int x, int width)
+    {
+        x += sizeof(T);
+        if (x >= width) {
+            return width;
+        }
+        return x + (int)sizeof(T) > width ? width - (int)sizeof(T) : x;
+    }
+};
+
+
+///////////////// sample types /////////////////
+
+// adds the products of the rows a and b with the tap pair coef to the
+// 32bit sums of the 4 quarters of the vector.
+template <typename T>
+static __forceinline void
+madd_pairs(const T& a, const T& b, const T& coef, T* total)
+{
+    T zero = xor_reg(a, a);
+    T ab_lo = unpacklo_epi8(a, b);
+    T ab_hi = unpackhi_epi8(a, b);
+
+    total[0] = add_epi32(madd_epi16(unpacklo_epi8(ab_lo, zero), coef), total[0]);
+    total[1] = add_epi32(madd_epi16(unpackhi_epi8(ab_lo, zero), coef), total[1]);
+    total[2] = add_epi32(madd_epi16(unpacklo_epi8(ab_hi, zero), coef), total[2]);
+    total[3] = add_epi32(madd_epi16(unpackhi_epi8(ab_hi, zero), coef), total[3]);
+}
+
+// the 8bit samples of the sums of madd_pairs.
+template <typename T>
+static __forceinline T
+pack_sums(T* total)
+{
+    // the sums of the negative lobes are negative, and saturate to 0.
+    for (int i = 0; i < 4; ++i) {
+        total[i] = srai_epi32(total[i], 10);
+    }
+    return packus_epi16(packs_epi32(total[0], total[1]), packs_epi32(total[2], total[3]));
+}
+
+// cubic interpolation of 8bit samples. sum(tap * sample) / 1024.
+template <typename T>
+static __forceinline T
+cubic(const T& a, const T& b, const T& c, const T& d, const T& coef0, const T& coef1)
+{
+    T total[4];
+    set1_epi32(total[0], 512);
+    total[1] = total[2] = total[3] = total[0];
+
+    madd_pairs(a, b, coef0, total);
+    madd_pairs(c, d, coef1, total);
+    return pack_sums(total);
+}
+
+
+template <typename T>
+static __forceinline T
+cubic_flip(const T& a, const T& b, const T& c, const T& d, const T& coef0, const T& coef1)
+{
+    return cubic(d, c, b, a, coef0, coef1);
+}
+
+template <typename T>
+static __forceinline T
+cubic_symmetry(const T& a, const T& b, const T& c, const T& d, const T& coeff)
+{
+    T zero, total0, total1, total2, total3;
+    zero = xor_reg(a, a);
+    set1_epi32(total0, 512);
+    total1 = total0;
+    total2 = total0;
+    total3 = total0;
+
+    T ad_lo = add_epu16(unpacklo_epi8(a, zero), unpacklo_epi8(d, zero));
+    T ad_hi = add_epu16(unpackhi_epi8(a, zero), unpackhi_epi8(d, zero));
+
+    T bc_lo = add_epu16(unpacklo_epi8(b, zero), unpacklo_epi8(c, zero));
+    T bc_hi = add_epu16(unpackhi_epi8(b, zero), unpackhi_epi8(c, zero));
+
+    T adbc0 = unpacklo_epi16(ad_lo, bc_lo);
+    T adbc1 = unpackhi_epi16(ad_lo, bc_lo);
+    T adbc2 = unpacklo_epi16(ad_hi, bc_hi);
+    T adbc3 = unpackhi_epi16(ad_hi, bc_hi);
+
+    total0 = add_epi32(madd_epi16(adbc0, coeff), total0);
+    total1 = add_epi32(madd_epi16(adbc1, coeff), total1);
+    total2 = add_epi32(madd_epi16(adbc2, coeff), total2);
+    total3 = add_epi32(madd_epi16(adbc3, coeff), total3);
+
+    total0 = srai_epi32(total0, 10);
+    total1 = srai_epi32(total1, 10);
+    total2 = srai_epi32(total2, 10);
+    total3 = srai_epi32(total3, 10);
+
+    total0 = packs_epi32(total0, total1);
+    total1 = packs_epi32(total2, total3);
+    return packus_epi16(total0, total1);
+}
+
+
+/*
+  Sample types. The kernels address rows in bytes (widths and pitches are
+  in bytes, so is sizeof(T)), and leave the arithmetic on the samples to S.
+
+  samples_8: 8bit samples. The results are the same as those of the 8bit
+  only kernels that came before.
+
+  samples_16: 9 to 16bit samples in uint16_t. Samples are made signed
+  (x ^ 0x8000) and weighted with madd_epi16 into 32bit sums, the bias of
+  the sign flip is added back with the rounding. The results are clamped
+  to [0, coeffs[8] + 32768], the largest value of the bit depth.
+
+  samples_f32: 32bit float samples. coeffs points to float taps instead
+  of int16_t ones, and the results are neither rounded nor clamped.
+
+  taps(i) is the i-th pair of cubic taps, in the form cubic() takes.
+  lerp() weights x with wx and y with 1 - wx.
+*/
+template <typename T>
+struct samples_8 {
+    static const int size = 1;
+    typedef T tap_pair;
+
+    const int16_t* coeffs;
+
+    explicit samples_8(const int16_t* c) : coeffs(c) {}
+
+    T taps(int i) const
+    {
+        T t;
+        set1_epi32(t, ((const int32_t*)coeffs)[i]);
+        return t;
+    }
+
+    T average(const T& x, const T& y) const
+    {
+        return ::average(x, y);
+    }
+
+    T average4(const T& w, const T& x, const T& y, const T& z) const
+    {
+        return ::average(w, x, y, z);
+    }
+
+    // (w * x + ((1 << SHIFT) - w) * y + (1 << SHIFT) / 2) >> SHIFT,
+    // w = wx * (1 << SHIFT) rounded.
+    template <int SHIFT>
+    T lerp(const T& x, const T& y, double wx) const
+    {
+        const int w = (int)(wx * (1 << SHIFT) + 0.5);
+        T vx, vy, round;
+        set1_epi16(vx, (int16_t)w);
+        set1_epi16(vy, (int16_t)((1 << SHIFT) - w));
+        set1_epi16(round, 1 << (SHIFT - 1));
+        T x0 = x, x1, y0 = y, y1;
+        cvtepu8_epi16x2(x0, x1);
+        cvtepu8_epi16x2(y0, y1);
+        T t0 = add_epu16(mullo_epi16(x0, vx), mullo_epi16(y0, vy));
+        t0 = srli_epi16(add_epu16(t0, round), SHIFT);
+        T t1 = add_epu16(mullo_epi16(x1, vx), mullo_epi16(y1, vy));
+        t1 = srli_epi16(add_epu16(t1, round), SHIFT);
+        return packus_epi16(t0, t1);
+    }
+
+    T cubic(const T& a, const T& b, const T& c, const T& d, const T& coef0,
+            const T& coef1) const
+    {
+        return ::cubic(a, b, c, d, coef0, coef1);
+    }
+
+    T cubic_flip(const T& a, const T& b, const T& c, const T& d, const T& coef0,
+                 const T& coef1) const
+    {
+        return ::cubic_flip(a, b, c, d, coef0, coef1);
+    }
+
+    T cubic_symmetry(const T& a, const T& b, const T& c, const T& d,
+                     const T& coeff) const
+    {
+        return ::cubic_symmetry(a, b, c, d, coeff);
+    }
+};
+
+
+template <typename T>
+struct samples_16 {
+    static const int size = 2;
+    typedef T tap_pair;
+
+    const int16_t* coeffs;
+    T sign;     // 0x8000
+    T max;      // the largest value - 32768
+
+    explicit samples_16(const int16_t* c) : coeffs(c)
+    {
+        set1_epi16(sign, -32768);
+        set1_epi16(max, coeffs ? coeffs[8] : 32767);
+    }
+
+    T taps(int i) const
+    {
+        T t;
+        set1_epi32(t, ((const int32_t*)coeffs)[i]);
+        return t;
+    }
+
+    T average(const T& x, const T& y) const
+    {
+        return average_epu16(x, y);
+    }
+
+    // the same as the 8bit one, on 16bit lanes.
+    T average4(const T& w, const T& x, const T& y, const T& z) const
+    {
+        T one;
+        set1_epi16(one, 1);
+        T avg0 = average_epu16(w, x);
+        T avg1 = average_epu16(y, z);
+        T err0 = or_reg(xor_reg(w, x), xor_reg(y, z));
+        T err1 = xor_reg(avg0, avg1);
+        T mask = and_reg(and_reg(err0, err1), one);
+        return subs_epu16(average_epu16(avg0, avg1), mask);
+    }
+
+    // the signed samples of x and y, interleaved.
+    void pairs(const T& x, const T& y, T& lo, T& hi) const
+    {
+        const T sx = xor_reg(x, sign);
+        const T sy = xor_reg(y, sign);
+        lo = unpacklo_epi16(sx, sy);
+        hi = unpackhi_epi16(sx, sy);
+    }
+
+    // restores the 32768 * sum(taps) lost by the sign flip, rounds, and
+    // takes 32768 off the result again for the signed saturation of pack().
+    T bias(const T& w0, const T& w1, int shift) const
+    {
+        T b;
+        set1_epi32(b, (1 << (shift - 1)) - (32768 << shift));
+        return sub_epi32(sub_epi32(b, madd_epi16(sign, w0)), madd_epi16(sign, w1));
+    }
+
+    T pack(const T& lo, const T& hi) const
+    {
+        return xor_reg(min_epi16(packs_epi32(lo, hi), max), sign);
+    }
+
+    template <int SHIFT>
+    T lerp(const T& x, const T& y, double wx) const
+    {
+        const int wi = (int)(wx * (1 << SHIFT) + 0.5);
+        T w, lo, hi;
+        set1_epi32(w, (((1 << SHIFT) - wi) << 16) | wi);
+        pairs(x, y, lo, hi);
+        const T b = bias(w, xor_reg(w, w), SHIFT);
+        lo = srai_epi32(add_epi32(madd_epi16(lo, w), b), SHIFT);
+        hi = srai_epi32(add_epi32(madd_epi16(hi, w), b), SHIFT);
+        return pack(lo, hi);
+    }
+
+    T cubic(const T& a, const T& b, const T& c, const T& d, const T& coef0,
+            const T& coef1) const
+    {
+        T ab_lo, ab_hi, cd_lo, cd_hi;
+        pairs(a, b, ab_lo, ab_hi);
+        pairs(c, d, cd_lo, cd_hi);
+        const T t = bias(coef0, coef1, 10);
+        T lo = add_epi32(add_epi32(madd_epi16(ab_lo, coef0), madd_epi16(cd_lo, coef1)), t);
+        T hi = add_epi32(add_epi32(madd_epi16(ab_hi, coef0), madd_epi16(cd_hi, coef1)), t);
+        return pack(srai_epi32(lo, 10), srai_epi32(hi, 10));
+    }
+
+    T cubic_flip(const T& a, const T& b, const T& c, const T& d, const T& coef0,
+                 const T& coef1) const
+    {
+        return cubic(d, c, b, a, coef0, coef1);
+    }
+
+    // coeff weights a and d with its first tap, b and c with its second.
+    T cubic_symmetry(const T& a, const T& b, const T& c, const T& d,
+                     const T& coeff) const
+    {
+        return cubic(a, b, d, c, coeff, coeff);
+    }
+};
+
+
+
+template <typename T>
+struct samples_f32 {
+    static const int size = 4;
+
+    struct tap_pair {
+        T w0, w1;
+    };
+
+    const float* coeffs;
+
+    explicit samples_f32(const int16_t* c) : coeffs((const float*)c) {}
+
+    tap_pair taps(int i) const
+    {
+        tap_pair t;
+        set1_ps(t.w0, coeffs[i * 2]);
+        set1_ps(t.w1, coeffs[i * 2 + 1]);
+        return t;
+    }
+
+    T average(const T& x, const T& y) const
+    {
+        T half;
+        set1_ps(half, 0.5f);
+        return mul_ps(add_ps(x, y), half);
+    }
+
+    T average4(const T& w, const T& x, const T& y, const T& z) const
+    {
+        T quarter;
+        set1_ps(quarter, 0.25f);
+        return mul_ps(add_ps(add_ps(w, x), add_ps(y, z)), quarter);
+    }
+
+    template <int SHIFT>
+    T lerp(const T& x, const T& y, double wx) const
+    {
+        T vx, vy;
+        set1_ps(vx, (float)wx);
+        set1_ps(vy, (float)(1.0 - wx));
+        return fmadd_ps(x, vx, mul_ps(y, vy));
+    }
+
+    T cubic(const T& a, const T& b, const T& c, const T& d, const tap_pair& coef0,
+            const tap_pair& coef1) const
+    {
+        T t = mul_ps(a, coef0.w0);
+        t = fmadd_ps(b, coef0.w1, t);
+        t = fmadd_ps(c, coef1.w0, t);
+        return fmadd_ps(d, coef1.w1, t);
+    }
+
+    T cubic_flip(const T& a, const T& b, const T& c, const T& d, const tap_pair& coef0,
+                 const tap_pair& coef1) const
+    {
+        return cubic(d, c, b, a, coef0, coef1);
+    }
+
+    T cubic_symmetry(const T& a, const T& b, const T& c, const T& d,
+                     const tap_pair& coeff) const
+    {
+        return fmadd_ps(add_ps(b, c), coeff.w1, mul_ps(add_ps(a, d), coeff.w0));
+    }
+};
+
+///////////////// itype 0 (Point) /////////////////
+
+template <typename T, typename M, typename S>
+static void __stdcall
+proc_point_p(const int width, const int height, const uint8_t* srcp,
+             uint8_t* dstp, int src_pitch, int dst_pitch,
+             const int16_t* coeffs)
+{
+    const uint8_t* s = srcp;
+    uint8_t* d = dstp;
+    const int sp = src_pitch;
+    const int dp = dst_pitch;
+    const S smp(coeffs);
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x = M::next(x, width)) {
+            T reg = M::load(s + x);
+            M::store(d      + x, reg);
+            M::store(d + dp + x, reg);
+        }
+        s += sp;
+        d += 2 * dp;
+    }
+}
+
+
+template <typename T, typename M, typename S>
+static void __stdcall
+proc_point_i(const int width, const int height, const uint8_t* srcp,
+             uint8_t* dstp, const int src_pitch, const int dst_pitch,
+             const int16_t* coeffs)
+{
+    const uint8_t* s = srcp;
+    uint8_t* d = dstp;
+    const int sp = src_pitch;
+    const int dp = dst_pitch;
+    const S smp(coeffs);
+
+    if (sp < 0) { // cplace=3(DV-PAL) and V-plane
+        s += -sp * (height - 1);
+        d += -dp * (2 * height - 1);
+    }
+
+    for (int y = 0; y < height; y += 2) {
+        for (int x = 0; x < width; x = M::next(x, width)) {
+            T reg = M::load(s + x);
+            M::store(d + 0 * dp + x, reg);
+            M::store(d + 2 * dp + x, reg);
+            reg = M::load(s + sp + x);
+            M::store(d + 1 * dp + x, reg);
+            M::store(d + 3 * dp + x, reg);
+        }
+        s += 2 * sp;
+        d += 4 * dp;
+    }
+}
+
+
+
+///////////////// itype 1 (Linear) /////////////////
+
+template <typename T, typename M, typename S>
+static void __stdcall
+proc_linear_c0_p(const int width, const int height, const uint8_t* srcp,
+                 uint8_t* dstp, const int src_pitch, const int dst_pitch,
+                 const int16_t* coeffs)
+{
+    const uint8_t* s = srcp;
+    uint8_t* d = dstp;
+    const int sp = src_pitch;
+    const int dp = dst_pitch;
+    const S smp(coeffs);
+
+    for (int y = 0; y < height - 1; ++y) {
+        for (int x = 0; x < width; x = M::next(x, width)) {
+            T reg0 = M::load(s      + x);
+            T reg1 = M::load(s + sp + x);
+            T avg = smp.average(reg0, reg1);
+            M::store(d      + x, reg0);
+            M::store(d + dp + x, avg);
+        }
+        s += sp;
+        d += 2 * dp;
+    }
+    for (int x = 0; x < width; x = M::next(x, width)) {
+        T reg = M::load(s + x);
+        M::store(d + x, reg);
+        M::store(d + dp + x, reg);
+    }
+}
+
+
+template <typename T, typename M, typename S>
+static void __stdcall
+proc_linear_c03_i(const int width, const int height, const uint8_t* srcp,
+                 uint8_t* dstp, const int src_pitch, const int dst_pitch,
+                 const int16_t* coeffs)
+{
+    const uint8_t* s = srcp;
+    uint8_t* d = dstp;
+    const int sp = src_pitch;
+    const int dp = dst_pitch;
+    const S smp(coeffs);
+
+    if (sp < 0) { // cplace=3(DV-PAL) and V-plane
+        s += -sp * (height - 1);
+        d += -dp * (2 * height - 1);
+    }
+
+    for (int y = 0; y < height - 2; y += 2) {
+        for (int x = 0; x < width; x = M::next(x, width)) {
+            T reg0 = M::load(s + 0 * sp + x);
+            T reg1 = M::load(s + 1 * sp + x);
+            T reg2 = M::load(s + 2 * sp + x);
+            T reg3 = M::load(s + 3 * sp + x);
+
+            M::store(d + 0 * dp + x, reg0);
+            M::store(d + 1 * dp + x, reg1);
+            M::store(d + 2 * dp + x, smp.average(reg0, reg2));
+            M::store(d + 3 * dp + x, smp.average(reg1, reg3));
+        }
+        s += 2 * sp;
+        d += 4 * dp;
+    }
+    for (int x = 0; x < width; x = M::next(x, width)) {
+        T reg0 = M::load(s      + x);
+        T reg1 = M::load(s + sp + x);
+        M::store(d + 0 * dp + x, reg0);
+        M::store(d + 1 * dp + x, reg1);
+        M::store(d + 2 * dp + x, reg0);
+        M::store(d + 3 * dp + x, reg1);
+    }
+}
+
+
+template <typename T, typename M, typename S>
+static void __stdcall
+proc_linear_c1_p(const int width, const int height, const uint8_t* srcp,
+                 uint8_t* dstp, const int src_pitch, const int dst_pitch,
+                 const int16_t* coeffs)
+{
+    const uint8_t* s = srcp;
+    uint8_t* d = dstp;
+    const int sp = src_pitch;
+    const int dp = dst_pitch;
+    const S smp(coeffs);
+
+    memcpy(d, s, width);
+    d += dp;
+
+    for (int y = 0; y < height - 1; ++y) {
+        for (int x = 0; x < width; x = M::next(x, width)) {
+            T reg0 = M::load(s      + x);
+            T reg1 = M::load(s + sp + x);
+            M::store(d      + x, smp.average4(reg0, reg0, reg0, reg1));
+            M::store(d + dp + x, smp.average4(reg0, reg1, reg1, reg1));
+        }
+        s += sp;
+        d += 2 * dp;
+    }
+
+    memcpy(d, s, width);
+}
+
+
+template <typename T, typename M, typename S>
+static void __stdcall
+proc_linear_c1_i(const int width, const int height, const uint8_t* srcp,
+                 uint8_t* dstp, const int src_pitch, const int dst_pitch,
+                 const int16_t* coeffs)
+{
+    const uint8_t* s = srcp;
+    uint8_t* d = dstp;
+    const int sp = src_pitch;
+    const int dp = dst_pitch;
+    const S smp(coeffs);
+
+    memcpy(d, s, width);
+    memcpy(d + dp, s + sp, width);
+    d += 2 * dp;
+
+    for (int y = 0; y < height - 2; y += 2) {
+        for (int x = 0; x < width; x = M::next(x, width)) {
+            T reg0 = M::load(s + 0 * sp + x);
+            T reg1 = M::load(s + 1 * sp + x);
+            T reg2 = M::load(s + 2 * sp + x);
+            T reg3 = M::load(s + 3 * sp + x);
+            M::store(d + 0 * dp + x, smp.average4(reg0, reg0, reg0, reg2));
+            M::store(d + 1 * dp + x, smp.average4(reg1, reg1, reg1, reg3));
+            M::store(d + 2 * dp + x, smp.average4(reg0, reg2, reg2, reg2));
+            M::store(d + 3 * dp + x, smp.average4(reg1, reg3, reg3, reg3));
+        }
+        s += 2 * sp;
+        d += 4 * dp;
+    }
+
+    memcpy(d, s, width);
+    memcpy(d + dp, s + sp, width);
+}
+
+
+template <typename T, typename M, typename S>
+static void __stdcall
+proc_linear_c2_p(const int width, const int height, const uint8_t* srcp,
+                 uint8_t* dstp, const int src_pitch, const int dst_pitch,
+                 const int16_t* coeffs)
+{
+    const uint8_t* s = srcp;
+    uint8_t* d = dstp;
+    const int sp = src_pitch;
+    const int dp = dst_pitch;
+    const S smp(coeffs);
+
+    for (int y = 0; y < height - 2; y += 2) {
+        memcpy(d, s, width);
+        s += sp;
+        d += dp;
+        memcpy(d, s, width);
+        d += dp;
+        for (int x = 0; x < width; x = M::next(x, width)) {
+            T reg0 = M::load(s + 0 * sp + x);
+            T reg1 = M::load(s + 1 * sp + x);
+            M::store(d + x, smp.template lerp<8>(reg0, reg1, 2.0 / 3));
+            M::store(d + dp + x, smp.template lerp<8>(reg0, reg1, 1.0 / 3));
+        }
+        s += sp;
+        d += 2 * dp;
+    }
+    memcpy(d, s, width);
+    s += sp;
+    d += dp;
+    memcpy(d + 0 * dp, s, width);
+    memcpy(d + 1 * dp, s, width);
+    memcpy(d + 2 * dp, s, width);
+}
+
+
+template <typename T, typename M, typename S>
+static void __stdcall
+proc_linear_c2_i(const int width, const int height, const uint8_t* srcp,
+                 uint8_t* dstp, const int src_pitch, const int dst_pitch,
+                 const int16_t* coeffs)
+{
+    const uint8_t* s = srcp;
+    uint8_t* d = dstp;
+    const int sp = src_pitch;
+    const int dp = dst_pitch;
+    const S smp(coeffs);
+
+    memcpy(d, s, width);
+    d += dp;
+    memcpy(d, s + sp, width);
+    d += dp;
+
+    for (int y = 0; y < height - 2; y += 2) {
+        for (int x = 0; x < width; x = M::next(x, width)) {
+            T reg0 = M::load(s + 0 * sp + x);
+            T reg2 = M::load(s + 2 * sp + x);
+            M::store(d + 0 * dp + x, smp.template lerp<3>(reg0, reg2, 5.0 / 8));
+            M::store(d + 2 * dp + x, smp.template lerp<3>(reg0, reg2, 1.0 / 8));
+
+            reg0 = M::load(s + 1 * sp + x);
+            reg2 = M::load(s + 3 * sp + x);
+            M::store(d + 1 * dp + x, smp.template lerp<3>(reg0, reg2, 7.0 / 8));
+            M::store(d + 3 * dp + x, smp.template lerp<3>(reg0, reg2, 3.0 / 8));
+        }
+        s += 2 * sp;
+        d += 4 * dp;
+    }
+    memcpy(d, s, width);
+    memcpy(d + dp, s + sp, width);
+}
+
+
+template <typename T, typename M, typename S>
+static void __stdcall
+proc_linear_c3_p(const int width, const int height, const uint8_t* srcp,
+                 uint8_t* dstp, const int src_pitch, const int dst_pitch,
+                 const int16_t* coeffs)
+{
+    const uint8_t* s = srcp;
+    uint8_t* d = dstp;
+    const int sp = src_pitch;
+    const int dp = dst_pitch;
+    const S smp(coeffs);
+
+    memcpy(d, s, width);
+    memcpy(d + dp, s, width);
+    s += sp;
+    d += 2 * dp;
+
+    for (int y = 1; y < height - 1; y += 2) {
+        for (int x = 0; x < width; x = M::next(x, width)) {
+            T reg0 = M::load(s      + x);
+            T reg1 = M::load(s + sp + x);
+            M::store(d + 0 * dp + x, reg0);
+            M::store(d + 3 * dp + x, reg1);
+            M::store(d + 1 * dp + x, smp.template lerp<8>(reg0, reg1, 2.0 / 3));
+            M::store(d + 2 * dp + x, smp.template lerp<8>(reg0, reg1, 1.0 / 3));
+        }
+        s += 2 * sp;
+        d += 4 * dp;
+    }
+    memcpy(d, s, width);
+    memcpy(d + dp, s, width);
+}
+
+
+//////////////// itype 2 (cubic) /////////////////////////
+
+template <typename T, typename M, typename S>
+static void __stdcall
+proc_cubic_c0_p(const int width, const int height, const uint8_t* srcp,
+                uint8_t* dstp, const int src_pitch, const int dst_pitch,
+                const int16_t* coeffs)
+{
+    uint8_t* d = dstp;
+    const int sp = src_pitch;
+    const int dp = dst_pitch;
+    const S smp(coeffs);
+
+    const uint8_t* s0 = srcp + 2 * sp;
+    const uint8_t* s1 = srcp;
+    const uint8_t* s2 = s1 + sp;
+    const uint8_t* s3 = s2 + sp;
+
+    const typename S::tap_pair coeff = smp.taps(0);
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x = M::next(x, width)) {
+            T src0 = M::load(s0 + x);
+            T src1 = M::load(s1 + x);
+            T src2 = M::load(s2 + x);
+            T src3 = M::load(s3 + x);
+
+            M::store(d + x, src1);
+
+            T cs = smp.cubic_symmetry(src0, src1, src2, src3, coeff);
+            M::store(d + dp + x, cs);
+        }
+        s0 = s1;
+        s1 = s2;
+        s2 = s2 + (y < height - 2 ? sp : 0);
+        s3 = y < height - 3 ? s3 + sp : s0;
+        d += 2 * dp;
+    }
+}
+
+
+template <typename T, typename M, typename S>
+static void __stdcall
+proc_cubic_c03_i(const int width, const int height, const uint8_t* srcp,
+                 uint8_t* dstp, const int src_pitch, const int dst_pitch,
+                 const int16_t* coeffs)
+{
+    uint8_t* d = dstp;
+    const int sp = src_pitch;
+    const int dp = dst_pitch;
+    const S smp(coeffs);
+
+    const uint8_t* s1 = srcp;
+    if (sp < 0) { // cplace=3(DV-PAL) and V-plane
+        s1 += -sp * (height - 1);
+        d += -dp * (2 * height - 1);
+    }
+    const uint8_t* s0 = s1 + 4 * sp;
+    const uint8_t* s2 = s1 + 2 * sp;
+    const uint8_t* s3 = s1 + 4 * sp;
+
+    const typename S::tap_pair coeff = smp.taps(0);
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x = M::next(x, width)) {
+            T src0 = M::load(s0 + x);
+            T src1 = M::load(s1 + x);
+            T src2 = M::load(s2 + x);
+            T src3 = M::load(s3 + x);
+
+            M::store(d + x, src1);
+
+            T cs = smp.cubic_symmetry(src0, src1, src2, src3, coeff);
+            M::store(d + 2 * dp + x, cs);
+        }
+        s1 += sp;
+        s0 = s1 + (y < 2 ? 4 : - 2) * sp;
+        s2 = s1 + (y > height - 4 ? 0 : 2) * sp;
+        s3 = s1 + (y > height - 6 ? -2 : 4) * sp;
+        d += (y & 1 ? 3 : 1) * dp;
+    }
+}
+
+template <typename T, typename M, typename S>
+static void __stdcall
+proc_cubic_c1_p(const int width, const int height, const uint8_t* srcp,
+    uint8_t* dstp, const int src_pitch, const int dst_pitch,
+    const int16_t* coeffs)
+{
+    const uint8_t* s = srcp;
+    uint8_t* d = dstp;
+    const int sp = src_pitch;
+    const int dp = dst_pitch;
+    const S smp(coeffs);
+
+    const typename S::tap_pair coeff0 = smp.taps(0);
+    const typename S::tap_pair coeff1 = smp.taps(1);
+    T src0, src1, src2, src3;
+
+    for (int x = 0; x < width; x = M::next(x, width)) {
+        src0 = M::load(s + 2 * sp + x);
+        src1 = M::load(s + 0 * sp + x);
+        src2 = M::load(s + 1 * sp + x);
+        M::store(d + 0 * dp + x, smp.cubic(src2, src1, src1, src2, coeff0, coeff1));
+        M::store(d + 1 * dp + x, smp.cubic_flip(src0, src1, src2, src0, coeff0, coeff1));
+        M::store(d + 2 * dp + x, smp.cubic(src0, src1, src2, src0, coeff0, coeff1));
+    }
+    d += 3 * dp;
+
+    for (int y = 0; y < height - 3; ++y) {
+        for (int x = 0; x < width; x = M::next(x, width)) {
+            src0 = M::load(s + 0 * sp + x);
+            src1 = M::load(s + 1 * sp + x);
+            src2 = M::load(s + 2 * sp + x);
+            src3 = M::load(s + 3 * sp + x);
+
+            M::store(d + x, smp.cubic_flip(src0, src1, src2, src3, coeff0, coeff1));
+            M::store(d + dp + x, smp.cubic(src0, src1, src2, src3, coeff0, coeff1));
+        }
+        s += sp;
+        d += 2 * dp;
+    }
+
+    for (int x = 0; x < width; x = M::next(x, width)) {
+        src0 = M::load(s + 0 * sp + x);
+        src1 = M::load(s + 1 * sp + x);
+        src2 = M::load(s + 2 * sp + x);
+        M::store(d + 0 * dp + x, smp.cubic_flip(src0, src1, src2, src0, coeff0, coeff1));
+        M::store(d + 1 * dp + x, smp.cubic(src0, src1, src2, src0, coeff0, coeff1));
+        M::store(d + 2 * dp + x, smp.cubic_flip(src1, src2, src2, src1, coeff0, coeff1));
+    }
+}
+
+
+template <typename T, typename M, typename S>
+static void __stdcall
+proc_cubic_c12_i(const int width, const int height, const uint8_t* srcp,
+    uint8_t* dstp, const int src_pitch, const int dst_pitch,
+    const int16_t* coeffs)
+{
+    const uint8_t* s = srcp;
+    uint8_t* d = dstp;
+    const int sp = src_pitch;
+    const int dp = dst_pitch;
+    const S smp(coeffs);
+
+    const typename S::tap_pair coeff0 = smp.taps(0);
+    const typename S::tap_pair coeff1 = smp.taps(1);
+    const typename S::tap_pair coeff2 = smp.taps(2);
+    const typename S::tap_pair coeff3 = smp.taps(3);
+    T src0, src1, src2, src3;
+
+    for (int x = 0; x < width; x = M::next(x, width)) {
+        src0 = M::load(s + 0 * sp + x);
+        src1 = M::load(s + 2 * sp + x);
+        src2 = M::load(s + 4 * sp + x);
+        M::store(d + 0 * dp + x, smp.cubic(src1, src0, src0, src1, coeff0, coeff1));
+        M::store(d + 2 * dp + x, smp.cubic_flip(src2, src0, src1, src2, coeff2, coeff3));
+        M::store(d + 4 * dp + x, smp.cubic(src2, src0, src1, src2, coeff0, coeff1));
+        src0 = M::load(s + 1 * sp + x);
+        src1 = M::load(s + 3 * sp + x);
+        src2 = M::load(s + 5 * sp + x);
+        M::store(d + 1 * dp + x, smp.cubic(src1, src0, src0, src1, coeff2, coeff3));
+        M::store(d + 3 * dp + x, smp.cubic_flip(src2, src0, src1, src2, coeff0, coeff1));
+        M::store(d + 5 * dp + x, smp.cubic(src2, src0, src1, src2, coeff2, coeff3));
+    }
+    d += 6 * dp;
+
+    for (int y = 0; y < height - 6; y += 2) {
+        for (int x = 0; x < width; x = M::next(x, width)) {
+            src0 = M::load(s + 0 * sp + x);
+            src1 = M::load(s + 2 * sp + x);
+            src2 = M::load(s + 4 * sp + x);
+            src3 = M::load(s + 6 * sp + x);
+            M::store(d + 0 * dp + x, smp.cubic_flip(src0, src1, src2, src3, coeff2, coeff3));
+            M::store(d + 2 * dp + x, smp.cubic(src0, src1, src2, src3, coeff0, coeff1));
+        }
+        for (int x = 0; x < width; x = M::next(x, width)) {
+            src0 = M::load(s + 1 * sp + x);
+            src1 = M::load(s + 3 * sp + x);
+            src2 = M::load(s + 5 * sp + x);
+            src3 = M::load(s + 7 * sp + x);
+            M::store(d + 1 * dp + x, smp.cubic_flip(src0, src1, src2, src3, coeff0, coeff1));
+            M::store(d + 3 * dp + x, smp.cubic(src0, src1, src2, src3, coeff2, coeff3));
+        }
+        s += 2 * sp;
+        d += 4 * dp;
+    }
+
+    for (int x = 0; x < width; x = M::next(x, width)) {
+        src0 = M::load(s + 0 * sp + x);
+        src1 = M::load(s + 2 * sp + x);
+        src2 = M::load(s + 4 * sp + x);
+        M::store(d + 0 * dp + x, smp.cubic_flip(src0, src1, src2, src0, coeff2, coeff3));
+        M::store(d + 2 * dp + x, smp.cubic(src0, src1, src2, src0, coeff0, coeff1));
+        M::store(d + 4 * dp + x, smp.cubic_flip(src1, src2, src2, src1, coeff2, coeff3));
+        src0 = M::load(s + 1 * sp + x);
+        src1 = M::load(s + 3 * sp + x);
+        src2 = M::load(s + 5 * sp + x);
+        M::store(d + 1 * dp + x, smp.cubic_flip(src0, src1, src2, src0, coeff0, coeff1));
+        M::store(d + 3 * dp + x, smp.cubic(src0, src1, src2, src0, coeff2, coeff3));
+        M::store(d + 5 * dp + x, smp.cubic_flip(src1, src2, src2, src1, coeff0, coeff1));
+    }
+}
+
+template <typename T, typename M, typename S>
+static void __stdcall
+proc_cubic_c2_p(const int width, const int height, const uint8_t* srcp,
+    uint8_t* dstp, const int src_pitch, const int dst_pitch,
+    const int16_t* coeffs)
+{
+    const uint8_t* s = srcp;
+    uint8_t* d = dstp;
+    const int sp = src_pitch;
+    const int dp = dst_pitch;
+    const S smp(coeffs);
+
+    const typename S::tap_pair coeff0 = smp.taps(0);
+    const typename S::tap_pair coeff1 = smp.taps(1);
+    T src0, src1, src2, src3;
+
+    for (int y = 0; y < height - 2; y += 2) {
+        for (int x = 0; x < width; x = M::next(x, width)) {
+            src0 = M::load(s + 0 * sp + x);
+            src1 = M::load(s + 1 * sp + x);
+            src2 = M::load(s + 2 * sp + x);
+            src3 = M::load(s + 3 * sp + x);
+
+            M::store(d + 0 * dp + x, src0);
+            M::store(d + 1 * dp + x, src1);
+            M::store(d + 2 * dp + x, smp.cubic(src0, src1, src2, src3, coeff0, coeff1));
+            M::store(d + 3 * dp + x, smp.cubic_flip(src0, src1, src2, src3, coeff0, coeff1));
+        }
+        s += 2 * sp;
+        d += 4 * dp;
+    }
+    for (int x = 0; x < width; x = M::next(x, width)) {
+        src0 = M::load(s + x);
+        src1 = M::load(s + sp + x);
+        M::store(d + 0 * dp + x, src0);
+        M::store(d + 1 * dp + x, src1);
+        M::store(d + 2 * dp + x, smp.cubic(src0, src1, src1, src0, coeff0, coeff1));
+        M::store(d + 3 * dp + x, smp.cubic_flip(src0, src1, src1, src0, coeff0, coeff1));
+    }
+}
+
+
+template <typename T, typename M, typename S>
+static void __stdcall
+proc_cubic_c3_p(const int width, const int height, const uint8_t* srcp,
+    uint8_t* dstp, const int src_pitch, const int dst_pitch,
+    const int16_t* coeffs)
+{
+    const uint8_t* s = srcp;
+    uint8_t* d = dstp;
+    const int sp = src_pitch;
+    const int dp = dst_pitch;
+    const S smp(coeffs);
+
+    const typename S::tap_pair coeff0 = smp.taps(0);
+    const typename S::tap_pair coeff1 = smp.taps(1);
+    T src0, src1, src2, src3;
+
+    for (int x = 0; x < width; x = M::next(x, width)) {
+        src0 = M::load(s + x);
+        src1 = M::load(s + sp + x);
+        M::store(d + x, smp.cubic(src1, src0, src0, src1, coeff0, coeff1));
+    }
+    d += dp;
+
+    for (int y = 0; y < height - 2; y += 2) {
+        for (int x = 0; x < width; x = M::next(x, width)) {
+            src0 = M::load(s + 0 * sp + x);
+            src1 = M::load(s + 1 * sp + x);
+            src2 = M::load(s + 2 * sp + x);
+            src3 = M::load(s + 3 * sp + x);
+            M::store(d + 0 * dp + x, src0);
+            M::store(d + 1 * dp + x, src1);
+            M::store(d + 2 * dp + x, smp.cubic_flip(src0, src1, src2, src3, coeff0, coeff1));
+            M::store(d + 3 * dp + x, smp.cubic(src0, src1, src2, src3, coeff0, coeff1));
+        }
+        s += 2 * sp;
+        d += 4 * dp;
+    }
+    for (int x = 0; x < width; x = M::next(x, width)) {
+        src0 = M::load(s + x);
+        src1 = M::load(s + sp + x);
+        M::store(d + 0 * dp + x, src0);
+        M::store(d + 1 * dp + x, src1);
+        M::store(d + 2 * dp + x, smp.cubic_flip(src0, src1, src1, src0, coeff0, coeff1));
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+
+
+// STEP is the samples between the neighbors, 2 for the interleaved UV rows
+// of nv12.
+template <typename T, typename M, typename S, int STEP>
+static void __stdcall
+proc_qpel_shift_h(const int width, const int height, const uint8_t* srcp,
+                  uint8_t* dstp, const int src_pitch, const int dst_pitch)
+{
+    const S smp(nullptr);
+    const int step = S::size * STEP;
+
+    for (int y = 0; y < height; ++y) {
+
+        T current = M::load(srcp);
+        T left = slli_reg<S::size * STEP>(current);
+        T mask = slli_reg<S::size * STEP>(cmpeq(current, current));
+        left = blendv_epi8(current, left, mask);
+        M::store(dstp, smp.average4(current, current, current, left));
+
+        for (int x = M::next(0, width); x < width; x = M::next(x, width)) {
+            current = M::load(srcp + x);
+            left = loadu_reg((const T*)(srcp + x - step));
+            M::store(dstp + x, smp.average4(current, current, current, left));
+        }
+        srcp += src_pitch;
+        dstp += dst_pitch;
+    }
+}
+
+
+// the samples of x and y alternately, SIZE bytes each.
+template <int SIZE, typename T>
+static __forceinline T interleave_lo(const T& x, const T& y)
+{
+    return SIZE == 1 ? unpacklo_epi8(x, y) : SIZE == 2 ? unpacklo_epi16(x, y) :
+           unpacklo_epi32(x, y);
+}
+
+template <int SIZE, typename T>
+static __forceinline T interleave_hi(const T& x, const T& y)
+{
+    return SIZE == 1 ? unpackhi_epi8(x, y) : SIZE == 2 ? unpackhi_epi16(x, y) :
+           unpackhi_epi32(x, y);
+}
+
+
+// 2x horizontal upsampling of the chroma rows for 4:4:4 output. width is
+// the bytes of a source row, the destination rows are twice as wide.
+// SITING 0 duplicates the samples. 1 and 2 interpolate linearly, for chroma
+// co-sited with the even luma columns (mpeg2, h264) and for chroma centered
+// between two columns (mpeg1, jpeg), where the even and odd outputs are
+// proc_qpel_shift_h to the left and to the right.
+template <typename T, typename M, typename S, int SITING>
+static void __stdcall
+proc_upsample_h(const int width, const int height, const uint8_t* srcp,
+                uint8_t* dstp, const int src_pitch, const int dst_pitch)
+{
+    const S smp(nullptr);
+    const int size = sizeof(T);
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x = M::next(x, width)) {
+            T current = M::load(srcp + x);
+            T even = current;
+            T odd = current;
+            if (SITING > 0) {
+                // the last vector reads nothing after the row. its last
+                // sample is fixed below.
+                T right = x + size < width ? loadu_reg((const T*)(srcp + x + S::size))
+                                           : srli_reg<S::size>(current);
+                if (SITING == 1) {
+                    odd = smp.average4(current, current, right, right);
+                } else {
+                    T left;
+                    if (x > 0) {
+                        left = loadu_reg((const T*)(srcp + x - S::size));
+                    } else {
+                        T mask = slli_reg<S::size>(cmpeq(current, current));
+                        left = blendv_epi8(current, slli_reg<S::size>(current), mask);
+                    }
+                    even = smp.average4(current, current, current, left);
+                    odd = smp.average4(current, current, current, right);
+                }
+            }
+            M::store(dstp + 2 * x, interleave_lo<S::size>(even, odd));
+            if (2 * x + size < width * 2) {
+                M::store(dstp + 2 * x + size, interleave_hi<S::size>(even, odd));
+            }
+        }
+        if (SITING > 0) {
+            // the right neighbor of the last sample is itself.
+            memcpy(dstp + width * 2 - S::size, srcp + width - S::size, S::size);
+        }
+        srcp += src_pitch;
+        dstp += dst_pitch;
+    }
+}
+
+
+// 2x horizontal upsampling of 4:1:1 chroma rows (dv ntsc) to 4:2:2. width
+// is the bytes of a source row, the destination rows are twice as wide. the
+// chroma is co-sited with the first of every 4 luma columns, so the even
+// outputs are the source samples and the odd ones lie halfway between two
+// of them: duplicated (ITYPE 0), averaged (1) or cubic (2), with the taps of
+// the vertical cplace 0 kernel. the rows are extended by their edge samples.
+template <typename T, typename M, typename S, int ITYPE>
+static void __stdcall
+proc_upsample_411(const int width, const int height, const uint8_t* srcp,
+                  uint8_t* dstp, const int src_pitch, const int dst_pitch,
+                  const int16_t* coeffs)
+{
+    const S smp(coeffs);
+    const typename S::tap_pair coeff = ITYPE == 2 ? smp.taps(0) : typename S::tap_pair();
+    const int size = sizeof(T);
+    const int ss = S::size;
+    // the left neighbor, a vector and two right neighbors of the edges.
+    alignas(64) uint8_t edge[sizeof(T) + 3 * S::size];
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x = M::next(x, width)) {
+            T current = M::load(srcp + x);
+            T odd = current;
+            if (ITYPE > 0) {
+                const uint8_t* p = srcp + x - ss;
+                if (x == 0 || x + size + ss * 2 > width) {
+                    const int n = width - x < size + ss * 2 ? width - x : size + ss * 2;
+                    memcpy(edge, x > 0 ? srcp + x - ss : srcp, ss);
+                    memcpy(edge + ss, srcp + x, n);
+                    for (int i = ss + n; i < size + ss * 3; i += ss) {
+                        memcpy(edge + i, srcp + width - ss, ss);
+                    }
+                    p = edge;
+                }
+                T right = loadu_reg((const T*)(p + ss * 2));
+                if (ITYPE == 1) {
+                    odd = smp.average(current, right);
+                } else {
+                    T left = loadu_reg((const T*)p);
+                    T right2 = loadu_reg((const T*)(p + ss * 3));
+                    odd = smp.cubic_symmetry(left, current, right, right2, coeff);
+                }
+            }
+            M::store(dstp + 2 * x, interleave_lo<S::size>(current, odd));
+            if (2 * x + size < width * 2) {
+                M::store(dstp + 2 * x + size, interleave_hi<S::size>(current, odd));
+            }
+        }
+        srcp += src_pitch;
+        dstp += dst_pitch;
+    }
+}
+
+
+// 8bit samples to 16bit words of x << SHIFT (8, or 2 for 10bit). width is
+// the bytes of the 16bit rows, the source rows are width / 2 bytes.
+template <typename T, typename M, int SHIFT>
+static void __stdcall
+proc_widen(const int width, const int height, const uint8_t* srcp,
+           uint8_t* dstp, const int src_pitch, const int dst_pitch)
+{
+    const int src_width = width / 2;
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < src_width; x = M::next(x, src_width)) {
+            T lo = M::load(srcp + x);
+            T hi;
+            if (SHIFT == 8) {
+                cvtepu8_epi16x2r(lo, hi);
+            } else {
+                cvtepu8_epi16x2(lo, hi);
+                lo = slli_epi16(lo, SHIFT);
+                hi = slli_epi16(hi, SHIFT);
+            }
+            M::store(dstp + 2 * x, lo);
+            if (2 * x + (int)sizeof(T) < width) {
+                M::store(dstp + 2 * x + sizeof(T), hi);
+            }
+        }
+        srcp += src_pitch;
+        dstp += dst_pitch;
+    }
+}
+
+
+// 10bit samples to the msbs of 16bit (P210).
+template <typename T, typename M>
+static void __stdcall
+proc_msb10(const int width, const int height, const uint8_t* srcp,
+           uint8_t* dstp, const int src_pitch, const int dst_pitch)
+{
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x = M::next(x, width)) {
+            M::store(dstp + x, slli_epi16(M::load(srcp + x), 6));
+        }
+        srcp += src_pitch;
+        dstp += dst_pitch;
+    }
+}
+
+
+/*
+  Writers of the 4:2:2 output which interleave the planes. Every vector of
+  U and V makes 4 vectors of packed output or 2 vectors of interleaved UV.
+  The aligned ones write up to aligned_size(bytes of the output row,
+  sizeof(T)) and read the luma up to aligned_size(width, sizeof(T)).
+*/
+
+struct order_yuy2 {
+    template <typename T>
+    static __forceinline T lo(const T& y, const T& uv)
+    {
+        return unpacklo_epi8(y, uv);
+    }
+    template <typename T>
+    static __forceinline T hi(const T& y, const T& uv)
+    {
+        return unpackhi_epi8(y, uv);
+    }
+};
+
+
+struct order_uyvy {
+    template <typename T>
+    static __forceinline T lo(const T& y, const T& uv)
+    {
+        return unpacklo_epi8(uv, y);
+    }
+    template <typename T>
+    static __forceinline T hi(const T& y, const T& uv)
+    {
+        return unpackhi_epi8(uv, y);
+    }
+};
+
+
+/*
+  YUV to YUV matrix and range conversion to 8bit 4:2:2, fused into the
+  writers. The chroma comes from the vertical kernels as 16bit samples
+  (8bit << 8, rounded once), so the output is rounded only here. The chroma
+  of the output depends on both U and V, and the luma on the chroma of its
+  pixel pair:
+    y' = (ky * (y << 7) + ku * (u >> 1) + kv * (v >> 1) + cy) >> 21
+    u' = (kuu * (u >> 1) + kuv * (v >> 1) + cu) >> 21
+    v' = (kvu * (u >> 1) + kvv * (v >> 1) + cv) >> 21
+  with 8bit y and 16bit u and v, all of 7 fractional bits in the signed
+  words of pmaddwd, summed in its 32bit lanes and saturated to 8bit.
+  coeffs: the pairs (ky, ku), (kv, 0), (kuu, kuv), (kvu, kvv) as 32bit
+  words, then cy, cu and cv.
+*/
+template <typename T>
+class yuv_matrix {
+    T taps[4];
+    T bias[3];
+
+    // 8bit to 16bit samples of the first (H == 0) or second half of x.
+    template <int H>
+    static __forceinline T half(const T& x, const T& zero)
+    {
+        return H == 0 ? unpacklo_epi8(x, zero) : unpackhi_epi8(x, zero);
+    }
+
+    // 16 bit samples of y and the chroma of their pairs to 8bit.
+    template <int H>
+    __forceinline T luma(const T& y, const T& u7, const T& v7, const T& zero) const
+    {
+        T y7 = slli_epi16(half<H>(y, zero), 7);
+        // the chroma of the pixels of y7.
+        T ud = H == 0 ? unpacklo_epi16(u7, u7) : unpackhi_epi16(u7, u7);
+        T vd = H == 0 ? unpacklo_epi16(v7, v7) : unpackhi_epi16(v7, v7);
+        T s0 = add_epi32(madd_epi16(unpacklo_epi16(y7, ud), taps[0]),
+                         madd_epi16(unpacklo_epi16(vd, zero), taps[1]));
+        T s1 = add_epi32(madd_epi16(unpackhi_epi16(y7, ud), taps[0]),
+                         madd_epi16(unpackhi_epi16(vd, zero), taps[1]));
+        s0 = srai_epi32(add_epi32(s0, bias[0]), 21);
+        s1 = srai_epi32(add_epi32(s1, bias[0]), 21);
+        return packs_epi32(s0, s1);
+    }
+
+    __forceinline T chroma(const T& u7, const T& v7, int c) const
+    {
+        T s0 = madd_epi16(unpacklo_epi16(u7, v7), taps[2 + c]);
+        T s1 = madd_epi16(unpackhi_epi16(u7, v7), taps[2 + c]);
+        s0 = srai_epi32(add_epi32(s0, bias[1 + c]), 21);
+        s1 = srai_epi32(add_epi32(s1, bias[1 + c]), 21);
+        return packs_epi32(s0, s1);
+    }
+
+public:
+    yuv_matrix(const int32_t* coeffs)
+    {
+        if (!coeffs) {
+            return;
+        }
+        for (int i = 0; i < 4; ++i) {
+            set1_epi32(taps[i], coeffs[i]);
+        }
+        for (int i = 0; i < 3; ++i) {
+            set1_epi32(bias[i], coeffs[4 + i]);
+        }
+    }
+
+    // y0 and y1 are the 8bit pixels of the 16bit samples of u0, v0 and u1,
+    // v1. u0 and u1 (v0 and v1) become the 8bit samples of u (v).
+    __forceinline void apply(T& y0, T& y1, T& u0, const T& u1, T& v0, const T& v1) const
+    {
+        const T zero = xor_reg(y0, y0);
+        const T u70 = srli_epi16(u0, 1);
+        const T u71 = srli_epi16(u1, 1);
+        const T v70 = srli_epi16(v0, 1);
+        const T v71 = srli_epi16(v1, 1);
+        y0 = packus_epi16(luma<0>(y0, u70, v70, zero), luma<1>(y0, u70, v70, zero));
+        y1 = packus_epi16(luma<0>(y1, u71, v71, zero), luma<1>(y1, u71, v71, zero));
+        u0 = packus_epi16(chroma(u70, v70, 0), chroma(u71, v71, 0));
+        v0 = packus_epi16(chroma(u70, v70, 1), chroma(u71, v71, 1));
+    }
+};
+
+
+// 8bit planar to YUY2/UYVY. width is the luma width. MATRIX converts the
+// samples with coeffs (see yuv_matrix), and the chroma is 16bit then.
+template <typename T, typename M, typename O, bool MATRIX>
+static void __stdcall
+planar_to_packed_t(const int width, const int height, const uint8_t* srcpy,
+                   const uint8_t* srcpu, const uint8_t* srcpv, uint8_t* dstp,
+                   const int pitch_y, const int pitch_uv, const int dst_pitch,
+                   const int32_t* coeffs)
+{
+    const int width_uv = width / 2;
+    const int size = sizeof(T);
+    const yuv_matrix<T> matrix(MATRIX ? coeffs : nullptr);
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width_uv; x = M::next(x, width_uv)) {
+            T u, v;
+            T y0 = M::load(srcpy + 2 * x);
+            T y1 = y0;
+            if (MATRIX) {
+                // 16bit chroma rows are as many bytes as the luma rows.
+                u = M::load(srcpu + 2 * x);
+                v = M::load(srcpv + 2 * x);
+                T u1 = u, v1 = v;
+                if (2 * x + size < width) {
+                    y1 = M::load(srcpy + 2 * x + size);
+                    u1 = M::load(srcpu + 2 * x + size);
+                    v1 = M::load(srcpv + 2 * x + size);
+                }
+                matrix.apply(y0, y1, u, u1, v, v1);
+            } else {
+                u = M::load(srcpu + x);
+                v = M::load(srcpv + x);
+                if (2 * x + size < width) {
+                    y1 = M::load(srcpy + 2 * x + size);
+                }
+            }
+            T uv0 = unpacklo_epi8(u, v);
+            T uv1 = unpackhi_epi8(u, v);
+
+            M::store(dstp + 4 * x, O::lo(y0, uv0));
+            if (4 * x + size < width * 2) {
+                M::store(dstp + 4 * x + size, O::hi(y0, uv0));
+            }
+            if (2 * x + size < width) {
+                M::store(dstp + 4 * x + size * 2, O::lo(y1, uv1));
+                if (4 * x + size * 3 < width * 2) {
+                    M::store(dstp + 4 * x + size * 3, O::hi(y1, uv1));
+                }
+            }
+        }
+        srcpy += pitch_y;
+        srcpu += pitch_uv;
+        srcpv += pitch_uv;
+        dstp += dst_pitch;
+    }
+}
+
+
+// U and V planes to one UV plane (NV16, P210, P216). width is the bytes of
+// a U row.
+template <typename T, typename M, int SAMPLE_SIZE, bool MSB10>
+static void __stdcall
+planar_to_interleaved_t(const int width, const int height, const uint8_t* srcpu,
+                        const uint8_t* srcpv, uint8_t* dstp, const int src_pitch,
+                        const int dst_pitch)
+{
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x = M::next(x, width)) {
+            T u = M::load(srcpu + x);
+            T v = M::load(srcpv + x);
+            if (MSB10) {
+                u = slli_epi16(u, 6);
+                v = slli_epi16(v, 6);
+            }
+            T uv0 = SAMPLE_SIZE == 1 ? unpacklo_epi8(u, v) : unpacklo_epi16(u, v);
+            T uv1 = SAMPLE_SIZE == 1 ? unpackhi_epi8(u, v) : unpackhi_epi16(u, v);
+            M::store(dstp + 2 * x, uv0);
+            if (2 * x + (int)sizeof(T) < width * 2) {
+                M::store(dstp + 2 * x + sizeof(T), uv1);
+            }
+        }
+        srcpu += src_pitch;
+        srcpv += src_pitch;
+        dstp += dst_pitch;
+    }
+}
+
+
+template <typename T, typename M, typename S>
+static proc_to422 get_proc_chroma_t(int itype, int cplace, bool interlaced)
+{
+    //      <itype, cplace, interlaced>
+    std::map<std::tuple<int, int, bool>, proc_to422> func;
+
+    func[std::make_tuple(0, 0, false)] = proc_point_p<T, M, S>;
+    func[std::make_tuple(0, 0, true)]  = proc_point_i<T, M, S>;
+    func[std::make_tuple(0, 1, false)] = proc_point_p<T, M, S>;
+    func[std::make_tuple(0, 1, true)]  = proc_point_i<T, M, S>;
+    func[std::make_tuple(0, 2, false)] = proc_point_p<T, M, S>;
+    func[std::make_tuple(0, 2, true)]  = proc_point_i<T, M, S>;
+    func[std::make_tuple(0, 3, false)] = proc_point_p<T, M, S>;
+    func[std::make_tuple(0, 3, true)]  = proc_point_i<T, M, S>;
+    func[std::make_tuple(1, 0, false)] = proc_linear_c0_p<T, M, S>;
+    func[std::make_tuple(1, 0, true)]  = proc_linear_c03_i<T, M, S>;
+    func[std::make_tuple(1, 1, false)] = proc_linear_c1_p<T, M, S>;
+    func[std::make_tuple(1, 1, true)]  = proc_linear_c1_i<T, M, S>;
+    func[std::make_tuple(1, 2, false)] = proc_linear_c2_p<T, M, S>;
+    func[std::make_tuple(1, 2, true)]  = proc_linear_c2_i<T, M, S>;
+    func[std::make_tuple(1, 3, false)] = proc_linear_c3_p<T, M, S>;
+    func[std::make_tuple(1, 3, true)]  = proc_linear_c03_i<T, M, S>;
+    func[std::make_tuple(2, 0, false)] = proc_cubic_c0_p<T, M, S>;
+    func[std::make_tuple(2, 0, true)]  = proc_cubic_c03_i<T, M, S>;
+    func[std::make_tuple(2, 1, false)] = proc_cubic_c1_p<T, M, S>;
+    func[std::make_tuple(2, 1, true)]  = proc_cubic_c12_i<T, M, S>;
+    func[std::make_tuple(2, 2, false)] = proc_cubic_c2_p<T, M, S>;
+    func[std::make_tuple(2, 2, true)]  = proc_cubic_c12_i<T, M, S>;
+    func[std::make_tuple(2, 3, false)] = proc_cubic_c3_p<T, M, S>;
+    func[std::make_tuple(2, 3, true)]  = proc_cubic_c03_i<T, M, S>;
+
+    return func[std::make_tuple(itype, cplace, interlaced)];
+}
+
+
+// sample_size is 1 for 8bit samples, 2 for 9 to 16bit samples and 4 for
+// float samples.
+template <typename T>
+static proc_to422
+get_proc_chroma_s(int itype, int cplace, bool interlaced, bool unaligned, int sample_size)
+{
+    if (sample_size == 4) {
+        if (unaligned) {
+            return get_proc_chroma_t<T, unaligned_io<T>, samples_f32<T>>(itype, cplace, interlaced);
+        }
+        return get_proc_chroma_t<T, aligned_io<T>, samples_f32<T>>(itype, cplace, interlaced);
+    }
+    if (sample_size == 2) {
+        if (unaligned) {
+            return get_proc_chroma_t<T, unaligned_io<T>, samples_16<T>>(itype, cplace, interlaced);
+        }
+        return get_proc_chroma_t<T, aligned_io<T>, samples_16<T>>(itype, cplace, interlaced);
+    }
+    if (unaligned) {
+        return get_proc_chroma_t<T, unaligned_io<T>, samples_8<T>>(itype, cplace, interlaced);
+    }
+    return get_proc_chroma_t<T, aligned_io<T>, samples_8<T>>(itype, cplace, interlaced);
+}
+
+
+template <typename T, typename M, int STEP>
+static proc_horizontal get_proc_horizontal_shift_t(int sample_size)
+{
+    if (sample_size == 4) {
+        return proc_qpel_shift_h<T, M, samples_f32<T>, STEP>;
+    }
+    if (sample_size == 2) {
+        return proc_qpel_shift_h<T, M, samples_16<T>, STEP>;
+    }
+    return proc_qpel_shift_h<T, M, samples_8<T>, STEP>;
+}
+
+
+template <typename T>
+static proc_horizontal
+get_proc_horizontal_shift_s(bool unaligned, int sample_size, bool interleaved)
+{
+    if (interleaved) {
+        if (unaligned) {
+            return get_proc_horizontal_shift_t<T, unaligned_io<T>, 2>(sample_size);
+        }
+        return get_proc_horizontal_shift_t<T, aligned_io<T>, 2>(sample_size);
+    }
+    if (unaligned) {
+        return get_proc_horizontal_shift_t<T, unaligned_io<T>, 1>(sample_size);
+    }
+    return get_proc_horizontal_shift_t<T, aligned_io<T>, 1>(sample_size);
+}
+
+
+template <typename T, typename M, typename S>
+static proc_horizontal get_proc_upsample_h_t(int siting)
+{
+    if (siting == 1) {
+        return proc_upsample_h<T, M, S, 1>;
+    }
+    if (siting == 2) {
+        return proc_upsample_h<T, M, S, 2>;
+    }
+    return proc_upsample_h<T, M, S, 0>;
+}
+
+
+template <typename T, typename M>
+static proc_horizontal get_proc_upsample_h_m(int sample_size, int siting)
+{
+    if (sample_size == 4) {
+        return get_proc_upsample_h_t<T, M, samples_f32<T>>(siting);
+    }
+    if (sample_size == 2) {
+        return get_proc_upsample_h_t<T, M, samples_16<T>>(siting);
+    }
+    return get_proc_upsample_h_t<T, M, samples_8<T>>(siting);
+}
+
+
+template <typename T, typename M, typename S>
+static proc_to422 get_proc_upsample_411_t(int itype)
+{
+    if (itype == 2) {
+        return proc_upsample_411<T, M, S, 2>;
+    }
+    if (itype == 1) {
+        return proc_upsample_411<T, M, S, 1>;
+    }
+    return proc_upsample_411<T, M, S, 0>;
+}
+
+
+template <typename T, typename M>
+static proc_to422 get_proc_upsample_411_m(int sample_size, int itype)
+{
+    if (sample_size == 4) {
+        return get_proc_upsample_411_t<T, M, samples_f32<T>>(itype);
+    }
+    if (sample_size == 2) {
+        return get_proc_upsample_411_t<T, M, samples_16<T>>(itype);
+    }
+    return get_proc_upsample_411_t<T, M, samples_8<T>>(itype);
+}
+
+
+template <typename T>
+static proc_to422 get_proc_upsample_411_s(bool unaligned, int sample_size, int itype)
+{
+    if (unaligned) {
+        return get_proc_upsample_411_m<T, unaligned_io<T>>(sample_size, itype);
+    }
+    return get_proc_upsample_411_m<T, aligned_io<T>>(sample_size, itype);
+}
+
+
+template <typename T>
+static proc_horizontal get_proc_upsample_h_s(bool unaligned, int sample_size, int siting)
+{
+    if (unaligned) {
+        return get_proc_upsample_h_m<T, unaligned_io<T>>(sample_size, siting);
+    }
+    return get_proc_upsample_h_m<T, aligned_io<T>>(sample_size, siting);
+}
+
+
+template <typename T, typename M>
+static proc_horizontal get_proc_widen_t(int bits)
+{
+    if (bits == 10) {
+        return proc_widen<T, M, 2>;
+    }
+    return proc_widen<T, M, 8>;
+}
+
+
+template <typename T>
+static proc_horizontal get_proc_widen_s(bool unaligned, int bits)
+{
+    if (unaligned) {
+        return get_proc_widen_t<T, unaligned_io<T>>(bits);
+    }
+    return get_proc_widen_t<T, aligned_io<T>>(bits);
+}
+
+template <typename T>
+static proc_horizontal get_proc_msb10_s(bool unaligned)
+{
+    if (unaligned) {
+        return proc_msb10<T, unaligned_io<T>>;
+    }
+    return proc_msb10<T, aligned_io<T>>;
+}
+
+
+template <typename T, typename M, bool MATRIX>
+static planar_to_packed get_planar_to_packed_t(bool uyvy)
+{
+    if (uyvy) {
+        return planar_to_packed_t<T, M, order_uyvy, MATRIX>;
+    }
+    return planar_to_packed_t<T, M, order_yuy2, MATRIX>;
+}
+
+
+template <typename T, typename M>
+static planar_to_packed get_planar_to_packed_m(bool uyvy, bool matrix)
+{
+    if (matrix) {
+        return get_planar_to_packed_t<T, M, true>(uyvy);
+    }
+    return get_planar_to_packed_t<T, M, false>(uyvy);
+}
+
+
+template <typename T>
+static planar_to_packed get_planar_to_packed_s(bool uyvy, bool matrix, bool unaligned)
+{
+    if (unaligned) {
+        return get_planar_to_packed_m<T, unaligned_io<T>>(uyvy, matrix);
+    }
+    return get_planar_to_packed_m<T, aligned_io<T>>(uyvy, matrix);
+}
+
+
+// 8bit luma and 16bit 4:2:2 chroma converted with coeffs (see yuv_matrix)
+// to 8bit YV16. width is the luma width. the source and the output do not
+// overlap.
+template <typename T, typename M>
+static void __stdcall
+proc_matrix_t(const int width, const int height, const uint8_t* srcpy,
+              const uint8_t* srcpu, const uint8_t* srcpv, uint8_t* dstpy,
+              uint8_t* dstpu, uint8_t* dstpv, const int pitch_y, const int pitch_uv,
+              const int dst_pitch_y, const int dst_pitch_u, const int dst_pitch_v,
+              const int32_t* coeffs)
+{
+    const int width_uv = width / 2;
+    const int size = sizeof(T);
+    const yuv_matrix<T> matrix(coeffs);
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width_uv; x = M::next(x, width_uv)) {
+            T u = M::load(srcpu + 2 * x);
+            T v = M::load(srcpv + 2 * x);
+            T y0 = M::load(srcpy + 2 * x);
+            T y1 = y0, u1 = u, v1 = v;
+            if (2 * x + size < width) {
+                y1 = M::load(srcpy + 2 * x + size);
+                u1 = M::load(srcpu + 2 * x + size);
+                v1 = M::load(srcpv + 2 * x + size);
+            }
+            matrix.apply(y0, y1, u, u1, v, v1);
+            M::store(dstpu + x, u);
+            M::store(dstpv + x, v);
+            M::store(dstpy + 2 * x, y0);
+            if (2 * x + size < width) {
+                M::store(dstpy + 2 * x + size, y1);
+            }
+        }
+        srcpy += pitch_y;
+        srcpu += pitch_uv;
+        srcpv += pitch_uv;
+        dstpy += dst_pitch_y;
+        dstpu += dst_pitch_u;
+        dstpv += dst_pitch_v;
+    }
+}
+
+
+template <typename T>
+static planar_matrix get_proc_matrix_s(bool unaligned)
+{
+    if (unaligned) {
+        return proc_matrix_t<T, unaligned_io<T>>;
+    }
+    return proc_matrix_t<T, aligned_io<T>>;
+}
+
+
+/*
+  rgb: the matrix is applied with pmaddwd on pairs of 16bit samples and
+  taps of 13 fractional bits,
+    r = (cy * (y - yoff) + 4096 + cr_v * (v - 128)) >> 13
+    g = (cy * (y - yoff) + 4096 + cg_u * (u - 128) + cg_v * (v - 128)) >> 13
+    b = (cy * (y - yoff) + 4096 + cb_u * (u - 128)) >> 13
+  saturated to 8bit. The pixels never leave their 128bit lane: the samples
+  are unpacked and packed within the lanes, the 3 byte pixels of rgb24 are
+  made by a shuffle of each lane, and every lane is stored on its own.
+*/
+
+// sizeof(T) pixels. taps: (cy, 4096), (0, cr_v), (cg_u, cg_v), (cb_u, 0)
+// pairs.
+template <typename T, typename M, bool RGB24>
+static __forceinline void
+yuv444_to_rgb_group(const uint8_t* srcpy, const uint8_t* srcpu,
+                    const uint8_t* srcpv, uint8_t* dstp, const T* taps,
+                    const T& yoff)
+{
+    const int lanes = sizeof(T) / 16;
+    const T zero = xor_reg(yoff, yoff);
+    T bias, one, a;
+    set1_epi16(bias, 128);
+    set1_epi16(one, 1);
+    set1_epi8(a, -1);
+    const T y = M::load(srcpy);
+    const T u = M::load(srcpu);
+    const T v = M::load(srcpv);
+
+    // r, g and b of the low and the high 8 pixels of each lane.
+    T c16[3][2];
+    for (int h = 0; h < 2; ++h) {
+        T y16 = h == 0 ? unpacklo_epi8_lane(y, zero) : unpackhi_epi8_lane(y, zero);
+        T u16 = h == 0 ? unpacklo_epi8_lane(u, zero) : unpackhi_epi8_lane(u, zero);
+        T v16 = h == 0 ? unpacklo_epi8_lane(v, zero) : unpackhi_epi8_lane(v, zero);
+        y16 = sub_epi16(y16, yoff);
+        u16 = sub_epi16(u16, bias);
+        v16 = sub_epi16(v16, bias);
+        T c32[3][2];
+        for (int q = 0; q < 2; ++q) {
+            T y1 = q == 0 ? unpacklo_epi16_lane(y16, one) : unpackhi_epi16_lane(y16, one);
+            T uv = q == 0 ? unpacklo_epi16_lane(u16, v16) : unpackhi_epi16_lane(u16, v16);
+            T luma = madd_epi16(y1, taps[0]);
+            for (int c = 0; c < 3; ++c) {
+                T sum = add_epi32(luma, madd_epi16(uv, taps[c + 1]));
+                c32[c][q] = srai_epi32(sum, 13);
+            }
+        }
+        for (int c = 0; c < 3; ++c) {
+            c16[c][h] = packs_epi32_lane(c32[c][0], c32[c][1]);
+        }
+    }
+    const T r = packus_epi16_lane(c16[0][0], c16[0][1]);
+    const T g = packus_epi16_lane(c16[1][0], c16[1][1]);
+    const T b = packus_epi16_lane(c16[2][0], c16[2][1]);
+
+    const T bg0 = unpacklo_epi8_lane(b, g);
+    const T bg1 = unpackhi_epi8_lane(b, g);
+    const T ra0 = unpacklo_epi8_lane(r, a);
+    const T ra1 = unpackhi_epi8_lane(r, a);
+    // lane l of px[i] is the pixels 16 * l + 4 * i to 16 * l + 4 * i + 3.
+    T px[4] = {
+        unpacklo_epi16_lane(bg0, ra0), unpackhi_epi16_lane(bg0, ra0),
+        unpacklo_epi16_lane(bg1, ra1), unpackhi_epi16_lane(bg1, ra1),
+    };
+    if (!RGB24) {
+        for (int l = 0; l < lanes; ++l) {
+            for (int i = 0; i < 4; ++i) {
+                M::store_lane(dstp + 64 * l + 16 * i, px[i], l);
+            }
+        }
+        return;
+    }
+    for (int i = 0; i < 4; ++i) {
+        px[i] = drop_byte3_lane(px[i]);
+    }
+    // the 48 bytes of the 16 pixels of each lane.
+    const T bgr[3] = {
+        or_reg(px[0], slli_lane<12>(px[1])),
+        or_reg(srli_lane<4>(px[1]), slli_lane<8>(px[2])),
+        or_reg(srli_lane<8>(px[2]), slli_lane<4>(px[3])),
+    };
+    for (int l = 0; l < lanes; ++l) {
+        for (int i = 0; i < 3; ++i) {
+            M::store_lane(dstp + 48 * l + 16 * i, bgr[i], l);
+        }
+    }
+}
+
+
+// coeffs: cy, 4096, 0, cr_v, cg_u, cg_v, cb_u, 0, the luma offset. the
+// last pixels of a row go through a whole group in a copy, so nothing
+// after width is read or written.
+template <typename T, typename M, bool RGB24>
+static void __stdcall
+yuv444_to_rgb_t(const int width, const int height, const uint8_t* srcpy,
+                const uint8_t* srcpu, const uint8_t* srcpv, uint8_t* dstp,
+                const int pitch_y, const int pitch_uv, const int dst_pitch,
+                const int16_t* coeffs)
+{
+    const int size = sizeof(T);
+    const int pixel_size = RGB24 ? 3 : 4;
+    const int groups = width / size;
+    const int rest = width % size;
+    T taps[4], yoff;
+    for (int i = 0; i < 4; ++i) {
+        set1_epi32(taps[i], (uint16_t)coeffs[i * 2] | ((int)coeffs[i * 2 + 1] << 16));
+    }
+    set1_epi16(yoff, coeffs[8]);
+    T tail_y, tail_u, tail_v, tail_d[4];
+
+    for (int y = 0; y < height; ++y) {
+        for (int g = 0; g < groups; ++g) {
+            yuv444_to_rgb_group<T, M, RGB24>(srcpy + size * g, srcpu + size * g,
+                                             srcpv + size * g,
+                                             dstp + size * pixel_size * g, taps, yoff);
+        }
+        if (rest > 0) {
+            memcpy(&tail_y, srcpy + size * groups, rest);
+            memcpy(&tail_u, srcpu + size * groups, rest);
+            memcpy(&tail_v, srcpv + size * groups, rest);
+            yuv444_to_rgb_group<T, unaligned_io<T>, RGB24>(
+                (const uint8_t*)&tail_y, (const uint8_t*)&tail_u, (const uint8_t*)&tail_v,
+                (uint8_t*)tail_d, taps, yoff);
+            memcpy(dstp + size * pixel_size * groups, tail_d, rest * pixel_size);
+        }
+        srcpy += pitch_y;
+        srcpu += pitch_uv;
+        srcpv += pitch_uv;
+        dstp += dst_pitch;
+    }
+}
+
+
+template <typename T>
+static yuv444_to_rgb get_yuv444_to_rgb_s(bool rgb24, bool unaligned)
+{
+    if (unaligned) {
+        return rgb24 ? yuv444_to_rgb_t<T, unaligned_io<T>, true>
+                     : yuv444_to_rgb_t<T, unaligned_io<T>, false>;
+    }
+    return rgb24 ? yuv444_to_rgb_t<T, aligned_io<T>, true>
+                 : yuv444_to_rgb_t<T, aligned_io<T>, false>;
+}
+
+
+// the interleaved UV rows of nv12 input and 8bit luma to YUY2/UYVY. width
+// is the luma width, which is the bytes of a UV row.
+template <typename T, typename M, typename O>
+static void __stdcall
+interleaved_to_packed_t(const int width, const int height, const uint8_t* srcpy,
+                        const uint8_t* srcpuv, uint8_t* dstp, const int pitch_y,
+                        const int pitch_uv, const int dst_pitch)
+{
+    const int size = sizeof(T);
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x = M::next(x, width)) {
+            T luma = M::load(srcpy + x);
+            T uv = M::load(srcpuv + x);
+            M::store(dstp + 2 * x, O::lo(luma, uv));
+            if (2 * x + size < width * 2) {
+                M::store(dstp + 2 * x + size, O::hi(luma, uv));
+            }
+        }
+        srcpy += pitch_y;
+        srcpuv += pitch_uv;
+        dstp += dst_pitch;
+    }
+}
+
+
+// an interleaved UV plane to U and V planes. width is the bytes of a U row.
+template <typename T, typename M, int SAMPLE_SIZE>
+static void __stdcall
+interleaved_to_planar_t(const int width, const int height, const uint8_t* srcp,
+                        uint8_t* dstpu, uint8_t* dstpv, const int src_pitch,
+                        const int dst_pitch_u, const int dst_pitch_v)
+{
+    const int size = sizeof(T);
+    T mask;
+    set1_epi16(mask, 0x00FF);
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x = M::next(x, width)) {
+            T uv0 = M::load(srcp + 2 * x);
+            T uv1 = 2 * x + size < width * 2 ? M::load(srcp + 2 * x + size) : uv0;
+            T u, v;
+            if (SAMPLE_SIZE == 1) {
+                u = packus_epi16(and_reg(uv0, mask), and_reg(uv1, mask));
+                v = packus_epi16(srli_epi16(uv0, 8), srli_epi16(uv1, 8));
+            } else {
+                // sign extended words, which packs_epi32 keeps as they are.
+                u = packs_epi32(srai_epi32(slli_epi32(uv0, 16), 16),
+                                srai_epi32(slli_epi32(uv1, 16), 16));
+                v = packs_epi32(srai_epi32(uv0, 16), srai_epi32(uv1, 16));
+            }
+            M::store(dstpu + x, u);
+            M::store(dstpv + x, v);
+        }
+        srcp += src_pitch;
+        dstpu += dst_pitch_u;
+        dstpv += dst_pitch_v;
+    }
+}
+
+
+/*
+  4:2:2 to 4:2:0 (YV422To12). Every output chroma row is made of the source
+  rows srcp[0] to srcp[7], chosen by the caller for the chroma placement:
+  CUBIC weights all 8 with the 4 tap pairs of coeffs (the cubic filter
+  stretched over the 4:2:2 rows reaches 4 rows up and down), otherwise the
+  first 4 are averaged, so point decimation passes the same row 4 times and
+  the linear one repeats the rows by their weights.
+*/
+template <typename T, bool CUBIC>
+static __forceinline T
+decimate(const T* r, const T* coef)
+{
+    if (!CUBIC) {
+        return average(r[0], r[1], r[2], r[3]);
+    }
+    T total[4];
+    set1_epi32(total[0], 512);
+    total[1] = total[2] = total[3] = total[0];
+    for (int i = 0; i < 4; ++i) {
+        madd_pairs(r[i * 2], r[i * 2 + 1], coef[i], total);
+    }
+    return pack_sums(total);
+}
+
+template <typename T, bool CUBIC>
+static __forceinline void set_decimate_coeffs(const int16_t* coeffs, T* coef)
+{
+    for (int i = 0; i < 4; ++i) {
+        set1_epi32(coef[i], CUBIC ? ((const int32_t*)coeffs)[i] : 0);
+    }
+}
+
+
+// width is the bytes of a chroma row.
+template <typename T, typename M, bool CUBIC>
+static void __stdcall
+proc_decimate_t(const int width, const uint8_t* const* srcp, uint8_t* dstp,
+                const int16_t* coeffs)
+{
+    const int rows = CUBIC ? 8 : 4;
+    T coef[4];
+    set_decimate_coeffs<T, CUBIC>(coeffs, coef);
+
+    for (int x = 0; x < width; x = M::next(x, width)) {
+        T r[8];
+        for (int i = 0; i < rows; ++i) {
+            r[i] = M::load(srcp[i] + x);
+        }
+        M::store(dstp + x, decimate<T, CUBIC>(r, coef));
+    }
+}
+
+
+// the YUY2 (UYVY) pixels of 4 vectors from p, deinterleaved in the
+// registers: the luma of the first 2 and the last 2 vectors, and the U and V
+// samples. bytes is what is left of the row from p. vectors after it are
+// not loaded, their samples are garbage.
+template <typename T, typename M, bool UYVY>
+static __forceinline void
+load_packed(const uint8_t* p, int bytes, T& y0, T& y1, T& u, T& v)
+{
+    const int size = sizeof(T);
+    T mask;
+    set1_epi16(mask, 0x00FF);
+    T luma[4], uv[4];
+    for (int i = 0; i < 4; ++i) {
+        T x = size * i < bytes ? M::load(p + size * i) : mask;
+        luma[i] = UYVY ? srli_epi16(x, 8) : and_reg(x, mask);
+        uv[i] = UYVY ? and_reg(x, mask) : srli_epi16(x, 8);
+    }
+    y0 = packus_epi16(luma[0], luma[1]);
+    y1 = packus_epi16(luma[2], luma[3]);
+    // U V U V..., then the U and the V bytes.
+    T uv0 = packus_epi16(uv[0], uv[1]);
+    T uv1 = packus_epi16(uv[2], uv[3]);
+    u = packus_epi16(and_reg(uv0, mask), and_reg(uv1, mask));
+    v = packus_epi16(srli_epi16(uv0, 8), srli_epi16(uv1, 8));
+}
+
+
+template <typename T, typename M, bool UYVY>
+static __forceinline void load_packed_uv(const uint8_t* p, int bytes, T& u, T& v)
+{
+    T y0, y1;
+    load_packed<T, M, UYVY>(p, bytes, y0, y1, u, v);
+}
+
+
+// the chroma of YUY2/UYVY rows to U and V rows. width is the luma width.
+// DVPAL takes V from the rows srcp[8] to srcp[15], U and V come from the
+// same rows otherwise.
+template <typename T, typename M, bool CUBIC, bool UYVY, bool DVPAL>
+static void __stdcall
+packed_decimate_t(const int width, const uint8_t* const* srcp, uint8_t* dstpu,
+                  uint8_t* dstpv, const int16_t* coeffs)
+{
+    const int width_uv = width / 2;
+    const int rows = CUBIC ? 8 : 4;
+    T coef[4];
+    set_decimate_coeffs<T, CUBIC>(coeffs, coef);
+
+    for (int x = 0; x < width_uv; x = M::next(x, width_uv)) {
+        const int bytes = (width_uv - x) * 4;
+        T u[8], v[8];
+        for (int i = 0; i < rows; ++i) {
+            load_packed_uv<T, M, UYVY>(srcp[i] + x * 4, bytes, u[i], v[i]);
+        }
+        if (DVPAL) {
+            T dummy;
+            for (int i = 0; i < rows; ++i) {
+                load_packed_uv<T, M, UYVY>(srcp[8 + i] + x * 4, bytes, dummy, v[i]);
+            }
+        }
+        M::store(dstpu + x, decimate<T, CUBIC>(u, coef));
+        M::store(dstpv + x, decimate<T, CUBIC>(v, coef));
+    }
+}
+
+
+// the luma of YUY2/UYVY rows. width is the luma width.
+template <typename T, typename M, bool UYVY>
+static void __stdcall
+packed_to_luma_t(const int width, const int height, const uint8_t* srcp,
+                 uint8_t* dstp, int src_pitch, int dst_pitch)
+{
+    const int size = sizeof(T);
+    T mask;
+    set1_epi16(mask, 0x00FF);
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x = M::next(x, width)) {
+            T x0 = M::load(srcp + 2 * x);
+            T x1 = 2 * x + size < width * 2 ? M::load(srcp + 2 * x + size) : x0;
+            T y0 = UYVY ? srli_epi16(x0, 8) : and_reg(x0, mask);
+            T y1 = UYVY ? srli_epi16(x1, 8) : and_reg(x1, mask);
+            M::store(dstp + x, packus_epi16(y0, y1));
+        }
+        srcp += src_pitch;
+        dstp += dst_pitch;
+    }
+}
+
+
+// YUY2/UYVY rows to YV16. width is the luma width. SHIFT moves the chroma
+// 1/4 sample to the left like proc_qpel_shift_h, in the same pass: the left
+// neighbors are the pixels one chroma sample before, deinterleaved again.
+template <typename T, typename M, bool UYVY, bool SHIFT>
+static void __stdcall
+packed_to_planar_t(const int width, const int height, const uint8_t* srcp,
+                   uint8_t* dstpy, uint8_t* dstpu, uint8_t* dstpv,
+                   const int src_pitch, const int dst_pitch_y, const int dst_pitch_u,
+                   const int dst_pitch_v)
+{
+    const int size = sizeof(T);
+    const int width_uv = width / 2;
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width_uv; x = M::next(x, width_uv)) {
+            const uint8_t* p = srcp + x * 4;
+            const int bytes = (width_uv - x) * 4;
+            T y0, y1, u, v;
+            load_packed<T, M, UYVY>(p, bytes, y0, y1, u, v);
+            M::store(dstpy + x * 2, y0);
+            if (x * 2 + size < width) {
+                M::store(dstpy + x * 2 + size, y1);
+            }
+            if (SHIFT) {
+                T left_u, left_v;
+                if (x == 0) {
+                    // the first sample is its own left neighbor.
+                    T mask = slli_reg<1>(cmpeq(u, u));
+                    left_u = blendv_epi8(u, slli_reg<1>(u), mask);
+                    left_v = blendv_epi8(v, slli_reg<1>(v), mask);
+                } else {
+                    load_packed_uv<T, unaligned_io<T>, UYVY>(p - 4, bytes + 4, left_u, left_v);
+                }
+                u = average(u, u, u, left_u);
+                v = average(v, v, v, left_v);
+            }
+            M::store(dstpu + x, u);
+            M::store(dstpv + x, v);
+        }
+        srcp += src_pitch;
+        dstpy += dst_pitch_y;
+        dstpu += dst_pitch_u;
+        dstpv += dst_pitch_v;
+    }
+}
+
+
+template <typename T, typename M>
+static planar_to_interleaved get_planar_to_interleaved_t(int sample_size, bool msb10)
+{
+    if (sample_size == 1) {
+        return planar_to_interleaved_t<T, M, 1, false>;
+    }
+    if (msb10) {
+        return planar_to_interleaved_t<T, M, 2, true>;
+    }
+    return planar_to_interleaved_t<T, M, 2, false>;
+}
+
+
+template <typename T>
+static planar_to_interleaved
+get_planar_to_interleaved_s(int sample_size, bool msb10, bool unaligned)
+{
+    if (unaligned) {
+        return get_planar_to_interleaved_t<T, unaligned_io<T>>(sample_size, msb10);
+    }
+    return get_planar_to_interleaved_t<T, aligned_io<T>>(sample_size, msb10);
+}
+
+
+template <typename T>
+static interleaved_to_packed get_interleaved_to_packed_s(bool uyvy, bool unaligned)
+{
+    if (unaligned) {
+        return uyvy ? interleaved_to_packed_t<T, unaligned_io<T>, order_uyvy>
+                    : interleaved_to_packed_t<T, unaligned_io<T>, order_yuy2>;
+    }
+    return uyvy ? interleaved_to_packed_t<T, aligned_io<T>, order_uyvy>
+                : interleaved_to_packed_t<T, aligned_io<T>, order_yuy2>;
+}
+
+
+template <typename T>
+static interleaved_to_planar get_interleaved_to_planar_s(int sample_size, bool unaligned)
+{
+    if (unaligned) {
+        return sample_size == 1 ? interleaved_to_planar_t<T, unaligned_io<T>, 1>
+                                : interleaved_to_planar_t<T, unaligned_io<T>, 2>;
+    }
+    return sample_size == 1 ? interleaved_to_planar_t<T, aligned_io<T>, 1>
+                            : interleaved_to_planar_t<T, aligned_io<T>, 2>;
+}
+
+
+template <typename T>
+static proc_decimate get_proc_decimate_s(bool cubic, bool unaligned)
+{
+    if (unaligned) {
+        return cubic ? proc_decimate_t<T, unaligned_io<T>, true>
+                     : proc_decimate_t<T, unaligned_io<T>, false>;
+    }
+    return cubic ? proc_decimate_t<T, aligned_io<T>, true>
+                 : proc_decimate_t<T, aligned_io<T>, false>;
+}
+
+
+template <typename T, typename M, bool CUBIC>
+static packed_decimate get_packed_decimate_t(bool uyvy, bool dvpal)
+{
+    if (uyvy) {
+        return dvpal ? packed_decimate_t<T, M, CUBIC, true, true>
+                     : packed_decimate_t<T, M, CUBIC, true, false>;
+    }
+    return dvpal ? packed_decimate_t<T, M, CUBIC, false, true>
+                 : packed_decimate_t<T, M, CUBIC, false, false>;
+}
+
+
+template <typename T, typename M>
+static packed_decimate get_packed_decimate_m(bool cubic, bool uyvy, bool dvpal)
+{
+    return cubic ? get_packed_decimate_t<T, M, true>(uyvy, dvpal)
+                 : get_packed_decimate_t<T, M, false>(uyvy, dvpal);
+}
+
+
+template <typename T>
+static packed_decimate get_packed_decimate_s(bool cubic, bool uyvy, bool dvpal, bool unaligned)
+{
+    if (unaligned) {
+        return get_packed_decimate_m<T, unaligned_io<T>>(cubic, uyvy, dvpal);
+    }
+    return get_packed_decimate_m<T, aligned_io<T>>(cubic, uyvy, dvpal);
+}
+
+
+template <typename T>
+static proc_horizontal get_packed_to_luma_s(bool uyvy, bool unaligned)
+{
+    if (unaligned) {
+        return uyvy ? packed_to_luma_t<T, unaligned_io<T>, true>
+                    : packed_to_luma_t<T, unaligned_io<T>, false>;
+    }
+    return uyvy ? packed_to_luma_t<T, aligned_io<T>, true>
+                : packed_to_luma_t<T, aligned_io<T>, false>;
+}
+
+
+template <typename T, typename M>
+static packed_to_planar get_packed_to_planar_t(bool uyvy, bool shift)
+{
+    if (uyvy) {
+        return shift ? packed_to_planar_t<T, M, true, true>
+                     : packed_to_planar_t<T, M, true, false>;
+    }
+    return shift ? packed_to_planar_t<T, M, false, true>
+                 : packed_to_planar_t<T, M, false, false>;
+}
+
+
+template <typename T>
+static packed_to_planar get_packed_to_planar_s(bool uyvy, bool shift, bool unaligned)
+{
+    if (unaligned) {
+        return get_packed_to_planar_t<T, unaligned_io<T>>(uyvy, shift);
+    }
+    return get_packed_to_planar_t<T, aligned_io<T>>(uyvy, shift);
+}
+
+#endif
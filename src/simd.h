@@ -27,6 +27,7 @@
 #define YV12TO422_SIMD_H
 
 #include <immintrin.h>
+#include "compat.h"
 
 
 static __forceinline __m128i load_reg(const __m128i* addr)
@@ -34,293 +35,921 @@ static __forceinline __m128i load_reg(const __m128i* addr)
     return _mm_load_si128(addr);
 }
 
+static __forceinline __m128i loadu_reg(const __m128i* addr)
+{
+    return _mm_loadu_si128(addr);
+}
+
+static __forceinline void stream_reg(__m128i* adrr, const __m128i& reg)
+{
+    _mm_stream_si128(adrr, reg);
+}
+
+static __forceinline void storeu_reg(__m128i* addr, const __m128i& reg)
+{
+    _mm_storeu_si128(addr, reg);
+}
+
+static __forceinline __m128i or_reg(const __m128i& x, const __m128i& y)
+{
+    return _mm_or_si128(x, y);
+}
+
+static __forceinline __m128i xor_reg(const __m128i& x, const __m128i& y)
+{
+    return _mm_xor_si128(x, y);
+}
+
+static __forceinline __m128i and_reg(const __m128i& x, const __m128i& y)
+{
+    return _mm_and_si128(x, y);
+}
+
+static __forceinline __m128i andnot_reg(const __m128i& x, const __m128i& y)
+{
+    return _mm_andnot_si128(x, y);
+}
+
+static __forceinline __m128i srli_epi16(const __m128i& x, int count)
+{
+    return _mm_srli_epi16(x, count);
+}
+
+static __forceinline __m128i slli_epi16(const __m128i& x, int count)
+{
+    return _mm_slli_epi16(x, count);
+}
+
+static __forceinline __m128i srli_epi32(const __m128i& x, int count)
+{
+    return _mm_srli_epi32(x, count);
+}
+
+static __forceinline __m128i slli_epi32(const __m128i& x, int count)
+{
+    return _mm_slli_epi32(x, count);
+}
+
+static __forceinline __m128i cmpeq(const __m128i& x, const __m128i& y)
+{
+    return _mm_cmpeq_epi8(x, y);
+}
+
+static __forceinline void set1_epi8(__m128i& x, char v)
+{
+    x = _mm_set1_epi8(v);
+}
+
+static __forceinline void set1_epi16(__m128i& x, int16_t v)
+{
+    x = _mm_set1_epi16(v);
+}
+
+static __forceinline void set1_epi32(__m128i& x, int32_t v)
+{
+    x = _mm_set1_epi32(v);
+}
+
+static __forceinline __m128i add_epu16(const __m128i& x, const __m128i& y)
+{
+    return _mm_adds_epu16(x, y);
+}
+
+static __forceinline __m128i add_epi32(const __m128i& x, const __m128i& y)
+{
+    return _mm_add_epi32(x, y);
+}
+
+static __forceinline __m128i subs_epu8(const __m128i& x, const __m128i& y)
+{
+    return _mm_subs_epu8(x, y);
+}
+
+static __forceinline __m128i sub_epi16(const __m128i& x, const __m128i& y)
+{
+    return _mm_sub_epi16(x, y);
+}
+
+static __forceinline __m128i mullo_epi16(const __m128i& x, const __m128i& y)
+{
+    return _mm_mullo_epi16(x, y);
+}
+
+static __forceinline __m128i madd_epi16(const __m128i& x, const __m128i& y)
+{
+    return _mm_madd_epi16(x, y);
+}
+
+static __forceinline __m128i average(const __m128i& x, const __m128i& y)
+{
+    return _mm_avg_epu8(x, y);
+}
+
+static __forceinline __m128i average_epu16(const __m128i& x, const __m128i& y)
+{
+    return _mm_avg_epu16(x, y);
+}
+
+static __forceinline __m128i subs_epu16(const __m128i& x, const __m128i& y)
+{
+    return _mm_subs_epu16(x, y);
+}
+
+static __forceinline __m128i sub_epi32(const __m128i& x, const __m128i& y)
+{
+    return _mm_sub_epi32(x, y);
+}
+
+static __forceinline __m128i srai_epi32(const __m128i& x, int count)
+{
+    return _mm_srai_epi32(x, count);
+}
+
+static __forceinline __m128i min_epi16(const __m128i& x, const __m128i& y)
+{
+    return _mm_min_epi16(x, y);
+}
+
+// float lanes. the kernels keep every vector in the integer types, so these
+// cast around the float instructions (the casts generate no code).
+static __forceinline __m128i add_ps(const __m128i& x, const __m128i& y)
+{
+    return _mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(x), _mm_castsi128_ps(y)));
+}
+
+static __forceinline __m128i mul_ps(const __m128i& x, const __m128i& y)
+{
+    return _mm_castps_si128(_mm_mul_ps(_mm_castsi128_ps(x), _mm_castsi128_ps(y)));
+}
+
+// x * y + z
+static __forceinline __m128i fmadd_ps(const __m128i& x, const __m128i& y, const __m128i& z)
+{
+#if defined(__FMA__)
+    return _mm_castps_si128(_mm_fmadd_ps(_mm_castsi128_ps(x), _mm_castsi128_ps(y),
+                                         _mm_castsi128_ps(z)));
+#else
+    return add_ps(mul_ps(x, y), z);
+#endif
+}
+
+static __forceinline void set1_ps(__m128i& x, float v)
+{
+    x = _mm_castps_si128(_mm_set1_ps(v));
+}
+
+static __forceinline __m128i unpacklo_epi8(const __m128i& x, const __m128i& y)
+{
+    return _mm_unpacklo_epi8(x, y);
+}
+
+static __forceinline __m128i unpackhi_epi8(const __m128i& x, const __m128i& y)
+{
+    return _mm_unpackhi_epi8(x, y);
+}
+
+static __forceinline __m128i unpacklo_epi16(const __m128i& x, const __m128i& y)
+{
+    return _mm_unpacklo_epi16(x, y);
+}
+
+static __forceinline __m128i unpackhi_epi16(const __m128i& x, const __m128i& y)
+{
+    return _mm_unpackhi_epi16(x, y);
+}
+
+static __forceinline __m128i unpacklo_epi32(const __m128i& x, const __m128i& y)
+{
+    return _mm_unpacklo_epi32(x, y);
+}
+
+static __forceinline __m128i unpackhi_epi32(const __m128i& x, const __m128i& y)
+{
+    return _mm_unpackhi_epi32(x, y);
+}
+
+static __forceinline __m128i packus_epi16(const __m128i& x, const __m128i& y)
+{
+    return _mm_packus_epi16(x, y);
+}
+
+static __forceinline __m128i packs_epi32(const __m128i& x, const __m128i& y)
+{
+    return _mm_packs_epi32(x, y);
+}
+
+template <int N>
+static __forceinline __m128i slli_reg(const __m128i& x)
+{
+    return _mm_slli_si128(x, N);
+}
+
+template <int N>
+static __forceinline __m128i srli_reg(const __m128i& x)
+{
+    return _mm_srli_si128(x, N);
+}
+
+static __forceinline __m128i
+blendv_epi8(const __m128i& x, const __m128i& y, const __m128i& mask)
+{
+    return or_reg(and_reg(mask, y), andnot_reg(mask, x));
+}
+
+// the _lane versions work within each 128bit lane, as the instructions do
+// (the ones above work like the 128bit versions across the whole vector),
+// so they need no lane crossing permute. lane(x, i) is 128bit lane i of x.
+
+static __forceinline __m128i unpacklo_epi8_lane(const __m128i& x, const __m128i& y)
+{
+    return _mm_unpacklo_epi8(x, y);
+}
+
+static __forceinline __m128i unpackhi_epi8_lane(const __m128i& x, const __m128i& y)
+{
+    return _mm_unpackhi_epi8(x, y);
+}
+
+static __forceinline __m128i unpacklo_epi16_lane(const __m128i& x, const __m128i& y)
+{
+    return _mm_unpacklo_epi16(x, y);
+}
+
+static __forceinline __m128i unpackhi_epi16_lane(const __m128i& x, const __m128i& y)
+{
+    return _mm_unpackhi_epi16(x, y);
+}
+
+static __forceinline __m128i packus_epi16_lane(const __m128i& x, const __m128i& y)
+{
+    return _mm_packus_epi16(x, y);
+}
+
+static __forceinline __m128i packs_epi32_lane(const __m128i& x, const __m128i& y)
+{
+    return _mm_packs_epi32(x, y);
+}
+
+template <int N>
+static __forceinline __m128i slli_lane(const __m128i& x)
+{
+    return _mm_slli_si128(x, N);
+}
+
+template <int N>
+static __forceinline __m128i srli_lane(const __m128i& x)
+{
+    return _mm_srli_si128(x, N);
+}
+
+// the bytes 0 to 2 of the 4 dwords of each lane to its bottom 12 bytes, the
+// top 4 bytes are 0. SSE2 has no pshufb, the bytes are masked and shifted.
+static __forceinline __m128i drop_byte3_lane(const __m128i& x)
+{
+    const __m128i px0 = _mm_set1_epi64x(0x0000000000FFFFFFLL);
+    const __m128i px1 = _mm_set1_epi64x(0x0000FFFFFF000000LL);
+    const __m128i lo = _mm_set_epi32(0, 0, 0x0000FFFF, (int)0xFFFFFFFF);
+    const __m128i hi = _mm_set_epi32(0, (int)0xFFFFFFFF, (int)0xFFFF0000, 0);
+    // 6 bytes at the bottom of each qword.
+    __m128i t = or_reg(and_reg(x, px0), and_reg(_mm_srli_epi64(x, 8), px1));
+    return or_reg(and_reg(t, lo), and_reg(_mm_srli_si128(t, 2), hi));
+}
+
+static __forceinline __m128i lane(const __m128i& x, int /*i*/)
+{
+    return x;
+}
+
+
+#if defined(__AVX2__)
+
 static __forceinline __m256i load_reg(const __m256i* addr)
 {
-    return _mm256_load_si256(addr);
+    return _mm256_load_si256(addr);
+}
+
+static __forceinline __m256i loadu_reg(const __m256i* addr)
+{
+    return _mm256_loadu_si256(addr);
+}
+
+static __forceinline void stream_reg(__m256i* adrr, const __m256i& reg)
+{
+    _mm256_stream_si256(adrr, reg);
+}
+
+static __forceinline void storeu_reg(__m256i* addr, const __m256i& reg)
+{
+    _mm256_storeu_si256(addr, reg);
+}
+
+static __forceinline __m256i or_reg(const __m256i& x, const __m256i& y)
+{
+    return _mm256_or_si256(x, y);
+}
+
+static __forceinline __m256i xor_reg(const __m256i& x, const __m256i& y)
+{
+    return _mm256_xor_si256(x, y);
+}
+
+static __forceinline __m256i and_reg(const __m256i& x, const __m256i& y)
+{
+    return _mm256_and_si256(x, y);
+}
+
+static __forceinline __m256i andnot_reg(const __m256i& x, const __m256i& y)
+{
+    return _mm256_andnot_si256(x, y);
+}
+
+static __forceinline __m256i srli_epi16(const __m256i& x, int count)
+{
+    return _mm256_srli_epi16(x, count);
+}
+
+static __forceinline __m256i slli_epi16(const __m256i& x, int count)
+{
+    return _mm256_slli_epi16(x, count);
+}
+
+static __forceinline __m256i srli_epi32(const __m256i& x, int count)
+{
+    return _mm256_srli_epi32(x, count);
+}
+
+static __forceinline __m256i slli_epi32(const __m256i& x, int count)
+{
+    return _mm256_slli_epi32(x, count);
+}
+
+static __forceinline __m256i cmpeq(const __m256i& x, const __m256i& y)
+{
+    return _mm256_cmpeq_epi8(x, y);
+}
+
+static __forceinline void set1_epi8(__m256i& x, char v)
+{
+    x = _mm256_set1_epi8(v);
+}
+
+static __forceinline void set1_epi16(__m256i& x, int16_t v)
+{
+    x = _mm256_set1_epi16(v);
+}
+
+static __forceinline void set1_epi32(__m256i& x, int32_t v)
+{
+    x = _mm256_set1_epi32(v);
+}
+
+static __forceinline __m256i add_epu16(const __m256i& x, const __m256i& y)
+{
+    return _mm256_adds_epu16(x, y);
+}
+
+static __forceinline __m256i add_epi32(const __m256i& x, const __m256i& y)
+{
+    return _mm256_add_epi32(x, y);
+}
+
+static __forceinline __m256i subs_epu8(const __m256i& x, const __m256i& y)
+{
+    return _mm256_subs_epu8(x, y);
+}
+
+static __forceinline __m256i sub_epi16(const __m256i& x, const __m256i& y)
+{
+    return _mm256_sub_epi16(x, y);
+}
+
+static __forceinline __m256i mullo_epi16(const __m256i& x, const __m256i& y)
+{
+    return _mm256_mullo_epi16(x, y);
+}
+
+static __forceinline __m256i madd_epi16(const __m256i& x, const __m256i& y)
+{
+    return _mm256_madd_epi16(x, y);
+}
+
+static __forceinline __m256i average(const __m256i& x, const __m256i& y)
+{
+    return _mm256_avg_epu8(x, y);
+}
+
+static __forceinline __m256i average_epu16(const __m256i& x, const __m256i& y)
+{
+    return _mm256_avg_epu16(x, y);
+}
+
+static __forceinline __m256i subs_epu16(const __m256i& x, const __m256i& y)
+{
+    return _mm256_subs_epu16(x, y);
+}
+
+static __forceinline __m256i sub_epi32(const __m256i& x, const __m256i& y)
+{
+    return _mm256_sub_epi32(x, y);
+}
+
+static __forceinline __m256i srai_epi32(const __m256i& x, int count)
+{
+    return _mm256_srai_epi32(x, count);
+}
+
+static __forceinline __m256i min_epi16(const __m256i& x, const __m256i& y)
+{
+    return _mm256_min_epi16(x, y);
+}
+
+static __forceinline __m256i add_ps(const __m256i& x, const __m256i& y)
+{
+    return _mm256_castps_si256(_mm256_add_ps(_mm256_castsi256_ps(x), _mm256_castsi256_ps(y)));
+}
+
+static __forceinline __m256i mul_ps(const __m256i& x, const __m256i& y)
+{
+    return _mm256_castps_si256(_mm256_mul_ps(_mm256_castsi256_ps(x), _mm256_castsi256_ps(y)));
+}
+
+// x * y + z
+static __forceinline __m256i fmadd_ps(const __m256i& x, const __m256i& y, const __m256i& z)
+{
+#if defined(__FMA__) || defined(_MSC_VER)
+    return _mm256_castps_si256(_mm256_fmadd_ps(_mm256_castsi256_ps(x), _mm256_castsi256_ps(y),
+                                               _mm256_castsi256_ps(z)));
+#else
+    return add_ps(mul_ps(x, y), z);
+#endif
+}
+
+static __forceinline void set1_ps(__m256i& x, float v)
+{
+    x = _mm256_castps_si256(_mm256_set1_ps(v));
+}
+
+static __forceinline __m256i unpacklo_epi8(const __m256i& x, const __m256i& y)
+{
+    __m256i t0 = _mm256_unpacklo_epi8(x, y);
+    __m256i t1 = _mm256_unpackhi_epi8(x, y);
+    return _mm256_permute2x128_si256(t0, t1, 0x20);
+}
+
+static __forceinline __m256i unpackhi_epi8(const __m256i& x, const __m256i& y)
+{
+    __m256i t0 = _mm256_unpacklo_epi8(x, y);
+    __m256i t1 = _mm256_unpackhi_epi8(x, y);
+    return _mm256_permute2x128_si256(t0, t1, 0x31);
+}
+
+static __forceinline __m256i unpacklo_epi16(const __m256i& x, const __m256i& y)
+{
+    __m256i t0 = _mm256_unpacklo_epi16(x, y);
+    __m256i t1 = _mm256_unpackhi_epi16(x, y);
+    return _mm256_permute2x128_si256(t0, t1, 0x20);
 }
 
-static __forceinline __m128i loadu_reg(const __m128i* addr)
+static __forceinline __m256i unpackhi_epi16(const __m256i& x, const __m256i& y)
 {
-    return _mm_loadu_si128(addr);
+    __m256i t0 = _mm256_unpacklo_epi16(x, y);
+    __m256i t1 = _mm256_unpackhi_epi16(x, y);
+    return _mm256_permute2x128_si256(t0, t1, 0x31);
 }
 
-static __forceinline __m256i loadu_reg(const __m256i* addr)
+static __forceinline __m256i unpacklo_epi32(const __m256i& x, const __m256i& y)
 {
-    return _mm256_loadu_si256(addr);
+    __m256i t0 = _mm256_unpacklo_epi32(x, y);
+    __m256i t1 = _mm256_unpackhi_epi32(x, y);
+    return _mm256_permute2x128_si256(t0, t1, 0x20);
 }
 
-static __forceinline void stream_reg(__m128i* adrr, __m128i& reg)
+static __forceinline __m256i unpackhi_epi32(const __m256i& x, const __m256i& y)
 {
-    _mm_stream_si128(adrr, reg);
+    __m256i t0 = _mm256_unpacklo_epi32(x, y);
+    __m256i t1 = _mm256_unpackhi_epi32(x, y);
+    return _mm256_permute2x128_si256(t0, t1, 0x31);
 }
 
-static __forceinline void stream_reg(__m256i* adrr, __m256i& reg)
+static __forceinline __m256i packus_epi16(const __m256i& x, const __m256i& y)
 {
-    _mm256_stream_si256(adrr, reg);
+    //3,1,2,0 -> 0b11011000 = 216
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(x, y), 216);
 }
 
-static __forceinline __m128i or_reg(const __m128i& x, const __m128i& y)
+static __forceinline __m256i packs_epi32(const __m256i& x, const __m256i& y)
 {
-    return _mm_or_si128(x, y);
+    //3,1,2,0 -> 0b11011000 = 216
+    return _mm256_permute4x64_epi64(_mm256_packs_epi32(x, y), 216);
 }
 
-static __forceinline __m256i or_reg(const __m256i& x, const __m256i& y)
+template <int N>
+static __forceinline __m256i slli_reg(const __m256i& x)
 {
-    return _mm256_or_si256(x, y);
+    __m256i mask = _mm256_permute2x128_si256(x, x, _MM_SHUFFLE(0, 0, 3, 0));
+    return _mm256_alignr_epi8(x, mask, 16 - N);
 }
 
-static __forceinline __m128i xor_reg(const __m128i& x, const __m128i& y)
+template <int N>
+static __forceinline __m256i srli_reg(const __m256i& x)
 {
-    return _mm_xor_si128(x, y);
+    // the upper lane moved down, zero above it.
+    __m256i next = _mm256_permute2x128_si256(x, x, 0x81);
+    return _mm256_alignr_epi8(next, x, N);
 }
 
-static __forceinline __m256i xor_reg(const __m256i& x, const __m256i& y)
+static __forceinline __m256i
+blendv_epi8(const __m256i& x, const __m256i& y, const __m256i& mask)
 {
-    return _mm256_xor_si256(x, y);
+    return _mm256_blendv_epi8(x, y, mask);
 }
 
-static __forceinline __m128i and_reg(const __m128i& x, const __m128i& y)
+static __forceinline __m256i unpacklo_epi8_lane(const __m256i& x, const __m256i& y)
 {
-    return _mm_and_si128(x, y);
+    return _mm256_unpacklo_epi8(x, y);
 }
 
-static __forceinline __m256i and_reg(const __m256i& x, const __m256i& y)
+static __forceinline __m256i unpackhi_epi8_lane(const __m256i& x, const __m256i& y)
 {
-    return _mm256_and_si256(x, y);
+    return _mm256_unpackhi_epi8(x, y);
 }
 
-static __forceinline __m128i andnot_reg(const __m128i& x, const __m128i& y)
+static __forceinline __m256i unpacklo_epi16_lane(const __m256i& x, const __m256i& y)
 {
-    return _mm_andnot_si128(x, y);
+    return _mm256_unpacklo_epi16(x, y);
 }
 
-static __forceinline __m256i andnot_reg(const __m256i& x, const __m256i& y)
+static __forceinline __m256i unpackhi_epi16_lane(const __m256i& x, const __m256i& y)
 {
-    return _mm256_andnot_si256(x, y);
+    return _mm256_unpackhi_epi16(x, y);
 }
 
-static __forceinline __m128i srli_epi16(const __m128i& x, int count)
+static __forceinline __m256i packus_epi16_lane(const __m256i& x, const __m256i& y)
 {
-    return _mm_srli_epi16(x, count);
+    return _mm256_packus_epi16(x, y);
 }
 
-static __forceinline __m256i srli_epi16(const __m256i& x, int count)
+static __forceinline __m256i packs_epi32_lane(const __m256i& x, const __m256i& y)
 {
-    return _mm256_srli_epi16(x, count);
+    return _mm256_packs_epi32(x, y);
 }
 
-static __forceinline __m128i slli_epi16(const __m128i& x, int count)
+template <int N>
+static __forceinline __m256i slli_lane(const __m256i& x)
 {
-    return _mm_slli_epi16(x, count);
+    return _mm256_slli_si256(x, N);
 }
 
-static __forceinline __m256i slli_epi16(const __m256i& x, int count)
+template <int N>
+static __forceinline __m256i srli_lane(const __m256i& x)
 {
-    return _mm256_slli_epi16(x, count);
+    return _mm256_srli_si256(x, N);
 }
 
-static __forceinline __m128i srli_epi32(const __m128i& x, int count)
+static __forceinline __m256i drop_byte3_lane(const __m256i& x)
 {
-    return _mm_srli_epi32(x, count);
+    const __m256i idx = _mm256_setr_epi8(
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    return _mm256_shuffle_epi8(x, idx);
 }
 
-static __forceinline __m256i srli_epi32(const __m256i& x, int count)
+// the stores of the lane take it from the register without a shuffle.
+static __forceinline __m128i lane(const __m256i& x, int i)
 {
-    return _mm256_srli_epi32(x, count);
+    return i == 0 ? _mm256_castsi256_si128(x) : _mm256_extracti128_si256(x, 1);
 }
 
-static __forceinline __m128i cmpeq(const __m128i& x, const __m128i& y)
+#endif // __AVX2__
+
+
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+
+static __forceinline __m512i load_reg(const __m512i* addr)
 {
-    return _mm_cmpeq_epi8(x, y);
+    return _mm512_load_si512(addr);
 }
 
-static __forceinline __m256i cmpeq(const __m256i& x, const __m256i& y)
+static __forceinline __m512i loadu_reg(const __m512i* addr)
 {
-    return _mm256_cmpeq_epi8(x, y);
+    return _mm512_loadu_si512(addr);
 }
 
-static __forceinline void set1_epi8(__m128i& x, char v)
+static __forceinline void stream_reg(__m512i* adrr, const __m512i& reg)
 {
-    x = _mm_set1_epi8(v);
+    _mm512_stream_si512(adrr, reg);
 }
 
-static __forceinline void set1_epi8(__m256i& x, char v)
+static __forceinline void storeu_reg(__m512i* addr, const __m512i& reg)
 {
-    x = _mm256_set1_epi8(v);
+    _mm512_storeu_si512(addr, reg);
 }
 
-static __forceinline void set1_epi16(__m128i& x, int16_t v)
+static __forceinline __m512i or_reg(const __m512i& x, const __m512i& y)
 {
-    x = _mm_set1_epi16(v);
+    return _mm512_or_si512(x, y);
 }
 
-static __forceinline void set1_epi16(__m256i& x, int16_t v)
+static __forceinline __m512i xor_reg(const __m512i& x, const __m512i& y)
 {
-    x = _mm256_set1_epi16(v);
+    return _mm512_xor_si512(x, y);
 }
 
-static __forceinline void set1_epi32(__m128i& x, int32_t v)
+static __forceinline __m512i and_reg(const __m512i& x, const __m512i& y)
 {
-    x = _mm_set1_epi32(v);
+    return _mm512_and_si512(x, y);
 }
 
-static __forceinline void set1_epi32(__m256i& x, int32_t v)
+static __forceinline __m512i andnot_reg(const __m512i& x, const __m512i& y)
 {
-    x = _mm256_set1_epi32(v);
+    return _mm512_andnot_si512(x, y);
 }
 
-static __forceinline __m128i add_epu16(const __m128i& x, const __m128i& y)
+static __forceinline __m512i srli_epi16(const __m512i& x, int count)
 {
-    return _mm_adds_epu16(x, y);
+    return _mm512_srli_epi16(x, count);
 }
 
-static __forceinline __m256i add_epu16(const __m256i& x, const __m256i& y)
+static __forceinline __m512i slli_epi16(const __m512i& x, int count)
 {
-    return _mm256_adds_epu16(x, y);
+    return _mm512_slli_epi16(x, count);
 }
 
-static __forceinline __m128i add_epi32(const __m128i& x, const __m128i& y)
+static __forceinline __m512i srli_epi32(const __m512i& x, int count)
 {
-    return _mm_add_epi32(x, y);
+    return _mm512_srli_epi32(x, count);
 }
 
-static __forceinline __m256i add_epi32(const __m256i& x, const __m256i& y)
+static __forceinline __m512i slli_epi32(const __m512i& x, int count)
 {
-    return _mm256_add_epi32(x, y);
+    return _mm512_slli_epi32(x, count);
 }
 
-static __forceinline __m128i subs_epu8(const __m128i& x, const __m128i& y)
+static __forceinline __m512i cmpeq(const __m512i& x, const __m512i& y)
 {
-    return _mm_subs_epu8(x, y);
+    return _mm512_movm_epi8(_mm512_cmpeq_epi8_mask(x, y));
 }
 
-static __forceinline __m256i subs_epu8(const __m256i& x, const __m256i& y)
+static __forceinline void set1_epi8(__m512i& x, char v)
 {
-    return _mm256_subs_epu8(x, y);
+    x = _mm512_set1_epi8(v);
 }
 
-static __forceinline __m128i sub_epi16(const __m128i& x, const __m128i& y)
+static __forceinline void set1_epi16(__m512i& x, int16_t v)
 {
-    return _mm_sub_epi16(x, y);
+    x = _mm512_set1_epi16(v);
 }
 
-static __forceinline __m256i sub_epi16(const __m256i& x, const __m256i& y)
+static __forceinline void set1_epi32(__m512i& x, int32_t v)
 {
-    return _mm256_sub_epi16(x, y);
+    x = _mm512_set1_epi32(v);
 }
 
-static __forceinline __m128i mullo_epi16(const __m128i& x, const __m128i& y)
+static __forceinline __m512i add_epu16(const __m512i& x, const __m512i& y)
 {
-    return _mm_mullo_epi16(x, y);
+    return _mm512_adds_epu16(x, y);
 }
 
-static __forceinline __m256i mullo_epi16(const __m256i& x, const __m256i& y)
+static __forceinline __m512i add_epi32(const __m512i& x, const __m512i& y)
 {
-    return _mm256_mullo_epi16(x, y);
+    return _mm512_add_epi32(x, y);
 }
 
-static __forceinline __m128i madd_epi16(const __m128i& x, const __m128i& y)
+static __forceinline __m512i subs_epu8(const __m512i& x, const __m512i& y)
 {
-    return _mm_madd_epi16(x, y);
+    return _mm512_subs_epu8(x, y);
 }
 
-static __forceinline __m256i madd_epi16(const __m256i& x, const __m256i& y)
+static __forceinline __m512i sub_epi16(const __m512i& x, const __m512i& y)
 {
-    return _mm256_madd_epi16(x, y);
+    return _mm512_sub_epi16(x, y);
 }
 
-static __forceinline __m128i average(const __m128i& x, const __m128i& y)
+static __forceinline __m512i mullo_epi16(const __m512i& x, const __m512i& y)
 {
-    return _mm_avg_epu8(x, y);
+    return _mm512_mullo_epi16(x, y);
 }
 
-static __forceinline __m256i average(const __m256i& x, const __m256i& y)
+static __forceinline __m512i madd_epi16(const __m512i& x, const __m512i& y)
 {
-    return _mm256_avg_epu8(x, y);
+    return _mm512_madd_epi16(x, y);
 }
 
-template <typename T>
-static __forceinline T
-average(const T& w, const T& x, const T& y, const T& z)
+static __forceinline __m512i average(const __m512i& x, const __m512i& y)
 {
-    T one;
-    set1_epi8(one, 0x01);
-    T avg0 = average(w, x);
-    T avg1 = average(y, z);
-    T err0 = or_reg(xor_reg(w, x), xor_reg(y, z));
-    T err1 = xor_reg(avg0, avg1);
-    T mask = and_reg(and_reg(err0, err1), one);
-    return subs_epu8(average(avg0, avg1), mask);
+    return _mm512_avg_epu8(x, y);
 }
 
-static __forceinline __m128i unpacklo_epi8(const __m128i& x, const __m128i& y)
+static __forceinline __m512i average_epu16(const __m512i& x, const __m512i& y)
 {
-    return _mm_unpacklo_epi8(x, y);
+    return _mm512_avg_epu16(x, y);
 }
 
-static __forceinline __m128i unpackhi_epi8(const __m128i& x, const __m128i& y)
+static __forceinline __m512i subs_epu16(const __m512i& x, const __m512i& y)
 {
-    return _mm_unpackhi_epi8(x, y);
+    return _mm512_subs_epu16(x, y);
 }
 
-static __forceinline __m256i unpacklo_epi8(const __m256i& x, const __m256i& y)
+static __forceinline __m512i sub_epi32(const __m512i& x, const __m512i& y)
 {
-    __m256i t0 = _mm256_unpacklo_epi8(x, y);
-    __m256i t1 = _mm256_unpackhi_epi8(x, y);
-    return _mm256_permute2x128_si256(t0, t1, 0x20);
+    return _mm512_sub_epi32(x, y);
 }
 
-static __forceinline __m256i unpackhi_epi8(const __m256i& x, const __m256i& y)
+static __forceinline __m512i srai_epi32(const __m512i& x, int count)
 {
-    __m256i t0 = _mm256_unpacklo_epi8(x, y);
-    __m256i t1 = _mm256_unpackhi_epi8(x, y);
-    return _mm256_permute2x128_si256(t0, t1, 0x31);
+    return _mm512_srai_epi32(x, count);
 }
 
-static __forceinline __m128i unpacklo_epi16(const __m128i& x, const __m128i& y)
+static __forceinline __m512i min_epi16(const __m512i& x, const __m512i& y)
 {
-    return _mm_unpacklo_epi16(x, y);
+    return _mm512_min_epi16(x, y);
 }
 
-static __forceinline __m128i unpackhi_epi16(const __m128i& x, const __m128i& y)
+static __forceinline __m512i add_ps(const __m512i& x, const __m512i& y)
 {
-    return _mm_unpackhi_epi16(x, y);
+    return _mm512_castps_si512(_mm512_add_ps(_mm512_castsi512_ps(x), _mm512_castsi512_ps(y)));
 }
 
-static __forceinline __m256i unpacklo_epi16(const __m256i& x, const __m256i& y)
+static __forceinline __m512i mul_ps(const __m512i& x, const __m512i& y)
 {
-    __m256i t0 = _mm256_unpacklo_epi16(x, y);
-    __m256i t1 = _mm256_unpackhi_epi16(x, y);
-    return _mm256_permute2x128_si256(t0, t1, 0x20);
+    return _mm512_castps_si512(_mm512_mul_ps(_mm512_castsi512_ps(x), _mm512_castsi512_ps(y)));
 }
 
-static __forceinline __m256i unpackhi_epi16(const __m256i& x, const __m256i& y)
+// x * y + z
+static __forceinline __m512i fmadd_ps(const __m512i& x, const __m512i& y, const __m512i& z)
 {
-    __m256i t0 = _mm256_unpacklo_epi16(x, y);
-    __m256i t1 = _mm256_unpackhi_epi16(x, y);
-    return _mm256_permute2x128_si256(t0, t1, 0x31);
+    return _mm512_castps_si512(_mm512_fmadd_ps(_mm512_castsi512_ps(x), _mm512_castsi512_ps(y),
+                                               _mm512_castsi512_ps(z)));
 }
 
-static __forceinline __m128i packus_epi16(const __m128i& x, const __m128i& y)
+static __forceinline void set1_ps(__m512i& x, float v)
 {
-    return _mm_packus_epi16(x, y);
+    x = _mm512_castps_si512(_mm512_set1_ps(v));
 }
 
-static __forceinline __m256i packus_epi16(const __m256i& x, const __m256i& y)
+// the 512bit unpack/pack instructions work within each 128bit lane.
+// qwords are reordered so that they behave like the 128bit versions.
+
+static __forceinline __m512i unpacklo_epi8(const __m512i& x, const __m512i& y)
 {
-    //3,1,2,0 -> 0b11011000 = 216
-    return _mm256_permute4x64_epi64(_mm256_packus_epi16(x, y), 216);
+    const __m512i idx = _mm512_set_epi64(11, 10, 3, 2, 9, 8, 1, 0);
+    __m512i t0 = _mm512_unpacklo_epi8(x, y);
+    __m512i t1 = _mm512_unpackhi_epi8(x, y);
+    return _mm512_permutex2var_epi64(t0, idx, t1);
 }
 
-static __forceinline __m128i packs_epi32(const __m128i& x, const __m128i& y)
+static __forceinline __m512i unpackhi_epi8(const __m512i& x, const __m512i& y)
 {
-    return _mm_packs_epi32(x, y);
+    const __m512i idx = _mm512_set_epi64(15, 14, 7, 6, 13, 12, 5, 4);
+    __m512i t0 = _mm512_unpacklo_epi8(x, y);
+    __m512i t1 = _mm512_unpackhi_epi8(x, y);
+    return _mm512_permutex2var_epi64(t0, idx, t1);
 }
 
-static __forceinline __m256i packs_epi32(const __m256i& x, const __m256i& y)
+static __forceinline __m512i unpacklo_epi16(const __m512i& x, const __m512i& y)
 {
-    //3,1,2,0 -> 0b11011000 = 216
-    return _mm256_permute4x64_epi64(_mm256_packs_epi32(x, y), 216);
+    const __m512i idx = _mm512_set_epi64(11, 10, 3, 2, 9, 8, 1, 0);
+    __m512i t0 = _mm512_unpacklo_epi16(x, y);
+    __m512i t1 = _mm512_unpackhi_epi16(x, y);
+    return _mm512_permutex2var_epi64(t0, idx, t1);
+}
+
+static __forceinline __m512i unpackhi_epi16(const __m512i& x, const __m512i& y)
+{
+    const __m512i idx = _mm512_set_epi64(15, 14, 7, 6, 13, 12, 5, 4);
+    __m512i t0 = _mm512_unpacklo_epi16(x, y);
+    __m512i t1 = _mm512_unpackhi_epi16(x, y);
+    return _mm512_permutex2var_epi64(t0, idx, t1);
+}
+
+static __forceinline __m512i unpacklo_epi32(const __m512i& x, const __m512i& y)
+{
+    const __m512i idx = _mm512_set_epi64(11, 10, 3, 2, 9, 8, 1, 0);
+    __m512i t0 = _mm512_unpacklo_epi32(x, y);
+    __m512i t1 = _mm512_unpackhi_epi32(x, y);
+    return _mm512_permutex2var_epi64(t0, idx, t1);
+}
+
+static __forceinline __m512i unpackhi_epi32(const __m512i& x, const __m512i& y)
+{
+    const __m512i idx = _mm512_set_epi64(15, 14, 7, 6, 13, 12, 5, 4);
+    __m512i t0 = _mm512_unpacklo_epi32(x, y);
+    __m512i t1 = _mm512_unpackhi_epi32(x, y);
+    return _mm512_permutex2var_epi64(t0, idx, t1);
+}
+
+static __forceinline __m512i packus_epi16(const __m512i& x, const __m512i& y)
+{
+    const __m512i idx = _mm512_set_epi64(7, 5, 3, 1, 6, 4, 2, 0);
+    return _mm512_permutexvar_epi64(idx, _mm512_packus_epi16(x, y));
+}
+
+static __forceinline __m512i packs_epi32(const __m512i& x, const __m512i& y)
+{
+    const __m512i idx = _mm512_set_epi64(7, 5, 3, 1, 6, 4, 2, 0);
+    return _mm512_permutexvar_epi64(idx, _mm512_packs_epi32(x, y));
+}
+
+template <int N>
+static __forceinline __m512i slli_reg(const __m512i& x)
+{
+    // lanes 0,1,2 of x moved up to lanes 1,2,3. lane 0 is zero.
+    __m512i prev = _mm512_maskz_shuffle_i64x2(0xFC, x, x, _MM_SHUFFLE(2, 1, 0, 0));
+    return _mm512_alignr_epi8(x, prev, 16 - N);
+}
+
+template <int N>
+static __forceinline __m512i srli_reg(const __m512i& x)
+{
+    // lanes 1,2,3 of x moved down to lanes 0,1,2. lane 3 is zero.
+    __m512i next = _mm512_maskz_shuffle_i64x2(0x3F, x, x, _MM_SHUFFLE(3, 3, 2, 1));
+    return _mm512_alignr_epi8(next, x, N);
+}
+
+static __forceinline __m512i
+blendv_epi8(const __m512i& x, const __m512i& y, const __m512i& mask)
+{
+    return _mm512_mask_blend_epi8(_mm512_movepi8_mask(mask), x, y);
+}
+
+static __forceinline __m512i unpacklo_epi8_lane(const __m512i& x, const __m512i& y)
+{
+    return _mm512_unpacklo_epi8(x, y);
+}
+
+static __forceinline __m512i unpackhi_epi8_lane(const __m512i& x, const __m512i& y)
+{
+    return _mm512_unpackhi_epi8(x, y);
+}
+
+static __forceinline __m512i unpacklo_epi16_lane(const __m512i& x, const __m512i& y)
+{
+    return _mm512_unpacklo_epi16(x, y);
+}
+
+static __forceinline __m512i unpackhi_epi16_lane(const __m512i& x, const __m512i& y)
+{
+    return _mm512_unpackhi_epi16(x, y);
+}
+
+static __forceinline __m512i packus_epi16_lane(const __m512i& x, const __m512i& y)
+{
+    return _mm512_packus_epi16(x, y);
+}
+
+static __forceinline __m512i packs_epi32_lane(const __m512i& x, const __m512i& y)
+{
+    return _mm512_packs_epi32(x, y);
+}
+
+template <int N>
+static __forceinline __m512i slli_lane(const __m512i& x)
+{
+    return _mm512_bslli_epi128(x, N);
+}
+
+template <int N>
+static __forceinline __m512i srli_lane(const __m512i& x)
+{
+    return _mm512_bsrli_epi128(x, N);
+}
+
+static __forceinline __m512i drop_byte3_lane(const __m512i& x)
+{
+    const __m512i idx = _mm512_broadcast_i32x4(_mm_setr_epi8(
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1));
+    return _mm512_shuffle_epi8(x, idx);
+}
+
+static __forceinline __m128i lane(const __m512i& x, int i)
+{
+    switch (i) {
+    case 0:
+        return _mm512_castsi512_si128(x);
+    case 1:
+        return _mm512_extracti32x4_epi32(x, 1);
+    case 2:
+        return _mm512_extracti32x4_epi32(x, 2);
+    default:
+        return _mm512_extracti32x4_epi32(x, 3);
+    }
+}
+
+#endif // __AVX512F__ && __AVX512BW__
+
+
+template <typename T>
+static __forceinline T
+average(const T& w, const T& x, const T& y, const T& z)
+{
+    T one;
+    set1_epi8(one, 0x01);
+    T avg0 = average(w, x);
+    T avg1 = average(y, z);
+    T err0 = or_reg(xor_reg(w, x), xor_reg(y, z));
+    T err1 = xor_reg(avg0, avg1);
+    T mask = and_reg(and_reg(err0, err1), one);
+    return subs_epu8(average(avg0, avg1), mask);
 }
 
 template <typename T>
@@ -347,29 +976,4 @@ static __forceinline void cvtepu16_epi32x2(T& x, T& y)
     x = unpacklo_epi16(x, zero);
 }
 
-template <int N>
-static __forceinline __m128i slli_reg(const __m128i& x)
-{
-    return _mm_slli_si128(x, N);
-}
-
-template <int N>
-static __forceinline __m256i slli_reg(const __m256i& x)
-{
-    __m256i mask = _mm256_permute2x128_si256(x, x, _MM_SHUFFLE(0, 0, 3, 0));
-    return _mm256_alignr_epi8(x, mask, 16 - N);
-}
-
-static __forceinline __m128i
-blendv_epi8(const __m128i& x, const __m128i& y, const __m128i& mask)
-{
-    return or_reg(and_reg(mask, y), andnot_reg(mask, x));
-}
-
-static __forceinline __m256i
-blendv_epi8(const __m256i& x, const __m256i& y, const __m256i& mask)
-{
-    return _mm256_blendv_epi8(x, y, mask);
-}
-
 #endif
@@ -0,0 +1,399 @@
+/*
+  vs_yv12to422.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+/*
+  VapourSynth(API4) frontend.
+
+  VapourSynth has no packed formats, so the output is always YUV422P8, or
+  YUV422P9 to P16 and YUV422PS for the inputs of those formats, or
+  YUV422P10/P16 for YUV420P8 with bits=10/16. YUV411P8 to P16 and
+  YUV411PS are upsampled horizontally to the same YUV422 formats.
+  The luma plane of the output is a reference to the source luma plane,
+  unless it is widened.
+  When interlaced/cplace are not given, they are decided per frame from
+  _FieldBased/_ChromaLocation. All the engines needed for that are
+  initialized at creation and are read only after that, so the filter
+  runs as fmParallel. The scratch areas are kept in a pool of the
+  instance, so each frame thread allocates one once.
+*/
+
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <xmmintrin.h>
+#include <VapourSynth4.h>
+
+#include "compat.h"
+#include "libyv12to422.h"
+
+
+// scratch areas of the largest scratch_size of the engines. a frame takes
+// one out of the pool and puts it back when it is done.
+class scratch_pool {
+    std::mutex mtx;
+    std::vector<void*> buffers;
+    size_t size = 0;
+
+public:
+    ~scratch_pool()
+    {
+        for (void* p : buffers) {
+            _mm_free(p);
+        }
+    }
+
+    void reserve(size_t n)
+    {
+        size = n > size ? n : size;
+    }
+
+    // nullptr if it fails to allocate.
+    void* get()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (!buffers.empty()) {
+                void* p = buffers.back();
+                buffers.pop_back();
+                return p;
+            }
+        }
+        return _mm_malloc(size, 64);
+    }
+
+    void put(void* p)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        try {
+            buffers.push_back(p);
+        } catch (...) {
+            _mm_free(p);
+        }
+    }
+};
+
+
+struct VSYV12To422 {
+    VSNode* node;
+    VSVideoInfo vi;
+    int interlaced;     // -1: from _FieldBased
+    int cplace;         // -1: from _ChromaLocation
+    bool widen;         // 8bit input to 10 or 16bit output
+    yv12to422_t engine[2][4];   // [interlaced][cplace]
+    yv12to422_t fallback[2][4]; // used when a frame is not aligned for engine
+    scratch_pool scratch;
+};
+
+
+static inline bool is_aligned(const void* p, ptrdiff_t pitch, int align)
+{
+    return (((uintptr_t)p | (uintptr_t)pitch) & (align - 1)) == 0;
+}
+
+
+// -1 for bottom left and bottom, which no cplace describes.
+static int cplace_from_chromaloc(int chromaloc, bool interlaced)
+{
+    switch (chromaloc) {
+    case 2: // top left
+    case 3: // top
+        return 0;
+    case -1: // none
+    case 0: // left
+    case 1: // center
+        return interlaced ? 2 : 1;
+    default:
+        return -1;
+    }
+}
+
+
+static const VSFrame* VS_CC
+get_frame(int n, int activation_reason, void* instance_data, void**,
+          VSFrameContext* frame_ctx, VSCore* core, const VSAPI* vsapi)
+{
+    auto d = reinterpret_cast<VSYV12To422*>(instance_data);
+
+    if (activation_reason == arInitial) {
+        vsapi->requestFrameFilter(n, d->node, frame_ctx);
+        return nullptr;
+    }
+    if (activation_reason != arAllFramesReady) {
+        return nullptr;
+    }
+
+    const VSFrame* src = vsapi->getFrameFilter(n, d->node, frame_ctx);
+    const VSMap* props = vsapi->getFramePropertiesRO(src);
+
+    int err;
+    int interlaced = d->interlaced;
+    if (interlaced < 0) {
+        int field_based = vsapi->mapGetIntSaturated(props, "_FieldBased", 0, &err);
+        interlaced = !err && field_based > 0 ? 1 : 0;
+    }
+    int chromaloc = vsapi->mapGetIntSaturated(props, "_ChromaLocation", 0, &err);
+    if (err) {
+        chromaloc = -1;
+    }
+    int cplace = d->cplace;
+    if (cplace < 0) {
+        cplace = cplace_from_chromaloc(chromaloc, interlaced != 0);
+    }
+    if (cplace < 0) {
+        const std::string msg = "YV12To422: _ChromaLocation " + std::to_string(chromaloc) +
+                                " has no cplace. set cplace.";
+        vsapi->setFilterError(msg.c_str(), frame_ctx);
+        vsapi->freeFrame(src);
+        return nullptr;
+    }
+
+    // plane 0 is taken from src as is, unless it is widened.
+    const VSFrame* plane_src[] = { d->widen ? nullptr : src, nullptr, nullptr };
+    const int planes[] = { 0, 1, 2 };
+    VSFrame* dst = vsapi->newVideoFrame2(&d->vi.format, d->vi.width, d->vi.height,
+                                         plane_src, planes, src, core);
+    const int first_plane = d->widen ? 0 : 1;
+
+    yv12to422_src_t s;
+    yv12to422_dst_t t;
+    bool aligned[2] = { true, true };   // engine, fallback
+    const int memalign[2] = {
+        yv12to422_memalign(&d->engine[interlaced][cplace]),
+        yv12to422_memalign(&d->fallback[interlaced][cplace]),
+    };
+    for (int i = 0; i < 3; ++i) {
+        s.data[i] = vsapi->getReadPtr(src, i);
+        s.pitch[i] = static_cast<int>(vsapi->getStride(src, i));
+        t.data[i] = i < first_plane ? nullptr : vsapi->getWritePtr(dst, i);
+        t.pitch[i] = static_cast<int>(vsapi->getStride(dst, i));
+        for (int j = 0; j < 2; ++j) {
+            aligned[j] = aligned[j] && is_aligned(s.data[i], s.pitch[i], memalign[j]) &&
+                         (i < first_plane || is_aligned(t.data[i], t.pitch[i], memalign[j]));
+        }
+    }
+
+    const yv12to422_t* engine = aligned[0] ? &d->engine[interlaced][cplace]
+                                           : &d->fallback[interlaced][cplace];
+
+    const VSFrame* alt = nullptr;
+    if (!aligned[0] && !aligned[1]) {
+        // cropped source. a new frame is aligned to the core's alignment
+        // (32 or more), which is always enough for the fallback.
+        VSFrame* copy = vsapi->newVideoFrame2(vsapi->getVideoFrameFormat(src),
+                                              d->vi.width, d->vi.height,
+                                              nullptr, nullptr, nullptr, core);
+        const VSVideoFormat* copy_format = vsapi->getVideoFrameFormat(copy);
+        for (int i = first_plane; i < 3; ++i) {
+            uint8_t* dstp = vsapi->getWritePtr(copy, i);
+            const int pitch = static_cast<int>(vsapi->getStride(copy, i));
+            const int rowsize = vsapi->getFrameWidth(copy, i) * copy_format->bytesPerSample;
+            for (int y = 0; y < vsapi->getFrameHeight(copy, i); ++y) {
+                memcpy(dstp + y * pitch, s.data[i] + y * s.pitch[i], rowsize);
+            }
+            s.data[i] = dstp;
+            s.pitch[i] = pitch;
+        }
+        alt = copy;
+    }
+
+    void* scratch = nullptr;
+    size_t scratch_size = yv12to422_scratch_size(engine);
+    if (scratch_size > 0) {
+        scratch = d->scratch.get();
+    }
+
+    int ret = scratch_size > 0 && !scratch ? -1 : yv12to422_convert(engine, &s, &t, scratch);
+
+    if (scratch) {
+        d->scratch.put(scratch);
+    }
+    if (alt) {
+        vsapi->freeFrame(alt);
+    }
+    vsapi->freeFrame(src);
+
+    if (ret != YV12TO422_OK) {
+        std::string msg = "YV12To422: ";
+        msg += ret < 0 ? "failed to allocate scratch buffer." : yv12to422_strerror(ret);
+        vsapi->setFilterError(msg.c_str(), frame_ctx);
+        vsapi->freeFrame(dst);
+        return nullptr;
+    }
+
+    // 4:2:2 has no vertical chroma offset. keep only the horizontal one.
+    VSMap* dst_props = vsapi->getFramePropertiesRW(dst);
+    if (chromaloc >= 0) {
+        vsapi->mapSetInt(dst_props, "_ChromaLocation", chromaloc % 2, maReplace);
+    }
+
+    return dst;
+}
+
+
+static void VS_CC
+free_filter(void* instance_data, VSCore*, const VSAPI* vsapi)
+{
+    auto d = reinterpret_cast<VSYV12To422*>(instance_data);
+    vsapi->freeNode(d->node);
+    delete d;
+}
+
+
+static void VS_CC
+create_yv12to422(const VSMap* in, VSMap* out, void*, VSCore* core,
+                 const VSAPI* vsapi)
+{
+    auto d = new VSYV12To422();
+    d->node = vsapi->mapGetNode(in, "clip", 0, nullptr);
+    d->vi = *vsapi->getVideoInfo(d->node);
+
+    auto set_error = [&](const char* msg) {
+        vsapi->mapSetError(out, (std::string("YV12To422: ") + msg).c_str());
+        vsapi->freeNode(d->node);
+        delete d;
+    };
+
+    const VSVideoFormat& f = d->vi.format;
+    const bool integer = f.sampleType == stInteger && f.bitsPerSample <= 16;
+    const bool single = f.sampleType == stFloat && f.bitsPerSample == 32;
+    const bool yv411 = f.subSamplingW == 2 && f.subSamplingH == 0;
+    if (f.colorFamily != cfYUV || !(integer || single) ||
+        !((f.subSamplingW == 1 && f.subSamplingH == 1) || yv411) ||
+        d->vi.width == 0 || d->vi.height == 0) {
+        return set_error("input must be YUV420P8 to P16, YUV420PS, or YUV411 of those, "
+                         "with constant format and size.");
+    }
+
+    int err;
+    d->interlaced = vsapi->mapGetIntSaturated(in, "interlaced", 0, &err);
+    if (err) {
+        d->interlaced = -1;
+    }
+    d->interlaced = d->interlaced > 0 ? 1 : d->interlaced;
+
+    int itype = vsapi->mapGetIntSaturated(in, "itype", 0, &err);
+    if (err) {
+        itype = 2;
+    }
+    if (itype < 0 || itype > 2) {
+        return set_error("itype must be set to 0, 1, or 2.");
+    }
+
+    d->cplace = vsapi->mapGetIntSaturated(in, "cplace", 0, &err);
+    if (err) {
+        d->cplace = -1;
+    } else if (d->cplace < 0 || d->cplace > 3) {
+        return set_error("cplace must be set to 0, 1, 2, or 3.");
+    }
+
+    // the core aligns frames to 32 bytes unless it runs AVX512 code itself,
+    // so AVX512 falls back to AVX2 rather than SSE2.
+    int simd = YV12TO422_SIMD_SSE2;
+    if (vsapi->mapGetIntSaturated(in, "avx512", 0, &err) > 0 && yv12to422_has_avx512()) {
+        simd = YV12TO422_SIMD_AVX512;
+    } else if (vsapi->mapGetIntSaturated(in, "avx2", 0, &err) > 0 && yv12to422_has_avx2()) {
+        simd = YV12TO422_SIMD_AVX2;
+    }
+    const int fallback = simd == YV12TO422_SIMD_AVX512 && yv12to422_has_avx2() ?
+                         YV12TO422_SIMD_AVX2 : YV12TO422_SIMD_SSE2;
+
+    yv12to422_params_t params;
+    yv12to422_default_params(&params, d->vi.width, d->vi.height);
+    params.itype = itype;
+    params.lshift = vsapi->mapGetIntSaturated(in, "lshift", 0, &err) > 0;
+    params.threads = vsapi->mapGetIntSaturated(in, "threads", 0, &err) > 0 ? 2 : 1;
+    params.output = YV12TO422_OUTPUT_YV16;
+    params.input = yv411 ? YV12TO422_INPUT_YV411 : YV12TO422_INPUT_YV12;
+    params.bits = f.bitsPerSample;
+    const int bits = vsapi->mapGetIntSaturated(in, "bits", 0, &err);
+    if (!err && bits != f.bitsPerSample) {
+        if ((bits != 10 && bits != 16) || f.sampleType != stInteger ||
+            f.bitsPerSample != 8) {
+            return set_error("bits must be 10 or 16 for YUV420P8, or the bits of the input.");
+        }
+        params.output_bits = bits;
+        d->widen = true;
+    }
+    params.b = vsapi->mapGetFloat(in, "b", 0, &err);
+    if (err) {
+        params.b = 0.0;
+    }
+    params.c = vsapi->mapGetFloat(in, "c", 0, &err);
+    if (err) {
+        params.c = 0.75;
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            params.interlaced = i;
+            params.cplace = c;
+            params.simd = simd;
+            int ret = yv12to422_init(&d->engine[i][c], &params);
+            if (ret != YV12TO422_OK) {
+                return set_error(yv12to422_strerror(ret));
+            }
+            params.simd = fallback;
+            ret = yv12to422_init(&d->fallback[i][c], &params);
+            if (ret != YV12TO422_OK) {
+                return set_error(yv12to422_strerror(ret));
+            }
+            d->scratch.reserve(yv12to422_scratch_size(&d->engine[i][c]));
+            d->scratch.reserve(yv12to422_scratch_size(&d->fallback[i][c]));
+        }
+    }
+
+    vsapi->queryVideoFormat(&d->vi.format, cfYUV, f.sampleType,
+                            d->widen ? params.output_bits : f.bitsPerSample, 1, 0, core);
+
+    VSFilterDependency deps[] = { { d->node, rpStrictSpatial } };
+    vsapi->createVideoFilter(out, "YV12To422", &d->vi, get_frame, free_filter,
+                             fmParallel, deps, 1, d, core);
+}
+
+
+VS_EXTERNAL_API(void)
+VapourSynthPluginInit2(VSPlugin* plugin, const VSPLUGINAPI* vspapi)
+{
+    vspapi->configPlugin("com.chikuzen.yv12to422", "yv12to422",
+                         "YV12 to YV16 converter ver." LIBYV12TO422_VERSION,
+                         VS_MAKE_VERSION(1, 2), VAPOURSYNTH_API_VERSION, 0,
+                         plugin);
+    vspapi->registerFunction("YV12To422",
+                             "clip:vnode;"
+                             "interlaced:int:opt;"
+                             "itype:int:opt;"
+                             "cplace:int:opt;"
+                             "lshift:int:opt;"
+                             "threads:int:opt;"
+                             "avx2:int:opt;"
+                             "b:float:opt;"
+                             "c:float:opt;"
+                             "avx512:int:opt;"
+                             "bits:int:opt;",
+                             "clip:vnode;",
+                             create_yv12to422, nullptr, plugin);
+}
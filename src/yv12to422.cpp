@@ -27,117 +27,72 @@
 #endif
 
 #include <cstdint>
-#include <cmath>
-#include <malloc.h>
-#include <immintrin.h>
-#include <omp.h>
-#include <windows.h>
+#include <cstring>
+#include <xmmintrin.h>
 #include "avisynth.h"
 
-#include "proc_to422.h"
-#include "simd.h"
+#include "compat.h"
+#include "libyv12to422.h"
 
 
-#define YV12TO422_VERSION "1.0.2"
-
-
-using planar_to_packed = void (__stdcall *)(
-    const int width, const int height, const uint8_t* srcpy,
-    const uint8_t* srcpu, const uint8_t* srcpv, uint8_t* dstp,
-    const int src_pitch_y, const int src_pitch_uv, const int dst_pitch);
-
-
-template <int MODE>
-static void __stdcall
-planar_to_yuy2(const int width, const int height, const uint8_t* srcpy,
-               const uint8_t* srcpu, const uint8_t* srcpv, uint8_t* dstp,
-               const int pitch_y, const int pitch_uv, const int dst_pitch)
-{
-    const int w = (width + 7) / 16 * 16;
-
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < w; x += 16) {
-            __m128i y = load_reg((__m128i*)(srcpy + x));
-            __m128i u = _mm_loadl_epi64((__m128i*)(srcpu + x / 2));
-            __m128i v = _mm_loadl_epi64((__m128i*)(srcpv + x / 2));
-
-            __m128i uv = unpacklo_epi8(u, v);
-            __m128i yuv0 = unpacklo_epi8(y, uv);
-            __m128i yuv1 = unpackhi_epi8(y, uv);
-
-            stream_reg((__m128i*)(dstp + 2 * x), yuv0);
-            stream_reg((__m128i*)(dstp + 2 * x + 16), yuv1);
-        }
-        if (MODE > 0) {
-            __m128i y = load_reg((__m128i*)(srcpy + w));
-            __m128i u = _mm_loadl_epi64((__m128i*)(srcpu + w / 2));
-            __m128i v = _mm_loadl_epi64((__m128i*)(srcpv + w / 2));
-
-            __m128i uv = unpacklo_epi8(u, v);
-            __m128i yuv0 = unpacklo_epi8(y, uv);
-            stream_reg((__m128i*)(dstp + 2 * w), yuv0);
-        }
-        srcpy += pitch_y;
-        srcpu += pitch_uv;
-        srcpv += pitch_uv;
-        dstp += dst_pitch;
-    }
-}
+#define YV12TO422_VERSION LIBYV12TO422_VERSION
 
 
 class YV12To422 : public GenericVideoFilter
 {
     VideoInfo vi_src;
-    VideoInfo vi_yv16;
-    VideoInfo vi_yuy2;
-    bool yuy2out;
-    bool lshift;
-    int dvpal;
     int memalign;
-    int num_threads;
-    int16_t cubic_coefficients[8];
-
-    proc_to422 proc_chroma;
-    proc_horizontal proc_chroma_qpel_shift_h;
-    planar_to_packed yv16toyuy2;
+    yv12to422_t engine;
 
 
 public:
     YV12To422(
         PClip child, int itype, bool interlaced, int cplace, double _b,
-        double _c, bool yuy2, bool avx2, bool lshift, int threads,
+        double _c, bool yuy2, int simd, bool lshift, int threads, int rgb,
+        int matrix, bool full_range, int out_matrix, bool out_full_range,
         IScriptEnvironment* env);
     ~YV12To422() {};
     PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env);
 };
 
 
-extern void set_cubic_coefficients(double b, double c, int16_t* array, bool interlaced, int cplace);
-
-
 YV12To422::
 YV12To422(PClip _child, int itype, bool interlaced, int cplace, double b,
-           double c, bool yuy2, bool avx2, bool _lshift, int threads,
+           double c, bool yuy2, int simd, bool lshift, int threads, int rgb,
+           int matrix, bool full_range, int out_matrix, bool out_full_range,
            IScriptEnvironment* env)
-  : GenericVideoFilter(_child),
-    yuy2out(yuy2),
-    lshift(_lshift),
-    num_threads(threads)
+  : GenericVideoFilter(_child)
 {
-    memalign = avx2 ? sizeof(__m256i) : sizeof(__m128i);
-    proc_chroma = get_proc_chroma(itype, cplace, interlaced, avx2);
-    proc_chroma_qpel_shift_h = get_proc_horizontal_shift(avx2);
-    yv16toyuy2 = vi.width - (vi.width + 7) / 16 * 16 > 0 ? planar_to_yuy2<1> : planar_to_yuy2<0>;
-    if (itype == 2) {
-        set_cubic_coefficients(b, c, cubic_coefficients, interlaced, cplace);
+    yv12to422_params_t params;
+    yv12to422_default_params(&params, vi.width, vi.height);
+    params.interlaced = interlaced;
+    params.itype = itype;
+    params.cplace = cplace;
+    params.lshift = lshift;
+    params.input = vi.IsYV411() ? YV12TO422_INPUT_YV411 :
+                   vi.IsYUY2() ? YV12TO422_INPUT_YUY2 : YV12TO422_INPUT_YV12;
+    params.b = b;
+    params.c = c;
+    params.output = rgb == 32 ? YV12TO422_OUTPUT_RGB32 :
+                    rgb == 24 ? YV12TO422_OUTPUT_RGB24 :
+                    yuy2 ? YV12TO422_OUTPUT_YUY2 : YV12TO422_OUTPUT_YV16;
+    params.matrix = matrix;
+    params.full_range = full_range;
+    params.out_matrix = out_matrix;
+    params.out_full_range = out_full_range;
+    params.simd = simd;
+    params.threads = threads;
+
+    int err = yv12to422_init(&engine, &params);
+    if (err != YV12TO422_OK) {
+        env->ThrowError("YV12To422: %s\n", yv12to422_strerror(err));
     }
-
-    dvpal = interlaced && cplace == 3 ? -1 : 1;
+    memalign = yv12to422_memalign(&engine);
 
     memcpy(&vi_src, &vi, sizeof(VideoInfo));
-    memcpy(&vi_yv16, &vi, sizeof(VideoInfo));
-    vi_yv16.pixel_type = VideoInfo::CS_YV16;
-    if (yuy2out) {
+    if (rgb > 0) {
+        vi.pixel_type = rgb == 32 ? VideoInfo::CS_BGR32 : VideoInfo::CS_BGR24;
+    } else if (yuy2) {
         vi.pixel_type = VideoInfo::CS_YUY2;
     } else {
         vi.pixel_type = VideoInfo::CS_YV16;
@@ -145,7 +100,7 @@ YV12To422(PClip _child, int itype, bool interlaced, int cplace, double b,
 
 #ifdef DEBUG
     std::cerr << "cplace:" << cplace << " itype:" << itype << " interlaced:"
-        << interlaced << " yuy2:" << yuy2out << " avx2:" << avx2 <<
+        << interlaced << " yuy2:" << yuy2 << " simd:" << simd <<
         " threads: " << threads << "\n";
 #endif
 }
@@ -155,14 +110,20 @@ PVideoFrame __stdcall YV12To422::
 GetFrame(int n, IScriptEnvironment* env)
 {
     PVideoFrame src = child->GetFrame(n, env);
+    // yuy2 is unpacked to yv16, from its only plane.
+    const bool yuy2_src = vi_src.IsYUY2();
 
     // check for crop left
-    if (((uintptr_t)src->GetReadPtr(PLANAR_Y) |
-         (uintptr_t)src->GetReadPtr(PLANAR_U) |
-         (uintptr_t)src->GetReadPtr(PLANAR_V)) & (memalign - 1)) {
+    uintptr_t addr = (uintptr_t)src->GetReadPtr() | src->GetPitch();
+    if (!yuy2_src) {
+        addr |= (uintptr_t)src->GetReadPtr(PLANAR_U) |
+                (uintptr_t)src->GetReadPtr(PLANAR_V) | src->GetPitch(PLANAR_U);
+    }
+    if (addr & (memalign - 1)) {
         int planes[] = { PLANAR_Y, PLANAR_U, PLANAR_V };
         PVideoFrame alt = env->NewVideoFrame(vi_src, memalign);
-        for (auto p : planes) {
+        for (int i = 0; i < (yuy2_src ? 1 : 3); ++i) {
+            int p = yuy2_src ? 0 : planes[i];
             env->BitBlt(alt->GetWritePtr(p), alt->GetPitch(p),
                 src->GetReadPtr(p), src->GetPitch(p),
                 src->GetRowSize(p), src->GetHeight(p));
@@ -170,85 +131,68 @@ GetFrame(int n, IScriptEnvironment* env)
         src = alt;
     }
 
-    const int width_uv = aligned_size(src->GetRowSize(PLANAR_U), memalign);
-    const int src_height_uv = src->GetHeight(PLANAR_U);
-    const int src_pitch_y = src->GetPitch(PLANAR_Y);
-    int src_pitch_u = src->GetPitch(PLANAR_U);
-    int src_pitch_v = src_pitch_u;
-
-    const uint8_t* srcpy = src->GetReadPtr(PLANAR_Y);
-    const uint8_t* srcpu = src->GetReadPtr(PLANAR_U);
-    const uint8_t* srcpv = src->GetReadPtr(PLANAR_V);
-
-    int buff_pitch = aligned_size(src_pitch_u, memalign);
-    uint8_t* buffu = nullptr;
-    uint8_t* buffv = nullptr;
-    if (lshift) {
-        buffu = (uint8_t*)_mm_malloc(buff_pitch * src_height_uv * 2, memalign);
-        buffv = buffu + buff_pitch * src_height_uv;
-    }
-
-    PVideoFrame yv16 = env->NewVideoFrame(vi_yv16, memalign);
-    const int yv16_pitch_uv = yv16->GetPitch(PLANAR_U);
-    uint8_t* yv16pu = yv16->GetWritePtr(PLANAR_U);
-    uint8_t* yv16pv = yv16->GetWritePtr(PLANAR_V);
-
-    omp_set_num_threads(num_threads);
-
-    #pragma omp parallel sections
-    {
-        #pragma omp section
-        {
-            if (lshift) {
-                proc_chroma_qpel_shift_h(width_uv, src_height_uv, srcpu, buffu,
-                                         src_pitch_u, buff_pitch);
-                srcpu = buffu;
-                src_pitch_u = buff_pitch;
-            }
-            proc_chroma(width_uv, src_height_uv, srcpu, yv16pu, src_pitch_u,
-                        yv16_pitch_uv, cubic_coefficients);
-        }
+    PVideoFrame dst = env->NewVideoFrame(vi, memalign);
 
-        #pragma omp section
-        {
-            if (lshift) {
-                proc_chroma_qpel_shift_h(width_uv, src_height_uv, srcpv, buffv,
-                                         src_pitch_v, buff_pitch);
-                srcpv = buffv;
-                src_pitch_v = buff_pitch;
-            }
-            proc_chroma(width_uv, src_height_uv, srcpv, yv16pv,
-                        src_pitch_v * dvpal, yv16_pitch_uv * dvpal, cubic_coefficients);
-        }
+    yv12to422_src_t s;
+    yv12to422_dst_t d;
+    int planes[] = { PLANAR_Y, PLANAR_U, PLANAR_V };
+    for (int i = 0; i < 3; ++i) {
+        s.data[i] = yuy2_src ? src->GetReadPtr() : src->GetReadPtr(planes[i]);
+        s.pitch[i] = yuy2_src ? src->GetPitch() : src->GetPitch(planes[i]);
+        d.data[i] = vi.IsYUY2() ? dst->GetWritePtr() : dst->GetWritePtr(planes[i]);
+        d.pitch[i] = vi.IsYUY2() ? dst->GetPitch() : dst->GetPitch(planes[i]);
     }
-
-    if (lshift) {
-        _mm_free((void*)buffu);
+    if (vi.IsRGB()) {
+        // rgb frames of avisynth are bottom up.
+        d.pitch[0] = -dst->GetPitch();
+        d.data[0] = dst->GetWritePtr() + (ptrdiff_t)dst->GetPitch() * (vi.height - 1);
     }
 
-    if (!yuy2out) {
-        env->BitBlt(yv16->GetWritePtr(PLANAR_Y), yv16->GetPitch(PLANAR_Y),
-                    srcpy, src_pitch_y, vi.width, vi.height);
-        return yv16;
+    void* scratch = nullptr;
+    size_t scratch_size = yv12to422_scratch_size(&engine);
+    if (scratch_size > 0) {
+        scratch = _mm_malloc(scratch_size, memalign);
+        if (!scratch) {
+            env->ThrowError("YV12To422: failed to allocate scratch buffer.\n");
+        }
     }
 
-    PVideoFrame dst = env->NewVideoFrame(vi, memalign);
+    int err = yv12to422_convert(&engine, &s, &d, scratch);
 
-    yv16toyuy2(vi.width, vi.height, srcpy, yv16pu, yv16pv, dst->GetWritePtr(),
-               src_pitch_y, yv16_pitch_uv, dst->GetPitch());
+    if (scratch) {
+        _mm_free(scratch);
+    }
+    if (err != YV12TO422_OK) {
+        env->ThrowError("YV12To422: %s\n", yv12to422_strerror(err));
+    }
 
     return dst;
 }
 
-extern int has_avx2();
+// 0 to 2: limited range of YV12TO422_MATRIX_*, 3 to 5: full range.
+static int get_matrix(const char* name, IScriptEnvironment* env)
+{
+    // the names of ConvertToRGB.
+    const char* matrix_names[] = {
+        "Rec601", "Rec709", "Rec2020", "PC.601", "PC.709", "PC.2020",
+    };
+    for (int i = 0; i < 6; ++i) {
+        if (_stricmp(name, matrix_names[i]) == 0) {
+            return i;
+        }
+    }
+    env->ThrowError("YV12To422: unknown matrix \"%s\".\n", name);
+    return -1;
+}
+
 
 static AVSValue __cdecl
 create_yv12to422(AVSValue args, void* user_data, IScriptEnvironment* env)
 {
     PClip clip = args[0].AsClip();
     const VideoInfo& vi = clip->GetVideoInfo();
-    if (!vi.IsYV12()) {
-        env->ThrowError("YV12To422: input must be YV12.\n");
+    if (!vi.IsYV12() && !vi.IsYV411() && !vi.IsYUY2()) {
+        env->ThrowError("YV12To422: input must be YV12, YV411 or YUY2.\n");
     }
 
     if (vi.height % 4 > 0) {
@@ -271,21 +215,164 @@ create_yv12to422(AVSValue args, void* user_data, IScriptEnvironment* env)
         env->ThrowError("YV12To422: cplace must be set to 0, 1, 2, or 3.");
     }
 
-    bool avx2 = false;
-    if (args[7].AsBool(false) && has_avx2()) {
-        avx2 = true;
+    int simd = YV12TO422_SIMD_SSE2;
+    if (args[10].AsBool(false) && yv12to422_has_avx512()) {
+        simd = YV12TO422_SIMD_AVX512;
+    } else if (args[7].AsBool(false) && yv12to422_has_avx2()) {
+        simd = YV12TO422_SIMD_AVX2;
+    }
+
+    int rgb = args[11].AsInt(0);
+    if (rgb != 0 && rgb != 24 && rgb != 32) {
+        env->ThrowError("YV12To422: rgb must be set to 0, 24 or 32.\n");
+    }
+
+    // yuy2 is only unpacked to yv16.
+    bool yuy2 = args[5].AsBool(!vi.IsYUY2());
+    if (vi.IsYUY2() && (yuy2 || rgb > 0)) {
+        env->ThrowError("YV12To422: YUY2 input is converted only to YV16.\n");
+    }
+
+    const char* matrix_name = args[12].AsString("Rec601");
+    int matrix = get_matrix(matrix_name, env);
+    // the yuv output is converted to out_matrix.
+    int out_matrix = get_matrix(args[13].AsString(matrix_name), env);
+    if (out_matrix != matrix && rgb > 0) {
+        env->ThrowError("YV12To422: out_matrix is not for rgb output.\n");
     }
 
     return new YV12To422(clip, itype, interlaced, cplace, args[8].AsFloat(0.0),
-                         args[9].AsFloat(0.75), args[5].AsBool(true), avx2,
+                         args[9].AsFloat(0.75), yuy2, simd,
                          args[4].AsBool(false), args[6].AsBool(false) ? 2 : 1,
-                         env);
+                         rgb, matrix % 3, matrix >= 3, out_matrix % 3,
+                         out_matrix >= 3, env);
 }
 
 
-static const AVS_Linkage* AVS_linkage = nullptr;
+class YV422To12 : public GenericVideoFilter
+{
+    VideoInfo vi_src;
+    int memalign;
+    yv422to12_t engine;
 
-extern "C" __declspec(dllexport) const char* __stdcall
+public:
+    YV422To12(PClip child, int itype, bool interlaced, int cplace, double b,
+              double c, int simd, IScriptEnvironment* env);
+    ~YV422To12() {};
+    PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env);
+};
+
+
+YV422To12::
+YV422To12(PClip _child, int itype, bool interlaced, int cplace, double b,
+          double c, int simd, IScriptEnvironment* env)
+  : GenericVideoFilter(_child)
+{
+    yv12to422_params_t params;
+    yv12to422_default_params(&params, vi.width, vi.height);
+    params.interlaced = interlaced;
+    params.itype = itype;
+    params.cplace = cplace;
+    params.b = b;
+    params.c = c;
+    // the 4:2:2 source.
+    params.output = vi.IsYUY2() ? YV12TO422_OUTPUT_YUY2 : YV12TO422_OUTPUT_YV16;
+    params.simd = simd;
+
+    int err = yv422to12_init(&engine, &params);
+    if (err != YV12TO422_OK) {
+        env->ThrowError("YV422To12: %s\n", yv12to422_strerror(err));
+    }
+    memalign = yv422to12_memalign(&engine);
+
+    memcpy(&vi_src, &vi, sizeof(VideoInfo));
+    vi.pixel_type = VideoInfo::CS_YV12;
+}
+
+
+PVideoFrame __stdcall YV422To12::
+GetFrame(int n, IScriptEnvironment* env)
+{
+    PVideoFrame src = child->GetFrame(n, env);
+    const bool yuy2 = vi_src.IsYUY2();
+    int planes[] = { PLANAR_Y, PLANAR_U, PLANAR_V };
+
+    // check for crop left
+    uintptr_t addr = (uintptr_t)src->GetReadPtr() | src->GetPitch();
+    if (!yuy2) {
+        addr |= (uintptr_t)src->GetReadPtr(PLANAR_U) |
+                (uintptr_t)src->GetReadPtr(PLANAR_V) | src->GetPitch(PLANAR_U);
+    }
+    if (addr & (memalign - 1)) {
+        PVideoFrame alt = env->NewVideoFrame(vi_src, memalign);
+        for (int i = 0; i < (yuy2 ? 1 : 3); ++i) {
+            int p = yuy2 ? 0 : planes[i];
+            env->BitBlt(alt->GetWritePtr(p), alt->GetPitch(p),
+                src->GetReadPtr(p), src->GetPitch(p),
+                src->GetRowSize(p), src->GetHeight(p));
+        }
+        src = alt;
+    }
+
+    PVideoFrame dst = env->NewVideoFrame(vi, memalign);
+
+    yv12to422_src_t s;
+    yv12to422_dst_t d;
+    for (int i = 0; i < 3; ++i) {
+        s.data[i] = yuy2 ? src->GetReadPtr() : src->GetReadPtr(planes[i]);
+        s.pitch[i] = yuy2 ? src->GetPitch() : src->GetPitch(planes[i]);
+        d.data[i] = dst->GetWritePtr(planes[i]);
+        d.pitch[i] = dst->GetPitch(planes[i]);
+    }
+
+    int err = yv422to12_convert(&engine, &s, &d);
+    if (err != YV12TO422_OK) {
+        env->ThrowError("YV422To12: %s\n", yv12to422_strerror(err));
+    }
+
+    return dst;
+}
+
+
+static AVSValue __cdecl
+create_yv422to12(AVSValue args, void* user_data, IScriptEnvironment* env)
+{
+    PClip clip = args[0].AsClip();
+    const VideoInfo& vi = clip->GetVideoInfo();
+    if (!vi.IsYV16() && !vi.IsYUY2()) {
+        env->ThrowError("YV422To12: input must be YV16 or YUY2.\n");
+    }
+    if (vi.height % 4 > 0 || vi.height < 16) {
+        env->ThrowError("YV422To12: height must be mod 4 and 16 or more.\n");
+    }
+
+    bool interlaced = args[1].AsBool(false);
+
+    int itype = args[2].AsInt(1);
+    if (itype < 0 || itype > 2) {
+        env->ThrowError("YV422To12: itype must be set to 0, 1, or 2.\n");
+    }
+
+    int cplace = args[3].AsInt(interlaced ? 2 : 1);
+    if (cplace < 0 || cplace > 3) {
+        env->ThrowError("YV422To12: cplace must be set to 0, 1, 2, or 3.\n");
+    }
+
+    int simd = YV12TO422_SIMD_SSE2;
+    if (args[7].AsBool(false) && yv12to422_has_avx512()) {
+        simd = YV12TO422_SIMD_AVX512;
+    } else if (args[4].AsBool(false) && yv12to422_has_avx2()) {
+        simd = YV12TO422_SIMD_AVX2;
+    }
+
+    return new YV422To12(clip, itype, interlaced, cplace, args[5].AsFloat(0.0),
+                         args[6].AsFloat(0.75), simd, env);
+}
+
+
+const AVS_Linkage* AVS_linkage = nullptr;
+
+extern "C" YV12TO422_EXPORT const char* __stdcall
 AvisynthPluginInit3(IScriptEnvironment* env, const AVS_Linkage* const vectors)
 {
     AVS_linkage = vectors;
@@ -299,8 +386,23 @@ AvisynthPluginInit3(IScriptEnvironment* env, const AVS_Linkage* const vectors)
                      /* 6*/ "[threads]b"
                      /* 7*/ "[avx2]b"
                      /* 8*/ "[b]f"
-                     /* 9*/ "[c]f",
+                     /* 9*/ "[c]f"
+                     /*10*/ "[avx512]b"
+                     /*11*/ "[rgb]i"
+                     /*12*/ "[matrix]s"
+                     /*13*/ "[out_matrix]s",
 
                      create_yv12to422, nullptr);
+    env->AddFunction("YV422To12",
+                     /* 0*/ "c"
+                     /* 1*/ "[interlaced]b"
+                     /* 2*/ "[itype]i"
+                     /* 3*/ "[cplace]i"
+                     /* 4*/ "[avx2]b"
+                     /* 5*/ "[b]f"
+                     /* 6*/ "[c]f"
+                     /* 7*/ "[avx512]b",
+
+                     create_yv422to12, nullptr);
     return "YV12To422 ver." YV12TO422_VERSION " by OKA Motofumi";
 }
@@ -0,0 +1,141 @@
+/*
+  yv12to422_async.hpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+
+/*
+  C++ interface of libyv12to422_async.h.
+
+      yv12to422_async_engine engine;
+
+      std::future<int> f = engine.submit(job);      // job.callback is not used
+      int status = f.get();
+
+      // C++20 coroutines: resumes on the worker thread that converted it.
+      int status = co_await engine.convert(job);
+
+  A full queue gives YV12TO422_ERR_BUSY at once instead of blocking.
+*/
+
+
+#ifndef YV12TO422_ASYNC_HPP
+#define YV12TO422_ASYNC_HPP
+
+#include <future>
+#include <memory>
+#include <new>
+
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+#include <coroutine>
+#define YV12TO422_HAS_COROUTINES 1
+#endif
+
+#include "libyv12to422_async.h"
+
+
+class yv12to422_async_engine {
+    yv12to422_async_t* async;
+
+public:
+    explicit yv12to422_async_engine(int threads = 0, int capacity = 256) :
+        async(yv12to422_async_create(threads, capacity))
+    {
+        if (!async) {
+            throw std::bad_alloc();
+        }
+    }
+    ~yv12to422_async_engine()
+    {
+        yv12to422_async_destroy(async);
+    }
+    yv12to422_async_engine(const yv12to422_async_engine&) = delete;
+    yv12to422_async_engine& operator=(const yv12to422_async_engine&) = delete;
+
+    yv12to422_async_t* handle() const
+    {
+        return async;
+    }
+
+    std::future<int> submit(yv12to422_job_t job)
+    {
+        std::unique_ptr<std::promise<int>> p(new std::promise<int>());
+        std::future<int> f = p->get_future();
+        job.callback = [](void* arg, uint64_t, int status) {
+            std::unique_ptr<std::promise<int>> done(static_cast<std::promise<int>*>(arg));
+            done->set_value(status);
+        };
+        job.arg = p.get();
+        if (yv12to422_async_submit(async, &job, 1) == 1) {
+            p.release();
+        } else {
+            p->set_value(YV12TO422_ERR_BUSY);
+        }
+        return f;
+    }
+
+#ifdef YV12TO422_HAS_COROUTINES
+    class awaitable {
+        yv12to422_async_t* async;
+        yv12to422_job_t job;
+        std::coroutine_handle<> waiter;
+        int status;
+
+    public:
+        awaitable(yv12to422_async_t* a, const yv12to422_job_t& j) :
+            async(a), job(j), status(YV12TO422_OK) {}
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> h)
+        {
+            waiter = h;
+            job.callback = [](void* arg, uint64_t, int s) {
+                auto self = static_cast<awaitable*>(arg);
+                self->status = s;
+                self->waiter.resume();
+            };
+            job.arg = this;
+            if (yv12to422_async_submit(async, &job, 1) == 1) {
+                return true;    // this may be resumed already. do not touch it.
+            }
+            status = YV12TO422_ERR_BUSY;
+            return false;
+        }
+
+        int await_resume() const noexcept
+        {
+            return status;
+        }
+    };
+
+    awaitable convert(const yv12to422_job_t& job)
+    {
+        return awaitable(async, job);
+    }
+#endif
+};
+
+#endif
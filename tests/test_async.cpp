@@ -0,0 +1,275 @@
+/*
+  test_async.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+/*
+  The worker pool of libyv12to422_async.h against yv12to422_convert() of
+  the same frames: jobs of two engines in one pool, with the scratch area
+  of the job or of the worker, completions through callbacks and through
+  the queue (poll, wait and the eventfd), a full queue, the jobs still
+  queued at destroy, and the futures of yv12to422_async.hpp.
+*/
+
+
+#include <atomic>
+#include <set>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include "test_common.h"
+#include "yv12to422_async.hpp"
+
+
+static const int WIDTH = 180;
+static const int HEIGHT = 36;
+static const int FRAMES = 24;
+
+
+// the frames of one engine, and their output by yv12to422_convert().
+struct work {
+    yv12to422_params_t p;
+    yv12to422_t ctx;
+    test::frames src;
+    test::frames dst;
+    std::vector<test::image> expected;
+    test::scratch scratch;
+
+    work(int output, int bits, int lshift) :
+        p(params(output, bits, lshift)), ctx(engine(p)),
+        src(test::source_planes(p), FRAMES, WIDTH, 0, false),
+        dst(test::output_planes(p), FRAMES, WIDTH, 0, false),
+        scratch(scratch_step() * FRAMES)
+    {
+        test::xorshift rng(output * 7 + bits + lshift);
+        test::frames ref(test::output_planes(p), 1, WIDTH, 0, false);
+        for (int k = 0; k < FRAMES; ++k) {
+            src.load(k, test::random_image(test::source_planes(p), bits, rng));
+            test::frames one(test::source_planes(p), 1, WIDTH, 0, false);
+            one.load(0, src.store(k));
+            TEST_CHECK(test::run(ctx, test::RUN_CONVERT, one, ref) == YV12TO422_OK,
+                       "reference of output %d", output);
+            expected.push_back(ref.store(0));
+        }
+    }
+
+    static yv12to422_params_t params(int output, int bits, int lshift)
+    {
+        yv12to422_params_t p;
+        yv12to422_default_params(&p, WIDTH, HEIGHT);
+        p.output = output;
+        p.bits = bits;
+        p.lshift = lshift;
+        return p;
+    }
+
+    static yv12to422_t engine(const yv12to422_params_t& p)
+    {
+        yv12to422_t ctx;
+        const int ret = yv12to422_init(&ctx, &p);
+        TEST_CHECK(ret == YV12TO422_OK, "init: %s", yv12to422_strerror(ret));
+        return ctx;
+    }
+
+    size_t scratch_step() const
+    {
+        return (yv12to422_scratch_size(&ctx) + 63) / 64 * 64;
+    }
+
+    // frame k, with its own part of the scratch area or that of the worker.
+    yv12to422_job_t job(int k, bool own_scratch) const
+    {
+        yv12to422_job_t j = {};
+        j.ctx = &ctx;
+        j.src = src.src(k);
+        j.dst = dst.dst(k);
+        j.scratch = own_scratch ?
+                    (uint8_t*)scratch.get() + scratch_step() * k : nullptr;
+        j.user = k;
+        return j;
+    }
+
+    void check(const char* name) const
+    {
+        for (int k = 0; k < FRAMES; ++k) {
+            TEST_CHECK(dst.store(k) == expected[k], "%s: frame %d of output %d", name, k,
+                       p.output);
+        }
+    }
+};
+
+
+struct callbacks {
+    std::atomic<int> count;
+    std::atomic<int> failed;
+    callbacks() : count(0), failed(0) {}
+};
+
+static void on_done(void* arg, uint64_t, int status)
+{
+    auto c = static_cast<callbacks*>(arg);
+    if (status != YV12TO422_OK) {
+        c->failed.fetch_add(1);
+    }
+    c->count.fetch_add(1);
+}
+
+
+// every job of both engines through a pool of 4 workers and 8 queue
+// entries. the odd frames complete through a callback, the even ones
+// through the queue. the jobs of the second engine are numbered after
+// those of the first.
+static void test_pool(work& a, work& b)
+{
+    yv12to422_async_t* async = yv12to422_async_create(4, 8);
+    TEST_CHECK(async, "create");
+    if (!async) {
+        return;
+    }
+    callbacks cb;
+    std::vector<yv12to422_job_t> jobs;
+    for (int k = 0; k < FRAMES * 2; ++k) {
+        yv12to422_job_t j = (k < FRAMES ? a : b).job(k % FRAMES, k % 3 == 0);
+        j.user = k;
+        if (k % 2 == 1) {
+            j.callback = on_done;
+            j.arg = &cb;
+        }
+        jobs.push_back(j);
+    }
+
+    // the queue is drained while the rest of the jobs wait for room.
+    std::set<uint64_t> done;
+    size_t submitted = 0;
+    while (submitted < jobs.size() || done.size() < (size_t)FRAMES) {
+        yv12to422_completion_t c[8];
+        int n;
+        if (submitted < jobs.size()) {
+            submitted += yv12to422_async_submit(async, &jobs[submitted],
+                                                (int)(jobs.size() - submitted));
+            n = yv12to422_async_wait(async, c, 8, 1, 1);
+        } else {
+            n = yv12to422_async_wait(async, c, 8, 1, 10000);
+            TEST_CHECK(n > 0, "wait: %d of %d jobs completed", (int)done.size(), FRAMES);
+            if (n == 0) {
+                break;
+            }
+        }
+        for (int i = 0; i < n; ++i) {
+            TEST_CHECK(c[i].status == YV12TO422_OK, "job %d: %s", (int)c[i].user,
+                       yv12to422_strerror(c[i].status));
+            TEST_CHECK(c[i].user % 2 == 0 && done.insert(c[i].user).second,
+                       "job %d completed twice or through the queue", (int)c[i].user);
+        }
+    }
+    yv12to422_completion_t c;
+    TEST_CHECK(yv12to422_async_poll(async, &c, 1) == 0, "poll: completion of no job");
+    // the callbacks of the last jobs may still be running.
+    yv12to422_async_destroy(async);
+    TEST_CHECK(cb.count == FRAMES && cb.failed == 0, "callbacks: %d, %d failed",
+               cb.count.load(), cb.failed.load());
+    a.check("pool");
+    b.check("pool");
+}
+
+
+// a full queue takes no more jobs, and destroy converts the queued ones.
+static void test_capacity(work& a)
+{
+    yv12to422_async_t* async = yv12to422_async_create(1, 1);
+    TEST_CHECK(async, "create");
+    if (!async) {
+        return;
+    }
+    callbacks cb;
+    std::vector<yv12to422_job_t> jobs;
+    for (int k = 0; k < FRAMES; ++k) {
+        jobs.push_back(a.job(k, false));
+        jobs.back().callback = on_done;
+        jobs.back().arg = &cb;
+    }
+    TEST_CHECK(yv12to422_async_submit(async, jobs.data(), FRAMES) == 1,
+               "submit: more jobs than the capacity are queued");
+    size_t submitted = 1;
+    while (submitted < jobs.size()) {
+        submitted += yv12to422_async_submit(async, &jobs[submitted], 1);
+    }
+    yv12to422_async_destroy(async);
+    TEST_CHECK(cb.count == FRAMES && cb.failed == 0, "destroy: %d of %d jobs, %d failed",
+               cb.count.load(), FRAMES, cb.failed.load());
+    a.check("capacity");
+}
+
+
+#if defined(__linux__)
+// the eventfd is readable once a completion is queued.
+static void test_event_fd(work& a)
+{
+    yv12to422_async_t* async = yv12to422_async_create(2, 4);
+    const int fd = async ? yv12to422_async_fd(async) : -1;
+    TEST_CHECK(fd >= 0, "eventfd");
+    if (fd >= 0) {
+        const yv12to422_job_t j = a.job(0, false);
+        TEST_CHECK(yv12to422_async_submit(async, &j, 1) == 1, "submit");
+        struct pollfd pfd = {fd, POLLIN, 0};
+        TEST_CHECK(poll(&pfd, 1, 10000) == 1, "eventfd: not readable");
+        uint64_t value;
+        TEST_CHECK(read(fd, &value, sizeof(value)) == sizeof(value), "eventfd: read");
+        yv12to422_completion_t c;
+        TEST_CHECK(yv12to422_async_poll(async, &c, 1) == 1 && c.status == YV12TO422_OK,
+                   "eventfd: no completion");
+    }
+    yv12to422_async_destroy(async);
+}
+#endif
+
+
+// std::future of yv12to422_async_engine.
+static void test_futures(work& a)
+{
+    yv12to422_async_engine engine(2, FRAMES);
+    std::vector<std::future<int>> results;
+    for (int k = 0; k < FRAMES; ++k) {
+        results.push_back(engine.submit(a.job(k, k % 2 == 0)));
+    }
+    for (auto& f : results) {
+        TEST_CHECK(f.get() == YV12TO422_OK, "future");
+    }
+    a.check("futures");
+}
+
+
+int main()
+{
+    work yuy2(YV12TO422_OUTPUT_YUY2, 8, 0);
+    work yv16(YV12TO422_OUTPUT_YV16, 10, 1);
+    test_pool(yuy2, yv16);
+    test_capacity(yv16);
+#if defined(__linux__)
+    test_event_fd(yuy2);
+#endif
+    test_futures(yuy2);
+    return test::finish("async");
+}
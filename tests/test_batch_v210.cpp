@@ -0,0 +1,97 @@
+/*
+  test_batch_v210.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+/*
+  yv12to422_convert_batch() to V210 of frames whose source planes lie side
+  by side by yv12to422_batch_step(), 10bit sources and 8bit ones widened
+  by output_bits, against yv12to422_convert() of each frame.
+*/
+
+
+#include "test_common.h"
+
+
+static void test_batch(int width, int height, int bits, int simd, bool unaligned)
+{
+    yv12to422_params_t p;
+    yv12to422_default_params(&p, width, height);
+    p.output = YV12TO422_OUTPUT_V210;
+    p.bits = bits;
+    p.output_bits = bits == 8 ? 10 : 0;
+    p.simd = simd;
+    p.unaligned = unaligned;
+
+    yv12to422_params_t rp = p;
+    rp.simd = YV12TO422_SIMD_SSE2;
+    rp.unaligned = 0;
+    yv12to422_t ctx, ref;
+    if (yv12to422_init(&ctx, &p) != YV12TO422_OK || yv12to422_init(&ref, &rp) != YV12TO422_OK) {
+        // too narrow for unaligned rows
+        return;
+    }
+
+    const int count = 3;
+    test::xorshift rng(width * 31 + height + bits);
+    test::frames src(test::source_planes(p), count, width, yv12to422_batch_step(&ctx),
+                     unaligned);
+    test::frames ref_src(test::source_planes(p), count, width, 0, false);
+    test::frames dst(test::output_planes(p), count, width, 0, unaligned);
+    test::frames ref_dst(test::output_planes(p), count, width, 0, false);
+    for (int k = 0; k < count; ++k) {
+        const test::image img = test::random_image(test::source_planes(p), bits, rng);
+        src.load(k, img);
+        ref_src.load(k, img);
+    }
+
+    int ret = test::run(ref, test::RUN_CONVERT, ref_src, ref_dst);
+    TEST_CHECK(ret == YV12TO422_OK, "reference %dx%d bits %d: %s", width, height, bits,
+               yv12to422_strerror(ret));
+    ret = test::run(ctx, test::RUN_BATCH, src, dst);
+    TEST_CHECK(ret == YV12TO422_OK, "batch %dx%d bits %d simd %d unaligned %d: %s",
+               width, height, bits, simd, unaligned, yv12to422_strerror(ret));
+    for (int k = 0; k < count && ret == YV12TO422_OK; ++k) {
+        TEST_CHECK(dst.store(k) == ref_dst.store(k),
+                   "batch %dx%d bits %d simd %d unaligned %d: frame %d differs",
+                   width, height, bits, simd, unaligned, k);
+    }
+}
+
+
+int main()
+{
+    const int sizes[][2] = {{64, 16}, {180, 36}, {352, 64}, {96, 20}};
+    for (const auto& size : sizes) {
+        for (int bits = 8; bits <= 10; bits += 2) {
+            for (int simd = YV12TO422_SIMD_SSE2; simd <= YV12TO422_SIMD_AVX512; ++simd) {
+                if ((simd == YV12TO422_SIMD_AVX2 && !yv12to422_has_avx2()) ||
+                    (simd == YV12TO422_SIMD_AVX512 && !yv12to422_has_avx512())) {
+                    continue;
+                }
+                test_batch(size[0], size[1], bits, simd, false);
+                test_batch(size[0], size[1], bits, simd, true);
+            }
+        }
+    }
+    return test::finish("batch_v210");
+}
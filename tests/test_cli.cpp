@@ -0,0 +1,350 @@
+/*
+  test_cli.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+/*
+  The command line converter run as a process on y4m and raw files of
+  random frames: the stream mode against yv12to422_convert() of the same
+  frames, and the batch modes against the stream mode, byte for byte.
+  usage: test_cli <yv12to422 binary> <directory for the files>
+*/
+
+
+#include <string>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "test_common.h"
+
+
+static std::string cli;
+static std::string dir;
+
+static const int WIDTH = 96;
+static const int HEIGHT = 48;
+static const int FRAMES = 5;
+
+
+// the exit status of the converter with args.
+static int run_cli(const std::string& args)
+{
+    const int ret = std::system((cli + " " + args).c_str());
+    return WIFEXITED(ret) ? WEXITSTATUS(ret) : -1;
+}
+
+static std::string path(const char* name)
+{
+    return dir + "/" + name;
+}
+
+static std::vector<uint8_t> read_file(const std::string& name)
+{
+    std::vector<uint8_t> bytes;
+    FILE* fp = std::fopen(name.c_str(), "rb");
+    if (!fp) {
+        return bytes;
+    }
+    uint8_t buff[65536];
+    size_t n;
+    while ((n = std::fread(buff, 1, sizeof(buff), fp)) > 0) {
+        bytes.insert(bytes.end(), buff, buff + n);
+    }
+    std::fclose(fp);
+    return bytes;
+}
+
+static void write_file(const std::string& name, const std::vector<uint8_t>& bytes)
+{
+    FILE* fp = std::fopen(name.c_str(), "wb");
+    TEST_CHECK(fp && std::fwrite(bytes.data(), 1, bytes.size(), fp) == bytes.size(),
+               "failed to write %s", name.c_str());
+    if (fp) {
+        std::fclose(fp);
+    }
+}
+
+static void append(std::vector<uint8_t>& bytes, const std::string& s)
+{
+    bytes.insert(bytes.end(), s.begin(), s.end());
+}
+
+// the header line of a y4m file, and the frames after it.
+static std::string header_of(const std::vector<uint8_t>& y4m)
+{
+    const std::string s(y4m.begin(), y4m.end());
+    return s.substr(0, s.find('\n'));
+}
+
+static std::vector<uint8_t> frames_of(const std::vector<uint8_t>& y4m)
+{
+    const std::string s(y4m.begin(), y4m.end());
+    const size_t end = s.find('\n');
+    return end == std::string::npos ? std::vector<uint8_t>() :
+           std::vector<uint8_t>(y4m.begin() + end + 1, y4m.end());
+}
+
+// the frames of frame_size bytes of a y4m file without the FRAME lines,
+// as in a raw file.
+static std::vector<uint8_t> raw_of(const std::vector<uint8_t>& y4m, size_t frame_size)
+{
+    const std::vector<uint8_t> frames = frames_of(y4m);
+    const size_t line = 6;  // "FRAME\n"
+    std::vector<uint8_t> raw;
+    for (size_t pos = 0; pos + line + frame_size <= frames.size(); pos += line + frame_size) {
+        raw.insert(raw.end(), frames.begin() + pos + line,
+                   frames.begin() + pos + line + frame_size);
+    }
+    return raw;
+}
+
+
+// FRAMES random yv12 frames of WIDTH x HEIGHT, progressive.
+static std::vector<test::image> source_frames()
+{
+    yv12to422_params_t p;
+    yv12to422_default_params(&p, WIDTH, HEIGHT);
+    test::xorshift rng(29);
+    std::vector<test::image> frames;
+    for (int k = 0; k < FRAMES; ++k) {
+        frames.push_back(test::random_image(test::source_planes(p), 8, rng));
+    }
+    return frames;
+}
+
+static std::vector<uint8_t> y4m_of(const std::vector<test::image>& frames, const char* chroma)
+{
+    std::vector<uint8_t> y4m;
+    append(y4m, "YUV4MPEG2 W" + std::to_string(WIDTH) + " H" + std::to_string(HEIGHT) +
+                " F30000:1001 Ip A1:1 " + chroma + "\n");
+    for (const auto& f : frames) {
+        append(y4m, "FRAME\n");
+        for (const auto& plane : f) {
+            y4m.insert(y4m.end(), plane.begin(), plane.end());
+        }
+    }
+    return y4m;
+}
+
+// the y4m frames of yv12to422_convert() of frames with p.
+static std::vector<uint8_t> converted(const std::vector<test::image>& frames,
+                                      const yv12to422_params_t& p)
+{
+    yv12to422_t ctx;
+    const int ret = yv12to422_init(&ctx, &p);
+    TEST_CHECK(ret == YV12TO422_OK, "init: %s", yv12to422_strerror(ret));
+    std::vector<uint8_t> out;
+    for (const auto& f : frames) {
+        test::frames s(test::source_planes(p), 1, p.width, 0, false);
+        test::frames d(test::output_planes(p), 1, p.width, 0, false);
+        s.load(0, f);
+        TEST_CHECK(test::run(ctx, test::RUN_CONVERT, s, d) == YV12TO422_OK, "convert");
+        append(out, "FRAME\n");
+        for (const auto& plane : d.store(0)) {
+            out.insert(out.end(), plane.begin(), plane.end());
+        }
+    }
+    return out;
+}
+
+static yv12to422_params_t cli_params(int output)
+{
+    yv12to422_params_t p;
+    yv12to422_default_params(&p, WIDTH, HEIGHT);
+    p.output = output;
+    return p;
+}
+
+
+// yv12to422 [options] input output, and from stdin to stdout.
+static void test_stream(const std::vector<test::image>& frames)
+{
+    const std::string in = path("stream.y4m");
+    write_file(in, y4m_of(frames, "C420jpeg"));
+
+    TEST_CHECK(run_cli(in + " " + path("stream_422.y4m")) == 0, "stream: exit status");
+    const std::vector<uint8_t> yv16 = read_file(path("stream_422.y4m"));
+    TEST_CHECK(header_of(yv16).find(" C422 ") != std::string::npos &&
+               header_of(yv16).find("XYSCSS=422") != std::string::npos,
+               "stream: header %s", header_of(yv16).c_str());
+    TEST_CHECK(frames_of(yv16) == converted(frames, cli_params(YV12TO422_OUTPUT_YV16)),
+               "stream: yv16 frames");
+
+    TEST_CHECK(run_cli("< " + in + " > " + path("stream_pipe.y4m")) == 0,
+               "stream: exit status of stdin to stdout");
+    TEST_CHECK(read_file(path("stream_pipe.y4m")) == yv16, "stream: stdin to stdout");
+
+    TEST_CHECK(run_cli("--yuy2 " + in + " " + path("stream_yuy2.y4m")) == 0,
+               "stream: exit status of --yuy2");
+    const std::vector<uint8_t> yuy2 = read_file(path("stream_yuy2.y4m"));
+    TEST_CHECK(header_of(yuy2).find("XPACKED=YUY2") != std::string::npos,
+               "stream: header %s", header_of(yuy2).c_str());
+    TEST_CHECK(frames_of(yuy2) == converted(frames, cli_params(YV12TO422_OUTPUT_YUY2)),
+               "stream: yuy2 frames");
+
+    // the same field placement as the avisynth filter's interlaced=true.
+    TEST_CHECK(run_cli("--interlaced 1 --itype 1 " + in + " " + path("stream_i.y4m")) == 0,
+               "stream: exit status of --interlaced 1");
+    yv12to422_params_t p = cli_params(YV12TO422_OUTPUT_YV16);
+    p.interlaced = 1;
+    p.cplace = 2;
+    p.itype = 1;
+    TEST_CHECK(frames_of(read_file(path("stream_i.y4m"))) == converted(frames, p),
+               "stream: interlaced frames");
+
+    write_file(path("stream_444.y4m"), y4m_of(frames, "C444"));
+    TEST_CHECK(run_cli(path("stream_444.y4m") + " " + path("stream_444_out.y4m") +
+                       " 2> /dev/null") != 0, "stream: 4:4:4 input is not rejected");
+}
+
+
+// the output of the stream mode with options, which the other modes must
+// write byte for byte.
+static std::vector<uint8_t> stream_output(const std::string& options, const std::string& in)
+{
+    const std::string out = path("reference.y4m");
+    TEST_CHECK(run_cli(options + " " + in + " " + out) == 0,
+               "stream: exit status of %s", options.c_str());
+    return read_file(out);
+}
+
+// --batch with options of the y4m file batch.y4m and the raw file
+// batch_raw.yuv into a directory of its own.
+static void check_batch(const std::string& options, const std::string& name)
+{
+    const size_t out_frame = (size_t)WIDTH * HEIGHT * 2;
+    for (const char* output : {"", " --yuy2"}) {
+        const std::vector<uint8_t> ref = stream_output(output, path("batch.y4m"));
+        const std::string out = path(name.c_str()) + (*output ? "_yuy2" : "");
+        mkdir(out.c_str(), 0755);
+        TEST_CHECK(run_cli("--batch " + options + output + " --size " + std::to_string(WIDTH) +
+                           "x" + std::to_string(HEIGHT) + " -o " + out + " " +
+                           path("batch.y4m") + " " + path("batch_raw.yuv")) == 0,
+                   "%s%s: exit status", name.c_str(), output);
+        TEST_CHECK(read_file(out + "/batch_422.y4m") == ref, "%s%s: y4m output",
+                   name.c_str(), output);
+        TEST_CHECK(read_file(out + "/batch_raw_422.yuv") == raw_of(ref, out_frame),
+                   "%s%s: raw output", name.c_str(), output);
+    }
+}
+
+// --batch through mmap, to a directory and to stdout (a file and a pipe).
+static void test_batch(const std::vector<test::image>& frames)
+{
+    const std::vector<uint8_t> y4m = y4m_of(frames, "C420jpeg");
+    write_file(path("batch.y4m"), y4m);
+    write_file(path("batch_raw.yuv"), raw_of(y4m, (size_t)WIDTH * HEIGHT * 3 / 2));
+
+    check_batch("", "batch_mmap");
+
+    const std::vector<uint8_t> ref = stream_output("", path("batch.y4m"));
+    TEST_CHECK(run_cli("--batch -o - " + path("batch.y4m") + " > " + path("batch_stdout.y4m")) == 0,
+               "batch: exit status to stdout");
+    TEST_CHECK(read_file(path("batch_stdout.y4m")) == ref, "batch: stdout");
+    TEST_CHECK(run_cli("--batch -o - " + path("batch.y4m") + " | cat > " + path("batch_pipe.y4m")) == 0,
+               "batch: exit status to a pipe");
+    TEST_CHECK(read_file(path("batch_pipe.y4m")) == ref, "batch: pipe");
+}
+
+// --io uring (the threads engine where io_uring is not available) and
+// --io threads, with fewer frames in flight than the file has.
+static void test_io_engines()
+{
+    check_batch("--io uring --queue-depth 3", "batch_uring");
+    check_batch("--io threads --io-threads 2 --queue-depth 2", "batch_threads");
+    TEST_CHECK(run_cli("--batch --io uring -o - " + path("batch.y4m") + " > /dev/null 2>&1") != 0,
+               "batch: --io uring to stdout is not rejected");
+}
+
+// --jobs: the frames of both files on several threads, more of them than
+// the files have frames too.
+static void test_jobs()
+{
+    check_batch("--jobs 3", "batch_jobs3");
+    check_batch("--jobs 16", "batch_jobs16");
+    TEST_CHECK(run_cli("--batch --jobs 2 --io threads -o " + path("batch_jobs3") + " " +
+                       path("batch.y4m") + " 2> /dev/null") != 0,
+               "batch: --jobs with --io threads is not rejected");
+}
+
+// --shard i/3 of each file, merged in any order of the parts, is the whole
+// file. a missing, a repeated or a foreign part is an error.
+static void test_shards()
+{
+    const std::string out = path("shards");
+    mkdir(out.c_str(), 0755);
+    for (int i = 0; i < 3; ++i) {
+        TEST_CHECK(run_cli("--batch --shard " + std::to_string(i) + "/3 --size " +
+                           std::to_string(WIDTH) + "x" + std::to_string(HEIGHT) + " -o " + out +
+                           " " + path("batch.y4m") + " " + path("batch_raw.yuv") +
+                           " 2> /dev/null") == 0,
+                   "shard %d/3: exit status", i);
+    }
+    const std::vector<uint8_t> ref = stream_output("", path("batch.y4m"));
+    auto part = [&](const char* name, int i) {
+        return " " + out + "/" + name + "_422_" + std::to_string(i) + "of3";
+    };
+    auto merge = [&](const std::string& parts, const char* merged) {
+        return run_cli("--merge -o " + path(merged) + parts + " 2> /dev/null");
+    };
+
+    TEST_CHECK(merge(part("batch", 2) + ".y4m" + part("batch", 0) + ".y4m" +
+                     part("batch", 1) + ".y4m", "merged.y4m") == 0, "merge: exit status");
+    TEST_CHECK(read_file(path("merged.y4m")) == ref, "merge: y4m output");
+    TEST_CHECK(merge(part("batch_raw", 1) + ".yuv" + part("batch_raw", 2) + ".yuv" +
+                     part("batch_raw", 0) + ".yuv", "merged.yuv") == 0,
+               "merge: exit status of raw parts");
+    TEST_CHECK(read_file(path("merged.yuv")) == raw_of(ref, (size_t)WIDTH * HEIGHT * 2),
+               "merge: raw output");
+
+    TEST_CHECK(merge(part("batch", 0) + ".y4m" + part("batch", 2) + ".y4m", "bad.y4m") != 0,
+               "merge: a missing shard is not rejected");
+    TEST_CHECK(merge(part("batch", 0) + ".y4m" + part("batch", 1) + ".y4m" +
+                     part("batch", 1) + ".y4m", "bad.y4m") != 0,
+               "merge: a repeated shard is not rejected");
+    TEST_CHECK(merge(part("batch", 0) + ".y4m" + part("batch", 1) + ".y4m" +
+                     part("batch_raw", 2) + ".yuv", "bad.y4m") != 0,
+               "merge: a raw part among y4m parts is not rejected");
+    TEST_CHECK(merge(part("batch", 0) + ".y4m " + path("reference.y4m") + part("batch", 2) +
+                     ".y4m", "bad.y4m") != 0,
+               "merge: a file without a shard is not rejected");
+}
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        std::printf("usage: test_cli <yv12to422> <directory>\n");
+        return 1;
+    }
+    cli = argv[1];
+    dir = argv[2];
+    mkdir(dir.c_str(), 0755);
+
+    const std::vector<test::image> frames = source_frames();
+    test_stream(frames);
+    test_batch(frames);
+    test_io_engines();
+    test_jobs();
+    test_shards();
+    return test::finish("cli");
+}
@@ -0,0 +1,384 @@
+/*
+  test_common.h
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+/*
+  Frames in memory laid out the ways the library takes them (one buffer
+  per plane and frame, or the frames side by side in one arena), the
+  drivers of yv12to422_convert(), _convert_batch() and the stream, and the
+  comparison of the results. Images are kept apart from the layout as
+  packed rows of bytes, so that the output of any layout can be compared
+  with that of any other.
+*/
+
+
+#ifndef YV12TO422_TEST_COMMON_H
+#define YV12TO422_TEST_COMMON_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <xmmintrin.h>
+
+#include "libyv12to422.h"
+
+
+namespace test {
+
+inline int& failures()
+{
+    static int count = 0;
+    return count;
+}
+
+#define TEST_CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            if (++test::failures() <= 20) { \
+                std::printf(__VA_ARGS__); \
+                std::printf("\n"); \
+            } \
+        } \
+    } while (0)
+
+inline int finish(const char* name)
+{
+    if (failures() > 0) {
+        std::printf("%s: %d failures\n", name, failures());
+        return 1;
+    }
+    std::printf("%s: ok\n", name);
+    return 0;
+}
+
+
+// bytes and rows of a plane.
+struct plane_size {
+    int width;
+    int height;
+};
+
+// the planes of one frame, rows of width bytes each.
+typedef std::vector<std::vector<uint8_t>> image;
+
+
+inline int sample_size(int bits)
+{
+    return bits == 32 ? 4 : bits > 8 ? 2 : 1;
+}
+
+inline bool packed_input(const yv12to422_params_t& p)
+{
+    return p.input == YV12TO422_INPUT_YUY2 || p.input == YV12TO422_INPUT_UYVY;
+}
+
+inline std::vector<plane_size> source_planes(const yv12to422_params_t& p)
+{
+    const int w = p.width * sample_size(p.bits);
+    const int h = p.height;
+    switch (p.input) {
+    case YV12TO422_INPUT_NV12:
+        return {{w, h}, {w, h / 2}};
+    case YV12TO422_INPUT_YV411:
+        return {{w, h}, {w / 4, h}, {w / 4, h}};
+    case YV12TO422_INPUT_YUY2:
+    case YV12TO422_INPUT_UYVY:
+        return {{p.width * 2, h}};
+    default:
+        return {{w, h}, {w / 2, h / 2}, {w / 2, h / 2}};
+    }
+}
+
+inline std::vector<plane_size> output_planes(const yv12to422_params_t& p)
+{
+    const int bits = p.output_bits ? p.output_bits : packed_input(p) ? 8 : p.bits;
+    const int w = p.width * sample_size(bits);
+    const int h = p.height;
+    switch (p.output) {
+    case YV12TO422_OUTPUT_YUY2:
+    case YV12TO422_OUTPUT_UYVY:
+        return {{p.width * 2, h}};
+    case YV12TO422_OUTPUT_P216:
+    case YV12TO422_OUTPUT_P210:
+    case YV12TO422_OUTPUT_NV16:
+        return {{w, h}, {w, h}};
+    case YV12TO422_OUTPUT_V210:
+        return {{(p.width + 47) / 48 * 128, h}};
+    case YV12TO422_OUTPUT_YV24:
+        return {{w, h}, {w, h}, {w, h}};
+    case YV12TO422_OUTPUT_RGB32:
+        return {{p.width * 4, h}};
+    case YV12TO422_OUTPUT_RGB24:
+        return {{p.width * 3, h}};
+    default:
+        return {{w, h}, {w / 2, h}, {w / 2, h}};
+    }
+}
+
+
+// xorshift32, the same numbers on every platform.
+class xorshift {
+    uint32_t state;
+public:
+    explicit xorshift(uint32_t seed) : state(seed * 2654435761u | 1) {}
+    uint32_t next()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+};
+
+// random samples of bits (floats in [0, 1)), or random bytes for packed
+// input.
+inline image random_image(const std::vector<plane_size>& planes, int bits, xorshift& rng)
+{
+    image img(planes.size());
+    for (size_t i = 0; i < planes.size(); ++i) {
+        std::vector<uint8_t>& plane = img[i];
+        plane.resize((size_t)planes[i].width * planes[i].height);
+        const int size = sample_size(bits);
+        for (size_t x = 0; x < plane.size(); x += size) {
+            const uint32_t r = rng.next();
+            if (size == 4) {
+                const float f = (r >> 20) / 4096.0f;
+                std::memcpy(&plane[x], &f, 4);
+            } else if (size == 2) {
+                const uint16_t s = (uint16_t)(bits == 16 ? r >> 16 : (r >> 16) & ((1 << bits) - 1));
+                std::memcpy(&plane[x], &s, 2);
+            } else {
+                plane[x] = (uint8_t)(r >> 24);
+            }
+        }
+    }
+    return img;
+}
+
+
+/*
+  count frames of the planes. With step > 0, plane i of frame k starts
+  step * width[i] / luma_width bytes right of that of frame 0 in one buffer
+  (yv12to422_batch_step() layout), otherwise every frame has its own
+  buffers. Pitches are multiples of 64 with a spare 64 bytes, and with
+  misalign the planes start at odd addresses and have odd pitches.
+  The padding is filled with 0xcd.
+*/
+class frames {
+    std::vector<plane_size> sizes;
+    int luma_width;
+    int step;
+    std::vector<uint8_t*> buffers;
+    std::vector<int> pitches;
+    int offset;
+
+    frames(const frames&);
+    frames& operator=(const frames&);
+
+public:
+    const int count;
+
+    frames(const std::vector<plane_size>& planes, int count, int luma_width, int step,
+           bool misalign) :
+        sizes(planes), luma_width(luma_width), step(step), offset(misalign ? 1 : 0),
+        count(count)
+    {
+        const int buffers_per_plane = step > 0 ? 1 : count;
+        for (size_t i = 0; i < sizes.size(); ++i) {
+            const int row = step > 0 ? column(i, step * (count - 1)) + sizes[i].width :
+                            sizes[i].width;
+            const int pitch = (row + 127) / 64 * 64 + (misalign ? 2 * (int)i + 3 : 0);
+            pitches.push_back(pitch);
+            for (int k = 0; k < buffers_per_plane; ++k) {
+                const size_t size = (size_t)pitch * sizes[i].height + 128;
+                uint8_t* buff = (uint8_t*)_mm_malloc(size, 64);
+                std::memset(buff, 0xcd, size);
+                buffers.push_back(buff);
+            }
+        }
+    }
+
+    ~frames()
+    {
+        for (size_t i = 0; i < buffers.size(); ++i) {
+            _mm_free(buffers[i]);
+        }
+    }
+
+    // bytes right of frame 0 of the plane.
+    int column(size_t plane, int columns) const
+    {
+        return (int)((int64_t)columns * sizes[plane].width / luma_width);
+    }
+
+    size_t planes() const { return sizes.size(); }
+
+    int pitch(size_t plane) const { return pitches[plane]; }
+
+    uint8_t* data(int k, size_t plane) const
+    {
+        if (step > 0) {
+            return buffers[plane] + offset + column(plane, step * k);
+        }
+        return buffers[plane * count + k] + offset;
+    }
+
+    void load(int k, const image& img)
+    {
+        for (size_t i = 0; i < sizes.size(); ++i) {
+            for (int y = 0; y < sizes[i].height; ++y) {
+                std::memcpy(data(k, i) + (size_t)y * pitches[i],
+                            &img[i][(size_t)y * sizes[i].width], sizes[i].width);
+            }
+        }
+    }
+
+    image store(int k) const
+    {
+        image img(sizes.size());
+        for (size_t i = 0; i < sizes.size(); ++i) {
+            for (int y = 0; y < sizes[i].height; ++y) {
+                const uint8_t* row = data(k, i) + (size_t)y * pitches[i];
+                img[i].insert(img[i].end(), row, row + sizes[i].width);
+            }
+        }
+        return img;
+    }
+
+    yv12to422_src_t src(int k) const
+    {
+        yv12to422_src_t s = {};
+        for (size_t i = 0; i < sizes.size(); ++i) {
+            s.data[i] = data(k, i);
+            s.pitch[i] = pitches[i];
+        }
+        return s;
+    }
+
+    yv12to422_dst_t dst(int k) const
+    {
+        yv12to422_dst_t d = {};
+        for (size_t i = 0; i < sizes.size(); ++i) {
+            d.data[i] = data(k, i);
+            d.pitch[i] = pitches[i];
+        }
+        return d;
+    }
+};
+
+
+class scratch {
+    void* buff;
+    scratch(const scratch&);
+    scratch& operator=(const scratch&);
+public:
+    explicit scratch(size_t size) : buff(_mm_malloc(size + 64, 64)) {}
+    ~scratch() { _mm_free(buff); }
+    void* get() const { return buff; }
+};
+
+
+enum run_mode {
+    RUN_CONVERT,    // yv12to422_convert() frame by frame
+    RUN_BATCH,      // yv12to422_convert_batch() of all the frames
+    RUN_STREAM,     // bands of 16 rows, pushed 12 source rows at a time
+};
+
+inline void ignore_band(void*, int, int) {}
+
+inline int run(const yv12to422_t& ctx, run_mode mode, const frames& src, const frames& dst)
+{
+    if (mode == RUN_BATCH) {
+        std::vector<yv12to422_src_t> s;
+        std::vector<yv12to422_dst_t> d;
+        for (int k = 0; k < src.count; ++k) {
+            s.push_back(src.src(k));
+            d.push_back(dst.dst(k));
+        }
+        scratch buff(yv12to422_batch_scratch_size(&ctx, src.count));
+        return yv12to422_convert_batch(&ctx, s.data(), d.data(), src.count, buff.get());
+    }
+    for (int k = 0; k < src.count; ++k) {
+        const yv12to422_src_t s = src.src(k);
+        const yv12to422_dst_t d = dst.dst(k);
+        int ret;
+        if (mode == RUN_STREAM) {
+            const int height = ctx.params.height;
+            scratch buff(yv12to422_stream_scratch_size(&ctx, 16));
+            yv12to422_stream_t stream;
+            ret = yv12to422_stream_begin(&stream, &ctx, &s, &d, buff.get(), 16,
+                                         ignore_band, nullptr);
+            for (int rows = 12; ret == YV12TO422_OK && rows < height + 12; rows += 12) {
+                ret = yv12to422_stream_push(&stream, rows < height ? rows : height);
+            }
+        } else {
+            scratch buff(yv12to422_scratch_size(&ctx));
+            ret = yv12to422_convert(&ctx, &s, &d, buff.get());
+        }
+        if (ret != YV12TO422_OK) {
+            return ret;
+        }
+    }
+    return YV12TO422_OK;
+}
+
+
+// the largest difference of the samples of two images, floats when bits
+// is 32.
+inline double difference(const image& a, const image& b, int bits)
+{
+    double diff = 0.0;
+    for (size_t i = 0; i < a.size() && i < b.size(); ++i) {
+        if (a[i].size() != b[i].size()) {
+            return 1e9;
+        }
+        const int size = sample_size(bits);
+        for (size_t x = 0; x < a[i].size(); x += size) {
+            double d;
+            if (size == 4) {
+                float fa, fb;
+                std::memcpy(&fa, &a[i][x], 4);
+                std::memcpy(&fb, &b[i][x], 4);
+                d = std::fabs((double)fa - fb);
+            } else if (size == 2) {
+                uint16_t sa, sb;
+                std::memcpy(&sa, &a[i][x], 2);
+                std::memcpy(&sb, &b[i][x], 2);
+                d = std::abs((int)sa - sb);
+            } else {
+                d = std::abs((int)a[i][x] - b[i][x]);
+            }
+            if (d > diff) {
+                diff = d;
+            }
+        }
+    }
+    return a.size() == b.size() ? diff : 1e9;
+}
+
+} // namespace test
+
+#endif // YV12TO422_TEST_COMMON_H
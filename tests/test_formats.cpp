@@ -0,0 +1,653 @@
+/*
+  test_formats.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+/*
+  The output formats and inputs against small scalar references. V210,
+  P210, YV24, RGB and the yuv to yuv matrix are built from the YV16 output
+  of the same params, so only the packing, the horizontal pass and the
+  arithmetic of the format are checked here (test_modes ties the YV16
+  output of every way of running to the SSE2 one). YV411 and YUY2/UYVY
+  input, and YV422To12 are checked from the source.
+  Integer results must be exact where the format only moves samples, and
+  within 1 of the float formula where it weights them.
+*/
+
+
+#include <algorithm>
+
+#include "test_common.h"
+
+
+// the samples of a plane of bits (uint16_t for 9 to 16, float for 32).
+static std::vector<double> samples(const std::vector<uint8_t>& plane, int bits)
+{
+    const int size = test::sample_size(bits);
+    std::vector<double> s(plane.size() / size);
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (size == 4) {
+            float f;
+            std::memcpy(&f, &plane[i * 4], 4);
+            s[i] = f;
+        } else if (size == 2) {
+            uint16_t v;
+            std::memcpy(&v, &plane[i * 2], 2);
+            s[i] = v;
+        } else {
+            s[i] = plane[i];
+        }
+    }
+    return s;
+}
+
+static std::vector<uint8_t> plane_of(const std::vector<double>& s, int bits)
+{
+    const int size = test::sample_size(bits);
+    std::vector<uint8_t> plane(s.size() * size);
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (size == 4) {
+            const float f = (float)s[i];
+            std::memcpy(&plane[i * 4], &f, 4);
+        } else if (size == 2) {
+            const uint16_t v = (uint16_t)s[i];
+            std::memcpy(&plane[i * 2], &v, 2);
+        } else {
+            plane[i] = (uint8_t)s[i];
+        }
+    }
+    return plane;
+}
+
+static double clip(double x, double max)
+{
+    return x < 0.0 ? 0.0 : x > max ? max : x;
+}
+
+// the Mitchell-Netravali filter of b and c.
+static double mitchell(double x, double b, double c)
+{
+    x = std::fabs(x);
+    if (x < 1.0) {
+        return ((12 - 9 * b - 6 * c) * x * x * x + (-18 + 12 * b + 6 * c) * x * x +
+                (6 - 2 * b)) / 6;
+    }
+    if (x < 2.0) {
+        return ((-b - 6 * c) * x * x * x + (6 * b + 30 * c) * x * x +
+                (-12 * b - 48 * c) * x + (8 * b + 24 * c)) / 6;
+    }
+    return 0.0;
+}
+
+static bool has_simd(int simd)
+{
+    return simd == YV12TO422_SIMD_SSE2 ||
+           (simd == YV12TO422_SIMD_AVX2 && yv12to422_has_avx2()) ||
+           (simd == YV12TO422_SIMD_AVX512 && yv12to422_has_avx512());
+}
+
+
+static test::image convert(const yv12to422_params_t& p, const test::image& src)
+{
+    yv12to422_t ctx;
+    int ret = yv12to422_init(&ctx, &p);
+    TEST_CHECK(ret == YV12TO422_OK, "init of input %d output %d bits %d/%d: %s", p.input,
+               p.output, p.bits, p.output_bits, yv12to422_strerror(ret));
+    test::frames s(test::source_planes(p), 1, p.width, 0, false);
+    test::frames d(test::output_planes(p), 1, p.width, 0, false);
+    s.load(0, src);
+    if (ret == YV12TO422_OK) {
+        ret = test::run(ctx, test::RUN_CONVERT, s, d);
+        TEST_CHECK(ret == YV12TO422_OK, "input %d output %d bits %d/%d: %s", p.input,
+                   p.output, p.bits, p.output_bits, yv12to422_strerror(ret));
+    }
+    return d.store(0);
+}
+
+static yv12to422_params_t params(int width, int height, int bits, int output_bits,
+                                 int itype, int cplace, int interlaced)
+{
+    yv12to422_params_t p;
+    yv12to422_default_params(&p, width, height);
+    p.output = YV12TO422_OUTPUT_YV16;
+    p.bits = bits;
+    p.output_bits = output_bits;
+    p.itype = itype;
+    p.cplace = cplace;
+    p.interlaced = interlaced;
+    return p;
+}
+
+// the source of p and its YV16 output.
+static void yv16(const yv12to422_params_t& p, test::image& src, test::image& out)
+{
+    yv12to422_params_t q = p;
+    q.output = YV12TO422_OUTPUT_YV16;
+    test::xorshift rng(p.width * 7 + p.height + p.bits * 3 + p.itype);
+    src = test::random_image(test::source_planes(q), q.bits, rng);
+    out = convert(q, src);
+}
+
+// the 4:2:2 chroma rows of width samples to 4:4:4, like the horizontal
+// pass of yv24 and rgb: the even columns are co-sited with the chroma
+// samples (hsiting 0) or 1/4 sample right of them (hsiting 1).
+static std::vector<double> upsample(const std::vector<double>& s, int width, int height,
+                                    int itype, int hsiting, bool flt)
+{
+    std::vector<double> out(s.size() * 2);
+    for (int y = 0; y < height; ++y) {
+        const double* row = &s[(size_t)y * width];
+        for (int x = 0; x < width; ++x) {
+            const double c = row[x];
+            const double l = row[std::max(x - 1, 0)];
+            const double r = row[std::min(x + 1, width - 1)];
+            double even = c, odd = c;
+            if (itype > 0 && hsiting == 0) {
+                odd = flt ? (double)(((float)c + (float)r) * 0.5f) : std::floor((c + r + 1) / 2);
+            } else if (itype > 0) {
+                even = flt ? (double)(((float)c * 3 + (float)l) * 0.25f) :
+                       std::floor((3 * c + l + 2) / 4);
+                odd = flt ? (double)(((float)c * 3 + (float)r) * 0.25f) :
+                      std::floor((3 * c + r + 2) / 4);
+            }
+            out[(size_t)y * width * 2 + x * 2] = even;
+            out[(size_t)y * width * 2 + x * 2 + 1] = odd;
+        }
+    }
+    return out;
+}
+
+
+// 10bit yv16 packed into groups of 6 pixels in 4 words, Cb Y Cr Y per
+// pixel pair, 48 pixels in 128 bytes, zeros after the last pixel.
+static void test_v210(int width, int height, int output_bits, int itype)
+{
+    yv12to422_params_t p = params(width, height, output_bits ? 8 : 10, output_bits, itype, 1, 0);
+    test::image src, ref;
+    yv16(p, src, ref);
+    const std::vector<double> y = samples(ref[0], 10);
+    const std::vector<double> u = samples(ref[1], 10);
+    const std::vector<double> v = samples(ref[2], 10);
+
+    const int row_bytes = (width + 47) / 48 * 128;
+    test::image expected(1, std::vector<uint8_t>((size_t)row_bytes * height, 0));
+    for (int r = 0; r < height; ++r) {
+        std::vector<uint32_t> seq;
+        for (int x = 0; x < width; x += 2) {
+            seq.push_back((uint32_t)u[r * width / 2 + x / 2]);
+            seq.push_back((uint32_t)y[r * width + x]);
+            seq.push_back((uint32_t)v[r * width / 2 + x / 2]);
+            seq.push_back((uint32_t)y[r * width + x + 1]);
+        }
+        seq.resize(row_bytes / 4 * 3, 0);
+        for (int i = 0; i < row_bytes / 4; ++i) {
+            const uint32_t word = seq[i * 3] | seq[i * 3 + 1] << 10 | seq[i * 3 + 2] << 20;
+            std::memcpy(&expected[0][(size_t)r * row_bytes + i * 4], &word, 4);
+        }
+    }
+    p.output = YV12TO422_OUTPUT_V210;
+    TEST_CHECK(convert(p, src) == expected, "v210 %dx%d output_bits %d itype %d", width,
+               height, output_bits, itype);
+}
+
+
+// 10bit yv16 in the msbs of 16bit Y and interleaved UV planes.
+static void test_p210(int width, int height, int output_bits, int itype)
+{
+    yv12to422_params_t p = params(width, height, output_bits ? 8 : 10, output_bits, itype, 2, 1);
+    test::image src, ref;
+    yv16(p, src, ref);
+    std::vector<double> y = samples(ref[0], 10);
+    const std::vector<double> u = samples(ref[1], 10);
+    const std::vector<double> v = samples(ref[2], 10);
+    std::vector<double> uv;
+    for (size_t i = 0; i < u.size(); ++i) {
+        uv.push_back(u[i] * 64);
+        uv.push_back(v[i] * 64);
+    }
+    for (size_t i = 0; i < y.size(); ++i) {
+        y[i] *= 64;
+    }
+    const test::image expected = {plane_of(y, 16), plane_of(uv, 16)};
+    p.output = YV12TO422_OUTPUT_P210;
+    TEST_CHECK(convert(p, src) == expected, "p210 %dx%d output_bits %d itype %d", width,
+               height, output_bits, itype);
+}
+
+
+// yv24 upsamples the 4:2:0 chroma horizontally before the vertical pass,
+// so the reference is the yv16 output of a frame twice as wide whose
+// chroma has been upsampled.
+static void test_yv24(int width, int height, int bits, int output_bits, int itype, int hsiting)
+{
+    yv12to422_params_t p = params(width, height, bits, output_bits, itype, 0, 0);
+    p.hsiting = hsiting;
+    test::image src, ref;
+    yv16(p, src, ref);
+    const int out_bits = output_bits ? output_bits : bits;
+    const bool flt = bits == 32;
+    // 8bit x << 8 is 10bit x << 2.
+    const double widen = output_bits == 16 ? 256 : output_bits == 10 ? 4 : 1;
+
+    yv12to422_params_t wide = params(width * 2, height, out_bits, 0, itype, 0, 0);
+    test::image wide_src(1, std::vector<uint8_t>((size_t)width * 2 * height *
+                                                 test::sample_size(out_bits), 0));
+    for (int i = 1; i < 3; ++i) {
+        std::vector<double> s = samples(src[i], bits);
+        for (size_t x = 0; x < s.size(); ++x) {
+            s[x] *= widen;
+        }
+        wide_src.push_back(plane_of(upsample(s, width / 2, height / 2, itype, hsiting, flt),
+                                    out_bits));
+    }
+    const test::image wide_out = convert(wide, wide_src);
+    const test::image expected = {ref[0], wide_out[1], wide_out[2]};
+
+    p.output = YV12TO422_OUTPUT_YV24;
+    const double diff = test::difference(convert(p, src), expected, out_bits);
+    TEST_CHECK(diff <= (flt ? 1e-6 : 0.0), "yv24 %dx%d bits %d/%d itype %d hsiting %d: %g",
+               width, height, bits, output_bits, itype, hsiting, diff);
+}
+
+
+static const double kr[] = {0.299, 0.2126, 0.2627};
+static const double kb[] = {0.114, 0.0722, 0.0593};
+
+// Y'CbCr of matrix and range to R'G'B' in [0, 1].
+static void yuv_to_rgb(int matrix, int full_range, double y, double u, double v, double* rgb)
+{
+    const double r = kr[matrix], b = kb[matrix], g = 1 - r - b;
+    y = full_range ? y / 255 : (y - 16) / 219;
+    u = full_range ? (u - 128) / 255 : (u - 128) / 224;
+    v = full_range ? (v - 128) / 255 : (v - 128) / 224;
+    rgb[0] = y + 2 * (1 - r) * v;
+    rgb[2] = y + 2 * (1 - b) * u;
+    rgb[1] = (y - r * rgb[0] - b * rgb[2]) / g;
+}
+
+static void rgb_to_yuv(int matrix, int full_range, const double* rgb, double* yuv)
+{
+    const double r = kr[matrix], b = kb[matrix], g = 1 - r - b;
+    const double y = r * rgb[0] + g * rgb[1] + b * rgb[2];
+    const double u = (rgb[2] - y) / (2 * (1 - b));
+    const double v = (rgb[0] - y) / (2 * (1 - r));
+    yuv[0] = full_range ? y * 255 : y * 219 + 16;
+    yuv[1] = full_range ? u * 255 + 128 : u * 224 + 128;
+    yuv[2] = full_range ? v * 255 + 128 : v * 224 + 128;
+}
+
+
+// B G R (A) of 8bit full range, within 1 of the float formula.
+static void test_rgb(int width, int height, int itype, int hsiting, int lshift, int matrix,
+                     int full_range, bool rgb24)
+{
+    yv12to422_params_t p = params(width, height, 8, 0, itype, 1, 0);
+    p.hsiting = hsiting;
+    p.lshift = lshift;
+    p.matrix = matrix;
+    p.full_range = full_range;
+    test::image src, ref;
+    yv16(p, src, ref);
+    const std::vector<double> y = samples(ref[0], 8);
+    const std::vector<double> u = upsample(samples(ref[1], 8), width / 2, height, itype,
+                                           hsiting, false);
+    const std::vector<double> v = upsample(samples(ref[2], 8), width / 2, height, itype,
+                                           hsiting, false);
+    p.output = rgb24 ? YV12TO422_OUTPUT_RGB24 : YV12TO422_OUTPUT_RGB32;
+    const test::image out = convert(p, src);
+    const int bpp = rgb24 ? 3 : 4;
+    double diff = 0.0;
+    bool alpha = true;
+    for (size_t i = 0; i < y.size(); ++i) {
+        double rgb[3];
+        yuv_to_rgb(matrix, full_range, y[i], u[i], v[i], rgb);
+        for (int c = 0; c < 3; ++c) {
+            const double expected = clip(rgb[2 - c] * 255, 255);
+            diff = std::max(diff, std::fabs(out[0][i * bpp + c] - expected));
+        }
+        alpha = alpha && (rgb24 || out[0][i * bpp + 3] == 255);
+    }
+    TEST_CHECK(diff <= 1.0 && alpha, "rgb%d %dx%d itype %d hsiting %d lshift %d matrix %d "
+               "full_range %d: %g%s", bpp * 8, width, height, itype, hsiting, lshift, matrix,
+               full_range, diff, alpha ? "" : ", alpha");
+}
+
+
+// yv16 of out_matrix and out_full_range, rounded once from the float
+// formula of the interpolated chroma (the 16bit output of output_bits 16),
+// and yuy2 and uyvy of the same samples.
+static void test_matrix(int width, int height, int matrix, int full_range, int out_matrix,
+                        int out_full_range, int itype)
+{
+    yv12to422_params_t p = params(width, height, 8, 16, itype, 1, 0);
+    p.matrix = matrix;
+    p.full_range = full_range;
+    test::image src, ref;
+    yv16(p, src, ref);
+    const std::vector<double> y = samples(ref[0], 16);
+    const std::vector<double> u = samples(ref[1], 16);
+    const std::vector<double> v = samples(ref[2], 16);
+    p.output_bits = 0;
+    p.out_matrix = out_matrix;
+    p.out_full_range = out_full_range;
+    const test::image out = convert(p, src);
+
+    double diff = 0.0;
+    for (int r = 0; r < height; ++r) {
+        for (int x = 0; x < width; ++x) {
+            const size_t c = (size_t)r * width / 2 + x / 2;
+            double rgb[3], yuv[3];
+            yuv_to_rgb(matrix, full_range, y[(size_t)r * width + x] / 256, u[c] / 256,
+                       v[c] / 256, rgb);
+            rgb_to_yuv(out_matrix, out_full_range, rgb, yuv);
+            diff = std::max(diff, std::fabs(out[0][(size_t)r * width + x] - clip(yuv[0], 255)));
+            if (x % 2 == 0) {
+                diff = std::max(diff, std::fabs(out[1][c] - clip(yuv[1], 255)));
+                diff = std::max(diff, std::fabs(out[2][c] - clip(yuv[2], 255)));
+            }
+        }
+    }
+    TEST_CHECK(diff <= 0.52, "matrix %d/%d to %d/%d %dx%d itype %d: %g", matrix, full_range,
+               out_matrix, out_full_range, width, height, itype, diff);
+
+    for (int uyvy = 0; uyvy < 2; ++uyvy) {
+        test::image packed(1);
+        for (size_t i = 0; i < out[0].size(); i += 2) {
+            const uint8_t pair[] = {out[0][i], out[1][i / 2], out[0][i + 1], out[2][i / 2]};
+            const uint8_t swapped[] = {pair[1], pair[0], pair[3], pair[2]};
+            packed[0].insert(packed[0].end(), uyvy ? swapped : pair, (uyvy ? swapped : pair) + 4);
+        }
+        p.output = uyvy ? YV12TO422_OUTPUT_UYVY : YV12TO422_OUTPUT_YUY2;
+        TEST_CHECK(convert(p, src) == packed, "matrix %d/%d to %d/%d %dx%d itype %d: %s",
+                   matrix, full_range, out_matrix, out_full_range, width, height, itype,
+                   uyvy ? "uyvy" : "yuy2");
+    }
+}
+
+
+// 4:1:1 chroma upsampled horizontally: the even columns are copied, the odd
+// ones are halfway between two source columns.
+static void test_yv411(int width, int height, int bits, int itype)
+{
+    yv12to422_params_t p = params(width, height, bits, 0, itype, 0, 0);
+    p.input = YV12TO422_INPUT_YV411;
+    test::xorshift rng(width + height * 5 + bits);
+    const test::image src = test::random_image(test::source_planes(p), bits, rng);
+    const bool flt = bits == 32;
+    const double max = bits == 32 ? 1e9 : (1 << bits) - 1;
+    const double w0 = mitchell(1.5, p.b, p.c), w1 = mitchell(0.5, p.b, p.c);
+    const int cw = width / 4;
+
+    test::image expected = {src[0]};
+    for (int i = 1; i < 3; ++i) {
+        const std::vector<double> s = samples(src[i], bits);
+        std::vector<double> out(s.size() * 2);
+        for (int y = 0; y < height; ++y) {
+            const double* row = &s[(size_t)y * cw];
+            for (int x = 0; x < cw; ++x) {
+                const double a = row[std::max(x - 1, 0)], b = row[x];
+                const double c = row[std::min(x + 1, cw - 1)], d = row[std::min(x + 2, cw - 1)];
+                double odd = b;
+                if (itype == 1) {
+                    odd = flt ? (b + c) / 2 : std::floor((b + c + 1) / 2);
+                } else if (itype == 2) {
+                    odd = (a + d) * w0 + (b + c) * w1;
+                    odd = flt ? odd : clip(std::floor(odd + 0.5), max);
+                }
+                out[(size_t)y * cw * 2 + x * 2] = b;
+                out[(size_t)y * cw * 2 + x * 2 + 1] = odd;
+            }
+        }
+        expected.push_back(plane_of(out, bits));
+    }
+    // the rounding of the taps, and the float ones of the kernels.
+    const double tolerance = flt ? 1e-5 : itype == 2 ? 1.0 : 0.0;
+    const test::image out = convert(p, src);
+    const double diff = test::difference(out, expected, bits);
+    TEST_CHECK(diff <= tolerance, "yv411 %dx%d bits %d itype %d: %g", width, height, bits,
+               itype, diff);
+    if (bits == 8) {
+        test::image packed(1);
+        for (size_t i = 0; i < out[0].size(); i += 2) {
+            const uint8_t pair[] = {out[0][i], out[1][i / 2], out[0][i + 1], out[2][i / 2]};
+            packed[0].insert(packed[0].end(), pair, pair + 4);
+        }
+        p.output = YV12TO422_OUTPUT_YUY2;
+        TEST_CHECK(convert(p, src) == packed, "yv411 %dx%d itype %d: yuy2", width, height,
+                   itype);
+    }
+}
+
+
+// yuy2 and uyvy unpacked to yv16, lshift moves the chroma 1/4 sample left.
+static void test_packed_input(int width, int height, bool uyvy, int lshift)
+{
+    yv12to422_params_t p = params(width, height, 8, 0, 0, 0, 0);
+    p.input = uyvy ? YV12TO422_INPUT_UYVY : YV12TO422_INPUT_YUY2;
+    p.lshift = lshift;
+    test::xorshift rng(width + height + lshift);
+    const test::image src = test::random_image(test::source_planes(p), 8, rng);
+    const int cw = width / 2;
+    test::image expected(3);
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* row = &src[0][(size_t)y * width * 2];
+        for (int x = 0; x < width; ++x) {
+            expected[0].push_back(row[x * 2 + (uyvy ? 1 : 0)]);
+        }
+        for (int i = 1; i < 3; ++i) {
+            const int offset = (uyvy ? 0 : 1) + (i - 1) * 2;
+            for (int x = 0; x < cw; ++x) {
+                const int c = row[x * 4 + offset], l = row[std::max(x - 1, 0) * 4 + offset];
+                expected[i].push_back((uint8_t)(lshift ? (3 * c + l + 2) >> 2 : c));
+            }
+        }
+    }
+    TEST_CHECK(convert(p, src) == expected, "%s input %dx%d lshift %d", uyvy ? "uyvy" : "yuy2",
+               width, height, lshift);
+}
+
+
+/*
+  YV422To12. Output row k of a chroma plane lies at pos (in 4:2:2 rows of
+  its field) by the readme: progressive 2k (cplace 0, 2) or 2k + 0.5
+  (cplace 1, 3), interlaced 2j for cplace 0, 2j + 0.5 for 1, 2j + 0.25 or
+  + 0.75 (top or bottom field) for 2, and 2j (U) or 2j + 1 (V) for dv pal.
+  itype 0 takes the nearest row, 1 interpolates the two rows around pos,
+  and 2 weights the rows around pos by the cubic filter stretched to the
+  4:2:0 rows, normalized.
+*/
+static void test_yv422to12(int width, int height, int output, int simd, int unaligned,
+                           int interlaced, int cplace, int itype)
+{
+    yv12to422_params_t p;
+    yv12to422_default_params(&p, width, height);
+    p.output = output;
+    p.simd = simd;
+    p.unaligned = unaligned;
+    p.interlaced = interlaced;
+    p.cplace = cplace;
+    p.itype = itype;
+    p.b = 1.0 / 3;
+    p.c = 1.0 / 3;
+    yv422to12_t ctx;
+    int ret = yv422to12_init(&ctx, &p);
+    if (unaligned && ret == YV12TO422_ERR_INVALID_SIZE) {
+        return;
+    }
+    char name[128];
+    std::snprintf(name, sizeof(name), "yv422to12 %dx%d output %d simd %d unaligned %d "
+                  "interlaced %d cplace %d itype %d", width, height, output, simd, unaligned,
+                  interlaced, cplace, itype);
+    TEST_CHECK(ret == YV12TO422_OK, "%s: init: %s", name, yv12to422_strerror(ret));
+    if (ret != YV12TO422_OK) {
+        return;
+    }
+
+    const int cw = width / 2;
+    const bool packed = output != YV12TO422_OUTPUT_YV16;
+    const bool uyvy = output == YV12TO422_OUTPUT_UYVY;
+    test::xorshift rng(width * 3 + height + output);
+    std::vector<test::plane_size> in;
+    if (packed) {
+        in = {{width * 2, height}};
+    } else {
+        in = {{width, height}, {cw, height}, {cw, height}};
+    }
+    const test::image src = test::random_image(in, 8, rng);
+    // the planes of the source.
+    std::vector<uint8_t> y, u, v;
+    if (packed) {
+        for (size_t i = 0; i < src[0].size(); i += 4) {
+            y.push_back(src[0][i + (uyvy ? 1 : 0)]);
+            y.push_back(src[0][i + (uyvy ? 3 : 2)]);
+            u.push_back(src[0][i + (uyvy ? 0 : 1)]);
+            v.push_back(src[0][i + (uyvy ? 2 : 3)]);
+        }
+    } else {
+        y = src[0];
+        u = src[1];
+        v = src[2];
+    }
+
+    const bool field = interlaced || cplace > 1;
+    double diff = 0.0;
+    test::image expected = {y, {}, {}};
+    for (int k = 0; k < height / 2; ++k) {
+        for (int i = 1; i < 3; ++i) {
+            const std::vector<uint8_t>& plane = i == 1 ? u : v;
+            const int parity = field ? k % 2 : 0;
+            const int j = field ? k / 2 : k;
+            const int rows = field ? height / 2 : height;
+            double pos;
+            if (!interlaced) {
+                pos = 2 * j + (cplace % 2 ? 0.5 : 0.0);
+            } else {
+                pos = cplace == 0 ? 2 * j : cplace == 1 ? 2 * j + 0.5 :
+                      cplace == 2 ? 2 * j + (parity ? 0.75 : 0.25) : 2 * j + (i == 2 ? 1 : 0);
+            }
+            const int floor_pos = (int)std::floor(pos);
+            for (int x = 0; x < cw; ++x) {
+                auto at = [&](int r) {
+                    r = std::min(std::max(r, 0), rows - 1);
+                    return (double)plane[(size_t)(field ? 2 * r + parity : r) * cw + x];
+                };
+                double s;
+                if (itype == 0) {
+                    s = at((int)std::ceil(pos - 0.5));
+                } else if (itype == 1) {
+                    const double q = pos - floor_pos;
+                    s = std::floor(at(floor_pos) * (1 - q) + at(floor_pos + 1) * q + 0.5);
+                } else {
+                    double total = 0.0, weights = 0.0;
+                    for (int t = floor_pos - 3; t <= floor_pos + 4; ++t) {
+                        const double w = mitchell((t - pos) / 2, p.b, p.c);
+                        total += w * at(t);
+                        weights += w;
+                    }
+                    s = clip(std::floor(total / weights + 0.5), 255);
+                }
+                expected[i].push_back((uint8_t)s);
+            }
+        }
+    }
+
+    test::frames s(in, 1, width, 0, unaligned != 0);
+    test::frames d({{width, height}, {cw, height / 2}, {cw, height / 2}}, 1, width, 0,
+                   unaligned != 0);
+    s.load(0, src);
+    const yv12to422_src_t sp = s.src(0);
+    const yv12to422_dst_t dp = d.dst(0);
+    ret = yv422to12_convert(&ctx, &sp, &dp);
+    TEST_CHECK(ret == YV12TO422_OK, "%s: %s", name, yv12to422_strerror(ret));
+    diff = test::difference(d.store(0), expected, 8);
+    // the rounding of the cubic taps.
+    TEST_CHECK(diff <= (itype == 2 ? 1.0 : 0.0), "%s: %g", name, diff);
+}
+
+
+int main()
+{
+    const int sizes[][2] = {{180, 36}, {64, 16}, {100, 16}};
+    for (const auto& size : sizes) {
+        const int w = size[0], h = size[1];
+        for (int itype = 0; itype < 3; ++itype) {
+            test_v210(w, h, 0, itype);
+            test_v210(w, h, 10, itype);
+            test_p210(w, h, 0, itype);
+            test_p210(w, h, 10, itype);
+            for (int hsiting = 0; hsiting < 2; ++hsiting) {
+                test_yv24(w, h, 8, 0, itype, hsiting);
+                test_yv24(w, h, 8, 16, itype, hsiting);
+                test_yv24(w, h, 12, 0, itype, hsiting);
+                test_yv24(w, h, 32, 0, itype, hsiting);
+                for (int matrix = 0; matrix < 3; ++matrix) {
+                    for (int full_range = 0; full_range < 2; ++full_range) {
+                        test_rgb(w, h, itype, hsiting, hsiting, matrix, full_range, false);
+                        test_rgb(w, h, itype, hsiting, 1 - hsiting, matrix, full_range, true);
+                    }
+                }
+            }
+            test_matrix(w, h, 0, 0, 1, 0, itype);
+            test_matrix(w, h, 1, 0, 0, 0, itype);
+            test_matrix(w, h, 2, 1, 1, 0, itype);
+            test_matrix(w, h, 0, 0, 0, 1, itype);
+            test_matrix(w, h, 1, 1, 2, 1, itype);
+            if (w % 4 == 0) {
+                for (int bits : {8, 10, 16, 32}) {
+                    test_yv411(w, h, bits, itype);
+                }
+            }
+        }
+        for (int lshift = 0; lshift < 2; ++lshift) {
+            test_packed_input(w, h, false, lshift);
+            test_packed_input(w, h, true, lshift);
+        }
+    }
+    // rgb is converted in bands of 64 rows, the last one is short here.
+    for (int itype = 0; itype < 3; ++itype) {
+        test_rgb(100, 148, itype, 0, 0, 1, 0, false);
+        test_rgb(100, 148, itype, 1, 1, 0, 1, true);
+    }
+
+    const int rev_sizes[][2] = {{34, 16}, {130, 20}, {262, 36}};
+    const int outputs[] = {YV12TO422_OUTPUT_YV16, YV12TO422_OUTPUT_YUY2, YV12TO422_OUTPUT_UYVY};
+    for (const auto& size : rev_sizes) {
+        for (int output : outputs) {
+            for (int simd = YV12TO422_SIMD_SSE2; simd <= YV12TO422_SIMD_AVX512; ++simd) {
+                if (!has_simd(simd)) {
+                    continue;
+                }
+                for (int unaligned = 0; unaligned < 2; ++unaligned) {
+                    for (int interlaced = 0; interlaced < 2; ++interlaced) {
+                        for (int cplace = 0; cplace < 4; ++cplace) {
+                            for (int itype = 0; itype < 3; ++itype) {
+                                test_yv422to12(size[0], size[1], output, simd, unaligned,
+                                               interlaced, cplace, itype);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return test::finish("formats");
+}
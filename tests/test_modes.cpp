@@ -0,0 +1,237 @@
+/*
+  test_modes.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+/*
+  Every way of running a conversion against yv12to422_convert() of the
+  same frames with SSE2 and aligned planes: AVX2 and AVX512, unaligned
+  planes, yv12to422_convert_batch() of frames side by side and of separate
+  frames, band streaming, narrow mode and 2 threads. Integer samples must
+  be identical, float samples may differ by the fused multiply-adds of the
+  wider kernels.
+*/
+
+
+#include "test_common.h"
+
+
+struct format {
+    int input;
+    int bits;
+    int output;
+    int output_bits;
+    int lshift;
+    int out_matrix;
+};
+
+static const format formats[] = {
+    {YV12TO422_INPUT_YV12, 8, YV12TO422_OUTPUT_YV16, 0, 0, -1},
+    {YV12TO422_INPUT_YV12, 8, YV12TO422_OUTPUT_YV16, 0, 1, -1},
+    {YV12TO422_INPUT_YV12, 8, YV12TO422_OUTPUT_YUY2, 0, 0, -1},
+    {YV12TO422_INPUT_YV12, 8, YV12TO422_OUTPUT_UYVY, 0, 1, -1},
+    {YV12TO422_INPUT_YV12, 8, YV12TO422_OUTPUT_NV16, 0, 0, -1},
+    {YV12TO422_INPUT_YV12, 10, YV12TO422_OUTPUT_YV16, 0, 0, -1},
+    {YV12TO422_INPUT_YV12, 12, YV12TO422_OUTPUT_YV16, 0, 1, -1},
+    {YV12TO422_INPUT_YV12, 16, YV12TO422_OUTPUT_P216, 0, 0, -1},
+    {YV12TO422_INPUT_YV12, 10, YV12TO422_OUTPUT_P210, 0, 0, -1},
+    {YV12TO422_INPUT_YV12, 10, YV12TO422_OUTPUT_V210, 0, 0, -1},
+    {YV12TO422_INPUT_YV12, 32, YV12TO422_OUTPUT_YV16, 0, 0, -1},
+    {YV12TO422_INPUT_YV12, 32, YV12TO422_OUTPUT_YV16, 0, 1, -1},
+    {YV12TO422_INPUT_YV12, 8, YV12TO422_OUTPUT_YV16, 16, 0, -1},
+    {YV12TO422_INPUT_YV12, 8, YV12TO422_OUTPUT_P210, 10, 0, -1},
+    {YV12TO422_INPUT_YV12, 8, YV12TO422_OUTPUT_V210, 10, 1, -1},
+    {YV12TO422_INPUT_YV12, 8, YV12TO422_OUTPUT_YV24, 0, 0, -1},
+    {YV12TO422_INPUT_YV12, 16, YV12TO422_OUTPUT_YV24, 0, 0, -1},
+    {YV12TO422_INPUT_YV12, 32, YV12TO422_OUTPUT_YV24, 0, 0, -1},
+    {YV12TO422_INPUT_YV12, 8, YV12TO422_OUTPUT_RGB32, 0, 0, -1},
+    {YV12TO422_INPUT_YV12, 8, YV12TO422_OUTPUT_RGB24, 0, 1, -1},
+    {YV12TO422_INPUT_YV12, 8, YV12TO422_OUTPUT_YV16, 0, 0, YV12TO422_MATRIX_BT709},
+    {YV12TO422_INPUT_YV12, 8, YV12TO422_OUTPUT_YUY2, 0, 1, YV12TO422_MATRIX_BT2020},
+    {YV12TO422_INPUT_NV12, 8, YV12TO422_OUTPUT_YV16, 0, 0, -1},
+    {YV12TO422_INPUT_NV12, 8, YV12TO422_OUTPUT_NV16, 0, 1, -1},
+    {YV12TO422_INPUT_NV12, 8, YV12TO422_OUTPUT_YUY2, 0, 0, -1},
+    {YV12TO422_INPUT_NV12, 16, YV12TO422_OUTPUT_P216, 0, 0, -1},
+    {YV12TO422_INPUT_NV12, 10, YV12TO422_OUTPUT_P210, 0, 0, -1},
+    {YV12TO422_INPUT_YV411, 8, YV12TO422_OUTPUT_YV16, 0, 0, -1},
+    {YV12TO422_INPUT_YV411, 8, YV12TO422_OUTPUT_YUY2, 0, 0, -1},
+    {YV12TO422_INPUT_YV411, 16, YV12TO422_OUTPUT_YV16, 0, 0, -1},
+    {YV12TO422_INPUT_YV411, 32, YV12TO422_OUTPUT_YV16, 0, 0, -1},
+    {YV12TO422_INPUT_YUY2, 8, YV12TO422_OUTPUT_YV16, 0, 0, -1},
+    {YV12TO422_INPUT_UYVY, 8, YV12TO422_OUTPUT_YV16, 0, 1, -1},
+};
+
+// itype, cplace, interlaced.
+static const int kernels[][3] = {
+    {0, 0, 0}, {1, 1, 0}, {1, 2, 1}, {2, 0, 0}, {2, 1, 1}, {2, 2, 1}, {2, 3, 0}, {2, 3, 1},
+};
+
+
+static const char* mode_names[] = {"convert", "batch", "stream"};
+
+
+static void test_format(const format& f, const int* kernel, int width, int height)
+{
+    yv12to422_params_t rp;
+    yv12to422_default_params(&rp, width, height);
+    rp.input = f.input;
+    rp.bits = f.bits;
+    rp.output = f.output;
+    rp.output_bits = f.output_bits;
+    rp.lshift = f.lshift;
+    rp.out_matrix = f.out_matrix;
+    rp.itype = kernel[0];
+    rp.cplace = kernel[1];
+    rp.interlaced = kernel[2];
+    rp.hsiting = kernel[1] & 1;
+    rp.simd = YV12TO422_SIMD_SSE2;
+    if (f.input == YV12TO422_INPUT_NV12 && rp.interlaced && rp.cplace == 3) {
+        // nv12 takes no dv pal placement.
+        return;
+    }
+
+    char name[160];
+    std::snprintf(name, sizeof(name), "input %d bits %d output %d/%d lshift %d matrix %d "
+                  "itype %d cplace %d interlaced %d %dx%d", f.input, f.bits, f.output,
+                  f.output_bits, f.lshift, f.out_matrix, rp.itype, rp.cplace, rp.interlaced,
+                  width, height);
+
+    yv12to422_t ref;
+    int ret = yv12to422_init(&ref, &rp);
+    TEST_CHECK(ret == YV12TO422_OK, "%s: init: %s", name, yv12to422_strerror(ret));
+    if (ret != YV12TO422_OK) {
+        return;
+    }
+
+    const int count = 3;
+    const std::vector<test::plane_size> in = test::source_planes(rp);
+    const std::vector<test::plane_size> out = test::output_planes(rp);
+    const int out_bits = rp.output == YV12TO422_OUTPUT_V210 ? 8 :
+                         f.output_bits ? f.output_bits : f.bits;
+    const bool flt = f.bits == 32;
+    test::xorshift rng(width * 131 + height + f.bits * 7 + f.output);
+    std::vector<test::image> images;
+    std::vector<test::image> expected;
+    {
+        test::frames src(in, count, width, 0, false);
+        test::frames dst(out, count, width, 0, false);
+        for (int k = 0; k < count; ++k) {
+            images.push_back(test::random_image(in, test::packed_input(rp) ? 8 : f.bits, rng));
+            src.load(k, images[k]);
+        }
+        ret = test::run(ref, test::RUN_CONVERT, src, dst);
+        TEST_CHECK(ret == YV12TO422_OK, "%s: reference: %s", name, yv12to422_strerror(ret));
+        for (int k = 0; k < count; ++k) {
+            expected.push_back(dst.store(k));
+        }
+    }
+
+    // v210 and rgb output is not side by side, see side_by_side().
+    const bool out_side_by_side = rp.output != YV12TO422_OUTPUT_V210 &&
+                                  rp.output != YV12TO422_OUTPUT_RGB32 &&
+                                  rp.output != YV12TO422_OUTPUT_RGB24;
+
+    for (int simd = YV12TO422_SIMD_SSE2; simd <= YV12TO422_SIMD_AVX512; ++simd) {
+        if ((simd == YV12TO422_SIMD_AVX2 && !yv12to422_has_avx2()) ||
+            (simd == YV12TO422_SIMD_AVX512 && !yv12to422_has_avx512())) {
+            continue;
+        }
+        for (int variant = 0; variant < 8; ++variant) {
+            // 0 convert, 1 batch side by side, 2 batch of separate frames,
+            // 3 stream, 4 narrow convert, 5 narrow batch, 6 2 threads,
+            // 7 2 threads batch. all of them aligned and unaligned.
+            for (int unaligned = 0; unaligned < 2; ++unaligned) {
+                if (variant >= 4 && variant <= 5 && unaligned) {
+                    continue;
+                }
+                yv12to422_params_t p = rp;
+                p.simd = simd;
+                p.unaligned = unaligned;
+                p.narrow = variant == 4 || variant == 5;
+                p.threads = variant >= 6 ? 2 : 1;
+                yv12to422_t ctx;
+                ret = yv12to422_init(&ctx, &p);
+                if (unaligned && ret == YV12TO422_ERR_INVALID_SIZE) {
+                    // chroma rows shorter than a vector
+                    continue;
+                }
+                TEST_CHECK(ret == YV12TO422_OK, "%s simd %d unaligned %d: init: %s", name, simd,
+                           unaligned, yv12to422_strerror(ret));
+                if (ret != YV12TO422_OK) {
+                    continue;
+                }
+                const test::run_mode mode = variant == 3 ? test::RUN_STREAM :
+                                            variant == 1 || variant == 2 || variant == 5 ||
+                                            variant == 7 ? test::RUN_BATCH :
+                                            test::RUN_CONVERT;
+                const int step = variant == 1 || variant == 5 || variant == 7 ?
+                                 yv12to422_batch_step(&ctx) : 0;
+                test::frames src(in, count, width, step, unaligned != 0);
+                test::frames dst(out, count, width, out_side_by_side ? step : 0,
+                                 unaligned != 0);
+                for (int k = 0; k < count; ++k) {
+                    src.load(k, images[k]);
+                }
+                ret = test::run(ctx, mode, src, dst);
+                TEST_CHECK(ret == YV12TO422_OK, "%s simd %d unaligned %d variant %d: %s", name,
+                           simd, unaligned, variant, yv12to422_strerror(ret));
+                for (int k = 0; k < count && ret == YV12TO422_OK; ++k) {
+                    const double diff = test::difference(dst.store(k), expected[k], out_bits);
+                    TEST_CHECK(diff <= (flt ? 1e-5 : 0.0),
+                               "%s simd %d unaligned %d variant %d (%s): frame %d differs by %g",
+                               name, simd, unaligned, variant, mode_names[mode], k, diff);
+                }
+            }
+        }
+    }
+}
+
+
+// params of another layout are rejected, not misread.
+static void test_abi_version()
+{
+    yv12to422_params_t p;
+    yv12to422_default_params(&p, 64, 16);
+    yv12to422_t ctx;
+    TEST_CHECK(yv12to422_init(&ctx, &p) == YV12TO422_OK, "abi: default params");
+    p.abi_version = YV12TO422_ABI_VERSION + 1;
+    TEST_CHECK(yv12to422_init(&ctx, &p) == YV12TO422_ERR_INVALID_PARAM,
+               "abi: params of another version");
+    yv422to12_t rctx;
+    TEST_CHECK(yv422to12_init(&rctx, &p) == YV12TO422_ERR_INVALID_PARAM,
+               "abi: yv422to12 params of another version");
+}
+
+
+int main()
+{
+    test_abi_version();
+    const int sizes[][2] = {{64, 16}, {180, 36}, {36, 64}};
+    for (const auto& f : formats) {
+        for (const auto& kernel : kernels) {
+            for (const auto& size : sizes) {
+                test_format(f, kernel, size[0], size[1]);
+            }
+        }
+    }
+    return test::finish("modes");
+}
@@ -0,0 +1,235 @@
+/*
+  test_shm_daemon.cpp
+
+  This file is part of YV12To422
+
+  Copyright (C) 2015 OKA Motofumi
+
+  Author: OKA Motofumi (chikuzen.mo at gmail dot com)
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+*/
+
+/*
+  The conversion daemon (--daemon) run as a process, with this test as its
+  client through shm_ring.cpp: yv16 and yuy2 requests against
+  yv12to422_convert() of the same frames, and requests whose planes lie
+  outside of their slot, or which are larger than --size, rejected without
+  stopping the daemon.
+  usage: test_shm_daemon <yv12to422 binary>
+*/
+
+
+#include <cmath>
+#include <csignal>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "shm_ring.h"
+#include "test_common.h"
+
+
+static const int MAX_WIDTH = 96;
+static const int MAX_HEIGHT = 48;
+
+
+static shm_request request(int width, int height, int output)
+{
+    shm_request req = {};
+    req.width = width;
+    req.height = height;
+    req.itype = 2;
+    req.cplace = 1;
+    req.c = 0.75;
+    req.output = output;
+    return req;
+}
+
+// rows of width bytes from img to the plane at offset of the slot, or back.
+static void put_plane(uint8_t* data, uint64_t offset, int pitch, const std::vector<uint8_t>& img,
+                      int width)
+{
+    for (size_t y = 0; y * width < img.size(); ++y) {
+        std::memcpy(data + offset + y * pitch, &img[y * width], width);
+    }
+}
+
+static std::vector<uint8_t> get_plane(const uint8_t* data, uint64_t offset, int pitch,
+                                      int width, int height)
+{
+    std::vector<uint8_t> plane;
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* row = data + offset + (size_t)y * pitch;
+        plane.insert(plane.end(), row, row + width);
+    }
+    return plane;
+}
+
+
+// a random frame through the daemon and through the library.
+static void test_convert(shm_client& client, int width, int height, int output)
+{
+    shm_request req = request(width, height, output);
+    TEST_CHECK(shm_set_layout(req, client.slot_size()), "%dx%d does not fit", width, height);
+
+    yv12to422_params_t p;
+    yv12to422_default_params(&p, width, height);
+    p.output = output;
+    test::xorshift rng(width + height * 3 + output);
+    const test::image src = test::random_image(test::source_planes(p), 8, rng);
+
+    const uint32_t slot = client.acquire();
+    uint8_t* data = client.data(slot);
+    client.request(slot) = req;
+    for (int i = 0; i < 3; ++i) {
+        put_plane(data, req.src[i], req.src_pitch[i], src[i], i == 0 ? width : width / 2);
+    }
+    client.submit(slot);
+    const int status = client.wait(slot);
+    TEST_CHECK(status == YV12TO422_OK, "%dx%d output %d: %s", width, height, output,
+               yv12to422_strerror(status));
+
+    test::image out;
+    if (output == YV12TO422_OUTPUT_YV16) {
+        for (int i = 0; i < 3; ++i) {
+            out.push_back(get_plane(data, req.dst[i], req.dst_pitch[i],
+                                    i == 0 ? width : width / 2, height));
+        }
+    } else {
+        out.push_back(get_plane(data, req.dst[0], req.dst_pitch[0], width * 2, height));
+    }
+    client.release(slot);
+
+    yv12to422_t ctx;
+    yv12to422_init(&ctx, &p);
+    test::frames s(test::source_planes(p), 1, width, 0, false);
+    test::frames d(test::output_planes(p), 1, width, 0, false);
+    s.load(0, src);
+    test::run(ctx, test::RUN_CONVERT, s, d);
+    TEST_CHECK(out == d.store(0), "%dx%d output %d: the frame differs from the library",
+               width, height, output);
+}
+
+
+// the status of req, whose planes are left as they are in the slot.
+static int submit(shm_client& client, const shm_request& req)
+{
+    const uint32_t slot = client.acquire();
+    client.request(slot) = req;
+    client.submit(slot);
+    const int status = client.wait(slot);
+    client.release(slot);
+    return status;
+}
+
+static void test_rejected(shm_client& client)
+{
+    const size_t slot_size = client.slot_size();
+    for (int output : {YV12TO422_OUTPUT_YV16, YV12TO422_OUTPUT_YUY2}) {
+        shm_request good = request(MAX_WIDTH, MAX_HEIGHT, output);
+        shm_set_layout(good, slot_size);
+
+        shm_request r = good;
+        r.src[1] = slot_size;
+        TEST_CHECK(submit(client, r) == YV12TO422_ERR_INVALID_SIZE,
+                   "output %d: U plane after the slot", output);
+        r = good;
+        r.src[2] = slot_size - MAX_WIDTH / 2;
+        TEST_CHECK(submit(client, r) == YV12TO422_ERR_INVALID_SIZE,
+                   "output %d: V plane across the end of the slot", output);
+        r = good;
+        r.src[0] = UINT64_MAX - 16;
+        TEST_CHECK(submit(client, r) == YV12TO422_ERR_INVALID_SIZE,
+                   "output %d: wrapping luma offset", output);
+        r = good;
+        r.dst[output == YV12TO422_OUTPUT_YV16 ? 2 : 0] = slot_size;
+        TEST_CHECK(submit(client, r) == YV12TO422_ERR_INVALID_SIZE,
+                   "output %d: destination after the slot", output);
+        r = good;
+        r.src_pitch[1] = -MAX_WIDTH / 2;
+        TEST_CHECK(submit(client, r) == YV12TO422_ERR_INVALID_SIZE,
+                   "output %d: negative pitch", output);
+        r = good;
+        r.src_pitch[0] = MAX_WIDTH - 2;
+        TEST_CHECK(submit(client, r) == YV12TO422_ERR_INVALID_SIZE,
+                   "output %d: pitch shorter than the row", output);
+    }
+
+    shm_request r = request(MAX_WIDTH + 16, MAX_HEIGHT, YV12TO422_OUTPUT_YV16);
+    TEST_CHECK(shm_set_layout(r, 1 << 30), "layout");
+    TEST_CHECK(submit(client, r) == YV12TO422_ERR_INVALID_PARAM, "wider than --size");
+    r = request(MAX_WIDTH, MAX_HEIGHT, YV12TO422_OUTPUT_YV16);
+    shm_set_layout(r, slot_size);
+    r.b = NAN;
+    TEST_CHECK(submit(client, r) == YV12TO422_ERR_INVALID_PARAM, "b of NaN");
+}
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::printf("usage: test_shm_daemon <yv12to422>\n");
+        return 1;
+    }
+    const std::string name = "/yv12to422_test_" + std::to_string(getpid());
+    const std::string size = std::to_string(MAX_WIDTH) + "x" + std::to_string(MAX_HEIGHT);
+
+    const pid_t pid = fork();
+    if (pid == 0) {
+        execl(argv[1], argv[1], "--daemon", "--shm", name.c_str(), "--size", size.c_str(),
+              "--slots", "2", "--jobs", "2", (char*)nullptr);
+        _exit(127);
+    }
+    TEST_CHECK(pid > 0, "fork failed");
+    if (pid < 0) {
+        return test::finish("shm_daemon");
+    }
+
+    // the ring is ready when the client can map it.
+    shm_client* client = nullptr;
+    for (int i = 0; i < 500 && !client; ++i) {
+        try {
+            client = new shm_client(name.c_str());
+        } catch (std::runtime_error&) {
+            usleep(10000);
+        }
+    }
+    TEST_CHECK(client, "the daemon did not start");
+    if (client) {
+        test_convert(*client, MAX_WIDTH, MAX_HEIGHT, YV12TO422_OUTPUT_YV16);
+        test_convert(*client, MAX_WIDTH, MAX_HEIGHT, YV12TO422_OUTPUT_YUY2);
+        test_rejected(*client);
+        // still serving after the rejected requests.
+        test_convert(*client, 64, 32, YV12TO422_OUTPUT_UYVY);
+        test_convert(*client, MAX_WIDTH, MAX_HEIGHT, YV12TO422_OUTPUT_YV16);
+        delete client;
+    }
+
+    kill(pid, SIGTERM);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    TEST_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0, "exit status of the daemon");
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    TEST_CHECK(fd < 0, "the shared memory object is left");
+    if (fd >= 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+    }
+    return test::finish("shm_daemon");
+}